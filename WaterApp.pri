@@ -0,0 +1,137 @@
+# Sources shared by the viewer (WaterApp.pro) and the benchmark (WaterBench.pro).
+
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+QMAKE_CXXFLAGS += -std=c++11
+QMAKE_LFLAGS += -L/usr/local/lib -L/usr/lib64 -lvulkan -lglfw -pthread -lGLEW -lGLU -lGL -lrt -lXrandr -lXxf86vm -lXi -lXinerama -lX11
+
+SOURCES += \
+        $$PWD/assetStreamer.cpp \
+        $$PWD/commandRecorder.cpp \
+        $$PWD/cpuFft.cpp \
+        $$PWD/cpuOcean.cpp \
+        $$PWD/cpuWaterSolver.cpp \
+        $$PWD/createApp.cpp \
+        $$PWD/descriptorCache.cpp \
+        $$PWD/deviceAllocator.cpp \
+        $$PWD/floatingObjects.cpp \
+        $$PWD/frameConstants.cpp \
+        $$PWD/framePacer.cpp \
+        $$PWD/gpuCuller.cpp \
+        $$PWD/gpuMesh.cpp \
+        $$PWD/oceanFft.cpp \
+        $$PWD/oceanSpectrum.cpp \
+        $$PWD/particleSystem.cpp \
+        $$PWD/pipelineCache.cpp \
+        $$PWD/profiler.cpp \
+        $$PWD/renderGraph.cpp \
+        $$PWD/renderPassBuilder.cpp \
+        $$PWD/resolutionController.cpp \
+        $$PWD/stagingRing.cpp \
+        $$PWD/threadPool.cpp \
+        $$PWD/vkUtils.cpp \
+        $$PWD/waterLod.cpp \
+        $$PWD/waterReflections.cpp \
+        $$PWD/waterSimulation.cpp
+
+HEADERS += \
+    $$PWD/assetStreamer.hpp \
+    $$PWD/commandRecorder.hpp \
+    $$PWD/cpuFft.hpp \
+    $$PWD/cpuOcean.hpp \
+    $$PWD/cpuWaterSolver.hpp \
+    $$PWD/createApp.hpp \
+    $$PWD/descriptorCache.hpp \
+    $$PWD/deviceAllocator.hpp \
+    $$PWD/floatingObjects.hpp \
+    $$PWD/frameConstants.hpp \
+    $$PWD/framePacer.hpp \
+    $$PWD/gpuCuller.hpp \
+    $$PWD/gpuMesh.hpp \
+    $$PWD/oceanFft.hpp \
+    $$PWD/oceanSpectrum.hpp \
+    $$PWD/particleSystem.hpp \
+    $$PWD/pipelineCache.hpp \
+    $$PWD/profiler.hpp \
+    $$PWD/renderGraph.hpp \
+    $$PWD/renderPassBuilder.hpp \
+    $$PWD/resolutionController.hpp \
+    $$PWD/stagingRing.hpp \
+    $$PWD/threadPool.hpp \
+    $$PWD/vkUtils.hpp \
+    $$PWD/waterLod.hpp \
+    $$PWD/waterReflections.hpp \
+    $$PWD/waterSimulation.hpp
+
+OTHER_FILES += \
+    $$PWD/shaders/vertex.vert \
+    $$PWD/shaders/fragment.frag \
+    $$PWD/shaders/waterLod.vert \
+    $$PWD/shaders/waterSim.comp \
+    $$PWD/shaders/cull.comp \
+    $$PWD/shaders/floating.vert \
+    $$PWD/shaders/floating.frag \
+    $$PWD/shaders/particleEmit.comp \
+    $$PWD/shaders/particleUpdate.comp \
+    $$PWD/shaders/particleSort.comp \
+    $$PWD/shaders/particle.vert \
+    $$PWD/shaders/particle.frag \
+    $$PWD/shaders/oceanSpectrum.comp \
+    $$PWD/shaders/oceanFft.comp \
+    $$PWD/shaders/oceanResolve.comp \
+    $$PWD/shaders/hiz.comp \
+    $$PWD/shaders/sky.comp \
+    $$PWD/shaders/frame.glsl
+
+# SPIR-V. The application loads ../WaterApp/shaders/<name>.spv from the build directory, so every binary is
+# compiled next to its source; spirv(name, source, flags) adds the rule building shaders/<name>.spv from
+# shaders/<source> with glslangValidator. The binaries are prerequisites of the target: an edited shader is
+# rebuilt with the application, never loaded stale; so is every shader when the shared frame.glsl changes.
+# shaders/compile.sh does the same without qmake.
+#
+GLSLANG    = glslangValidator
+SHADER_DIR = $$PWD/shaders
+
+defineTest(spirv) {
+    rule   = spirv_$$1
+    source = SPIRV_SOURCE_$$1
+
+    $$source = $$SHADER_DIR/$$2
+    $${rule}.input    = $$source
+    $${rule}.output   = $$SHADER_DIR/$${1}.spv
+    $${rule}.commands = $$GLSLANG -V $$3 ${QMAKE_FILE_IN} -o ${QMAKE_FILE_OUT}
+    $${rule}.depends  = $$SHADER_DIR/frame.glsl
+    $${rule}.CONFIG   = no_link target_predeps
+
+    QMAKE_EXTRA_COMPILERS += $$rule
+    export($$source)
+    export($${rule}.input)
+    export($${rule}.output)
+    export($${rule}.commands)
+    export($${rule}.depends)
+    export($${rule}.CONFIG)
+    export(QMAKE_EXTRA_COMPILERS)
+    return(true)
+}
+
+spirv(vert,     vertex.vert)
+spirv(frag,     fragment.frag)
+spirv(waterSim, waterSim.comp)
+spirv(waterLod, waterLod.vert)
+spirv(cull,     cull.comp)
+spirv(floatingVert, floating.vert)
+spirv(floatingFrag, floating.frag)
+spirv(particleEmit,   particleEmit.comp)
+spirv(particleUpdate, particleUpdate.comp)
+spirv(particleSort,   particleSort.comp)
+spirv(particleVert,   particle.vert)
+spirv(particleFrag,   particle.frag)
+spirv(oceanSpectrum,  oceanSpectrum.comp)
+spirv(oceanFft,       oceanFft.comp)
+spirv(oceanResolve,   oceanResolve.comp)
+spirv(fragReflect,    fragment.frag, -DREFLECTIONS)
+spirv(hizReduce,      hiz.comp)
+spirv(hizCopy,        hiz.comp,      -DCOPY_DEPTH)
+spirv(hizCopyMs,      hiz.comp,      -DCOPY_DEPTH -DMULTISAMPLED)
+spirv(sky,            sky.comp)
@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET   = WaterBench
+
+include(WaterApp.pri)
+
+SOURCES += \
+        benchmark.cpp
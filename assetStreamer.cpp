@@ -0,0 +1,238 @@
+#include "createApp.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace std;
+using namespace app;
+
+void assetStreamer::init(deviceAllocator* a_pAllocator, VkDevice a_device, VkQueue a_queue, uint32_t a_queueFamily,
+                         const std::vector<uint32_t>& a_consumerFamilies, VkDeviceSize a_stagingBytes)
+{
+    m_queue       = a_queue;
+    m_queueFamily = a_queueFamily;
+    m_stop        = false;
+    m_nextJob     = 0;
+
+    m_sharedFamilies.assign(1, a_queueFamily);
+    for (uint32_t family : a_consumerFamilies)
+        if (std::find(m_sharedFamilies.begin(), m_sharedFamilies.end(), family) == m_sharedFamilies.end())
+            m_sharedFamilies.push_back(family);
+
+    m_slotSize = std::max<VkDeviceSize>(a_stagingBytes / SLOT_COUNT, 64 * 1024) & ~VkDeviceSize(15);
+    a_pAllocator->createBuffer(m_slotSize * SLOT_COUNT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_staging, &m_stagingMem);
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = a_queueFamily;
+    VK_CHECK_RESULT(vkCreateCommandPool(a_device, &poolInfo, NULL, &m_pool));
+
+    VkCommandBuffer cmds[SLOT_COUNT];
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool        = m_pool;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = SLOT_COUNT;
+    VK_CHECK_RESULT(vkAllocateCommandBuffers(a_device, &allocInfo, cmds));
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    for (uint32_t i = 0; i < SLOT_COUNT; i++)
+    {
+        m_slots[i]     = stagingSlot();
+        m_slots[i].cmd = cmds[i];
+        VK_CHECK_RESULT(vkCreateFence(a_device, &fenceInfo, NULL, &m_slots[i].fence));
+    }
+
+    m_loader = std::thread(&assetStreamer::loaderLoop, this);
+}
+
+void assetStreamer::destroy(VkDevice a_device, deviceAllocator* a_pAllocator)
+{
+    if (m_loader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        m_loader.join();
+    }
+
+    for (uint32_t i = 0; i < SLOT_COUNT; i++)
+    {
+        if (m_slots[i].state == SLOT_IN_FLIGHT)
+            vkWaitForFences(a_device, 1, &m_slots[i].fence, VK_TRUE, UINT64_MAX);
+        if (m_slots[i].fence != VK_NULL_HANDLE)
+            vkDestroyFence(a_device, m_slots[i].fence, NULL);
+        m_slots[i] = stagingSlot();
+    }
+
+    for (const streamJob& job : m_jobs)
+        a_pAllocator->destroyBuffer(job.buffer, job.memory);
+    m_jobs.clear();
+
+    if (m_pool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(a_device, m_pool, NULL);
+    if (m_staging != VK_NULL_HANDLE)
+        a_pAllocator->destroyBuffer(m_staging, m_stagingMem);
+
+    m_pool    = VK_NULL_HANDLE;
+    m_staging = VK_NULL_HANDLE;
+}
+
+uint32_t assetStreamer::requestBuffer(deviceAllocator* a_pAllocator, const std::string& a_path, VkBufferUsageFlags a_usage)
+{
+    // only the size is read here, the contents are the loader's job
+    //
+    std::ifstream file(a_path, std::ios::binary | std::ios::ate);
+    if (!file)
+        throw std::runtime_error("[assetStreamer::requestBuffer]: can't open file " + a_path + "!");
+
+    const VkDeviceSize size = VkDeviceSize(file.tellg());
+    if (size == 0)
+        throw std::runtime_error("[assetStreamer::requestBuffer]: file " + a_path + " is empty!");
+
+    streamJob job;
+    job.path  = a_path;
+    job.size  = size;
+    job.start = clock::now();
+    a_pAllocator->createBuffer(size, a_usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               &job.buffer, &job.memory, m_sharedFamilies);
+
+    uint32_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = uint32_t(m_jobs.size());
+        m_jobs.push_back(job);
+    }
+    m_wake.notify_one();
+    return id;
+}
+
+streamState assetStreamer::state(uint32_t a_id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs[a_id].state;
+}
+
+void assetStreamer::poll(VkDevice a_device)
+{
+    bool freed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint32_t i = 0; i < SLOT_COUNT; i++)
+        {
+            stagingSlot& slot = m_slots[i];
+
+            if (slot.state == SLOT_IN_FLIGHT && vkGetFenceStatus(a_device, slot.fence) == VK_SUCCESS)
+            {
+                // chunks may be submitted out of order, a job is done when all of its bytes arrived
+                //
+                streamJob& job = m_jobs[slot.job];
+                job.copied += slot.size;
+                if (job.copied == job.size && job.state == STREAM_PENDING)
+                {
+                    job.state    = STREAM_READY;
+                    job.loadTime = std::chrono::duration<double, std::milli>(clock::now() - job.start).count();
+                }
+                slot.state = SLOT_FREE;
+                freed      = true;
+            }
+
+            if (slot.state != SLOT_FILLED)
+                continue;
+
+            VkCommandBufferBeginInfo beginInfo = {};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            VK_CHECK_RESULT(vkBeginCommandBuffer(slot.cmd, &beginInfo));
+
+            VkBufferCopy region = {};
+            region.srcOffset = m_slotSize * i;
+            region.dstOffset = slot.dstOffset;
+            region.size      = slot.size;
+            vkCmdCopyBuffer(slot.cmd, m_staging, m_jobs[slot.job].buffer, 1, &region);
+
+            VK_CHECK_RESULT(vkEndCommandBuffer(slot.cmd));
+
+            VkSubmitInfo submitInfo = {};
+            submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers    = &slot.cmd;
+
+            VK_CHECK_RESULT(vkResetFences(a_device, 1, &slot.fence));
+            if (vkQueueSubmit(m_queue, 1, &submitInfo, slot.fence) != VK_SUCCESS)
+                throw std::runtime_error("[assetStreamer::poll]: failed to submit copy!");
+            slot.state = SLOT_IN_FLIGHT;
+        }
+    }
+    if (freed)
+        m_wake.notify_one();
+}
+
+void assetStreamer::loaderLoop()
+{
+    std::ifstream file;
+    uint32_t      openJob = UINT32_MAX;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        uint32_t slot = 0;
+        m_wake.wait(lock, [this, &slot] {
+            if (m_stop)
+                return true;
+            if (m_nextJob >= m_jobs.size())
+                return false;
+            for (slot = 0; slot < SLOT_COUNT; slot++)
+                if (m_slots[slot].state == SLOT_FREE) return true;
+            return false;
+        });
+        if (m_stop)
+            return;
+
+        const uint32_t     jobId  = m_nextJob;
+        const std::string  path   = m_jobs[jobId].path;
+        const VkDeviceSize offset = m_jobs[jobId].read;
+        const VkDeviceSize size   = std::min(m_slotSize, m_jobs[jobId].size - offset);
+        m_slots[slot].state = SLOT_LOADING;
+
+        // the file is read without the lock, the main thread keeps polling and submitting the other slots meanwhile
+        //
+        lock.unlock();
+        if (openJob != jobId)
+        {
+            file.close();
+            file.clear();
+            file.open(path, std::ios::binary);
+            openJob = jobId;
+        }
+        file.read((char*)m_stagingMem.mapped + m_slotSize * slot, std::streamsize(size));
+        const bool ok = bool(file);
+        lock.lock();
+
+        streamJob&   job  = m_jobs[jobId];
+        stagingSlot& dst  = m_slots[slot];
+        if (!ok)
+        {
+            job.state = STREAM_FAILED;
+            dst.state = SLOT_FREE;
+            m_nextJob++;
+            openJob   = UINT32_MAX;
+            continue;
+        }
+
+        dst.job       = jobId;
+        dst.dstOffset = offset;
+        dst.size      = size;
+        dst.state     = SLOT_FILLED;
+
+        job.read += size;
+        if (job.read == job.size)
+            m_nextJob++;
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef WATERAPP_ASSETSTREAMER_HPP
+#define WATERAPP_ASSETSTREAMER_HPP
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deviceAllocator.hpp"
+
+namespace app
+{
+
+enum streamState { STREAM_PENDING = 0, STREAM_READY, STREAM_FAILED };
+
+// Streams files into device local buffers in the background, so large assets never stall drawFrame().
+//
+// A loader thread reads the files chunk by chunk into a persistently mapped staging buffer split into SLOT_COUNT
+// slots. The main thread calls poll() once per frame: it submits a copy for every slot the loader has filled and
+// hands slots back to the loader once their fences signaled; it never waits. The copies go to a_queue, a transfer
+// only family on hardware that has one, where they run next to the graphics and compute work.
+//
+// Only the loader thread touches files and only the main thread touches Vulkan objects, so neither the queue nor
+// the allocator needs to be synchronized with the rest of the application. The destination buffers are shared
+// concurrently with the consumer families and need no ownership transfer; they are valid once state() is STREAM_READY.
+//
+class assetStreamer
+{
+public:
+    static const uint32_t SLOT_COUNT = 4;
+
+    void init(deviceAllocator* a_pAllocator, VkDevice a_device, VkQueue a_queue, uint32_t a_queueFamily,
+              const std::vector<uint32_t>& a_consumerFamilies, VkDeviceSize a_stagingBytes);
+    void destroy(VkDevice a_device, deviceAllocator* a_pAllocator);   // waits for the copies in flight
+
+    // Main thread. Creates the destination buffer, as large as the file, and queues the file for the loader.
+    // Returns the id for the queries below.
+    //
+    uint32_t requestBuffer(deviceAllocator* a_pAllocator, const std::string& a_path, VkBufferUsageFlags a_usage);
+
+    void poll(VkDevice a_device);
+
+    streamState  state(uint32_t a_id) const;
+    VkBuffer     buffer(uint32_t a_id) const   { return m_jobs[a_id].buffer; }
+    VkDeviceSize size(uint32_t a_id) const     { return m_jobs[a_id].size; }
+    double       loadTime(uint32_t a_id) const { return m_jobs[a_id].loadTime; } // ms, request to the last copy
+    uint32_t     queueFamily() const           { return m_queueFamily; }
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    enum slotState { SLOT_FREE = 0, SLOT_LOADING, SLOT_FILLED, SLOT_IN_FLIGHT };
+
+    struct streamJob
+    {
+        std::string       path;
+        VkBuffer          buffer = VK_NULL_HANDLE;
+        deviceAllocation  memory;
+        VkDeviceSize      size     = 0;
+        VkDeviceSize      read     = 0;   // loader thread progress
+        VkDeviceSize      copied   = 0;   // bytes whose copies completed
+        streamState       state    = STREAM_PENDING;
+        clock::time_point start;
+        double            loadTime = 0.0;
+    };
+
+    struct stagingSlot
+    {
+        VkCommandBuffer cmd       = VK_NULL_HANDLE;
+        VkFence         fence     = VK_NULL_HANDLE;
+        slotState       state     = SLOT_FREE;
+        uint32_t        job       = 0;
+        VkDeviceSize    dstOffset = 0;
+        VkDeviceSize    size      = 0;
+    };
+
+    void loaderLoop();
+
+    VkQueue                  m_queue       = VK_NULL_HANDLE;
+    uint32_t                 m_queueFamily = 0;
+    std::vector<uint32_t>    m_sharedFamilies;
+    VkCommandPool            m_pool        = VK_NULL_HANDLE;
+    VkBuffer                 m_staging     = VK_NULL_HANDLE;
+    deviceAllocation         m_stagingMem;
+    VkDeviceSize             m_slotSize    = 0;
+    stagingSlot              m_slots[SLOT_COUNT];
+
+    std::vector<streamJob>   m_jobs;       // guarded by m_mutex
+    uint32_t                 m_nextJob = 0; // first job the loader has not finished reading
+    std::thread              m_loader;
+    mutable std::mutex       m_mutex;
+    std::condition_variable  m_wake;
+    bool                     m_stop = false;
+};
+
+}
+#endif // WATERAPP_ASSETSTREAMER_HPP
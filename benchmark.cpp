@@ -0,0 +1,316 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+
+#include "createApp.hpp"
+
+using namespace std;
+using namespace app;
+
+// Renders N frames through the regular application path (render pass, pipeline, drawFrame)
+// and prints throughput and frame time distribution. Runs headless by default, so it works
+// on display-less nodes and with software ICDs such as lavapipe (VK_ICD_FILENAMES=.../lvp_icd.x86_64.json).
+
+static double percentile(std::vector<double> a_values, double a_p)
+{
+    if (a_values.empty()) return 0.0;
+    std::sort(a_values.begin(), a_values.end());
+    size_t index = size_t(a_p * double(a_values.size() - 1) + 0.5);
+    return a_values[std::min(index, a_values.size() - 1)];
+}
+
+static double mean(const std::vector<double>& a_values)
+{
+    double sum = 0.0;
+    for (double v : a_values) sum += v;
+    return a_values.empty() ? 0.0 : sum / double(a_values.size());
+}
+
+static void savePPM(const char* a_fileName, const std::vector<uint32_t>& a_pixels, int a_width, int a_height)
+{
+    std::ofstream out(a_fileName, std::ios::binary);
+    out << "P6\n" << a_width << " " << a_height << "\n255\n";
+    for (uint32_t pixel : a_pixels)
+    {
+        const char rgb[3] = { char((pixel >> 16) & 0xFF), char((pixel >> 8) & 0xFF), char(pixel & 0xFF) }; // BGRA8 in memory
+        out.write(rgb, 3);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    appSettings settings;
+    settings.headless   = true;
+    settings.validation = false; // layers distort timings
+
+    int         frames     = 1000;
+    int         warmup     = 60;
+    const char* screenshot = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if      (strcmp(argv[i], "--window") == 0)                      settings.headless   = false;
+        else if (strcmp(argv[i], "--validation") == 0)                  settings.validation = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)      frames              = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)      warmup              = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--width")  == 0 && i + 1 < argc)      settings.width      = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc)      settings.height     = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc)      settings.deviceId   = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc)        settings.gridSize   = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--cpu-solver") == 0)                  settings.cpuSolver  = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)     settings.solverThreads = unsigned(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--staging-mb") == 0 && i + 1 < argc)  settings.stagingMB  = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) settings.recordThreads = unsigned(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc)       settings.drawCalls  = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--dynamic-res") == 0 && i + 1 < argc) { settings.dynamicResolution = true; settings.targetFrameMs = float(atof(argv[++i])); }
+        else if (strcmp(argv[i], "--min-scale") == 0 && i + 1 < argc)   settings.minRenderScale = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--max-scale") == 0 && i + 1 < argc)   settings.maxRenderScale = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--scale-band") == 0 && i + 2 < argc)
+        {
+            settings.scaleUpThreshold   = float(atof(argv[++i]));
+            settings.scaleDownThreshold = float(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--scale-settle") == 0 && i + 1 < argc) settings.scaleSettleFrames = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc && parsePresentMode(argv[i + 1], &settings.presentMode)) i++;
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) settings.framesInFlight = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc)   settings.maxFps     = atof(argv[++i]);
+        else if (strcmp(argv[i], "--no-async-compute") == 0)            settings.asyncCompute = false;
+        else if (strcmp(argv[i], "--heightmap") == 0 && i + 1 < argc)   settings.heightmapFile = argv[++i];
+        else if (strcmp(argv[i], "--mesh-index") == 0 && i + 1 < argc && parseMeshIndexType(argv[i + 1], &settings.mesh.indexType)) i++;
+        else if (strcmp(argv[i], "--mesh-split") == 0)                  settings.mesh.streams = MESH_SPLIT;
+        else if (strcmp(argv[i], "--mesh-quantize") == 0)               settings.mesh.quantizePositions = settings.mesh.quantizeNormals = true;
+        else if (strcmp(argv[i], "--no-mesh-optimize") == 0)            settings.mesh.optimizeOrder = false;
+        else if (strcmp(argv[i], "--lod") == 0)                         settings.lod        = true;
+        else if (strcmp(argv[i], "--ocean-size") == 0 && i + 1 < argc)  settings.oceanSize  = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--lod-tile") == 0 && i + 1 < argc)    settings.lodTileSize = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--lod-levels") == 0 && i + 1 < argc)  settings.lodLevels  = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--lod-patch") == 0 && i + 1 < argc)   settings.lodPatchRes = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--gpu-cull") == 0)                    settings.gpuCulling = true;
+        else if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)     settings.objects = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)   settings.particles = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--no-particle-sort") == 0)            settings.particleSort = false;
+        else if (strcmp(argv[i], "--wind") == 0 && i + 2 < argc)
+        {
+            settings.windSpeed     = float(atof(argv[++i]));
+            settings.windDirection = float(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--fft-ocean") == 0)                   settings.fftOcean = true;
+        else if (strcmp(argv[i], "--fft-size") == 0 && i + 1 < argc)    settings.fftSize = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--fft-cascades") == 0 && i + 1 < argc) settings.fftCascades = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--spectrum") == 0 && i + 1 < argc && parseOceanSpectrum(argv[i + 1], &settings.fftSpectrum)) i++;
+        else if (strcmp(argv[i], "--depth-prepass") == 0)               settings.depthPrepass = true;
+        else if (strcmp(argv[i], "--msaa") == 0 && i + 1 < argc)        settings.msaa = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--reflections") == 0 && i + 1 < argc && parseReflectionQuality(argv[i + 1], &settings.reflections)) i++;
+        else if (strcmp(argv[i], "--fixed-reflection-steps") == 0)      settings.adaptiveReflections = false;
+        else if (strcmp(argv[i], "--object-sweep") == 0)                settings.objectSweep = true;
+        else if (strcmp(argv[i], "--cull-sweep") == 0)                  settings.cullSweep = true;
+        else if (strcmp(argv[i], "--validate-solver") == 0)             settings.validateSolver = true;
+        else if (strcmp(argv[i], "--resize-every") == 0 && i + 1 < argc) settings.resizeEvery = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--screenshot") == 0 && i + 1 < argc)  screenshot          = argv[++i];
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)     settings.profileOutput = argv[++i];
+        else if (strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc) settings.pipelineCacheDir = argv[++i];
+        else if (strcmp(argv[i], "--no-pipeline-cache") == 0)           settings.pipelineCacheDir.clear();
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--window] [--validation] [--frames N] [--warmup N] [--width W] [--height H] [--device ID] [--grid N] [--cpu-solver] [--threads N] [--staging-mb N] [--record-threads N] [--draws N] [--dynamic-res MS] [--min-scale F] [--max-scale F] [--scale-band UP DOWN] [--scale-settle N] [--present-mode immediate|mailbox|fifo|fifo_relaxed] [--frames-in-flight N] [--fps-limit N] [--no-async-compute] [--heightmap file.raw] [--mesh-index none|16|32|auto] [--mesh-split] [--mesh-quantize] [--no-mesh-optimize] [--lod] [--ocean-size F] [--lod-tile F] [--lod-levels N] [--lod-patch N] [--gpu-cull] [--objects N] [--particles N] [--no-particle-sort] [--wind SPEED DEG] [--fft-ocean] [--fft-size N] [--fft-cascades N] [--spectrum phillips|jonswap] [--depth-prepass] [--msaa N] [--reflections off|low|medium|high] [--fixed-reflection-steps] [--object-sweep] [--cull-sweep] [--validate-solver] [--resize-every N] [--screenshot file.ppm] [--profile out.csv|out.json]"
+                      << " [--pipeline-cache DIR] [--no-pipeline-cache]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (frames <= 0)
+    {
+        std::cerr << "--frames must be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    benchmarkResults results;
+    application      app(settings);
+    try
+    {
+        app.runBenchmark(warmup, frames, screenshot != nullptr, &results);
+    }
+    catch (const exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "device:          " << results.deviceName << std::endl;
+    std::cout << "mode:            " << (settings.headless ? "headless" : "window") << ", " << settings.width << "x" << settings.height << std::endl;
+    std::cout << "present:         " << (settings.headless ? "offscreen" : results.presentMode) << ", " << settings.framesInFlight
+              << " frame(s) in flight" << std::endl;
+    const uint32_t gridSize = settings.fftOcean ? settings.fftSize : settings.gridSize;
+    std::cout << "grid:            " << gridSize << "x" << gridSize << (settings.cpuSolver ? ", CPU solver" : ", GPU solver") << std::endl;
+    if (!settings.cpuSolver)
+    {
+        std::cout << "simulation:      ";
+        if (results.asyncCompute) std::cout << "async compute queue (family " << results.computeFamily << ")";
+        else                      std::cout << "graphics queue";
+        if (!results.simulationTimes.empty()) std::cout << ", gpu mean " << mean(results.simulationTimes) << " ms";
+        std::cout << std::endl;
+    }
+    if (!results.oceanPath.empty())
+    {
+        std::cout << "ocean:           " << results.oceanSize << "x" << results.oceanSize << " FFT, " << results.oceanCascades << " cascade(s), "
+                  << oceanSpectrumName(settings.fftSpectrum) << " spectrum, " << results.oceanPath;
+        if (results.oceanDispatches > 0) std::cout << " (" << results.oceanDispatches << " dispatches)";
+        if (!results.oceanFftTimes.empty())
+        {
+            std::cout << ", mean spectrum " << mean(results.oceanSpectrumTimes) << " ms, fft " << mean(results.oceanFftTimes)
+                      << " ms, resolve " << mean(results.oceanResolveTimes) << " ms";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "mesh:            indices " << meshIndexTypeName(results.meshIndices) << ", "
+              << (settings.mesh.streams == MESH_SPLIT ? "split" : "interleaved") << (settings.mesh.quantizePositions ? ", quantized" : "")
+              << (settings.mesh.optimizeOrder ? ", cache optimized" : "") << ", " << results.meshBytes / 1024 << " KB, ACMR " << results.meshAcmr << std::endl;
+    if (settings.lod && results.lodDraws != "direct")
+    {
+        std::cout << "lod:             " << settings.oceanSize << " units ocean, " << settings.lodLevels << " levels, "
+                  << mean(results.lodPatches) << " nodes, " << mean(results.lodTriangles) << " triangles before selection and culling on the GPU, "
+                  << results.lodDraws << " draws" << std::endl;
+    }
+    else if (settings.lod)
+    {
+        std::cout << "lod:             " << settings.oceanSize << " units ocean, " << settings.lodLevels << " levels, mean "
+                  << mean(results.lodPatches) << " patches, " << mean(results.lodTriangles) << " triangles, max "
+                  << percentile(results.lodTriangles, 1.0) << " triangles per frame, " << results.lodDraws << " draws" << std::endl;
+    }
+    if (results.objects > 0)
+    {
+        std::cout << "objects:         " << results.objects << " instances in " << results.objectDraws << " draws, "
+                  << results.objectTriangles << " triangles" << std::endl;
+    }
+    if (results.particles > 0)
+    {
+        std::cout << "particles:       " << results.particlesAlive << " of " << results.particles << " alive at the end, "
+                  << (results.particlesSorted ? "sorted" : "unsorted");
+        if (results.particlesSorted) std::cout << " in " << results.particleSortDispatches << " dispatches";
+        if (!results.particleTimes.empty()) std::cout << ", gpu mean " << mean(results.particleTimes) << " ms";
+        std::cout << std::endl;
+    }
+    if (!results.vsInvocations.empty())
+    {
+        const double triangles = settings.lod ? mean(results.lodTriangles) : double(results.meshTriangles);
+        std::cout << "vs invocations:  " << mean(results.vsInvocations) << " per frame, "
+                  << mean(results.vsInvocations) / std::max(1.0, triangles) << " per triangle" << std::endl;
+    }
+    if (!results.fsInvocations.empty())
+    {
+        std::cout << "fs invocations:  " << mean(results.fsInvocations) << " per frame, overdraw mean " << mean(results.overdraw)
+                  << ", p99 " << percentile(results.overdraw, 0.99) << " (" << results.depthFormat << " reverse-Z"
+                  << (settings.depthPrepass ? ", depth pre-pass)" : ")") << std::endl;
+    }
+    std::cout << "attachments:     " << results.passAttachments << " (" << results.transientAttachments << " transient, "
+              << (results.lazyMemory ? "lazily allocated" : "no lazy memory") << "), " << results.msaaSamples << "x MSAA, "
+              << results.attachmentMB << " MB per frame loaded and stored, " << results.attachmentNaiveMB << " MB if all were" << std::endl;
+    if (!results.reflectionSteps.empty())
+    {
+        std::cout << "reflections:     " << results.reflections << ", mean " << mean(results.reflectionSteps) << " march steps";
+        if (!results.reflectionTimes.empty())
+            std::cout << ", scene copy and Hi-Z " << mean(results.reflectionTimes) << " ms";
+        std::cout << std::endl;
+    }
+    std::cout << "render graph:    " << results.graphPasses << " passes (" << results.graphCulledPasses << " culled), mean "
+              << mean(results.graphBarriers) << " barrier calls per frame (" << results.graphBufferBarriers << " buffer, "
+              << results.graphImageBarriers << " image barriers in the last), transient memory " << mean(results.transientMB)
+              << " MB, " << results.transientUnaliasedMB << " MB unaliased" << std::endl;
+    std::cout << "startup:         " << results.startupTime << " ms" << std::endl;
+    std::cout << "pipelines:       " << results.pipelineCreateTime << " ms ("
+              << (settings.pipelineCacheDir.empty() ? "no" : (results.pipelineCacheWarm ? "warm" : "cold")) << " pipeline cache)" << std::endl;
+    std::cout << "device memory:   " << results.memoryStats.usedBytes / (1024 * 1024) << " MB used, "
+              << results.memoryStats.freeBytes / (1024 * 1024) << " MB free in " << results.memoryStats.blockCount << " block(s), fragmentation "
+              << results.memoryStats.fragmentation << std::endl;
+    std::cout << "peak memory:     " << results.peakUsedMB << " MB used, " << results.peakBlockMB << " MB in blocks in a measured frame" << std::endl;
+    std::cout << "descriptors:     " << results.setLayouts << " set layouts for " << results.setLayoutRequests << " requests, "
+              << results.frameSets << " set(s) per frame from " << results.descriptorPools << " reset pool(s)" << std::endl;
+    std::cout << "frame constants: " << sizeof(frameUniforms) << " bytes per frame, " << results.frameUniformStride
+              << " byte stride, persistently mapped" << std::endl;
+    std::cout << "frames:          " << frames << " (+" << warmup << " warmup)" << std::endl;
+    std::cout << "frames/sec:      " << 1000.0 * double(frames) / results.totalTime << std::endl;
+    std::cout << "record mean:     " << mean(results.recordTimes) << " ms, p99 " << percentile(results.recordTimes, 0.99) << " ms ("
+              << settings.drawCalls << " draw calls)" << std::endl;
+    if (settings.dynamicResolution || settings.maxRenderScale < 1.0f)
+    {
+        std::cout << "render scale:    mean " << mean(results.renderScales) << ", p01 " << percentile(results.renderScales, 0.01) << ", p99 "
+                  << percentile(results.renderScales, 0.99);
+        if (settings.dynamicResolution) std::cout << " (target " << settings.targetFrameMs << " ms)";
+        std::cout << std::endl;
+    }
+    std::cout << "upload:          " << results.uploadBytes / double(frames) / (1024.0 * 1024.0) << " MB/frame, "
+              << results.uploadBytes / (results.totalTime * 1e-3) / (1024.0 * 1024.0 * 1024.0) << " GB/s" << std::endl;
+    std::cout << "frame time p50:  " << percentile(results.frameTimes, 0.50) << " ms" << std::endl;
+    std::cout << "frame time p99:  " << percentile(results.frameTimes, 0.99) << " ms" << std::endl;
+    std::cout << "submit mean:     " << mean(results.submitTimes) << " ms" << std::endl;
+    std::cout << "submit p99:      " << percentile(results.submitTimes, 0.99) << " ms" << std::endl;
+    if (!results.gpuFrameTimes.empty())
+    {
+        std::cout << "gpu frame p50:   " << percentile(results.gpuFrameTimes, 0.50) << " ms" << std::endl;
+        std::cout << "gpu frame p99:   " << percentile(results.gpuFrameTimes, 0.99) << " ms" << std::endl;
+    }
+
+    if (!results.inputLatencies.empty())
+    {
+        std::cout << "input latency:   p50 " << percentile(results.inputLatencies, 0.50) << " ms, p99 " << percentile(results.inputLatencies, 0.99)
+                  << " ms (poll to present)" << std::endl;
+    }
+    if (settings.maxFps > 0.0)
+        std::cout << "fps limit:       " << settings.maxFps << std::endl;
+
+    if (!settings.heightmapFile.empty() && !settings.cpuSolver)
+    {
+        std::cout << "heightmap:       ";
+        if (results.heightmapTime >= 0.0) std::cout << results.heightmapTime << " ms";
+        else                              std::cout << "not loaded";
+        std::cout << " (streamed on queue family " << results.streamFamily << ")" << std::endl;
+    }
+
+    if (!results.recreateTimes.empty())
+    {
+        std::cout << "recreate mean:   " << mean(results.recreateTimes) << " ms, p99 " << percentile(results.recreateTimes, 0.99) << " ms ("
+                  << results.recreateTimes.size() << " times)" << std::endl;
+    }
+
+    if (!results.objectSweep.empty())
+    {
+        std::cout << "object sweep:    instances, frame ms, gpu ms, record ms" << std::endl;
+        for (const sweepPoint& point : results.objectSweep)
+        {
+            std::cout << "                 " << point.count << ", " << point.frameMs << ", ";
+            if (point.gpuMs >= 0.0) std::cout << point.gpuMs;
+            else                    std::cout << "-";
+            std::cout << ", " << point.recordMs << std::endl;
+        }
+    }
+
+    if (!results.cullSweep.empty())
+    {
+        std::cout << "cull sweep:      candidates, frame ms, gpu ms, record ms, cpu ms" << std::endl;
+        for (const sweepPoint& point : results.cullSweep)
+        {
+            std::cout << "                 " << point.count << ", " << point.frameMs << ", ";
+            if (point.gpuMs >= 0.0) std::cout << point.gpuMs;
+            else                    std::cout << "-";
+            std::cout << ", " << point.recordMs << ", " << point.cpuMs << std::endl;
+        }
+    }
+
+    if (results.solverMaxError >= 0.0)
+    {
+        std::cout << std::scientific;
+        if (!results.oceanPath.empty())
+            std::cout << "ocean max |gpu - cpu|: " << results.solverMaxError << " height units, last frame" << std::endl;
+        else
+            std::cout << "solver max |gpu - cpu|: " << results.solverMaxError << " after " << results.solverSteps << " steps" << std::endl;
+        std::cout << std::fixed;
+    }
+
+    if (screenshot != nullptr && !results.lastFrame.empty())
+        savePPM(screenshot, results.lastFrame, results.lastFrameWidth, results.lastFrameHeight);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+#include "createApp.hpp"
+
+using namespace std;
+using namespace app;
+
+void commandRecorder::init(VkDevice a_device, uint32_t a_queueFamilyIndex, uint32_t a_frameCount, unsigned a_threads)
+{
+    m_pool.reset(new threadPool(a_threads));
+
+    m_frames.resize(a_frameCount);
+    for (auto& frame : m_frames)
+    {
+        frame.threads.resize(m_pool->threadCount());
+        for (auto& thread : frame.threads)
+        {
+            VkCommandPoolCreateInfo poolInfo = {};
+            poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = a_queueFamilyIndex;
+            if (vkCreateCommandPool(a_device, &poolInfo, NULL, &thread.pool) != VK_SUCCESS)
+                throw std::runtime_error("[commandRecorder::init]: failed to create command pool!");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = frame.threads[0].pool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(a_device, &allocInfo, &frame.primary) != VK_SUCCESS)
+            throw std::runtime_error("[commandRecorder::init]: failed to allocate command buffer!");
+    }
+}
+
+void commandRecorder::destroy(VkDevice a_device)
+{
+    for (auto& frame : m_frames)
+        for (auto& thread : frame.threads)
+            vkDestroyCommandPool(a_device, thread.pool, NULL);  // frees its command buffers too
+    m_frames.clear();
+    m_pool.reset();
+}
+
+VkCommandBuffer commandRecorder::beginFrame(VkDevice a_device, uint32_t a_frame)
+{
+    m_frame = a_frame;
+
+    frameData& frame = m_frames[a_frame];
+    for (auto& thread : frame.threads)
+    {
+        VK_CHECK_RESULT(vkResetCommandPool(a_device, thread.pool, 0));
+        thread.secondariesUsed = 0;
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(frame.primary, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("[commandRecorder::beginFrame]: failed to begin recording command buffer!");
+
+    return frame.primary;
+}
+
+VkCommandBuffer commandRecorder::nextSecondary(VkDevice a_device, threadPoolData* a_pThread)
+{
+    if (a_pThread->secondariesUsed == a_pThread->secondaries.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = a_pThread->pool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer cmdBuff;
+        if (vkAllocateCommandBuffers(a_device, &allocInfo, &cmdBuff) != VK_SUCCESS)
+            throw std::runtime_error("[commandRecorder::nextSecondary]: failed to allocate command buffer!");
+        a_pThread->secondaries.push_back(cmdBuff);
+    }
+    return a_pThread->secondaries[a_pThread->secondariesUsed++];
+}
+
+void commandRecorder::recordSecondaries(VkDevice a_device, uint32_t a_chunks, const VkCommandBufferInheritanceInfo& a_inheritance,
+                                        const std::function<void(VkCommandBuffer, uint32_t)>& a_record, std::vector<VkCommandBuffer>* a_pSecondaries)
+{
+    a_pSecondaries->resize(a_chunks);
+    frameData& frame = m_frames[m_frame];
+
+    // a pool is only touched by its own thread: chunks with the same thread index run one after another
+    //
+    std::function<void(uint32_t, unsigned)> job = [&](uint32_t a_chunk, unsigned a_thread)
+    {
+        VkCommandBuffer cmdBuff = nextSecondary(a_device, &frame.threads[a_thread]);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &a_inheritance;
+        if (vkBeginCommandBuffer(cmdBuff, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("[commandRecorder::recordSecondaries]: failed to begin recording command buffer!");
+
+        a_record(cmdBuff, a_chunk);
+
+        if (vkEndCommandBuffer(cmdBuff) != VK_SUCCESS)
+            throw std::runtime_error("[commandRecorder::recordSecondaries]: failed to record command buffer!");
+
+        (*a_pSecondaries)[a_chunk] = cmdBuff;
+    };
+    m_pool->parallelFor(a_chunks, job);
+}
@@ -0,0 +1,57 @@
+#ifndef WATERAPP_COMMANDRECORDER_HPP
+#define WATERAPP_COMMANDRECORDER_HPP
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "threadPool.hpp"
+
+namespace app
+{
+
+// Command buffers re-recorded every frame. Every frame in flight owns one VkCommandPool per recording thread;
+// the pools are reset as a whole once the frame's fence was waited, and the command buffers allocated from
+// them are kept and reused, so steady state recording allocates nothing.
+//
+class commandRecorder
+{
+public:
+    void init(VkDevice a_device, uint32_t a_queueFamilyIndex, uint32_t a_frameCount, unsigned a_threads);
+    void destroy(VkDevice a_device);
+
+    // Resets the pools of a_frame (its fence must have been waited) and returns its primary command buffer, begun.
+    //
+    VkCommandBuffer beginFrame(VkDevice a_device, uint32_t a_frame);
+
+    // Records a_chunks secondary command buffers in parallel, one call of a_record per chunk, and returns them in
+    // chunk order, ready for vkCmdExecuteCommands. a_inheritance describes the render pass they continue.
+    //
+    void recordSecondaries(VkDevice a_device, uint32_t a_chunks, const VkCommandBufferInheritanceInfo& a_inheritance,
+                           const std::function<void(VkCommandBuffer, uint32_t)>& a_record, std::vector<VkCommandBuffer>* a_pSecondaries);
+
+    unsigned threadCount() const { return m_pool ? m_pool->threadCount() : 1; }
+
+private:
+    struct threadPoolData
+    {
+        VkCommandPool                pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> secondaries;     // allocated so far, reused after every reset
+        uint32_t                     secondariesUsed = 0;
+    };
+
+    struct frameData
+    {
+        VkCommandBuffer             primary = VK_NULL_HANDLE;  // allocated from threads[0].pool
+        std::vector<threadPoolData> threads;
+    };
+
+    VkCommandBuffer nextSecondary(VkDevice a_device, threadPoolData* a_pThread);
+
+    std::vector<frameData>      m_frames;
+    uint32_t                    m_frame = 0;
+    std::unique_ptr<threadPool> m_pool;
+};
+
+}
+#endif // WATERAPP_COMMANDRECORDER_HPP
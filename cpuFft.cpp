@@ -0,0 +1,249 @@
+#include "cpuFft.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WATERAPP_X86 1
+#endif
+
+using namespace app;
+
+static void spanScalar(const float* a_aRe, const float* a_aIm, const float* a_bRe, const float* a_bIm,
+                       const float* a_wRe, const float* a_wIm, float* a_o0Re, float* a_o0Im, float* a_o1Re, float* a_o1Im, uint32_t a_count)
+{
+    for (uint32_t i = 0; i < a_count; i++)
+    {
+        const float re = a_wRe[i] * a_bRe[i] - a_wIm[i] * a_bIm[i];
+        const float im = a_wRe[i] * a_bIm[i] + a_wIm[i] * a_bRe[i];
+        a_o0Re[i] = a_aRe[i] + re;
+        a_o0Im[i] = a_aIm[i] + im;
+        a_o1Re[i] = a_aRe[i] - re;
+        a_o1Im[i] = a_aIm[i] - im;
+    }
+}
+
+static void constScalar(const float* a_aRe, const float* a_aIm, const float* a_bRe, const float* a_bIm,
+                        float a_wRe, float a_wIm, float* a_o0Re, float* a_o0Im, float* a_o1Re, float* a_o1Im, uint32_t a_count)
+{
+    for (uint32_t i = 0; i < a_count; i++)
+    {
+        const float re = a_wRe * a_bRe[i] - a_wIm * a_bIm[i];
+        const float im = a_wRe * a_bIm[i] + a_wIm * a_bRe[i];
+        a_o0Re[i] = a_aRe[i] + re;
+        a_o0Im[i] = a_aIm[i] + im;
+        a_o1Re[i] = a_aRe[i] - re;
+        a_o1Im[i] = a_aIm[i] - im;
+    }
+}
+
+#ifdef WATERAPP_X86
+
+// The vector kernels do whole registers and leave the tail (and the short spans of the first row stages)
+// to the scalar code.
+//
+__attribute__((target("sse2")))
+static void spanSSE2(const float* a_aRe, const float* a_aIm, const float* a_bRe, const float* a_bIm,
+                     const float* a_wRe, const float* a_wIm, float* a_o0Re, float* a_o0Im, float* a_o1Re, float* a_o1Im, uint32_t a_count)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= a_count; i += 4)
+    {
+        __m128 wr = _mm_loadu_ps(a_wRe + i), wi = _mm_loadu_ps(a_wIm + i);
+        __m128 br = _mm_loadu_ps(a_bRe + i), bi = _mm_loadu_ps(a_bIm + i);
+        __m128 ar = _mm_loadu_ps(a_aRe + i), ai = _mm_loadu_ps(a_aIm + i);
+        __m128 re = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi));
+        __m128 im = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+        _mm_storeu_ps(a_o0Re + i, _mm_add_ps(ar, re));
+        _mm_storeu_ps(a_o0Im + i, _mm_add_ps(ai, im));
+        _mm_storeu_ps(a_o1Re + i, _mm_sub_ps(ar, re));
+        _mm_storeu_ps(a_o1Im + i, _mm_sub_ps(ai, im));
+    }
+    spanScalar(a_aRe + i, a_aIm + i, a_bRe + i, a_bIm + i, a_wRe + i, a_wIm + i, a_o0Re + i, a_o0Im + i, a_o1Re + i, a_o1Im + i, a_count - i);
+}
+
+__attribute__((target("sse2")))
+static void constSSE2(const float* a_aRe, const float* a_aIm, const float* a_bRe, const float* a_bIm,
+                      float a_wRe, float a_wIm, float* a_o0Re, float* a_o0Im, float* a_o1Re, float* a_o1Im, uint32_t a_count)
+{
+    const __m128 wr = _mm_set1_ps(a_wRe), wi = _mm_set1_ps(a_wIm);
+
+    uint32_t i = 0;
+    for (; i + 4 <= a_count; i += 4)
+    {
+        __m128 br = _mm_loadu_ps(a_bRe + i), bi = _mm_loadu_ps(a_bIm + i);
+        __m128 ar = _mm_loadu_ps(a_aRe + i), ai = _mm_loadu_ps(a_aIm + i);
+        __m128 re = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi));
+        __m128 im = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+        _mm_storeu_ps(a_o0Re + i, _mm_add_ps(ar, re));
+        _mm_storeu_ps(a_o0Im + i, _mm_add_ps(ai, im));
+        _mm_storeu_ps(a_o1Re + i, _mm_sub_ps(ar, re));
+        _mm_storeu_ps(a_o1Im + i, _mm_sub_ps(ai, im));
+    }
+    constScalar(a_aRe + i, a_aIm + i, a_bRe + i, a_bIm + i, a_wRe, a_wIm, a_o0Re + i, a_o0Im + i, a_o1Re + i, a_o1Im + i, a_count - i);
+}
+
+__attribute__((target("avx2")))
+static void spanAVX2(const float* a_aRe, const float* a_aIm, const float* a_bRe, const float* a_bIm,
+                     const float* a_wRe, const float* a_wIm, float* a_o0Re, float* a_o0Im, float* a_o1Re, float* a_o1Im, uint32_t a_count)
+{
+    // no FMA on purpose, the rounding stays the same as in the scalar and SSE2 paths
+    //
+    uint32_t i = 0;
+    for (; i + 8 <= a_count; i += 8)
+    {
+        __m256 wr = _mm256_loadu_ps(a_wRe + i), wi = _mm256_loadu_ps(a_wIm + i);
+        __m256 br = _mm256_loadu_ps(a_bRe + i), bi = _mm256_loadu_ps(a_bIm + i);
+        __m256 ar = _mm256_loadu_ps(a_aRe + i), ai = _mm256_loadu_ps(a_aIm + i);
+        __m256 re = _mm256_sub_ps(_mm256_mul_ps(wr, br), _mm256_mul_ps(wi, bi));
+        __m256 im = _mm256_add_ps(_mm256_mul_ps(wr, bi), _mm256_mul_ps(wi, br));
+        _mm256_storeu_ps(a_o0Re + i, _mm256_add_ps(ar, re));
+        _mm256_storeu_ps(a_o0Im + i, _mm256_add_ps(ai, im));
+        _mm256_storeu_ps(a_o1Re + i, _mm256_sub_ps(ar, re));
+        _mm256_storeu_ps(a_o1Im + i, _mm256_sub_ps(ai, im));
+    }
+    spanScalar(a_aRe + i, a_aIm + i, a_bRe + i, a_bIm + i, a_wRe + i, a_wIm + i, a_o0Re + i, a_o0Im + i, a_o1Re + i, a_o1Im + i, a_count - i);
+}
+
+__attribute__((target("avx2")))
+static void constAVX2(const float* a_aRe, const float* a_aIm, const float* a_bRe, const float* a_bIm,
+                      float a_wRe, float a_wIm, float* a_o0Re, float* a_o0Im, float* a_o1Re, float* a_o1Im, uint32_t a_count)
+{
+    const __m256 wr = _mm256_set1_ps(a_wRe), wi = _mm256_set1_ps(a_wIm);
+
+    uint32_t i = 0;
+    for (; i + 8 <= a_count; i += 8)
+    {
+        __m256 br = _mm256_loadu_ps(a_bRe + i), bi = _mm256_loadu_ps(a_bIm + i);
+        __m256 ar = _mm256_loadu_ps(a_aRe + i), ai = _mm256_loadu_ps(a_aIm + i);
+        __m256 re = _mm256_sub_ps(_mm256_mul_ps(wr, br), _mm256_mul_ps(wi, bi));
+        __m256 im = _mm256_add_ps(_mm256_mul_ps(wr, bi), _mm256_mul_ps(wi, br));
+        _mm256_storeu_ps(a_o0Re + i, _mm256_add_ps(ar, re));
+        _mm256_storeu_ps(a_o0Im + i, _mm256_add_ps(ai, im));
+        _mm256_storeu_ps(a_o1Re + i, _mm256_sub_ps(ar, re));
+        _mm256_storeu_ps(a_o1Im + i, _mm256_sub_ps(ai, im));
+    }
+    constScalar(a_aRe + i, a_aIm + i, a_bRe + i, a_bIm + i, a_wRe, a_wIm, a_o0Re + i, a_o0Im + i, a_o1Re + i, a_o1Im + i, a_count - i);
+}
+
+#endif
+
+void cpuFft::init(uint32_t a_size, simdLevel a_maxSimd)
+{
+    if (a_size < 2 || (a_size & (a_size - 1)) != 0)
+        throw std::runtime_error("[cpuFft::init]: size must be a power of two!");
+
+    m_size   = a_size;
+    m_stages = 0;
+    while ((1u << m_stages) < a_size)
+        m_stages++;
+
+    // the same angles as shaders/oceanFft.comp, computed in double
+    //
+    m_twRe.resize(a_size - 1);
+    m_twIm.resize(a_size - 1);
+    for (uint32_t ns = 1; ns < a_size; ns *= 2)
+    {
+        for (uint32_t k = 0; k < ns; k++)
+        {
+            const double angle = 3.14159265358979323846 * double(k) / double(ns);
+            m_twRe[ns - 1 + k] = float(cos(angle));
+            m_twIm[ns - 1 + k] = float(sin(angle));
+        }
+    }
+
+    m_simd  = cpuWaterSolver::SIMD_SCALAR;
+    m_span  = spanScalar;
+    m_const = constScalar;
+#ifdef WATERAPP_X86
+    __builtin_cpu_init();
+    if (a_maxSimd >= cpuWaterSolver::SIMD_AVX2 && __builtin_cpu_supports("avx2"))
+    {
+        m_simd  = cpuWaterSolver::SIMD_AVX2;
+        m_span  = spanAVX2;
+        m_const = constAVX2;
+    }
+    else if (a_maxSimd >= cpuWaterSolver::SIMD_SSE2 && __builtin_cpu_supports("sse2"))
+    {
+        m_simd  = cpuWaterSolver::SIMD_SSE2;
+        m_span  = spanSSE2;
+        m_const = constSSE2;
+    }
+#else
+    (void)a_maxSimd;
+#endif
+}
+
+void cpuFft::inverseRow(float* a_re, float* a_im, float* a_tmpRe, float* a_tmpIm) const
+{
+    const uint32_t half = m_size / 2;
+
+    float* srcRe = a_re;
+    float* srcIm = a_im;
+    float* dstRe = a_tmpRe;
+    float* dstIm = a_tmpIm;
+
+    // butterfly j = b + k of a stage reads j and j + half and writes 2b + k and 2b + k + ns, b a multiple of ns
+    //
+    for (uint32_t ns = 1; ns < m_size; ns *= 2)
+    {
+        const float* wRe = m_twRe.data() + ns - 1;
+        const float* wIm = m_twIm.data() + ns - 1;
+        for (uint32_t b = 0; b < half; b += ns)
+        {
+            m_span(srcRe + b, srcIm + b, srcRe + b + half, srcIm + b + half, wRe, wIm,
+                   dstRe + 2 * b, dstIm + 2 * b, dstRe + 2 * b + ns, dstIm + 2 * b + ns, ns);
+        }
+        std::swap(srcRe, dstRe);
+        std::swap(srcIm, dstIm);
+    }
+
+    if (srcRe != a_re)
+    {
+        memcpy(a_re, srcRe, m_size * sizeof(float));
+        memcpy(a_im, srcIm, m_size * sizeof(float));
+    }
+}
+
+void cpuFft::inverseColumns(float* a_re, float* a_im, uint32_t a_stride, uint32_t a_width, float* a_tmpRe, float* a_tmpIm) const
+{
+    const uint32_t half = m_size / 2;
+
+    float*   srcRe = a_re;
+    float*   srcIm = a_im;
+    uint32_t srcStride = a_stride;
+    float*   dstRe = a_tmpRe;
+    float*   dstIm = a_tmpIm;
+    uint32_t dstStride = a_width;
+
+    // the same butterflies as inverseRow(), on whole row segments
+    //
+    for (uint32_t ns = 1; ns < m_size; ns *= 2)
+    {
+        for (uint32_t j = 0; j < half; j++)
+        {
+            const uint32_t k = j & (ns - 1);
+            const uint32_t o = (j - k) * 2 + k;
+            m_const(srcRe + size_t(j) * srcStride, srcIm + size_t(j) * srcStride,
+                    srcRe + size_t(j + half) * srcStride, srcIm + size_t(j + half) * srcStride,
+                    m_twRe[ns - 1 + k], m_twIm[ns - 1 + k],
+                    dstRe + size_t(o) * dstStride, dstIm + size_t(o) * dstStride,
+                    dstRe + size_t(o + ns) * dstStride, dstIm + size_t(o + ns) * dstStride, a_width);
+        }
+        std::swap(srcRe, dstRe);
+        std::swap(srcIm, dstIm);
+        std::swap(srcStride, dstStride);
+    }
+
+    if (srcRe != a_re)
+    {
+        for (uint32_t y = 0; y < m_size; y++)
+        {
+            memcpy(a_re + size_t(y) * a_stride, srcRe + size_t(y) * a_width, a_width * sizeof(float));
+            memcpy(a_im + size_t(y) * a_stride, srcIm + size_t(y) * a_width, a_width * sizeof(float));
+        }
+    }
+}
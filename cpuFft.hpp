@@ -0,0 +1,57 @@
+#ifndef WATERAPP_CPUFFT_HPP
+#define WATERAPP_CPUFFT_HPP
+#include <cstdint>
+#include <vector>
+
+#include "cpuWaterSolver.hpp"
+
+namespace app
+{
+
+// Inverse complex FFT (positive exponent, no scaling) of a power-of-two size on split arrays: real and imaginary
+// parts live in separate arrays (SoA), so a SIMD register holds the same part of consecutive values.
+//
+// Radix-2 Stockham like shaders/oceanFft.comp: every stage reads one array and writes the other in natural
+// order, no bit reversal pass. A stage is a set of spans of butterflies; inverseRow() transforms one row, its
+// spans grow from 1 to size/2 values with a twiddle per value. inverseColumns() transforms a block of columns
+// at once: its spans are row segments sharing one twiddle, so every stage is fully vectorized.
+//
+class cpuFft
+{
+public:
+    typedef cpuWaterSolver::simdLevel simdLevel;
+
+    void init(uint32_t a_size, simdLevel a_maxSimd = cpuWaterSolver::SIMD_AVX2);
+
+    // a_re, a_im: size values, transformed in place; a_tmpRe, a_tmpIm: size values of scratch
+    //
+    void inverseRow(float* a_re, float* a_im, float* a_tmpRe, float* a_tmpIm) const;
+
+    // a_width columns starting at a_re/a_im of a plane with a_stride floats per row, transformed in place;
+    // a_tmpRe, a_tmpIm: size * a_width values of scratch
+    //
+    void inverseColumns(float* a_re, float* a_im, uint32_t a_stride, uint32_t a_width, float* a_tmpRe, float* a_tmpIm) const;
+
+    uint32_t  size() const       { return m_size; }
+    uint32_t  stageCount() const { return m_stages; }   // log2(size) per direction
+    simdLevel simd() const       { return m_simd; }
+
+    // o0 = a + w b, o1 = a - w b over a_count values; twiddles per value, or one for all
+    //
+    typedef void (*spanKernel)(const float* a_aRe, const float* a_aIm, const float* a_bRe, const float* a_bIm,
+                               const float* a_wRe, const float* a_wIm, float* a_o0Re, float* a_o0Im, float* a_o1Re, float* a_o1Im, uint32_t a_count);
+    typedef void (*constKernel)(const float* a_aRe, const float* a_aIm, const float* a_bRe, const float* a_bIm,
+                                float a_wRe, float a_wIm, float* a_o0Re, float* a_o0Im, float* a_o1Re, float* a_o1Im, uint32_t a_count);
+
+private:
+    uint32_t           m_size   = 0;
+    uint32_t           m_stages = 0;
+    std::vector<float> m_twRe;   // stage with sub-transform length ns: ns twiddles exp(i pi k / ns) at offset ns - 1
+    std::vector<float> m_twIm;
+    simdLevel          m_simd   = cpuWaterSolver::SIMD_SCALAR;
+    spanKernel         m_span   = nullptr;
+    constKernel        m_const  = nullptr;
+};
+
+}
+#endif // WATERAPP_CPUFFT_HPP
@@ -0,0 +1,153 @@
+#include "cpuOcean.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+using namespace app;
+
+static double msSince(std::chrono::steady_clock::time_point a_start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - a_start).count();
+}
+
+void cpuOcean::init(const oceanSettings& a_settings, unsigned a_threads, simdLevel a_maxSimd)
+{
+    a_settings.validate();
+    m_settings = a_settings;
+
+    const size_t n2 = size_t(a_settings.size) * a_settings.size;
+    m_initial.resize(n2 * 4 * a_settings.cascades);
+    for (uint32_t c = 0; c < a_settings.cascades; c++)
+        initialSpectrum(a_settings, c, m_initial.data() + n2 * 4 * c);
+
+    m_re.assign(n2 * 4 * a_settings.cascades, 0.0f);
+    m_im.assign(n2 * 4 * a_settings.cascades, 0.0f);
+
+    m_fft.init(a_settings.size, a_maxSimd);
+    m_pool.reset(new threadPool(a_threads));
+    m_scratch.resize(size_t(m_pool->threadCount()) * 2 * a_settings.size * COLUMN_BLOCK);
+}
+
+void cpuOcean::evaluate(float a_time, float* a_pHeights, float* a_pMaps)
+{
+    const uint32_t n        = m_settings.size;
+    const uint32_t cascades = m_settings.cascades;
+    const size_t   scratch  = size_t(2) * n * COLUMN_BLOCK;
+
+    auto start = std::chrono::steady_clock::now();
+    m_pool->parallelFor(cascades * n, std::function<void(uint32_t)>([this, a_time](uint32_t a_row) { spectrumRow(a_row, a_time); }));
+    m_spectrumMs = msSince(start);
+
+    // rows of every plane, then column blocks of every plane
+    //
+    start = std::chrono::steady_clock::now();
+    m_pool->parallelFor(cascades * 4 * n, std::function<void(uint32_t, unsigned)>([&](uint32_t a_row, unsigned a_thread)
+    {
+        const uint32_t plane = a_row / n, y = a_row % n;
+        float* tmp = m_scratch.data() + a_thread * scratch;
+        m_fft.inverseRow(planeRe(plane / 4, plane % 4) + size_t(y) * n, planeIm(plane / 4, plane % 4) + size_t(y) * n, tmp, tmp + n);
+    }));
+    const uint32_t blocks = n / COLUMN_BLOCK;
+    m_pool->parallelFor(cascades * 4 * blocks, std::function<void(uint32_t, unsigned)>([&](uint32_t a_block, unsigned a_thread)
+    {
+        const uint32_t plane = a_block / blocks, x = (a_block % blocks) * COLUMN_BLOCK;
+        float* tmp = m_scratch.data() + a_thread * scratch;
+        m_fft.inverseColumns(planeRe(plane / 4, plane % 4) + x, planeIm(plane / 4, plane % 4) + x, n, COLUMN_BLOCK,
+                             tmp, tmp + size_t(n) * COLUMN_BLOCK);
+    }));
+    m_fftMs = msSince(start);
+
+    start = std::chrono::steady_clock::now();
+    m_pool->parallelFor(n, std::function<void(uint32_t)>([this, a_pHeights, a_pMaps](uint32_t a_y) { resolveRow(a_y, a_pHeights, a_pMaps); }));
+    m_resolveMs = msSince(start);
+}
+
+void cpuOcean::spectrumRow(uint32_t a_row, float a_time)
+{
+    const uint32_t n      = m_settings.size;
+    const uint32_t c      = a_row / n;
+    const uint32_t y      = a_row % n;
+    const float    dk     = 2.0f * 3.14159265f / m_settings.cascadeLength(c);
+    const float    lambda = m_settings.choppiness;
+
+    const float* initial = m_initial.data() + ((size_t(c) * n + y) * n) * 4;
+    const size_t row     = size_t(y) * n;
+    float* re[4];
+    float* im[4];
+    for (uint32_t f = 0; f < 4; f++)
+    {
+        re[f] = planeRe(c, f) + row;
+        im[f] = planeIm(c, f) + row;
+    }
+
+    // the formulas of shaders/oceanSpectrum.comp, written out for real and imaginary parts:
+    //   h(k, t) = h0(k) e^(iwt) + conj(h0(-k)) e^(-iwt),  D = -i lambda k/|k| h,  S = i k h,  dD/dx = i k_x D
+    //   planes: h + i Dx, Dz + i Sx, Sz + i dDx/dx, dDz/dz + i dDx/dz
+    //
+    const float kz = (float(y) - float(n / 2)) * dk;
+    for (uint32_t x = 0; x < n; x++)
+    {
+        const float  kx   = (float(x) - float(n / 2)) * dk;
+        const float  k    = sqrtf(kx * kx + kz * kz);
+        const float  nx   = k > 1e-6f ? kx / k : 0.0f;
+        const float  nz   = k > 1e-6f ? kz / k : 0.0f;
+        const float  w    = sqrtf(m_settings.gravity * k) * a_time;
+        const float  er   = cosf(w), ei = sinf(w);
+        const float* h0   = initial + size_t(x) * 4;
+        const float  hr   = (h0[0] * er - h0[1] * ei) + (h0[2] * er + h0[3] * ei);
+        const float  hi   = (h0[0] * ei + h0[1] * er) + (h0[3] * er - h0[2] * ei);
+
+        // i * (-i lambda nx h) = lambda nx h, i * (i kx h) = -kx h, i * (lambda kx nx h) = i lambda kx nx h
+        //
+        re[0][x] = hr + lambda * nx * hr;
+        im[0][x] = hi + lambda * nx * hi;
+        re[1][x] =  lambda * nz * hi - kx * hr;
+        im[1][x] = -lambda * nz * hr - kx * hi;
+        re[2][x] = -(kz + lambda * kx * nx) * hi;
+        im[2][x] =  (kz + lambda * kx * nx) * hr;
+        re[3][x] = lambda * kz * nz * hr - lambda * kz * nx * hi;
+        im[3][x] = lambda * kz * nz * hi + lambda * kz * nx * hr;
+    }
+}
+
+void cpuOcean::resolveRow(uint32_t a_y, float* a_pHeights, float* a_pMaps) const
+{
+    const uint32_t n  = m_settings.size;
+    const size_t   n2 = size_t(n) * n;
+    const float    u  = m_settings.unitsPerMetre;
+
+    const float* re = m_re.data();
+    const float* im = m_im.data();
+
+    for (uint32_t x = 0; x < n; x++)
+    {
+        // the transform ran over wave numbers shifted by size/2, shifting back flips every other texel
+        //
+        const float sign = ((x + a_y) & 1) ? -1.0f : 1.0f;
+        const size_t i   = size_t(a_y) * n + x;
+
+        float    height = 0.0f;
+        uint32_t scale  = 1;
+        for (uint32_t c = 0; c < m_settings.cascades; c++)
+        {
+            const size_t plane = size_t(c) * 4 * n2;
+            float* out = a_pMaps + (size_t(c) * n2 + i) * 8;
+            out[0] = im[plane + 0 * n2 + i] * sign * u;   // dx
+            out[1] = re[plane + 0 * n2 + i] * sign * u;   // height
+            out[2] = re[plane + 1 * n2 + i] * sign * u;   // dz
+            out[3] = im[plane + 2 * n2 + i] * sign;       // d dx / dx
+            out[4] = im[plane + 1 * n2 + i] * sign;       // slope x
+            out[5] = re[plane + 2 * n2 + i] * sign;       // slope z
+            out[6] = re[plane + 3 * n2 + i] * sign;       // d dz / dz
+            out[7] = im[plane + 3 * n2 + i] * sign;       // d dx / dz
+
+            // the heights buffer is on the grid of cascade 0, finer cascades repeat over it and are point sampled
+            //
+            const uint32_t qx = (x * scale) % n, qy = (a_y * scale) % n;
+            height += re[plane + size_t(qy) * n + qx] * (((qx + qy) & 1) ? -1.0f : 1.0f);
+            scale  *= oceanSettings::CASCADE_RATIO;
+        }
+        a_pHeights[i] = height * m_settings.heightUnitsPerMetre;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef WATERAPP_CPUOCEAN_HPP
+#define WATERAPP_CPUOCEAN_HPP
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "cpuFft.hpp"
+#include "oceanSpectrum.hpp"
+#include "threadPool.hpp"
+
+namespace app
+{
+
+// CPU version of the oceanFft passes (shaders/oceanSpectrum.comp, oceanFft.comp, oceanResolve.comp), used to
+// validate the GPU results and instead of them where Vulkan compute is slow (software ICDs).
+//
+// Same fields, packing and output layouts as the GPU: per cascade four complex planes, each the spectrum of two
+// real fields, stored split (real and imaginary planes apart) for cpuFft. The rows of all planes are transformed
+// in parallel, then blocks of COLUMN_BLOCK columns, every block a vectorized transform over its row segments.
+//
+class cpuOcean
+{
+public:
+    static const uint32_t COLUMN_BLOCK = 32;
+
+    typedef cpuFft::simdLevel simdLevel;
+
+    // a_threads: 0 - one per hardware thread
+    //
+    void init(const oceanSettings& a_settings, unsigned a_threads = 0, simdLevel a_maxSimd = cpuWaterSolver::SIMD_AVX2);
+
+    // The ocean at a_time: a_pHeights gets size^2 floats laid out like oceanFft::heightBuffer(), a_pMaps
+    // cascades * size^2 * 8 floats like oceanFft::mapBuffer(). Both may point into mapped staging memory.
+    //
+    void evaluate(float a_time, float* a_pHeights, float* a_pMaps);
+
+    const oceanSettings& settings() const    { return m_settings; }
+    simdLevel            simd() const        { return m_fft.simd(); }
+    unsigned             threadCount() const { return m_pool ? m_pool->threadCount() : 0; }
+
+    // ms, stages of the last evaluate()
+    //
+    double spectrumMs() const { return m_spectrumMs; }
+    double fftMs() const      { return m_fftMs; }
+    double resolveMs() const  { return m_resolveMs; }
+
+private:
+    void spectrumRow(uint32_t a_row, float a_time);   // a_row: cascade * size + y
+    void resolveRow (uint32_t a_y, float* a_pHeights, float* a_pMaps) const;
+
+    float* planeRe(uint32_t a_cascade, uint32_t a_field) { return m_re.data() + (size_t(a_cascade) * 4 + a_field) * m_settings.size * m_settings.size; }
+    float* planeIm(uint32_t a_cascade, uint32_t a_field) { return m_im.data() + (size_t(a_cascade) * 4 + a_field) * m_settings.size * m_settings.size; }
+
+    oceanSettings               m_settings;
+    std::vector<float>          m_initial;    // initialSpectrum() of every cascade
+    std::vector<float>          m_re;         // [cascade][field][y][x]
+    std::vector<float>          m_im;
+    std::vector<float>          m_scratch;    // per thread, 2 * size * COLUMN_BLOCK floats
+    cpuFft                      m_fft;
+    std::unique_ptr<threadPool> m_pool;
+    double                      m_spectrumMs = 0.0;
+    double                      m_fftMs      = 0.0;
+    double                      m_resolveMs  = 0.0;
+};
+
+}
+#endif // WATERAPP_CPUOCEAN_HPP
@@ -0,0 +1,184 @@
+#include "cpuWaterSolver.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WATERAPP_X86 1
+#endif
+
+using namespace app;
+
+// One cell of the stencil, operation order matches shaders/waterSim.comp.
+//
+static inline float waveCell(float a_l, float a_r, float a_u, float a_d, float a_h, float a_prev, float a_c2, float a_damping)
+{
+    float lap = ((a_l + a_r) + (a_u + a_d)) - 4.0f * a_h;
+    return ((2.0f * a_h - a_prev) + a_c2 * lap) * a_damping;
+}
+
+// Border cells clamp their left/right neighbour to the row, the same way the shader does.
+//
+static inline void waveCellClamped(const float* a_up, const float* a_row, const float* a_down, float* a_prev,
+                                   uint32_t a_x, uint32_t a_n, float a_c2, float a_damping)
+{
+    const uint32_t xl = (a_x > 0)       ? a_x - 1 : 0;
+    const uint32_t xr = (a_x + 1 < a_n) ? a_x + 1 : a_n - 1;
+    a_prev[a_x] = waveCell(a_row[xl], a_row[xr], a_up[a_x], a_down[a_x], a_row[a_x], a_prev[a_x], a_c2, a_damping);
+}
+
+static void waveRowScalar(const float* a_up, const float* a_row, const float* a_down, float* a_prev,
+                          uint32_t a_x0, uint32_t a_x1, uint32_t a_n, float a_c2, float a_damping)
+{
+    for (uint32_t x = a_x0; x < a_x1; x++)
+        waveCellClamped(a_up, a_row, a_down, a_prev, x, a_n, a_c2, a_damping);
+}
+
+#ifdef WATERAPP_X86
+
+// Vector kernels process the interior [1, n-1) of the span and leave the two border cells to the scalar path.
+//
+__attribute__((target("sse2")))
+static void waveRowSSE2(const float* a_up, const float* a_row, const float* a_down, float* a_prev,
+                        uint32_t a_x0, uint32_t a_x1, uint32_t a_n, float a_c2, float a_damping)
+{
+    const uint32_t begin = std::max(a_x0, 1u);
+    const uint32_t end   = std::min(a_x1, a_n - 1);
+
+    const __m128 four    = _mm_set1_ps(4.0f);
+    const __m128 two     = _mm_set1_ps(2.0f);
+    const __m128 c2      = _mm_set1_ps(a_c2);
+    const __m128 damping = _mm_set1_ps(a_damping);
+
+    uint32_t x = begin;
+    for (; x + 4 <= end; x += 4)
+    {
+        __m128 h   = _mm_loadu_ps(a_row + x);
+        __m128 l   = _mm_loadu_ps(a_row + x - 1);
+        __m128 r   = _mm_loadu_ps(a_row + x + 1);
+        __m128 u   = _mm_loadu_ps(a_up + x);
+        __m128 d   = _mm_loadu_ps(a_down + x);
+        __m128 p   = _mm_loadu_ps(a_prev + x);
+        __m128 lap = _mm_sub_ps(_mm_add_ps(_mm_add_ps(l, r), _mm_add_ps(u, d)), _mm_mul_ps(four, h));
+        __m128 res = _mm_mul_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(two, h), p), _mm_mul_ps(c2, lap)), damping);
+        _mm_storeu_ps(a_prev + x, res);
+    }
+
+    for (; x < end; x++)
+        waveCellClamped(a_up, a_row, a_down, a_prev, x, a_n, a_c2, a_damping);
+
+    if (a_x0 == 0)
+        waveCellClamped(a_up, a_row, a_down, a_prev, 0, a_n, a_c2, a_damping);
+    if (a_x1 == a_n && a_n > 1)
+        waveCellClamped(a_up, a_row, a_down, a_prev, a_n - 1, a_n, a_c2, a_damping);
+}
+
+__attribute__((target("avx2")))
+static void waveRowAVX2(const float* a_up, const float* a_row, const float* a_down, float* a_prev,
+                        uint32_t a_x0, uint32_t a_x1, uint32_t a_n, float a_c2, float a_damping)
+{
+    const uint32_t begin = std::max(a_x0, 1u);
+    const uint32_t end   = std::min(a_x1, a_n - 1);
+
+    const __m256 four    = _mm256_set1_ps(4.0f);
+    const __m256 two     = _mm256_set1_ps(2.0f);
+    const __m256 c2      = _mm256_set1_ps(a_c2);
+    const __m256 damping = _mm256_set1_ps(a_damping);
+
+    // no FMA on purpose: separate mul/add keeps the rounding identical to the scalar and SSE2 paths
+    //
+    uint32_t x = begin;
+    for (; x + 8 <= end; x += 8)
+    {
+        __m256 h   = _mm256_loadu_ps(a_row + x);
+        __m256 l   = _mm256_loadu_ps(a_row + x - 1);
+        __m256 r   = _mm256_loadu_ps(a_row + x + 1);
+        __m256 u   = _mm256_loadu_ps(a_up + x);
+        __m256 d   = _mm256_loadu_ps(a_down + x);
+        __m256 p   = _mm256_loadu_ps(a_prev + x);
+        __m256 lap = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(l, r), _mm256_add_ps(u, d)), _mm256_mul_ps(four, h));
+        __m256 res = _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(two, h), p), _mm256_mul_ps(c2, lap)), damping);
+        _mm256_storeu_ps(a_prev + x, res);
+    }
+
+    for (; x < end; x++)
+        waveCellClamped(a_up, a_row, a_down, a_prev, x, a_n, a_c2, a_damping);
+
+    if (a_x0 == 0)
+        waveCellClamped(a_up, a_row, a_down, a_prev, 0, a_n, a_c2, a_damping);
+    if (a_x1 == a_n && a_n > 1)
+        waveCellClamped(a_up, a_row, a_down, a_prev, a_n - 1, a_n, a_c2, a_damping);
+}
+
+#endif
+
+const char* cpuWaterSolver::simdName(simdLevel a_level)
+{
+    static const char* names[] = { "scalar", "sse2", "avx2" };
+    return names[a_level];
+}
+
+void cpuWaterSolver::init(uint32_t a_gridSize, const std::vector<float>& a_initialHeights, unsigned a_threads, simdLevel a_maxSimd)
+{
+    if (a_gridSize < 2 || a_initialHeights.size() != size_t(a_gridSize) * a_gridSize)
+        throw std::runtime_error("[cpuWaterSolver::init]: bad grid size or initial heights!");
+
+    m_gridSize  = a_gridSize;
+    m_tilesX    = (a_gridSize + TILE_COLUMNS - 1) / TILE_COLUMNS;
+    m_tilesY    = (a_gridSize + TILE_ROWS - 1) / TILE_ROWS;
+    m_fields[0] = a_initialHeights;
+    m_fields[1] = a_initialHeights;
+    m_current   = 0;
+
+    m_simd   = SIMD_SCALAR;
+    m_kernel = waveRowScalar;
+#ifdef WATERAPP_X86
+    __builtin_cpu_init();
+    if (a_maxSimd >= SIMD_AVX2 && __builtin_cpu_supports("avx2"))
+    {
+        m_simd   = SIMD_AVX2;
+        m_kernel = waveRowAVX2;
+    }
+    else if (a_maxSimd >= SIMD_SSE2 && __builtin_cpu_supports("sse2"))
+    {
+        m_simd   = SIMD_SSE2;
+        m_kernel = waveRowSSE2;
+    }
+#else
+    (void)a_maxSimd;
+#endif
+
+    m_pool.reset(new threadPool(a_threads));
+}
+
+void cpuWaterSolver::step(uint32_t a_steps)
+{
+    // parallelFor returns after the last tile, which is the barrier between two steps
+    //
+    std::function<void(uint32_t)> job = [this](uint32_t a_tile) { stepTile(a_tile); };
+    for (uint32_t i = 0; i < a_steps; i++)
+    {
+        m_pool->parallelFor(m_tilesX * m_tilesY, job);
+        m_current = 1 - m_current;
+    }
+}
+
+void cpuWaterSolver::stepTile(uint32_t a_tile)
+{
+    const uint32_t n  = m_gridSize;
+    const uint32_t tx = a_tile % m_tilesX;
+    const uint32_t ty = a_tile / m_tilesX;
+    const uint32_t x0 = tx * TILE_COLUMNS, x1 = std::min(x0 + TILE_COLUMNS, n);
+    const uint32_t y0 = ty * TILE_ROWS,    y1 = std::min(y0 + TILE_ROWS, n);
+
+    const float* cur  = m_fields[m_current].data();
+    float*       prev = m_fields[1 - m_current].data();
+
+    for (uint32_t y = y0; y < y1; y++)
+    {
+        const float* up   = cur + size_t(y > 0 ? y - 1 : 0) * n;
+        const float* down = cur + size_t(y + 1 < n ? y + 1 : n - 1) * n;
+        m_kernel(up, cur + size_t(y) * n, down, prev + size_t(y) * n, x0, x1, n, waveSpeed2, damping);
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef WATERAPP_CPUWATERSOLVER_HPP
+#define WATERAPP_CPUWATERSOLVER_HPP
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "threadPool.hpp"
+
+namespace app
+{
+
+// CPU version of shaders/waterSim.comp, used to validate the GPU results and as a fallback
+// where Vulkan compute is slow (software ICDs).
+//
+// Same ping-pong scheme as waterSimulation: two height fields stored as separate arrays (SoA), a step reads
+// one and overwrites the other. The stencil is evaluated in the same operation order as the shader, so
+// results match the GPU up to FMA contraction done by the shader compiler.
+//
+// The grid is split into tiles of TILE_ROWS x TILE_COLUMNS cells (three source rows of a tile fit into L1,
+// the whole tile source into L2) and the tiles of a step are distributed over a thread pool.
+//
+class cpuWaterSolver
+{
+public:
+    static const uint32_t TILE_ROWS    = 32;
+    static const uint32_t TILE_COLUMNS = 1024;
+
+    enum simdLevel { SIMD_SCALAR = 0, SIMD_SSE2, SIMD_AVX2 };
+
+    float waveSpeed2 = 0.25f;
+    float damping    = 0.998f;
+
+    // a_threads: 0 - one per hardware thread; a_maxSimd limits the kernel, e.g. SIMD_SCALAR for a reference run
+    //
+    void init(uint32_t a_gridSize, const std::vector<float>& a_initialHeights, unsigned a_threads = 0, simdLevel a_maxSimd = SIMD_AVX2);
+    void step(uint32_t a_steps);
+
+    // after an even number of steps this is the same buffer as waterSimulation::heightBuffer(0)
+    //
+    const float* heights() const   { return m_fields[m_current].data(); }
+    uint32_t     gridSize() const  { return m_gridSize; }
+    simdLevel    simd() const      { return m_simd; }
+    unsigned     threadCount() const { return m_pool ? m_pool->threadCount() : 0; }
+
+    static const char* simdName(simdLevel a_level);
+
+private:
+    typedef void (*rowKernel)(const float* a_up, const float* a_row, const float* a_down, float* a_prev,
+                              uint32_t a_x0, uint32_t a_x1, uint32_t a_n, float a_c2, float a_damping);
+
+    void stepTile(uint32_t a_tile);
+
+    uint32_t                    m_gridSize = 0;
+    uint32_t                    m_tilesX   = 0;
+    uint32_t                    m_tilesY   = 0;
+    std::vector<float>          m_fields[2];
+    int                         m_current  = 0;   // field holding the newest heights
+    simdLevel                   m_simd     = SIMD_SCALAR;
+    rowKernel                   m_kernel   = nullptr;
+    std::unique_ptr<threadPool> m_pool;
+};
+
+}
+#endif // WATERAPP_CPUWATERSOLVER_HPP
@@ -1,19 +1,276 @@
 #include "createApp.hpp"
 
+#include <chrono>
+
 using namespace std;
 using namespace app;
 
-const bool enableValidationLayers = true;
-#ifdef QT_NO_DEBUG*/
-const bool enableValidationLayers = false;
-#endif
+static double elapsedMs(std::chrono::steady_clock::time_point a_start, std::chrono::steady_clock::time_point a_end)
+{
+    return std::chrono::duration<double, std::milli>(a_end - a_start).count();
+}
 
 void application::run()
 {
-    initWindow();
+    startup();
+    mainLoop();
+    cleanup();
+}
+
+void application::startup()
+{
+    settings.framesInFlight = std::max(1u, std::min(settings.framesInFlight, uint32_t(MAX_FRAMES_IN_FLIGHT)));
+    pacer.init(settings.maxFps);
+
+    if (!settings.headless) initWindow();
+
+    auto startupBegin = std::chrono::steady_clock::now();
     initVulkan();
     createResources();
-    mainLoop();
+    startupTime = elapsedMs(startupBegin, std::chrono::steady_clock::now());
+
+    std::cout << "[startup]: " << startupTime << " ms, pipelines " << pipelineCreateTime << " ms ("
+              << (pipelineCacheStore.warm() ? "warm" : "cold") << " pipeline cache)" << std::endl;
+}
+
+void application::runBenchmark(int a_warmupFrames, int a_frames, bool a_readbackLastFrame, benchmarkResults* a_pResults)
+{
+    startup();
+    a_pResults->startupTime        = startupTime;
+    a_pResults->pipelineCreateTime = pipelineCreateTime;
+    a_pResults->pipelineCacheWarm  = pipelineCacheStore.warm();
+    a_pResults->memoryStats        = allocator.stats();
+    a_pResults->setLayouts         = layoutCache.layoutCount();
+    a_pResults->setLayoutRequests  = layoutCache.requestCount();
+    a_pResults->frameUniformStride = constants.stride();
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    a_pResults->deviceName = props.deviceName;
+    a_pResults->presentMode = settings.headless ? "none" : presentModeName(m_presentMode);
+    a_pResults->asyncCompute  = water.async();
+    a_pResults->computeFamily = m_computeFamily;
+    a_pResults->streamFamily  = m_transferFamily;
+    a_pResults->meshIndices   = waterMesh.indexType();
+    a_pResults->meshBytes     = waterMesh.bytes();
+    a_pResults->meshAcmr      = waterMesh.acmr();
+    a_pResults->meshTriangles = waterMesh.triangleCount();
+    a_pResults->depthFormat   = (m_depthFormat == VK_FORMAT_D32_SFLOAT) ? "D32_SFLOAT" : "D32_SFLOAT_S8_UINT";
+    a_pResults->msaaSamples     = uint32_t(m_samples);
+    a_pResults->passAttachments = m_passDesc.attachmentCount();
+    for (uint32_t i = 0; i < m_passDesc.attachmentCount(); i++)
+        a_pResults->transientAttachments += transientAttachment(i) ? 1 : 0;
+    a_pResults->lazyMemory        = (allocator.propertyFlags(screen.depthMemory) & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+    a_pResults->attachmentMB      = double(m_passDesc.attachmentTraffic(screen.swapChainExtent.width, screen.swapChainExtent.height)) / (1024.0 * 1024.0);
+    a_pResults->attachmentNaiveMB = double(m_passDesc.attachmentTraffic(screen.swapChainExtent.width, screen.swapChainExtent.height, true)) / (1024.0 * 1024.0);
+    a_pResults->reflections       = reflectionQualityName(m_reflections ? reflections.quality() : REFLECTIONS_OFF);
+    if (m_reflections && reflections.quality() != REFLECTIONS_OFF)
+    {
+        // the scene in two passes: the attachments are stored after the first and loaded again by the second
+        //
+        const uint32_t width = screen.swapChainExtent.width, height = screen.swapChainExtent.height;
+        a_pResults->attachmentMB      = double(m_opaqueDesc.attachmentTraffic(width, height) + m_waterDesc.attachmentTraffic(width, height)) / (1024.0 * 1024.0);
+        a_pResults->attachmentNaiveMB = double(m_opaqueDesc.attachmentTraffic(width, height, true) + m_waterDesc.attachmentTraffic(width, height, true)) / (1024.0 * 1024.0);
+    }
+    if (settings.lod)
+        a_pResults->lodDraws = !m_gpuCulling ? "direct" : (culler.drawCount() ? "indirect count" : (culler.multiDraw() ? "multi draw indirect" : "indirect"));
+    a_pResults->objects         = floating.activeCount();
+    a_pResults->objectDraws     = floating.activeCount() > 0 ? uint32_t(FLOATING_TYPE_COUNT) : 0;
+    a_pResults->objectTriangles = floating.triangleCount();
+    a_pResults->particles       = particles.capacity();
+    a_pResults->particlesSorted = particles.sorted();
+    a_pResults->particleSortDispatches = particles.sortDispatches();
+    if (settings.fftOcean)
+    {
+        a_pResults->oceanPath       = settings.cpuSolver ? "cpu" : "gpu";
+        a_pResults->oceanSize       = ocean.size();
+        a_pResults->oceanCascades   = ocean.cascades();
+        a_pResults->oceanDispatches = settings.cpuSolver ? 0 : ocean.fftDispatches() + 2;
+    }
+
+    for (int i = 0; i < a_warmupFrames; i++)
+    {
+        pollInput();
+        drawFrame();
+    }
+    vkDeviceWaitIdle(device);
+
+    a_pResults->frameTimes.resize(a_frames);
+    a_pResults->submitTimes.resize(a_frames);
+
+    const int  fullWidth  = settings.width;
+    const int  fullHeight = settings.height;
+    bool       halfSize   = false;
+    m_recreateTimes.clear();
+
+    auto benchStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < a_frames; i++)
+    {
+        if (settings.resizeEvery > 0 && i % settings.resizeEvery == settings.resizeEvery - 1)
+        {
+            halfSize = !halfSize;
+            requestResize(halfSize ? std::max(fullWidth / 2, 1) : fullWidth, halfSize ? std::max(fullHeight / 2, 1) : fullHeight);
+        }
+
+        auto frameStart = std::chrono::steady_clock::now();
+        pollInput();
+        drawFrame();
+        a_pResults->frameTimes[i]  = elapsedMs(frameStart, std::chrono::steady_clock::now());
+        a_pResults->submitTimes[i] = lastSubmitTime;
+        a_pResults->uploadBytes   += double(uploadRing.frameBytes());
+        if (settings.lod && m_gpuCulling)
+        {
+            a_pResults->lodPatches.push_back(double(m_lodNodes));
+            a_pResults->lodTriangles.push_back(double(culler.candidateCount()) * (oceanLod.patchRes / 2) * (oceanLod.patchRes / 2) * 2);
+        }
+        else if (settings.lod)
+        {
+            a_pResults->lodPatches.push_back(double(oceanLod.patches().size()));
+            a_pResults->lodTriangles.push_back(double(oceanLod.triangleCount()));
+        }
+        if (settings.fftOcean && settings.cpuSolver)
+        {
+            a_pResults->oceanSpectrumTimes.push_back(cpuWaves.spectrumMs());
+            a_pResults->oceanFftTimes.push_back(cpuWaves.fftMs());
+            a_pResults->oceanResolveTimes.push_back(cpuWaves.resolveMs());
+        }
+        if (m_reflections)
+            a_pResults->reflectionSteps.push_back(m_reflecting ? double(reflections.steps()) : 0.0);
+    }
+    vkDeviceWaitIdle(device);
+    a_pResults->totalTime     = elapsedMs(benchStart, std::chrono::steady_clock::now());
+    a_pResults->recreateTimes = m_recreateTimes;
+    a_pResults->heightmapTime = m_heightmapTime;
+    a_pResults->frameSets       = framePools.frameSets();
+    a_pResults->descriptorPools = framePools.poolCount();
+    {
+        const renderGraphStats& graph = m_graph.stats();
+        a_pResults->graphPasses          = graph.passes;
+        a_pResults->graphCulledPasses    = graph.culledPasses;
+        a_pResults->graphBufferBarriers  = graph.bufferBarriers;
+        a_pResults->graphImageBarriers   = graph.imageBarriers;
+        a_pResults->transientUnaliasedMB = double(graph.unaliasedBytes) / (1024.0 * 1024.0);
+    }
+    if (particles.capacity() > 0)
+    {
+        uint32_t state[particleSystem::STATE_WORDS];
+        readbackBuffer_Now(device, &allocator, commandPool, graphicsQueue, particles.stateBuffer(), sizeof(state), state);
+        a_pResults->particlesAlive = state[particleSystem::STATE_ALIVE];
+    }
+
+    profiler.collectAll(device);
+    std::vector<frameRecord> records = profiler.records();
+    for (size_t i = (records.size() > size_t(a_frames)) ? records.size() - a_frames : 0; i < records.size(); i++)
+    {
+        if (records[i].gpuValid & (1u << GPU_SCOPE_FRAME))
+            a_pResults->gpuFrameTimes.push_back(records[i].gpu[GPU_SCOPE_FRAME]);
+        if (records[i].statsValid)
+        {
+            a_pResults->vsInvocations.push_back(double(records[i].stats[STAT_VS_INVOCATIONS]));
+            a_pResults->fsInvocations.push_back(double(records[i].stats[STAT_FS_INVOCATIONS]));
+            if (records[i].renderPixels > 0)
+                a_pResults->overdraw.push_back(double(records[i].stats[STAT_FS_INVOCATIONS]) / double(records[i].renderPixels));
+        }
+        if (records[i].gpuValid & (1u << GPU_SCOPE_SIMULATION))
+            a_pResults->simulationTimes.push_back(records[i].gpu[GPU_SCOPE_SIMULATION]);
+        if ((records[i].gpuValid & (1u << GPU_SCOPE_PARTICLES)) && particles.capacity() > 0)
+            a_pResults->particleTimes.push_back(records[i].gpu[GPU_SCOPE_PARTICLES]);
+        if ((records[i].gpuValid & (1u << GPU_SCOPE_OCEAN_FFT)) && settings.fftOcean && !settings.cpuSolver)
+        {
+            a_pResults->oceanSpectrumTimes.push_back(records[i].gpu[GPU_SCOPE_OCEAN_SPECTRUM]);
+            a_pResults->oceanFftTimes.push_back(records[i].gpu[GPU_SCOPE_OCEAN_FFT]);
+            a_pResults->oceanResolveTimes.push_back(records[i].gpu[GPU_SCOPE_OCEAN_RESOLVE]);
+        }
+        if (records[i].gpuValid & (1u << GPU_SCOPE_REFLECTIONS))
+            a_pResults->reflectionTimes.push_back(records[i].gpu[GPU_SCOPE_REFLECTIONS]);
+        a_pResults->recordTimes.push_back(records[i].cpu[CPU_SCOPE_RECORD]);
+        a_pResults->renderScales.push_back(records[i].renderScale);
+        a_pResults->graphBarriers.push_back(double(records[i].barriers));
+        a_pResults->transientMB.push_back(double(records[i].transientBytes) / (1024.0 * 1024.0));
+        a_pResults->peakBlockMB = std::max(a_pResults->peakBlockMB, double(records[i].memoryBlockBytes) / (1024.0 * 1024.0));
+        a_pResults->peakUsedMB  = std::max(a_pResults->peakUsedMB,  double(records[i].memoryUsedBytes)  / (1024.0 * 1024.0));
+        if (records[i].inputLatency >= 0.0)
+            a_pResults->inputLatencies.push_back(records[i].inputLatency);
+    }
+
+    if (settings.objectSweep && floating.capacity() > 0)
+    {
+        // the draw calls stay at one per object type, only their instance counts double from point to point
+        //
+        const int sweepFrames = std::max(a_frames / 4, 30);
+        for (uint32_t count = std::max(floating.capacity() / 64, 1u); ; count = std::min(count * 2, floating.capacity()))
+        {
+            floating.setActiveCount(count);
+            a_pResults->objectSweep.push_back(measureSweepPoint(floating.activeCount(), sweepFrames));
+
+            if (count == floating.capacity())
+                break;
+        }
+        floating.setActiveCount(floating.capacity());
+    }
+
+    if (settings.cullSweep && m_gpuCulling)
+    {
+        // the same ocean in more and more levels: every level has four times the candidates of the one before, while
+        // the selection only gains a ring of patches, so the cull pass grows with the candidates and the CPU work should not
+        //
+        const int      sweepFrames = std::max(a_frames / 4, 30);
+        const uint32_t levels      = oceanLod.levels;
+        for (uint32_t level = 1; level <= levels; level++)
+        {
+            vkDeviceWaitIdle(device);
+            oceanLod.levels = level;
+            uploadLodNodes();
+            a_pResults->cullSweep.push_back(measureSweepPoint(culler.candidateCount(), sweepFrames));
+        }
+    }
+
+    if (settings.validateSolver && !settings.cpuSolver && settings.fftOcean)
+    {
+        // the last frame's ocean evaluated again on the CPU; differences come from sin/cos precision and summation order
+        //
+        std::vector<float> gpuHeights(size_t(ocean.size()) * ocean.size());
+        readbackBuffer_Now(device, &allocator, commandPool, graphicsQueue, ocean.heightBuffer(), gpuHeights.size() * sizeof(float), gpuHeights.data());
+
+        cpuOcean reference;
+        reference.init(ocean.settings(), settings.solverThreads);
+
+        std::vector<float> heights(gpuHeights.size());
+        std::vector<float> maps(size_t(ocean.mapBufferSize() / sizeof(float)));
+        reference.evaluate(m_oceanTime, heights.data(), maps.data());
+
+        double maxError = 0.0;
+        for (size_t i = 0; i < gpuHeights.size(); i++)
+            maxError = std::max(maxError, double(std::fabs(gpuHeights[i] - heights[i])));
+        a_pResults->solverMaxError = maxError;
+    }
+    else if (settings.validateSolver && !settings.cpuSolver)
+    {
+        // same initial state and step count on the CPU; results differ only where the shader compiler fused mul+add
+        //
+        std::vector<float> gpuHeights(size_t(water.gridSize()) * water.gridSize());
+        readbackBuffer_Now(device, &allocator, commandPool, graphicsQueue, water.heightBuffer(0), gpuHeights.size() * sizeof(float), gpuHeights.data());
+
+        std::vector<float> heights;
+        water.initialHeights(&heights);
+
+        cpuWaterSolver reference;
+        reference.waveSpeed2 = water.waveSpeed2;
+        reference.damping    = water.damping;
+        reference.init(water.gridSize(), heights, settings.solverThreads);
+
+        a_pResults->solverSteps = water.stepCount();   // warm-up frames and any frame the profiler missed step the water too
+        reference.step(uint32_t(a_pResults->solverSteps));
+
+        double maxError = 0.0;
+        for (size_t i = 0; i < gpuHeights.size(); i++)
+            maxError = std::max(maxError, double(std::fabs(gpuHeights[i] - reference.heights()[i])));
+        a_pResults->solverMaxError = maxError;
+    }
+
+    if (a_readbackLastFrame && settings.headless)
+        readbackFrame(&a_pResults->lastFrame, &a_pResults->lastFrameWidth, &a_pResults->lastFrameHeight);
+
     cleanup();
 }
 
@@ -22,9 +279,53 @@ void application::initWindow(void)
     glfwInit();
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+
+    windowApp = glfwCreateWindow(settings.width, settings.height, "Water with Vulkan API", NULL, NULL);
+    glfwSetWindowUserPointer(windowApp, this);
+    glfwSetFramebufferSizeCallback(windowApp, framebufferResizeCallback);
+    glfwSetKeyCallback(windowApp, keyCallback);
+}
+
+void application::framebufferResizeCallback(GLFWwindow* a_window, int a_width, int a_height)
+{
+    // not every platform reports VK_ERROR_OUT_OF_DATE_KHR on resize, so remember it for the next present
+    //
+    auto pApp = reinterpret_cast<application*>(glfwGetWindowUserPointer(a_window));
+    pApp->m_framebufferResized = true;
+}
+
+void application::keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action, int a_mods)
+{
+    // R cycles the reflection presets: low, medium, high, off
+    //
+    if (a_key != GLFW_KEY_R || a_action != GLFW_PRESS)
+        return;
+
+    auto pApp = reinterpret_cast<application*>(glfwGetWindowUserPointer(a_window));
+    pApp->setReflectionQuality(reflectionQuality((pApp->settings.reflections + 1) % REFLECTION_QUALITY_COUNT));
+}
+
+void application::setReflectionQuality(reflectionQuality a_quality)
+{
+    if (!m_reflections)
+        return;
+
+    // the GPU times of the frames already recorded describe the old preset
+    //
+    settings.reflections  = a_quality;
+    reflections.setQuality(a_quality);
+    m_lastReflectionFrame = profiler.frameCount();
+
+    std::cout << "[waterReflections]: " << reflectionQualityName(a_quality) << std::endl;
+}
 
-    windowApp = glfwCreateWindow(WIDTH, HEIGHT, "Water with Vulkan API", NULL, NULL);
+void application::requestResize(int a_width, int a_height)
+{
+    if (settings.headless)
+        m_pendingExtent = { uint32_t(std::max(a_width, 1)), uint32_t(std::max(a_height, 1)) };
+    else
+        glfwSetWindowSize(windowApp, a_width, a_height);
 }
 
 VkPhysicalDevice application::findPhysicalDevice(VkInstance a_instance, bool a_printInfo, uint64_t a_preferredDeviceId)
@@ -62,32 +363,88 @@ VkPhysicalDevice application::findPhysicalDevice(VkInstance a_instance, bool a_p
 
 void application::initVulkan(void)
 {
-    const uint64_t deviceId = 0;
+    const uint64_t deviceId = settings.deviceId;
 
         vector<const char*> extensions;
+        if (!settings.headless)
         {
           uint32_t glfwExtensionCount = 0;
           const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
           extensions = vector<const char*>(glfwExtensions, glfwExtensions + glfwExtensionCount);
         }
 
-        instance = createInstance(enableValidationLayers, enabledLayers, extensions);
-        if (enableValidationLayers != 0) initDebugReportCallback(instance, &debugReportCallbackFn, &debugReportCallback);
+        instance = createInstance(settings.validation, enabledLayers, extensions);
+        if (settings.validation) initDebugReportCallback(instance, &debugReportCallbackFn, &debugReportCallback);
 
-        if (glfwCreateWindowSurface(instance, windowApp, NULL, &surface) != VK_SUCCESS)
+        if (!settings.headless && glfwCreateWindowSurface(instance, windowApp, NULL, &surface) != VK_SUCCESS)
             throw runtime_error("glfwCreateWindowSurface: failed to create window surface!");
 
         physicalDevice = findPhysicalDevice(instance, true, deviceId);
         uint32_t queueFID  = getQueueFamilyIndex(physicalDevice, VK_QUEUE_GRAPHICS_BIT);
 
-        VkBool32 presentSupport = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueFID, surface, &presentSupport);
-        if (presentSupport == VK_FALSE)
-            throw std::runtime_error("vkGetPhysicalDeviceSurfaceSupportKHR: no present support for the target device and graphics queue");
+        // the CPU solver has no dispatches to move, the heights come through the graphics queue uploads; the FFT ocean
+        // passes are short and read by the same frame, they stay on the graphics queue too
+        //
+        m_graphicsFamily = queueFID;
+        m_computeFamily  = (settings.asyncCompute && !settings.cpuSolver && !settings.fftOcean) ?
+                           findDedicatedQueueFamily(physicalDevice, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT, queueFID) : queueFID;
+
+        // a family with neither graphics nor compute is the DMA engine; streaming falls back to the graphics queue,
+        // which is fine since the streamer submits from the main thread as well
+        //
+        m_transferFamily = findDedicatedQueueFamily(physicalDevice, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, queueFID);
+
+        vector<uint32_t> queueFamilies = { m_graphicsFamily };
+        if (m_computeFamily != m_graphicsFamily)
+            queueFamilies.push_back(m_computeFamily);
+        if (m_transferFamily != m_graphicsFamily)
+            queueFamilies.push_back(m_transferFamily);
+
+        if (!settings.headless)
+        {
+            VkBool32 presentSupport = VK_FALSE;
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, queueFID, surface, &presentSupport);
+            if (presentSupport == VK_FALSE)
+                throw std::runtime_error("vkGetPhysicalDeviceSurfaceSupportKHR: no present support for the target device and graphics queue");
+        }
+
+        // pipeline statistics are optional, the profiler falls back to timestamps only; the secondary command buffers
+        // of the recording threads run inside the statistics query, which takes inheritedQueries
+        //
+        VkPhysicalDeviceFeatures supportedFeatures, enabledFeatures = {};
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        enabledFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+        enabledFeatures.inheritedQueries        = supportedFeatures.inheritedQueries;
+
+        // there is no surface to present to in headless mode, so VK_KHR_swapchain is not required
+        //
+        vector<const char*> enabledExtensions = settings.headless ? vector<const char*>() : deviceExtensions;
+
+        // GPU culling addresses the patches through firstInstance; multi draw and the draw count only save CPU calls
+        //
+        if (settings.lod && settings.gpuCulling)
+        {
+            if (supportedFeatures.drawIndirectFirstInstance)
+            {
+                m_gpuCulling        = true;
+                m_multiDraw         = supportedFeatures.multiDrawIndirect != VK_FALSE;
+                m_drawIndirectCount = hasDeviceExtension(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+                enabledFeatures.drawIndirectFirstInstance = VK_TRUE;
+                enabledFeatures.multiDrawIndirect         = supportedFeatures.multiDrawIndirect;
+                if (m_drawIndirectCount)
+                    enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            }
+            else
+                std::cout << "[gpuCuller]: no drawIndirectFirstInstance, the patches are culled and drawn from the CPU" << std::endl;
+        }
 
-        device = createLogicalDevice(queueFID, physicalDevice, enabledLayers, deviceExtensions);
+        device = createLogicalDevice(queueFamilies, physicalDevice, enabledLayers, enabledExtensions, enabledFeatures);
         vkGetDeviceQueue(device, queueFID, 0, &graphicsQueue);
         vkGetDeviceQueue(device, queueFID, 0, &presentQueue);
+        vkGetDeviceQueue(device, m_computeFamily, 0, &computeQueue);
+        vkGetDeviceQueue(device, m_transferFamily, 0, &streamQueue);
+
+        allocator.init(physicalDevice, device);
 
         {
             VkCommandPoolCreateInfo poolInfo = {};
@@ -98,44 +455,549 @@ void application::initVulkan(void)
                 throw std::runtime_error("[CreateCommandPoolAndBuffers]: failed to create command pool!");
         }
 
-        createCwapChain(physicalDevice, device, surface, WIDTH, HEIGHT, &screen);
+        if (m_computeFamily != m_graphicsFamily)
+        {
+            VkCommandPoolCreateInfo poolInfo = {};
+            poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+            poolInfo.queueFamilyIndex = m_computeFamily;
+
+            if (vkCreateCommandPool(device, &poolInfo, nullptr, &m_computePool) != VK_SUCCESS)
+                throw std::runtime_error("[initVulkan]: failed to create compute command pool!");
+
+            VkCommandBufferAllocateInfo allocInfo = {};
+            allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool        = m_computePool;
+            allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = settings.framesInFlight;
+
+            m_computeCmds.resize(settings.framesInFlight);
+            if (vkAllocateCommandBuffers(device, &allocInfo, m_computeCmds.data()) != VK_SUCCESS)
+                throw std::runtime_error("[initVulkan]: failed to allocate compute command buffers!");
+
+            uint32_t familyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, NULL);
+            vector<VkQueueFamilyProperties> families(familyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+            m_computeTimestamps = families[m_computeFamily].timestampValidBits != 0;
+
+            std::cout << "[initVulkan]: async compute on queue family " << m_computeFamily << std::endl;
+        }
+        else if (settings.asyncCompute && !settings.cpuSolver && !settings.fftOcean)
+            std::cout << "[initVulkan]: no separate compute queue family, simulating on the graphics queue" << std::endl;
+
+        m_scaledRendering = settings.dynamicResolution || settings.maxRenderScale < 1.0f;
+        m_reflections     = settings.reflections != REFLECTIONS_OFF;
+
+        if (settings.headless)
+            createOffscreenTargets(&allocator, device, settings.width, settings.height, settings.framesInFlight, &screen);
+        else
+            createCwapChain(physicalDevice, device, surface, settings.width, settings.height, VK_NULL_HANDLE, &screen);
 
         createScreenImageViews(device, &screen);
+
+        // the scene target has the output format, so the upscale is a single vkCmdBlitImage
+        //
+        if (m_scaledRendering)
+        {
+            VkFormatProperties formatProps;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, screen.swapChainImageFormat, &formatProps);
+
+            const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+            if ((formatProps.optimalTilingFeatures & blitFeatures) != blitFeatures)
+            {
+                std::cout << "[initVulkan]: output format can't be blitted, scaled rendering disabled" << std::endl;
+                m_scaledRendering = false;
+            }
+            m_upscaleFilter = (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        }
+
+        // one query slot per frame in flight, the frame fence guards both the slot and the command buffer that uses it.
+        // Without inheritedQueries no query may be active around vkCmdExecuteCommands, so with more than one recording
+        // thread the statistics are dropped rather than the threads
+        //
+        recorder.init(device, queueFID, settings.framesInFlight, settings.recordThreads);
+        bool statistics = enabledFeatures.pipelineStatisticsQuery == VK_TRUE;
+        if (statistics && enabledFeatures.inheritedQueries == VK_FALSE && recorder.threadCount() > 1)
+        {
+            std::cout << "[frameProfiler]: no inheritedQueries, pipeline statistics disabled with multithreaded recording" << std::endl;
+            statistics = false;
+        }
+        profiler.init(physicalDevice, device, queueFID, settings.framesInFlight, statistics);
+        layoutCache.init(device);
+        framePools.init(device, settings.framesInFlight);
+        constants.init(&allocator, physicalDevice, settings.framesInFlight);
+        m_graph.init(&allocator, device, settings.framesInFlight);
 }
 
 void application::createResources(void)
   {
-    createRenderPass(device, screen.swapChainImageFormat, &renderPass);
+    m_depthFormat = chooseDepthFormat(physicalDevice);
+    m_samples     = chooseSampleCount(physicalDevice, settings.msaa);
+
+    // the Hi-Z build samples the depth attachment, with all its samples under multisampling
+    //
+    if (m_reflections)
+    {
+        VkFormatProperties formatProps;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, m_depthFormat, &formatProps);
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+        if (!(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) || !(props.limits.sampledImageDepthSampleCounts & m_samples))
+        {
+            std::cout << "[waterReflections]: the depth attachment can't be sampled, reflections disabled" << std::endl;
+            m_reflections = false;
+        }
+    }
+
+    createRenderPass(device, screen.swapChainImageFormat, m_depthFormat, m_samples, sceneFinalLayout(), SCENE_WHOLE, &m_passDesc, &renderPass);
+    if (m_reflections)
+    {
+        createRenderPass(device, screen.swapChainImageFormat, m_depthFormat, m_samples, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, SCENE_OPAQUE, &m_opaqueDesc, &m_opaquePass);
+        createRenderPass(device, screen.swapChainImageFormat, m_depthFormat, m_samples, sceneFinalLayout(), SCENE_WATER, &m_waterDesc, &m_waterPass);
+    }
+
+    if (!settings.pipelineCacheDir.empty())
+        pipelineCache = pipelineCacheStore.load(physicalDevice, device, settings.pipelineCacheDir);
 
-    createGraphicsPipeline(device, screen.swapChainExtent, renderPass, &pipelineLayout, &graphicsPipeline);
+    auto pipelinesBegin = std::chrono::steady_clock::now();
+    // the FFT ocean stands in for the simulation heights, so the grid and everything sampling it takes its size
+    //
+    water.init(&allocator, &layoutCache, device, pipelineCache, settings.fftOcean ? settings.fftSize : settings.gridSize,
+               settings.framesInFlight, m_graphicsFamily, m_computeFamily);
+    if (settings.fftOcean)
+        ocean.init(&allocator, &layoutCache, device, pipelineCache, oceanConfig());
+    pipelineCreateTime = elapsedMs(pipelinesBegin, std::chrono::steady_clock::now());
+
+    // the vertex input state of the pipeline depends on the mesh layout
+    //
+    createWaterMesh();
+
+    // the set every water and object draw binds: the heights of the frame, its part of the constants and the ocean maps;
+    // the reflecting water reads the constants in its fragment shader as well
+    //
+    {
+        VkDescriptorSetLayoutBinding bindings[3] = {};
+        bindings[0].binding         = 0;
+        bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+        bindings[1].binding         = 1;
+        bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[2].binding         = 2;
+        bindings[2].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[2].descriptorCount = 1;
+        bindings[2].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+        m_frameSetLayout = layoutCache.get(std::vector<VkDescriptorSetLayoutBinding>(bindings, bindings + 3));
+    }
 
-    createScreenFrameBuffers(device, renderPass, &screen);
+    pipelinesBegin = std::chrono::steady_clock::now();
+    if (m_reflections)
+    {
+        // the march length shares the frame time budget of the dynamic resolution
+        //
+        reflections.targetMs      = settings.targetFrameMs;
+        reflections.upThreshold   = settings.scaleUpThreshold;
+        reflections.downThreshold = settings.scaleDownThreshold;
+        reflections.settleFrames  = settings.scaleSettleFrames;
+        reflections.init(&allocator, &layoutCache, device, pipelineCache, m_samples);
+        reflections.setQuality(settings.reflections);
+    }
+    createGraphicsPipeline(device, waterMesh, settings.lod, pipelineCache, renderPass, m_frameSetLayout, m_reflections ? reflections.setLayout() : VK_NULL_HANDLE,
+                           m_samples, &pipelineLayout, &graphicsPipeline, settings.depthPrepass ? &m_depthPipeline : nullptr,
+                           m_reflections ? &m_reflectPipeline : nullptr);
+    if (settings.objects > 0)
+        createFloatingObjects();
+    if (settings.particles > 0)
+        createParticles();
+    pipelineCreateTime += elapsedMs(pipelinesBegin, std::chrono::steady_clock::now());
+
+    createPassAttachments(&allocator, device, &screen);
+    if (m_scaledRendering)
+        createSceneTarget(&allocator, device, renderPass, &screen);
+    else
+        createScreenFrameBuffers(device, renderPass, &screen);
 
-    createVertexBuffer(device, physicalDevice, 6 * sizeof(float), &m_vbo, &m_vboMem);
+    resolution.targetMs      = settings.targetFrameMs;
+    resolution.minScale      = std::min(settings.minRenderScale, settings.maxRenderScale);
+    resolution.maxScale      = std::min(settings.maxRenderScale, 1.0f);
+    resolution.upThreshold   = settings.scaleUpThreshold;
+    resolution.downThreshold = settings.scaleDownThreshold;
+    resolution.settleFrames  = settings.scaleSettleFrames;
+    resolution.reset(m_scaledRendering ? resolution.maxScale : 1.0f);
 
-    createAndWriteCommandBuffers(device, commandPool, screen.swapChainFramebuffers, screen.swapChainExtent, renderPass, graphicsPipeline, m_vbo,
-                                 &commandBuffers);
+    if (settings.dynamicResolution && m_scaledRendering && !profiler.gpuTimingSupported())
+        std::cout << "[resolutionController]: no GPU timestamps, render scale stays at " << resolution.scale() << std::endl;
 
     createSyncObjects(device, &m_sync);
 
-    // put our vertices to GPU
+    // put the initial heights to GPU; both height buffers get the same state, so the water starts at rest
     //
-    float trianglePos[] =
+    std::vector<float> heights;
+    water.initialHeights(&heights);
+    for (int i = 0; i < 2; i++)
+        putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, heights.data(), heights.size() * sizeof(float), water.heightBuffer(i));
+
+    if (settings.fftOcean)
     {
-      -0.8f, -0.8f,
-      0.8f, -0.8f,
-      0.8f, 0.8f,
-    };
+        std::vector<float> spectrum;
+        ocean.initialSpectrum(&spectrum);
+        putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, spectrum.data(), spectrum.size() * sizeof(float), ocean.initialBuffer());
+    }
+
+    // the sky the reflections fall back to never changes, it is baked once like the initial state is uploaded
+    //
+    if (m_reflections)
+    {
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = commandPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer cmdBuff;
+        if (vkAllocateCommandBuffers(device, &allocInfo, &cmdBuff) != VK_SUCCESS)
+            throw std::runtime_error("[createResources]: failed to allocate command buffer!");
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(cmdBuff, &beginInfo);
+        reflections.cmdBakeSky(cmdBuff);
+        vkEndCommandBuffer  (cmdBuff);
+
+        runCommandBuffer(cmdBuff, graphicsQueue, device);
+        vkFreeCommandBuffers(device, commandPool, 1, &cmdBuff);
+
+        std::cout << "[waterReflections]: " << reflectionQualityName(reflections.quality()) << ", "
+                  << (settings.adaptiveReflections ? "adaptive" : "fixed") << " march length" << std::endl;
+    }
+
+    VkDeviceSize stagingSize = VkDeviceSize(settings.stagingMB) * 1024 * 1024;
+    if (settings.cpuSolver)
+        stagingSize = std::max(stagingSize, settings.fftOcean ? ocean.heightBufferSize() + ocean.mapBufferSize() : water.heightBufferSize());
+    if (settings.lod && !m_gpuCulling)
+        stagingSize += waterLod::MAX_PATCHES * sizeof(lodPatch);
+    uploadRing.init(&allocator, settings.framesInFlight, stagingSize);
+
+    streamer.init(&allocator, device, streamQueue, m_transferFamily, { m_graphicsFamily, m_computeFamily },
+                  VkDeviceSize(settings.streamStagingMB) * 1024 * 1024);
+    if (m_transferFamily != m_graphicsFamily)
+        std::cout << "[assetStreamer]: streaming on transfer queue family " << m_transferFamily << std::endl;
+
+    if (!settings.heightmapFile.empty())
+    {
+        if (settings.fftOcean)
+            std::cout << "[assetStreamer]: the FFT ocean has no simulation state, " << settings.heightmapFile << " is not loaded" << std::endl;
+        else if (settings.cpuSolver)
+            std::cout << "[assetStreamer]: the CPU solver keeps its own heights, " << settings.heightmapFile << " is not loaded" << std::endl;
+        else
+        {
+            m_heightmapStream = streamer.requestBuffer(&allocator, settings.heightmapFile, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+            if (streamer.size(m_heightmapStream) != water.heightBufferSize())
+                throw std::runtime_error("[createResources]: heightmap size does not match the grid!");
+        }
+    }
+
+    if (settings.cpuSolver && settings.fftOcean)
+    {
+        cpuWaves.init(ocean.settings(), settings.solverThreads);
+
+        std::cout << "[oceanFft]: CPU evaluation, " << cpuWaterSolver::simdName(cpuWaves.simd()) << ", "
+                  << cpuWaves.threadCount() << " thread(s)" << std::endl;
+    }
+    else if (settings.cpuSolver)
+    {
+        cpuWater.waveSpeed2 = water.waveSpeed2;
+        cpuWater.damping    = water.damping;
+        cpuWater.init(water.gridSize(), heights, settings.solverThreads);
+
+        std::cout << "[waterSimulation]: CPU solver, " << cpuWaterSolver::simdName(cpuWater.simd()) << ", "
+                  << cpuWater.threadCount() << " thread(s)" << std::endl;
+    }
+}
+
+void application::createWaterMesh(void)
+{
+    if (settings.lod)
+    {
+        oceanLod.worldSize   = settings.oceanSize;
+        oceanLod.tileSize    = settings.lodTileSize;
+        oceanLod.levels      = settings.lodLevels;
+        oceanLod.patchRes    = std::max(2u, settings.lodPatchRes & ~1u);
+
+        // crests of the FFT ocean stay below ~1.5 significant wave heights; the horizontal displacement is of the
+        // same size, small against the patches, and not added to their bounds
+        //
+        if (settings.fftOcean)
+            oceanLod.maxHeight = std::max(oceanLod.maxHeight, 1.5f * significantHeight(ocean.settings()));
+
+        meshSource source;
+        waterLod::buildPatchMesh(oceanLod.patchRes, &source);
+        waterMesh.build(source, settings.mesh);
+        waterMesh.createBuffers(&allocator);
+
+        for (uint32_t i = 0; i < waterMesh.streamCount(); i++)
+            putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, waterMesh.vertexData(i).data(), waterMesh.vertexData(i).size(), waterMesh.vertexBuffer(i));
+        if (waterMesh.indexType() != MESH_INDEX_NONE)
+            putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, waterMesh.indexData().data(), waterMesh.indexData().size(), waterMesh.indexBuffer());
+
+        m_lodCamera.farZ = settings.oceanSize * 1.5f;
+
+        if (m_gpuCulling && waterMesh.indexType() == MESH_INDEX_NONE)
+        {
+            std::cout << "[gpuCuller]: indirect draws need an indexed mesh, the patches are culled and drawn from the CPU" << std::endl;
+            m_gpuCulling = false;
+        }
+
+        // selected on the GPU, every node is an instance and its quadrants are the cull candidates
+        //
+        uint32_t instances = waterLod::MAX_PATCHES;
+        if (m_gpuCulling)
+        {
+            oceanLod.levels = std::max(1u, std::min(oceanLod.levels, waterLod::MAX_LEVELS));
+            while (waterLod::nodeCount(oceanLod.levels) > waterLod::MAX_NODES)
+                oceanLod.levels--;
+            if (oceanLod.levels != settings.lodLevels)
+                std::cout << "[gpuCuller]: " << settings.lodLevels << " levels are beyond the node limit, using " << oceanLod.levels << std::endl;
+
+            instances = uint32_t(waterLod::nodeCount(oceanLod.levels));
+            culler.init(&allocator, &layoutCache, device, pipelineCache, waterMesh, instances * 4, m_multiDraw, m_drawIndirectCount);
+            std::cout << "[gpuCuller]: " << (culler.drawCount() ? "vkCmdDrawIndexedIndirectCount" : (culler.multiDraw() ? "multi draw indirect" : "one indirect draw per patch"))
+                      << ", " << instances * 4 << " candidates" << std::endl;
+        }
+
+        allocator.createBuffer(VkDeviceSize(instances) * sizeof(lodPatch), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_lodInstances, &m_lodInstanceMem);
+        if (m_gpuCulling)
+            uploadLodNodes();
+
+        std::cout << "[waterLod]: " << settings.oceanSize << " units ocean, " << oceanLod.levels << " levels of " << oceanLod.patchRes << "x"
+                  << oceanLod.patchRes << " patches, heightfield tile " << settings.lodTileSize << " units" << std::endl;
+        return;
+    }
+
+    // one segment (and draw call) per strip of rows; 16 bit indices need strips of at most 65536 vertices
+    //
+    const uint32_t rows     = water.gridSize() - 1;
+    uint32_t       segments = std::max(1u, std::min(settings.drawCalls, rows));
+    if (settings.mesh.indexType == MESH_INDEX_16 || settings.mesh.indexType == MESH_INDEX_AUTO)
+    {
+        const uint32_t maxRows = std::max(1u, 65536 / water.gridSize() - 1);
+        segments = std::max(segments, (rows + maxRows - 1) / maxRows);
+    }
+
+    meshSource source;
+    waterSimulation::buildGridMesh(water.gridSize(), segments, &source);
+
+    waterMesh.build(source, settings.mesh);
+    waterMesh.createBuffers(&allocator);
+    settings.drawCalls = waterMesh.segmentCount();
+
+    for (uint32_t i = 0; i < waterMesh.streamCount(); i++)
+        putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, waterMesh.vertexData(i).data(), waterMesh.vertexData(i).size(), waterMesh.vertexBuffer(i));
+    if (waterMesh.indexType() != MESH_INDEX_NONE)
+        putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, waterMesh.indexData().data(), waterMesh.indexData().size(), waterMesh.indexBuffer());
+
+    std::cout << "[gpuMesh]: water grid, " << waterMesh.vertexCount() << " vertices, indices: " << meshIndexTypeName(waterMesh.indexType()) << ", "
+              << waterMesh.segmentCount() << " segment(s), ACMR " << waterMesh.acmr() << ", " << waterMesh.bytes() / 1024 << " KB" << std::endl;
+}
+
+void application::createFloatingObjects(void)
+{
+    // a ring around the LOD camera path, or the whole grid; object sizes are in the units of the water they float on
+    //
+    floatingArea area;
+    if (settings.lod)
+    {
+        area.centerX     = 0.0f;
+        area.centerZ     = 0.0f;
+        area.innerRadius = settings.oceanSize * 0.22f;
+        area.outerRadius = settings.oceanSize * 0.28f;
+        area.scale       = 3.0f;
+        area.drift       = 0.5f;
+    }
+    floating.init(&allocator, settings.objects, area);
 
-    putTriangleVerticesToVBO_Now(device, commandPool, graphicsQueue, trianglePos, 6*2, m_vbo);
+    for (uint32_t t = 0; t < FLOATING_TYPE_COUNT; t++)
+    {
+        const gpuMesh& mesh = floating.mesh(t);
+        for (uint32_t i = 0; i < mesh.streamCount(); i++)
+            putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, mesh.vertexData(i).data(), mesh.vertexData(i).size(), mesh.vertexBuffer(i));
+        if (mesh.indexType() != MESH_INDEX_NONE)
+            putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, mesh.indexData().data(), mesh.indexData().size(), mesh.indexBuffer());
+    }
+    putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, floating.instanceData().data(),
+                        floating.instanceData().size() * sizeof(floatingInstance), floating.instanceBuffer());
+
+    floating.createPipeline(device, pipelineCache, renderPass, m_frameSetLayout, m_samples);
+
+    std::cout << "[floatingObjects]: " << floating.capacity() << " objects, " << uint32_t(FLOATING_TYPE_COUNT) << " instanced draws, "
+              << floating.triangleCount() << " triangles" << std::endl;
+}
+
+void application::createParticles(void)
+{
+    // a software rasterizer can't afford a million sorted sprites; keep a small unsorted set so the path still runs
+    //
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+    uint32_t capacity = settings.particles;
+    bool     sort     = settings.particleSort;
+    if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU && (capacity > 65536 || sort))
+    {
+        capacity = std::min(capacity, 65536u);
+        sort     = false;
+        std::cout << "[particleSystem]: CPU device, " << capacity << " particles at most, not sorted" << std::endl;
+    }
+
+    std::vector<VkBuffer> heights(settings.framesInFlight);
+    for (uint32_t i = 0; i < settings.framesInFlight; i++)
+        heights[i] = settings.fftOcean ? ocean.heightBuffer() : water.renderBuffer(i);
+
+    particles.init(&allocator, &layoutCache, device, pipelineCache, capacity, sort, heights);
+
+    std::vector<particle> data;
+    std::vector<uint32_t> freeList, state;
+    particles.initialState(&data, &freeList, &state);
+    putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, data.data(), data.size() * sizeof(particle), particles.particleBuffer());
+    putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, freeList.data(), freeList.size() * sizeof(uint32_t), particles.freeListBuffer());
+    putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, state.data(), state.size() * sizeof(uint32_t), particles.stateBuffer());
+
+    particles.createPipeline(device, pipelineCache, renderPass, m_samples);
+
+    std::cout << "[particleSystem]: " << particles.capacity() << " particles, ";
+    if (particles.sorted())
+        std::cout << "sorted in " << particles.sortDispatches() << " dispatches" << std::endl;
+    else
+        std::cout << "unsorted, additive blending" << std::endl;
+}
+
+void application::waterSpace(float a_toClip[16], float* a_pCellsPerUnit, float* a_pHeightToWorld, float* a_pWrap) const
+{
+    if (settings.lod)
+    {
+        memcpy(a_toClip, oceanLod.viewProj(), 16 * sizeof(float));
+        *a_pCellsPerUnit  = float(water.gridSize()) / oceanLod.tileSize;
+        *a_pHeightToWorld = oceanLod.heightScale;
+        *a_pWrap          = 0.0f;
+    }
+    else
+    {
+        // a fixed, slightly oblique view from the front over the [0,1] grid, with the height at 0.05 grid sizes per unit;
+        // reverse-Z like the LOD camera: the front edge z = 0 at depth 0.75, the far one at 0.25, higher is nearer
+        //
+        const float toClip[16] = { 2.0f, 0.0f, 0.0f, 0.0f,   0.0f, 2.0f, 0.1f, 0.0f,   0.0f, -1.6f, -0.5f, 0.0f,   -1.0f, 0.8f, 0.75f, 1.0f };
+        memcpy(a_toClip, toClip, sizeof(toClip));
+        *a_pCellsPerUnit  = settings.fftOcean ? float(water.gridSize()) : float(water.gridSize() - 1);   // the ocean repeats every unit
+        *a_pHeightToWorld = 0.05f;
+        *a_pWrap          = 1.0f;
+    }
+}
+
+oceanSettings application::oceanConfig(void) const
+{
+    // cascade 0 covers the heightfield tile of the LOD ocean, or the whole grid; the heights buffer is in the
+    // height units of the water space, the maps in its units
+    //
+    float toClip[16], cellsPerUnit, heightToWorld, wrap;
+    waterSpace(toClip, &cellsPerUnit, &heightToWorld, &wrap);
+
+    oceanSettings config;
+    config.size                = settings.fftSize;
+    config.cascades            = settings.fftCascades;
+    config.spectrum            = settings.fftSpectrum;
+    config.length              = (settings.lod ? settings.lodTileSize : 1.0f) * metresPerUnit();
+    config.windSpeed           = settings.windSpeed;
+    config.windDirection       = settings.windDirection * 3.14159265f / 180.0f;
+    config.unitsPerMetre       = 1.0f / metresPerUnit();
+    config.heightUnitsPerMetre = config.unitsPerMetre / heightToWorld;
+    return config;
+}
+
+void application::writeFrameConstants(uint32_t a_slot)
+{
+    frameUniforms u = {};
+    waterSpace(u.toClip, &u.space[0], &u.space[1], &u.space[2]);
+
+    if (settings.lod)
+    {
+        u.camera[0] = m_lodCamera.position[0];
+        u.camera[1] = m_lodCamera.position[1];
+        u.camera[2] = m_lodCamera.position[2];
+    }
+    u.camera[3] = float(profiler.frameCount()) / 60.0f;
+
+    const float radians = settings.windDirection * 3.14159265f / 180.0f;
+    u.wind[0] = cosf(radians);
+    u.wind[1] = sinf(radians);
+    u.wind[2] = settings.windSpeed;
+    u.wind[3] = 1.0f / 60.0f;
+
+    // Detail waves a few cells long, longer with more wind, at a fixed steepness. The phase speed is the deep
+    // water one, sqrt(g * wavelength / 2pi), with g in water space units: metres for the ocean, a 20 m pond for the grid.
+    // The FFT ocean has its own short waves.
+    //
+    if (settings.windSpeed > 0.0f && !settings.fftOcean)
+    {
+        const float gravity    = 9.81f / metresPerUnit();
+        const float wavelength = 8.0f / u.space[0] * (settings.windSpeed / 6.0f);
+        u.waves[0] = 0.02f * wavelength / u.space[1];
+        u.waves[1] = wavelength;
+        u.waves[2] = sqrtf(gravity * wavelength / (2.0f * 3.14159265f));
+        u.waves[3] = 4.0f;
+    }
+    else
+        u.waves[1] = 1.0f;   // no waves; keeps the wave number finite
+
+    if (settings.fftOcean)
+    {
+        u.ocean[0] = float(ocean.cascades());
+        u.ocean[1] = float(ocean.size());
+        u.ocean[2] = ocean.settings().length * ocean.settings().unitsPerMetre;
+        u.ocean[3] = float(oceanSettings::CASCADE_RATIO);
+    }
+
+    // the reflecting water walks its rays in pixels of the rendered part and finds them in the output sized scene copy
+    //
+    if (m_reflecting)
+    {
+        invertMatrix(u.toClip, u.fromClip);
+        u.screen[0] = float(m_renderExtent.width);
+        u.screen[1] = float(m_renderExtent.height);
+        u.screen[2] = 1.0f / float(screen.swapChainExtent.width);
+        u.screen[3] = 1.0f / float(screen.swapChainExtent.height);
+        reflections.uniforms(u.reflections);
+    }
+
+    constants.write(a_slot, u);
 }
 
 void application::mainLoop(void)
   {
-    while (!glfwWindowShouldClose(windowApp))
+    if (settings.headless)
+    {
+      const int frames = settings.frames > 0 ? settings.frames : 1;
+      for (int i = 0; i < frames; i++)
+      {
+        pollInput();
+        drawFrame();
+      }
+    }
+    else
     {
-      glfwPollEvents();
-      drawFrame();
+      int frame = 0;
+      while (!glfwWindowShouldClose(windowApp) && (settings.frames <= 0 || frame < settings.frames))
+      {
+        pollInput();
+        drawFrame();
+        frame++;
+      }
     }
 
     vkDeviceWaitIdle(device);
@@ -143,11 +1005,46 @@ void application::mainLoop(void)
 
 void application::cleanup(void)
 {
-    // free our vbo
-    vkFreeMemory(device, m_vboMem, NULL);
-    vkDestroyBuffer(device, m_vbo, NULL);
+    profiler.collectAll(device);
+    if (!settings.profileOutput.empty())
+    {
+        const std::string& fileName = settings.profileOutput;
+        if (fileName.size() > 5 && fileName.compare(fileName.size() - 5, 5, ".json") == 0)
+            profiler.dumpChromeTrace(fileName);
+        else
+            profiler.dumpCSV(fileName);
+    }
+    profiler.destroy(device);
+
+    if (pipelineCache != VK_NULL_HANDLE)
+    {
+        pipelineCacheStore.save(device, pipelineCache);
+        vkDestroyPipelineCache(device, pipelineCache, NULL);
+    }
 
-    if (enableValidationLayers)
+    waterMesh.destroy(&allocator);
+    floating.destroy(device, &allocator);
+    particles.destroy(device, &allocator);
+    if (m_reflections)
+        reflections.destroy(device, &allocator);
+    if (m_lodInstances != VK_NULL_HANDLE)
+        allocator.destroyBuffer(m_lodInstances, m_lodInstanceMem);
+    if (m_gpuCulling)
+        culler.destroy(device, &allocator);
+
+    water.destroy(device, &allocator);
+    if (settings.fftOcean)
+        ocean.destroy(device, &allocator);
+    constants.destroy(&allocator);
+    framePools.destroy();
+    layoutCache.destroy();
+
+    uploadRing.destroy(&allocator);
+    streamer.destroy(device, &allocator);
+    recorder.destroy(device);
+    m_graph.destroy();
+
+    if (settings.validation)
     {
         // destroy callback.
         auto func = (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT");
@@ -156,32 +1053,39 @@ void application::cleanup(void)
         func(instance, debugReportCallback, NULL);
     }
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < m_sync.inFlightFences.size(); i++)
     {
         vkDestroySemaphore(device, m_sync.renderFinishedSemaphores[i], NULL);
         vkDestroySemaphore(device, m_sync.imageAvailableSemaphores[i], NULL);
         vkDestroyFence    (device, m_sync.inFlightFences[i], NULL);
     }
+    for (auto semaphore : m_sync.simulationFinishedSemaphores) vkDestroySemaphore(device, semaphore, NULL);
 
     vkDestroyCommandPool(device, commandPool, NULL);
-
-    for (auto framebuffer : screen.swapChainFramebuffers) vkDestroyFramebuffer(device, framebuffer, NULL);
+    if (m_computePool != VK_NULL_HANDLE) vkDestroyCommandPool(device, m_computePool, NULL);
 
     vkDestroyPipeline      (device, graphicsPipeline, NULL);
+    if (m_depthPipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, m_depthPipeline, NULL);
+    if (m_reflectPipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, m_reflectPipeline, NULL);
     vkDestroyPipelineLayout(device, pipelineLayout, NULL);
     vkDestroyRenderPass    (device, renderPass, NULL);
+    if (m_opaquePass != VK_NULL_HANDLE) vkDestroyRenderPass(device, m_opaquePass, NULL);
+    if (m_waterPass != VK_NULL_HANDLE)  vkDestroyRenderPass(device, m_waterPass, NULL);
 
-    for (auto imageView : screen.swapChainImageViews) vkDestroyImageView(device, imageView, NULL);
+    releaseRetiredScreens(true);
+    destroyScreenResources(device, &allocator, &screen);
 
-    vkDestroySwapchainKHR(device, screen.swapChain, NULL);
+    allocator.destroy();
     vkDestroyDevice(device, NULL);
 
-    vkDestroySurfaceKHR(instance, surface, NULL);
+    if (surface != VK_NULL_HANDLE) vkDestroySurfaceKHR(instance, surface, NULL);
     vkDestroyInstance(instance, NULL);
 
-    glfwDestroyWindow(windowApp);
-
-    glfwTerminate();
+    if (windowApp != nullptr)
+    {
+        glfwDestroyWindow(windowApp);
+        glfwTerminate();
+    }
 }
 
 VkInstance application::createInstance(bool                     a_enableValidationLayers,
@@ -332,33 +1236,74 @@ uint32_t application::getQueueFamilyIndex(VkPhysicalDevice a_physicalDevice, VkQ
     return i;
 }
 
-VkDevice application::createLogicalDevice(uint32_t                       queueFamilyIndex,
-                             VkPhysicalDevice               physicalDevice,
-                             const vector<const char *>&    a_enabledLayers,
-                             vector<const char *>           a_extentions)
+uint32_t application::findDedicatedQueueFamily(VkPhysicalDevice a_physicalDevice, VkQueueFlags a_required, VkQueueFlags a_excluded, uint32_t a_fallback)
 {
-    // When creating the device, we also specify what queues it has.
+    uint32_t queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(a_physicalDevice, &queueFamilyCount, NULL);
+
+    vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(a_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // families without the graphics bit are the ones that run next to the graphics queue on real hardware
+    // (async compute, DMA); a_fallback is returned if there is none
+    //
+    for (uint32_t i = 0; i < queueFamilyCount; i++)
+    {
+        const VkQueueFamilyProperties& props = queueFamilies[i];
+        if (i != a_fallback && props.queueCount > 0 && (props.queueFlags & a_required) == a_required && (props.queueFlags & a_excluded) == 0)
+            return i;
+    }
+    return a_fallback;
+}
+
+bool application::hasDeviceExtension(VkPhysicalDevice a_physicalDevice, const char* a_name)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(a_physicalDevice, NULL, &extensionCount, NULL);
+
+    vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(a_physicalDevice, NULL, &extensionCount, extensions.data());
+
+    for (const VkExtensionProperties& props : extensions)
+        if (strcmp(props.extensionName, a_name) == 0)
+            return true;
+    return false;
+}
+
+VkDevice application::createLogicalDevice(const vector<uint32_t>&        a_queueFamilies,
+                             VkPhysicalDevice               physicalDevice,
+                             const vector<const char *>&    a_enabledLayers,
+                             vector<const char *>           a_extentions,
+                             const VkPhysicalDeviceFeatures& a_features)
+{
+    // When creating the device, we also specify what queues it has: one in every requested family.
     //
-    VkDeviceQueueCreateInfo queueCreateInfo = {};
-    queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
-    queueCreateInfo.queueCount       = 1;    // create one queue in this family. We don't need more.
-    float queuePriorities            = 1.0;  // we only have one queue, so this is not that imporant.
-    queueCreateInfo.pQueuePriorities = &queuePriorities;
+    float queuePriorities = 1.0;  // one queue per family, so this is not that imporant.
+
+    vector<VkDeviceQueueCreateInfo> queueCreateInfos(a_queueFamilies.size());
+    for (size_t i = 0; i < a_queueFamilies.size(); i++)
+    {
+        VkDeviceQueueCreateInfo queueCreateInfo = {};
+        queueCreateInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = a_queueFamilies[i];
+        queueCreateInfo.queueCount       = 1;
+        queueCreateInfo.pQueuePriorities = &queuePriorities;
+        queueCreateInfos[i] = queueCreateInfo;
+    }
 
     // Now we create the logical device. The logical device allows us to interact with the physical device.
     //
     VkDeviceCreateInfo deviceCreateInfo = {};
 
-    // Specify any desired device features here. We do not need any for this application, though.
+    // Device features are chosen by the caller, after checking vkGetPhysicalDeviceFeatures.
     //
-    VkPhysicalDeviceFeatures deviceFeatures = {};
+    VkPhysicalDeviceFeatures deviceFeatures = a_features;
 
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.enabledLayerCount    = uint32_t(a_enabledLayers.size());  // need to specify validation layers here as well.
     deviceCreateInfo.ppEnabledLayerNames  = a_enabledLayers.data();
-    deviceCreateInfo.pQueueCreateInfos    = &queueCreateInfo;        // when creating the logical device, we also specify what queues it has.
-    deviceCreateInfo.queueCreateInfoCount = 1;
+    deviceCreateInfo.pQueueCreateInfos    = queueCreateInfos.data(); // when creating the logical device, we also specify what queues it has.
+    deviceCreateInfo.queueCreateInfoCount = uint32_t(queueCreateInfos.size());
     deviceCreateInfo.pEnabledFeatures     = &deviceFeatures;
     deviceCreateInfo.enabledExtensionCount   = static_cast<uint32_t>(a_extentions.size());
     deviceCreateInfo.ppEnabledExtensionNames = a_extentions.data();
@@ -397,14 +1342,34 @@ void application::createCwapChain(VkPhysicalDevice          a_physDevice,
                                   VkSurfaceKHR              a_surface,
                                   int                       a_width,
                                   int                       a_height,
+                                  VkSwapchainKHR            a_oldSwapChain,
                                   screenBufferResources*    a_buff)
 {
     swapChainSupportDetails swapChainSupport = querySwapChainSupport(a_physDevice, a_surface);
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode     = chooseSwapPresentMode(swapChainSupport.presentModes);
+    VkPresentModeKHR presentMode     = chooseSwapPresentMode(swapChainSupport.presentModes, settings.presentMode);
     VkExtent2D extent                = chooseSwapExtent(swapChainSupport.capabilities, a_width, a_height);
 
+    // scaled rendering blits the scene into the swapchain images; without it the reflections copy the opaque
+    // scene out of them, and scaled rendering may still turn out unsupported
+    //
+    VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (m_scaledRendering && (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT))
+        imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    else if (m_scaledRendering)
+    {
+        std::cout << "[createCwapChain]: swapchain images can't be transfer destinations, scaled rendering disabled" << std::endl;
+        m_scaledRendering = false;
+    }
+    if (m_reflections && (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+        imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    else if (m_reflections)
+    {
+        std::cout << "[createCwapChain]: swapchain images can't be transfer sources, reflections disabled" << std::endl;
+        m_reflections = false;
+    }
+
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
     if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
         imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -418,13 +1383,13 @@ void application::createCwapChain(VkPhysicalDevice          a_physDevice,
     createInfo.imageColorSpace  = surfaceFormat.colorSpace;
     createInfo.imageExtent      = extent;
     createInfo.imageArrayLayers = 1;
-    createInfo.imageUsage       = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    createInfo.imageUsage       = imageUsage;
     createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
     createInfo.preTransform     = swapChainSupport.capabilities.currentTransform;
     createInfo.compositeAlpha   = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode      = presentMode;
     createInfo.clipped          = VK_TRUE;
-    createInfo.oldSwapchain     = VK_NULL_HANDLE;
+    createInfo.oldSwapchain     = a_oldSwapChain; // images already acquired from it can still be presented
 
     if (vkCreateSwapchainKHR(a_device, &createInfo, nullptr, &a_buff->swapChain) != VK_SUCCESS)
         throw std::runtime_error("[vk_utils::CreateCwapChain]: failed to create swap chain!");
@@ -435,6 +1400,50 @@ void application::createCwapChain(VkPhysicalDevice          a_physDevice,
 
     a_buff->swapChainImageFormat = surfaceFormat.format;
     a_buff->swapChainExtent      = extent;
+
+    if (a_oldSwapChain == VK_NULL_HANDLE)
+    {
+        std::cout << "[createCwapChain]: " << imageCount << " images, present mode " << presentModeName(presentMode);
+        if (presentMode != settings.presentMode) std::cout << " (" << presentModeName(settings.presentMode) << " is not supported)";
+        std::cout << std::endl;
+    }
+    m_presentMode = presentMode;
+}
+
+void application::createOffscreenTargets(deviceAllocator*          a_pAllocator,
+                                         VkDevice                  a_device,
+                                         int                       a_width,
+                                         int                       a_height,
+                                         uint32_t                  a_imageCount,
+                                         screenBufferResources*    a_buff)
+{
+    // Same format the windowed path prefers, so both modes run identical pipelines.
+    // Every driver including software ones (lavapipe, swiftshader) supports it as a color attachment.
+    //
+    a_buff->swapChain            = VK_NULL_HANDLE;
+    a_buff->swapChainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+    a_buff->swapChainExtent      = { uint32_t(a_width), uint32_t(a_height) };
+
+    a_buff->swapChainImages.resize(a_imageCount);
+    a_buff->offscreenImagesMemory.resize(a_imageCount);
+
+    for (uint32_t i = 0; i < a_imageCount; i++)
+    {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageInfo.format        = a_buff->swapChainImageFormat;
+        imageInfo.extent        = { uint32_t(a_width), uint32_t(a_height), 1 };
+        imageInfo.mipLevels     = 1;
+        imageInfo.arrayLayers   = 1;
+        imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage         = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        a_pAllocator->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &a_buff->swapChainImages[i], &a_buff->offscreenImagesMemory[i]);
+    }
 }
 
 VkSurfaceFormatKHR application::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
@@ -447,10 +1456,18 @@ VkSurfaceFormatKHR application::chooseSwapSurfaceFormat(const std::vector<VkSurf
     return availableFormats[0];
 }
 
-VkPresentModeKHR application::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+VkPresentModeKHR application::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, VkPresentModeKHR a_preferred)
 {
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) return availablePresentMode;
+    // the unsupported low latency modes fall back to each other before settling on vsync
+    //
+    VkPresentModeKHR candidates[3] = { a_preferred, a_preferred, VK_PRESENT_MODE_FIFO_KHR };
+    if (a_preferred == VK_PRESENT_MODE_IMMEDIATE_KHR) candidates[1] = VK_PRESENT_MODE_MAILBOX_KHR;
+    if (a_preferred == VK_PRESENT_MODE_MAILBOX_KHR)   candidates[1] = VK_PRESENT_MODE_IMMEDIATE_KHR;
+
+    for (VkPresentModeKHR candidate : candidates) {
+        for (const auto& availablePresentMode : availablePresentModes) {
+            if (availablePresentMode == candidate) return availablePresentMode;
+        }
     }
     return VK_PRESENT_MODE_FIFO_KHR;
 }
@@ -472,6 +1489,35 @@ VkExtent2D application::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabil
     }
 }
 
+VkFormat application::chooseDepthFormat(VkPhysicalDevice a_physDevice)
+{
+    // reverse-Z needs float depth; not guaranteed by the spec, but every desktop and software driver has one of these
+    //
+    const VkFormat candidates[2] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT };
+    for (VkFormat format : candidates)
+    {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(a_physDevice, format, &props);
+        if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+            return format;
+    }
+    throw std::runtime_error("[chooseDepthFormat]: no float depth attachment format!");
+}
+
+VkSampleCountFlagBits application::chooseSampleCount(VkPhysicalDevice a_physDevice, uint32_t a_requested)
+{
+    // the color and the depth attachment are multisampled together; one sample is always supported
+    //
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(a_physDevice, &props);
+    const VkSampleCountFlags supported = props.limits.framebufferColorSampleCounts & props.limits.framebufferDepthSampleCounts;
+
+    uint32_t samples = VK_SAMPLE_COUNT_64_BIT;
+    while (samples > 1 && (samples > a_requested || !(supported & samples)))
+        samples /= 2;
+    return VkSampleCountFlagBits(samples);
+}
+
 void application::createScreenImageViews(VkDevice a_device, screenBufferResources* pScreen)
 {
     pScreen->swapChainImageViews.resize(pScreen->swapChainImages.size());
@@ -504,12 +1550,12 @@ void application::createScreenFrameBuffers(VkDevice a_device, VkRenderPass a_ren
     pScreen->swapChainFramebuffers.resize(pScreen->swapChainImageViews.size());
     for (size_t i = 0; i < pScreen->swapChainImageViews.size(); i++)
     {
-        VkImageView attachments[] = { pScreen->swapChainImageViews[i] };
+        VkImageView attachments[] = { pScreen->swapChainImageViews[i], pScreen->depthView, pScreen->msaaView };   // as m_passDesc numbers them
 
         VkFramebufferCreateInfo framebufferInfo = {};
         framebufferInfo.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass      = a_renderPass;
-        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.attachmentCount = m_passDesc.attachmentCount();
         framebufferInfo.pAttachments    = attachments;
         framebufferInfo.width           = pScreen->swapChainExtent.width;
         framebufferInfo.height          = pScreen->swapChainExtent.height;
@@ -520,61 +1566,326 @@ void application::createScreenFrameBuffers(VkDevice a_device, VkRenderPass a_ren
     }
 }
 
-void application::createRenderPass(VkDevice       a_device,
-                                   VkFormat       a_swapChainImageFormat,
-                                   VkRenderPass*  a_pRenderPass)
+void application::createSceneTarget(deviceAllocator* a_pAllocator, VkDevice a_device, VkRenderPass a_renderPass, screenBufferResources* pScreen)
 {
-    VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format         = a_swapChainImageFormat;
-    colorAttachment.samples        = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // One image for all frames in flight: frames are submitted to one queue and the render graph orders
+    // the next render pass after the previous upscale, so only the output images need to be multiple.
+    //
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = pScreen->swapChainImageFormat;
+    imageInfo.extent        = { pScreen->swapChainExtent.width, pScreen->swapChainExtent.height, 1 };
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage         = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    a_pAllocator->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &pScreen->sceneImage, &pScreen->sceneMemory);
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image                           = pScreen->sceneImage;
+    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format                          = pScreen->swapChainImageFormat;
+    viewInfo.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.layerCount     = 1;
+
+    if (vkCreateImageView(a_device, &viewInfo, nullptr, &pScreen->sceneView) != VK_SUCCESS)
+        throw std::runtime_error("[createSceneTarget]: failed to create image view!");
+
+    VkImageView attachments[] = { pScreen->sceneView, pScreen->depthView, pScreen->msaaView };
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass      = a_renderPass;
+    framebufferInfo.attachmentCount = m_passDesc.attachmentCount();
+    framebufferInfo.pAttachments    = attachments;
+    framebufferInfo.width           = pScreen->swapChainExtent.width;
+    framebufferInfo.height          = pScreen->swapChainExtent.height;
+    framebufferInfo.layers          = 1;
+
+    if (vkCreateFramebuffer(a_device, &framebufferInfo, NULL, &pScreen->sceneFramebuffer) != VK_SUCCESS)
+        throw std::runtime_error("[createSceneTarget]: failed to create framebuffer!");
+}
+
+static void createAttachmentImage(deviceAllocator* a_pAllocator, VkDevice a_device, VkExtent2D a_extent, VkFormat a_format,
+                                  VkSampleCountFlagBits a_samples, VkImageUsageFlags a_usage, VkImageAspectFlags a_aspect, bool a_transient,
+                                  VkImage* a_pImage, deviceAllocation* a_pMemory, VkImageView* a_pView)
+{
+    // a transient attachment never leaves the tile memory of a tile based GPU, which then needs no memory behind it
+    //
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = a_format;
+    imageInfo.extent        = { a_extent.width, a_extent.height, 1 };
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = a_samples;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage         = a_usage | (a_transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    const VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | (a_transient ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0);
+    a_pAllocator->createImage(imageInfo, properties, a_pImage, a_pMemory);
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image                           = (*a_pImage);
+    viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format                          = a_format;
+    viewInfo.subresourceRange.aspectMask     = a_aspect;
+    viewInfo.subresourceRange.levelCount     = 1;
+    viewInfo.subresourceRange.layerCount     = 1;
+
+    if (vkCreateImageView(a_device, &viewInfo, nullptr, a_pView) != VK_SUCCESS)
+        throw std::runtime_error("[createAttachmentImage]: failed to create image view!");
+}
+
+void application::createPassAttachments(deviceAllocator* a_pAllocator, VkDevice a_device, screenBufferResources* pScreen)
+{
+    // sized as the output like the scene target; the render pass needs them, nothing after it. The reflections
+    // sample the depth between their two passes
+    //
+    const VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (m_reflections ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
+    createAttachmentImage(a_pAllocator, a_device, pScreen->swapChainExtent, m_depthFormat, m_samples, depthUsage,
+                          VK_IMAGE_ASPECT_DEPTH_BIT, transientAttachment(1), &pScreen->depthImage, &pScreen->depthMemory, &pScreen->depthView);
+    if (m_samples != VK_SAMPLE_COUNT_1_BIT)
+        createAttachmentImage(a_pAllocator, a_device, pScreen->swapChainExtent, pScreen->swapChainImageFormat, m_samples, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                              VK_IMAGE_ASPECT_COLOR_BIT, transientAttachment(2), &pScreen->msaaImage, &pScreen->msaaMemory, &pScreen->msaaView);
+}
+
+bool application::transientAttachment(uint32_t a_attachment) const
+{
+    // the split passes run on the same images, which stay transient only if no pass keeps them
+    //
+    if (!m_reflections)
+        return m_passDesc.transient(a_attachment);
+    return m_passDesc.transient(a_attachment) && m_opaqueDesc.transient(a_attachment) && m_waterDesc.transient(a_attachment);
+}
+
+VkImageLayout application::sceneFinalLayout(void) const
+{
+    // offscreen targets are never presented; leave them ready to be copied out for readback.
+    // The scene target is the source of the upscale blit.
+    //
+    if (m_scaledRendering || settings.headless)
+        return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+void application::destroyScreenResources(VkDevice a_device, deviceAllocator* a_pAllocator, screenBufferResources* pScreen)
+{
+    for (auto framebuffer : pScreen->swapChainFramebuffers) vkDestroyFramebuffer(a_device, framebuffer, NULL);
+    for (auto imageView : pScreen->swapChainImageViews) vkDestroyImageView(a_device, imageView, NULL);
+
+    if (pScreen->swapChain == VK_NULL_HANDLE)
+    {
+        for (size_t i = 0; i < pScreen->swapChainImages.size(); i++)
+        {
+            a_pAllocator->destroyImage(pScreen->swapChainImages[i], pScreen->offscreenImagesMemory[i]);
+        }
+    }
+    else
+        vkDestroySwapchainKHR(a_device, pScreen->swapChain, NULL);
+
+    if (pScreen->sceneImage != VK_NULL_HANDLE)
+    {
+        vkDestroyFramebuffer(a_device, pScreen->sceneFramebuffer, NULL);
+        vkDestroyImageView  (a_device, pScreen->sceneView, NULL);
+        a_pAllocator->destroyImage(pScreen->sceneImage, pScreen->sceneMemory);
+    }
+
+    if (pScreen->depthImage != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView  (a_device, pScreen->depthView, NULL);
+        a_pAllocator->destroyImage(pScreen->depthImage, pScreen->depthMemory);
+    }
+
+    if (pScreen->msaaImage != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView  (a_device, pScreen->msaaView, NULL);
+        a_pAllocator->destroyImage(pScreen->msaaImage, pScreen->msaaMemory);
+    }
 
-    VkAttachmentReference colorAttachmentRef = {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    pScreen->swapChainFramebuffers.clear();
+    pScreen->swapChainImageViews.clear();
+    pScreen->swapChainImages.clear();
+    pScreen->offscreenImagesMemory.clear();
+    pScreen->swapChain        = VK_NULL_HANDLE;
+    pScreen->sceneImage       = VK_NULL_HANDLE;
+    pScreen->sceneView        = VK_NULL_HANDLE;
+    pScreen->sceneFramebuffer = VK_NULL_HANDLE;
+    pScreen->depthImage       = VK_NULL_HANDLE;
+    pScreen->depthView        = VK_NULL_HANDLE;
+    pScreen->msaaImage        = VK_NULL_HANDLE;
+    pScreen->msaaView         = VK_NULL_HANDLE;
+}
 
-    VkSubpassDescription subpass  = {};
-    subpass.pipelineBindPoint     = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount  = 1;
-    subpass.pColorAttachments     = &colorAttachmentRef;
+void application::recreateScreen(void)
+{
+    if (!settings.headless)
+    {
+        // a minimized window has a zero sized surface, no swapchain can be created until it is restored
+        //
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(windowApp, &width, &height);
+        while ((width == 0 || height == 0) && !glfwWindowShouldClose(windowApp))
+        {
+            glfwWaitEvents();
+            glfwGetFramebufferSize(windowApp, &width, &height);
+        }
+        if (width == 0 || height == 0)
+            return;
 
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass    = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass    = 0;
-    dependency.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        settings.width  = width;
+        settings.height = height;
+    }
 
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments    = &colorAttachment;
-    renderPassInfo.subpassCount    = 1;
-    renderPassInfo.pSubpasses      = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies   = &dependency;
+    auto recreateBegin = std::chrono::steady_clock::now();
 
-    if (vkCreateRenderPass(a_device, &renderPassInfo, nullptr, a_pRenderPass) != VK_SUCCESS)
-        throw std::runtime_error("[CreateRenderPass]: failed to create render pass!");
+    // Only the objects that depend on the image size are rebuilt, the device, pipelines and buffers stay.
+    // The old ones are retired instead of destroyed, so frames in flight finish without a vkDeviceWaitIdle.
+    //
+    screenBufferResources fresh = {};
+    if (settings.headless)
+        createOffscreenTargets(&allocator, device, settings.width, settings.height, settings.framesInFlight, &fresh);
+    else
+        createCwapChain(physicalDevice, device, surface, settings.width, settings.height, screen.swapChain, &fresh);
+
+    createScreenImageViews(device, &fresh);
+
+    if (fresh.swapChainImageFormat != screen.swapChainImageFormat)
+    {
+        // the render pass and the pipeline depend on the format; this is rare enough to simply wait for idle
+        //
+        vkDeviceWaitIdle(device);
+        vkDestroyPipeline      (device, graphicsPipeline, NULL);
+        if (m_depthPipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, m_depthPipeline, NULL);
+        if (m_reflectPipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, m_reflectPipeline, NULL);
+        vkDestroyPipelineLayout(device, pipelineLayout, NULL);
+        floating.destroyPipeline(device);
+        particles.destroyPipeline(device);
+        vkDestroyRenderPass    (device, renderPass, NULL);
+
+        createRenderPass(device, fresh.swapChainImageFormat, m_depthFormat, m_samples, sceneFinalLayout(), SCENE_WHOLE, &m_passDesc, &renderPass);
+        if (m_reflections)
+        {
+            vkDestroyRenderPass(device, m_opaquePass, NULL);
+            vkDestroyRenderPass(device, m_waterPass, NULL);
+            createRenderPass(device, fresh.swapChainImageFormat, m_depthFormat, m_samples, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, SCENE_OPAQUE, &m_opaqueDesc, &m_opaquePass);
+            createRenderPass(device, fresh.swapChainImageFormat, m_depthFormat, m_samples, sceneFinalLayout(), SCENE_WATER, &m_waterDesc, &m_waterPass);
+        }
+        createGraphicsPipeline(device, waterMesh, settings.lod, pipelineCache, renderPass, m_frameSetLayout, m_reflections ? reflections.setLayout() : VK_NULL_HANDLE,
+                               m_samples, &pipelineLayout, &graphicsPipeline, settings.depthPrepass ? &m_depthPipeline : nullptr,
+                               m_reflections ? &m_reflectPipeline : nullptr);
+        if (floating.capacity() > 0)
+            floating.createPipeline(device, pipelineCache, renderPass, m_frameSetLayout, m_samples);
+        if (particles.capacity() > 0)
+            particles.createPipeline(device, pipelineCache, renderPass, m_samples);
+    }
+
+    createPassAttachments(&allocator, device, &fresh);
+    if (m_scaledRendering)
+        createSceneTarget(&allocator, device, renderPass, &fresh);
+    else
+        createScreenFrameBuffers(device, renderPass, &fresh);
+
+    retiredScreen retired;
+    retired.resources = screen;
+    retired.lastFrame = m_submittedFrames;
+    m_retiredScreens.push_back(retired);
+
+    screen = fresh;
+    m_framebufferResized = false;
+    m_graph.invalidate();   // the new scene image starts undefined
+
+    const double recreateTime = elapsedMs(recreateBegin, std::chrono::steady_clock::now());
+    m_recreateTimes.push_back(recreateTime);
+    if (!settings.headless)
+        std::cout << "[swapchain]: recreated " << screen.swapChainExtent.width << "x" << screen.swapChainExtent.height
+                  << " in " << recreateTime << " ms" << std::endl;
+}
+
+void application::releaseRetiredScreens(bool a_all)
+{
+    // Called after the fence wait of frame m_submittedFrames, so every frame up to m_submittedFrames - framesInFlight
+    // has completed. Resources retired at frame F were last used by frame F - 1.
+    //
+    for (size_t i = 0; i < m_retiredScreens.size(); )
+    {
+        if (a_all || m_submittedFrames + 1 >= m_retiredScreens[i].lastFrame + settings.framesInFlight)
+        {
+            destroyScreenResources(device, &allocator, &m_retiredScreens[i].resources);
+            m_retiredScreens.erase(m_retiredScreens.begin() + i);
+        }
+        else
+            i++;
+    }
+}
+
+void application::createRenderPass(VkDevice              a_device,
+                                   VkFormat              a_swapChainImageFormat,
+                                   VkFormat              a_depthFormat,
+                                   VkSampleCountFlagBits a_samples,
+                                   VkImageLayout         a_finalLayout,
+                                   scenePart             a_part,
+                                   renderPassBuilder*    a_pDesc,
+                                   VkRenderPass*         a_pRenderPass)
+{
+    // Only the output is used after the pass. The depth (reverse-Z: cleared to 0, the far plane) and the multisampled
+    // color are transient: never loaded or stored, a tile based GPU keeps them on chip. With multisampling the output
+    // is written by the resolve alone, so it is not cleared either.
+    //
+    // The reflections split the scene in two passes over the same attachments: SCENE_OPAQUE clears and keeps all of
+    // them, the depth for the Hi-Z chain, the color for the scene copy (from a_finalLayout) and both for the water;
+    // SCENE_WATER loads them and only the output survives it. The three passes are compatible.
+    //
+    const bool     msaa  = (a_samples != VK_SAMPLE_COUNT_1_BIT);
+    const uint32_t begin = (a_part == SCENE_WATER) ? ATTACHMENT_PRESERVE : ATTACHMENT_CLEAR;
+    const uint32_t keep  = (a_part == SCENE_OPAQUE) ? ATTACHMENT_OUTPUT : 0;
+
+    a_pDesc->reset();
+    const uint32_t output = a_pDesc->addAttachment(a_swapChainImageFormat, VK_SAMPLE_COUNT_1_BIT,
+                                                   msaa ? ATTACHMENT_OUTPUT : (begin | ATTACHMENT_OUTPUT), a_finalLayout);
+    const uint32_t depth  = a_pDesc->addAttachment(a_depthFormat, a_samples, begin | keep,
+                                                   (a_part == SCENE_WHOLE) ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    const uint32_t scene  = a_pDesc->addSubpass();
+
+    if (msaa)
+        a_pDesc->color(scene, a_pDesc->addAttachment(a_swapChainImageFormat, a_samples, begin | keep,
+                                                     (a_part == SCENE_WHOLE) ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL), output);
+    else
+        a_pDesc->color(scene, output);
+    a_pDesc->depth(scene, depth, true);
+
+    a_pDesc->build(a_device, a_pRenderPass);
 }
 
 void application::createGraphicsPipeline(VkDevice             a_device,
-                                         VkExtent2D           a_screenExtent,
+                                         const gpuMesh&       a_mesh,
+                                         bool                 a_lodPatches,
+                                         VkPipelineCache      a_pipelineCache,
                                          VkRenderPass         a_renderPass,
+                                         VkDescriptorSetLayout a_setLayout,
+                                         VkDescriptorSetLayout a_reflectionSetLayout,
+                                         VkSampleCountFlagBits a_samples,
                                          VkPipelineLayout*    a_pLayout,
-                                         VkPipeline*          a_pPipiline)
+                                         VkPipeline*          a_pPipiline,
+                                         VkPipeline*          a_pDepthPipeline,
+                                         VkPipeline*          a_pReflectPipeline)
 {
-    auto vertShaderCode = readFile("../WaterApp/shaders/vert.spv");
-    auto fragShaderCode = readFile("../WaterApp/shaders/frag.spv");
+    auto vertShaderCode = vk_utils::readFile(a_lodPatches ? "../WaterApp/shaders/waterLod.spv" : "../WaterApp/shaders/vert.spv");
+    auto fragShaderCode = vk_utils::readFile("../WaterApp/shaders/frag.spv");
 
-    VkShaderModule vertShaderModule = createShaderModule(a_device, vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(a_device, fragShaderCode);
+    VkShaderModule vertShaderModule = vk_utils::createShaderModule(a_device, vertShaderCode);
+    VkShaderModule fragShaderModule = vk_utils::createShaderModule(a_device, fragShaderCode);
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
     vertShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -590,47 +1901,62 @@ void application::createGraphicsPipeline(VkDevice             a_device,
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-    VkVertexInputBindingDescription vInputBinding = { };
-    vInputBinding.binding   = 0;
-    vInputBinding.stride    = sizeof(float) * 2;
-    vInputBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    // the mesh decides between float and UNORM16 positions and the stream layout;
+    // the shader reads a vec2 either way, the grid bounds are [0,1] so quantized positions need no decoding
+    //
+    std::vector<VkVertexInputBindingDescription>   vInputBindings;
+    std::vector<VkVertexInputAttributeDescription> vAttributes;
+    a_mesh.vertexInput(&vInputBindings, &vAttributes);
 
-    VkVertexInputAttributeDescription vAttribute = {};
-    vAttribute.binding  = 0;
-    vAttribute.location = 0;
-    vAttribute.format   = VK_FORMAT_R32G32_SFLOAT;
-    vAttribute.offset   = 0;
+    // CDLOD patches: one lodPatch per instance, on the binding after the mesh streams
+    //
+    if (a_lodPatches)
+    {
+        VkVertexInputBindingDescription instanceBinding = {};
+        instanceBinding.binding   = uint32_t(vInputBindings.size());
+        instanceBinding.stride    = sizeof(lodPatch);
+        instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        vInputBindings.push_back(instanceBinding);
+
+        VkVertexInputAttributeDescription patchInfo = {};
+        patchInfo.location = 2;
+        patchInfo.binding  = instanceBinding.binding;
+        patchInfo.format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+        patchInfo.offset   = offsetof(lodPatch, offsetX);
+        vAttributes.push_back(patchInfo);
+
+        VkVertexInputAttributeDescription morphRange = patchInfo;
+        morphRange.location = 3;
+        morphRange.format   = VK_FORMAT_R32G32_SFLOAT;
+        morphRange.offset   = offsetof(lodPatch, morphStart);
+        vAttributes.push_back(morphRange);
+    }
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount   = 1;
-    vertexInputInfo.vertexAttributeDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions      = &vInputBinding;
-    vertexInputInfo.pVertexAttributeDescriptions    = &vAttribute;
+    vertexInputInfo.vertexBindingDescriptionCount   = uint32_t(vInputBindings.size());
+    vertexInputInfo.vertexAttributeDescriptionCount = uint32_t(vAttributes.size());
+    vertexInputInfo.pVertexBindingDescriptions      = vInputBindings.data();
+    vertexInputInfo.pVertexAttributeDescriptions    = vAttributes.data();
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
     inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
     inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    VkViewport viewport = {};
-    viewport.x        = 0.0f;
-    viewport.y        = 0.0f;
-    viewport.width    = static_cast<float>(a_screenExtent.width);
-    viewport.height   = static_cast<float>(a_screenExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor = {};
-    scissor.offset = { 0, 0 };
-    scissor.extent = a_screenExtent;
-
+    // viewport and scissor are set while recording, so the pipeline survives swapchain recreation
+    //
     VkPipelineViewportStateCreateInfo viewportState = {};
     viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports    = &viewport;
     viewportState.scissorCount  = 1;
-    viewportState.pScissors     = &scissor;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates    = dynamicStates;
 
     VkPipelineRasterizationStateCreateInfo rasterizer = {};
     rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -645,12 +1971,21 @@ void application::createGraphicsPipeline(VkDevice             a_device,
     VkPipelineMultisampleStateCreateInfo multisampling = {};
     multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     multisampling.sampleShadingEnable  = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.rasterizationSamples = a_samples;
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
     colorBlendAttachment.blendEnable    = VK_FALSE;
 
+    // reverse-Z, nearer is greater. With the depth pre-pass (a_pDepthPipeline) the depth of the water is final
+    // before it is shaded, so the shading pipeline only runs the fragments that stay visible
+    //
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable  = VK_TRUE;
+    depthStencil.depthWriteEnable = (a_pDepthPipeline == nullptr) ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp   = (a_pDepthPipeline == nullptr) ? VK_COMPARE_OP_GREATER_OR_EQUAL : VK_COMPARE_OP_EQUAL;
+
     VkPipelineColorBlendStateCreateInfo colorBlending = {};
     colorBlending.sType             = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     colorBlending.logicOpEnable     = VK_FALSE;
@@ -662,10 +1997,21 @@ void application::createGraphicsPipeline(VkDevice             a_device,
     colorBlending.blendConstants[2] = 0.0f;
     colorBlending.blendConstants[3] = 0.0f;
 
+    VkPushConstantRange pushConstant = {};
+    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstant.offset     = 0;
+    pushConstant.size       = a_lodPatches ? sizeof(lodRenderParams) : sizeof(waterRenderParams);
+
+    // set 1 - the reflection inputs, only the reflecting pipeline uses it
+    //
+    VkDescriptorSetLayout setLayouts[2] = { a_setLayout, a_reflectionSetLayout };
+
     VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
     pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount         = 0;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.setLayoutCount         = (a_reflectionSetLayout != VK_NULL_HANDLE) ? 2 : 1;
+    pipelineLayoutInfo.pSetLayouts            = setLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
 
     if (vkCreatePipelineLayout(a_device, &pipelineLayoutInfo, NULL, a_pLayout) != VK_SUCCESS)
         throw std::runtime_error("[CreateGraphicsPipeline]: failed to create pipeline layout!");
@@ -679,115 +2025,645 @@ void application::createGraphicsPipeline(VkDevice             a_device,
     pipelineInfo.pViewportState      = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState  = &depthStencil;
     pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.pDynamicState       = &dynamicState;
     pipelineInfo.layout              = (*a_pLayout);
     pipelineInfo.renderPass          = a_renderPass;
     pipelineInfo.subpass             = 0;
     pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(a_device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, a_pPipiline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, a_pPipiline) != VK_SUCCESS)
         throw std::runtime_error("[CreateGraphicsPipeline]: failed to create graphics pipeline!");
 
+    // the water of the split scene: the same state, the fragment shader built with -DREFLECTIONS
+    //
+    if (a_pReflectPipeline != nullptr)
+    {
+        auto           reflectShaderCode   = vk_utils::readFile("../WaterApp/shaders/fragReflect.spv");
+        VkShaderModule reflectShaderModule = vk_utils::createShaderModule(a_device, reflectShaderCode);
+
+        shaderStages[1].module = reflectShaderModule;
+        VkResult res = vkCreateGraphicsPipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, a_pReflectPipeline);
+        shaderStages[1].module = fragShaderModule;
+        vkDestroyShaderModule(a_device, reflectShaderModule, NULL);
+
+        if (res != VK_SUCCESS)
+            throw std::runtime_error("[CreateGraphicsPipeline]: failed to create reflecting water pipeline!");
+    }
+
+    // the pre-pass: same vertex shader (its gl_Position is invariant, so both passes produce the same depth),
+    // no fragment shader and no color writes
+    //
+    if (a_pDepthPipeline != nullptr)
+    {
+        VkPipelineDepthStencilStateCreateInfo depthOnly = depthStencil;
+        depthOnly.depthWriteEnable = VK_TRUE;
+        depthOnly.depthCompareOp   = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+        VkPipelineColorBlendAttachmentState noColor = colorBlendAttachment;
+        noColor.colorWriteMask = 0;
+
+        VkPipelineColorBlendStateCreateInfo noColorBlending = colorBlending;
+        noColorBlending.pAttachments = &noColor;
+
+        pipelineInfo.stageCount         = 1;
+        pipelineInfo.pDepthStencilState = &depthOnly;
+        pipelineInfo.pColorBlendState   = &noColorBlending;
+
+        if (vkCreateGraphicsPipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, a_pDepthPipeline) != VK_SUCCESS)
+            throw std::runtime_error("[CreateGraphicsPipeline]: failed to create depth pre-pass pipeline!");
+    }
+
     vkDestroyShaderModule(a_device, fragShaderModule, NULL);
     vkDestroyShaderModule(a_device, vertShaderModule, NULL);
 }
 
-void application::createVertexBuffer(VkDevice         a_device,
-                                     VkPhysicalDevice a_physDevice,
-                                     const size_t     a_bufferSize,
-                                     VkBuffer         *a_pBuffer,
-                                     VkDeviceMemory   *a_pBufferMemory)
+void application::recordDraws(VkCommandBuffer a_cmdBuff, uint32_t a_firstDraw, uint32_t a_drawCount, bool a_depthOnly, scenePart a_part)
 {
-   VkBufferCreateInfo bufferCreateInfo = {};
-   bufferCreateInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-   bufferCreateInfo.pNext       = NULL;
-   bufferCreateInfo.size        = a_bufferSize;
-   bufferCreateInfo.usage       = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-   bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    // dynamic state is not inherited by secondary command buffers, so every chunk sets it
+    {
+        VkViewport viewport = {};
+        viewport.x        = 0.0f;
+        viewport.y        = 0.0f;
+        viewport.width    = static_cast<float>(m_renderExtent.width);
+        viewport.height   = static_cast<float>(m_renderExtent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+
+        VkRect2D scissor = {};
+        scissor.offset = { 0, 0 };
+        scissor.extent = m_renderExtent;
+
+        vkCmdSetViewport(a_cmdBuff, 0, 1, &viewport);
+        vkCmdSetScissor (a_cmdBuff, 0, 1, &scissor);
+    }
+
+    // every draw sees the frameUniforms part of the slot being recorded
+    //
+    const uint32_t frameOffset = constants.offset(m_recordSlot);
+
+    // the floating objects are opaque and on top of the water: drawn first in the first chunk, they hide the water
+    // below them from the early depth test, one instanced draw per object type. They are all the opaque pass of
+    // the reflections has
+    //
+    if (!a_depthOnly && a_part != SCENE_WATER && floating.activeCount() > 0 && a_firstDraw == 0)
+    {
+        floatingRenderParams params = {};
+        params.gridSize = water.gridSize();
+        floating.cmdDraw(a_cmdBuff, m_frameSet, frameOffset, params);
+    }
+    if (a_part == SCENE_OPAQUE)
+        return;
 
-   VK_CHECK_RESULT(vkCreateBuffer(a_device, &bufferCreateInfo, NULL, a_pBuffer)); // create bufferStaging.
+    VkPipeline waterPipeline = graphicsPipeline;
+    if (a_depthOnly)
+        waterPipeline = m_depthPipeline;
+    else if (a_part == SCENE_WATER)
+        waterPipeline = m_reflectPipeline;
 
-   VkMemoryRequirements memoryRequirements;
-   vkGetBufferMemoryRequirements(a_device, (*a_pBuffer), &memoryRequirements);
+    vkCmdBindPipeline(a_cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, waterPipeline);
+    waterMesh.cmdBind(a_cmdBuff);
 
-   VkMemoryAllocateInfo allocateInfo = {};
-   allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-   allocateInfo.pNext           = NULL;
-   allocateInfo.allocationSize  = memoryRequirements.size; // specify required memory.
-   allocateInfo.memoryTypeIndex = findMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, a_physDevice); // #NOTE VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    if (a_part == SCENE_WATER && !a_depthOnly)
+        vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &m_reflectionSet, 0, nullptr);
+
+    if (settings.lod)
+    {
+        VkDeviceSize    offset    = 0;
+        lodRenderParams params    = {};
+        params.gridSize    = water.gridSize();
+        params.heightScale = oceanLod.heightScale;
+        params.tileSize    = oceanLod.tileSize;
+        params.patchRes    = float(oceanLod.patchRes);
+        vkCmdBindVertexBuffers (a_cmdBuff, waterMesh.streamCount(), 1, &m_lodInstances, &offset);
+        vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &m_frameSet, 1, &frameOffset);
+        vkCmdPushConstants     (a_cmdBuff, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(params), &params);
+
+        // the culled draws come from the commands of the cull pass, in a single call
+        //
+        if (m_gpuCulling)
+        {
+            if (a_firstDraw == 0)
+                culler.cmdDraw(a_cmdBuff);
+        }
+        else
+        {
+            // the draw calls split the front to back list of patch quadrants, one mesh segment per quadrant
+            //
+            const std::vector<lodDraw>& draws = oceanLod.draws();
+            const size_t begin = size_t(uint64_t(a_firstDraw) * draws.size() / settings.drawCalls);
+            const size_t end   = size_t(uint64_t(a_firstDraw + a_drawCount) * draws.size() / settings.drawCalls);
+            for (size_t i = begin; i < end; i++)
+                waterMesh.cmdDrawSegments(a_cmdBuff, draws[i].quadrant, 1, 1, draws[i].patch);
+        }
+    }
+    else
+    {
+        // heights come from the simulation storage buffer, the vertex buffer only holds grid coordinates
+        {
+            waterRenderParams params    = {};
+            params.gridSize    = water.gridSize();
+            params.heightScale = 1.0f;
+            vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &m_frameSet, 1, &frameOffset);
+            vkCmdPushConstants     (a_cmdBuff, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(params), &params);
+        }
 
-   VK_CHECK_RESULT(vkAllocateMemory(a_device, &allocateInfo, NULL, a_pBufferMemory));   // allocate memory on device.
+        // draw i is mesh segment i, a strip of quad rows
+        //
+        waterMesh.cmdDrawSegments(a_cmdBuff, a_firstDraw, a_drawCount);
+    }
 
-   VK_CHECK_RESULT(vkBindBufferMemory(a_device, (*a_pBuffer), (*a_pBufferMemory), 0));  // Now associate that allocated memory with the bufferStaging. With that, the bufferStaging is backed by actual memory.
+    // blended spray last, over the water and the objects; depth tested, not written
+    //
+    if (!a_depthOnly && particles.capacity() > 0 && a_firstDraw + a_drawCount == settings.drawCalls)
+    {
+        particleParams params = {};
+        waterSpace(params.toClip, &params.cellsPerUnit, &params.heightToWorld, &params.wrap);
+        particles.cmdDraw(a_cmdBuff, m_recordSlot, params);
+    }
 }
 
-void application::createAndWriteCommandBuffers(VkDevice                       a_device,
-                                               VkCommandPool                  a_cmdPool,
-                                               std::vector<VkFramebuffer>     a_swapChainFramebuffers,
-                                               VkExtent2D                     a_frameBufferExtent,
-                                               VkRenderPass                   a_renderPass,
-                                               VkPipeline                     a_graphicsPipeline,
-                                               VkBuffer                       a_vPosBuffer,
-                                               std::vector<VkCommandBuffer>*  a_cmdBuffers)
+void application::recordSimulation(VkCommandBuffer a_cmdBuff, uint32_t a_slot)
 {
-    std::vector<VkCommandBuffer>& commandBuffers = (*a_cmdBuffers);
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    commandBuffers.resize(a_swapChainFramebuffers.size());
+    if (vkBeginCommandBuffer(a_cmdBuff, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("[recordSimulation]: failed to begin recording command buffer!");
 
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool        = a_cmdPool;
-    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+    // the graphics command buffer of the frame resets every other scope of the slot
+    //
+    if (m_computeTimestamps)
+    {
+        profiler.cmdResetScope(a_cmdBuff, a_slot, GPU_SCOPE_SIMULATION);
+        profiler.cmdBeginScope(a_cmdBuff, a_slot, GPU_SCOPE_SIMULATION);
+    }
+    if (m_loadHeightmap)
+        water.cmdLoadHeights(a_cmdBuff, streamer.buffer(m_heightmapStream));
+    water.cmdSimulateAsync(a_cmdBuff, a_slot);
+    if (m_computeTimestamps)
+        profiler.cmdEndScope(a_cmdBuff, a_slot, GPU_SCOPE_SIMULATION);
+
+    if (vkEndCommandBuffer(a_cmdBuff) != VK_SUCCESS)
+        throw std::runtime_error("[recordSimulation]: failed to record command buffer!");
+}
 
-    if (vkAllocateCommandBuffers(a_device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
-        throw std::runtime_error("[CreateCommandPoolAndBuffers]: failed to allocate command buffers!");
+void application::recordFrame(VkCommandBuffer a_cmdBuff, uint32_t a_imageIndex, uint32_t a_slot)
+{
+    m_recordSlot = a_slot;
+    m_reflecting = m_reflections && reflections.quality() != REFLECTIONS_OFF;
 
-    for (size_t i = 0; i < commandBuffers.size(); i++)
+    // the set shared by every draw of the frame; allocated here, before the recording threads read it
+    //
     {
-        VkCommandBufferBeginInfo beginInfo = {};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        m_frameSet = framePools.allocate(m_frameSetLayout);
+
+        VkDescriptorBufferInfo heights = {};
+        heights.buffer = settings.fftOcean ? ocean.heightBuffer() : water.renderBuffer(a_slot);
+        heights.range  = VK_WHOLE_SIZE;
+
+        // without the ocean the shaders skip the maps, any storage buffer keeps the binding valid
+        //
+        VkDescriptorBufferInfo maps = {};
+        maps.buffer = settings.fftOcean ? ocean.mapBuffer() : water.renderBuffer(a_slot);
+        maps.range  = VK_WHOLE_SIZE;
+
+        // the whole buffer with the range of one part; the draws pick the part with the dynamic offset
+        //
+        VkDescriptorBufferInfo uniforms = {};
+        uniforms.buffer = constants.buffer();
+        uniforms.range  = constants.range();
+
+        VkWriteDescriptorSet writes[3] = {};
+        writes[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].dstSet          = m_frameSet;
+        writes[0].dstBinding      = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[0].pBufferInfo     = &heights;
+        writes[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet          = m_frameSet;
+        writes[1].dstBinding      = 1;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        writes[1].pBufferInfo     = &uniforms;
+        writes[2].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[2].dstSet          = m_frameSet;
+        writes[2].dstBinding      = 2;
+        writes[2].descriptorCount = 1;
+        writes[2].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[2].pBufferInfo     = &maps;
+        vkUpdateDescriptorSets(device, 3, writes, 0, NULL);
+    }
+    writeFrameConstants(a_slot);
+
+    profiler.cmdResetSlot      (a_cmdBuff, a_slot, water.async() ? (1u << GPU_SCOPE_SIMULATION) : 0);
+    profiler.cmdBeginScope     (a_cmdBuff, a_slot, GPU_SCOPE_FRAME);
+
+    profiler.cmdBeginScope     (a_cmdBuff, a_slot, GPU_SCOPE_UPLOAD);
+    uploadRing.cmdCopies       (a_cmdBuff);
+    profiler.cmdEndScope       (a_cmdBuff, a_slot, GPU_SCOPE_UPLOAD);
+
+    profiler.cmdBeginStatistics(a_cmdBuff, a_slot);
 
-        if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS)
-            throw std::runtime_error("[CreateCommandPoolAndBuffers]: failed to begin recording command buffer!");
+    if (water.async())
+        water.cmdAcquire       (a_cmdBuff, a_slot);
 
-        VkRenderPassBeginInfo renderPassInfo = {};
-        renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass        = a_renderPass;
-        renderPassInfo.framebuffer       = a_swapChainFramebuffers[i];
-        renderPassInfo.renderArea.offset = { 0, 0 };
-        renderPassInfo.renderArea.extent = a_frameBufferExtent;
+    // The rest of the frame goes through the render graph: every pass declares what it reads and writes, the graph
+    // records the barriers between the passes and against the previous frame. The uploads and the async acquire
+    // above synchronise themselves, the passes only synchronise what happens inside them.
+    //
+    m_graph.reset();
+
+    const VkPipelineStageFlags computeStages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    const VkAccessFlags        computeAccess = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
 
-        VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
+    // the semaphore of the swapchain image waits at the first stage writing it, see drawFrame()
+    //
+    const VkPipelineStageFlags acquireStage = m_scaledRendering ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
-        vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    const uint32_t heights = m_graph.importBuffer("heights", settings.fftOcean ? ocean.heightBuffer() : water.renderBuffer(a_slot));
+    const uint32_t maps    = m_graph.importBuffer("maps",    settings.fftOcean ? ocean.mapBuffer()    : water.renderBuffer(a_slot));
+    const uint32_t output  = m_graph.acquireImage("output", screen.swapChainImages[a_imageIndex], VK_IMAGE_ASPECT_COLOR_BIT, acquireStage);
+    const uint32_t scene   = m_scaledRendering ? m_graph.importImage("scene", screen.sceneImage, VK_IMAGE_ASPECT_COLOR_BIT) : output;
 
-        vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, a_graphicsPipeline);
+    if (!water.async())
+    {
+        const bool loadHeightmap = m_loadHeightmap;
+        const bool gpuOcean      = settings.fftOcean && !settings.cpuSolver;
+        const bool gpuWater      = !settings.fftOcean && !settings.cpuSolver;
 
-        // say we want to take vertices pos from a_vPosBuffer
+        const uint32_t pass = m_graph.addPass("simulation", [this, a_slot, loadHeightmap, gpuOcean, gpuWater](VkCommandBuffer a_cmd)
+        {
+            profiler.cmdBeginScope (a_cmd, a_slot, GPU_SCOPE_SIMULATION);
+            if (loadHeightmap)
+                water.cmdLoadHeights(a_cmd, streamer.buffer(m_heightmapStream));
+            if (gpuOcean)
+            {
+                profiler.cmdBeginScope(a_cmd, a_slot, GPU_SCOPE_OCEAN_SPECTRUM);
+                ocean.cmdSpectrum     (a_cmd, m_oceanTime);
+                profiler.cmdEndScope  (a_cmd, a_slot, GPU_SCOPE_OCEAN_SPECTRUM);
+                profiler.cmdBeginScope(a_cmd, a_slot, GPU_SCOPE_OCEAN_FFT);
+                ocean.cmdFft          (a_cmd);
+                profiler.cmdEndScope  (a_cmd, a_slot, GPU_SCOPE_OCEAN_FFT);
+                profiler.cmdBeginScope(a_cmd, a_slot, GPU_SCOPE_OCEAN_RESOLVE);
+                ocean.cmdResolve      (a_cmd);
+                profiler.cmdEndScope  (a_cmd, a_slot, GPU_SCOPE_OCEAN_RESOLVE);
+            }
+            else if (gpuWater)
+                water.cmdSimulate  (a_cmd);
+            profiler.cmdEndScope   (a_cmd, a_slot, GPU_SCOPE_SIMULATION);
+        });
+
+        // the CPU solvers write the heights through the staging ring instead
+        //
+        if (loadHeightmap || gpuWater)
+            m_graph.use(pass, m_graph.importBuffer("water heights", water.renderBuffer(a_slot)), bufferAccess(computeStages, computeAccess));
+        if (gpuOcean)
         {
-            VkBuffer vertexBuffers[] = { a_vPosBuffer };
-            VkDeviceSize offsets[]   = { 0 };
-            vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+            m_graph.use(pass, heights, bufferAccess(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT));
+            m_graph.use(pass, maps,    bufferAccess(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT));
         }
+    }
 
-        vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
+    uint32_t commands = renderGraph::NO_RESOURCE, drawCount = renderGraph::NO_RESOURCE;
+    if (m_gpuCulling)
+    {
+        float planes[6][4], camera[3];
+        frustumPlanes(oceanLod.viewProj(), planes);
+        memcpy(camera, oceanLod.camera(), sizeof(camera));
 
-        vkCmdEndRenderPass(commandBuffers[i]);
+        const uint32_t pass = m_graph.addPass("cull", [this, a_slot, planes, camera](VkCommandBuffer a_cmd)
+        {
+            profiler.cmdBeginScope (a_cmd, a_slot, GPU_SCOPE_CULL);
+            culler.cmdCull         (a_cmd, planes, camera);
+            profiler.cmdEndScope   (a_cmd, a_slot, GPU_SCOPE_CULL);
+        });
+
+        commands  = m_graph.importBuffer("cull commands", culler.commandBuffer());
+        drawCount = m_graph.importBuffer("cull count", culler.countBuffer());
+        m_graph.use(pass, commands,  bufferAccess(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT));
+        m_graph.use(pass, drawCount, bufferAccess(computeStages, computeAccess));
+    }
 
-        if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to record command buffer!");
+    uint32_t particleData = renderGraph::NO_RESOURCE, drawList = renderGraph::NO_RESOURCE, particleState = renderGraph::NO_RESOURCE;
+    if (particles.capacity() > 0)
+    {
+        // fixed 60 Hz steps like the floating objects; emission follows the tile in front of the LOD camera
+        //
+        particleParams params = {};
+        waterSpace(params.toClip, &params.cellsPerUnit, &params.heightToWorld, &params.wrap);
+        params.gridSize  = water.gridSize();
+        params.dt        = 1.0f / 60.0f;
+        params.seed      = uint32_t(profiler.frameCount());
+        params.threshold = particles.threshold;
+        params.rate      = particles.rate;
+        params.gravity   = settings.lod ? 9.81f : 0.5f;
+        if (settings.lod)
+        {
+            const float tile = oceanLod.tileSize;
+            params.origin[0] = std::floor(0.5f * (m_lodCamera.position[0] + m_lodCamera.target[0]) / tile) * tile;
+            params.origin[1] = std::floor(0.5f * (m_lodCamera.position[2] + m_lodCamera.target[2]) / tile) * tile;
         }
+
+        const uint32_t pass = m_graph.addPass("particles", [this, a_slot, params](VkCommandBuffer a_cmd)
+        {
+            profiler.cmdBeginScope (a_cmd, a_slot, GPU_SCOPE_PARTICLES);
+            particles.cmdUpdate    (a_cmd, a_slot, params);
+            profiler.cmdEndScope   (a_cmd, a_slot, GPU_SCOPE_PARTICLES);
+        });
+
+        // the sort dispatches read their sizes from the state buffer at the draw indirect stage
+        //
+        particleData  = m_graph.importBuffer("particles", particles.particleBuffer());
+        drawList      = m_graph.importBuffer("particle draw list", particles.drawListBuffer());
+        particleState = m_graph.importBuffer("particle state", particles.stateBuffer());
+        m_graph.use(pass, heights,      bufferAccess(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT));
+        m_graph.use(pass, particleData, bufferAccess(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT));
+        m_graph.use(pass, m_graph.importBuffer("particle free list", particles.freeListBuffer()),
+                    bufferAccess(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT));
+        m_graph.use(pass, drawList,     bufferAccess(computeStages, computeAccess));
+        m_graph.use(pass, particleState, bufferAccess(computeStages | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, computeAccess | VK_ACCESS_INDIRECT_COMMAND_READ_BIT));
+    }
+
+    // what the scene passes draw from: the floating objects read the heights too, the water everything
+    //
+    auto sceneReads = [&](uint32_t a_pass, bool a_water)
+    {
+        m_graph.use(a_pass, heights, bufferAccess(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT));
+        m_graph.use(a_pass, maps,    bufferAccess(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT));
+        if (!a_water)
+            return;
+        if (m_gpuCulling)
+        {
+            m_graph.use(a_pass, commands,  bufferAccess(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT));
+            m_graph.use(a_pass, drawCount, bufferAccess(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT));
+        }
+        if (particles.capacity() > 0)
+        {
+            m_graph.use(a_pass, particleData,  bufferAccess(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT));
+            m_graph.use(a_pass, drawList,      bufferAccess(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT));
+            m_graph.use(a_pass, particleState, bufferAccess(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT));
+        }
+    };
+
+    if (!m_reflecting)
+    {
+        const uint32_t pass = m_graph.addPass("scene", [this, a_imageIndex, a_slot](VkCommandBuffer a_cmd)
+        {
+            recordRenderPass(a_cmd, a_imageIndex, a_slot, SCENE_WHOLE);
+        });
+        sceneReads(pass, true);
+
+        // the render pass handles the layout of its color target: from UNDEFINED, cleared, to sceneFinalLayout()
+        //
+        m_graph.use(pass, scene, imageAccess(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                             VK_IMAGE_LAYOUT_UNDEFINED, sceneFinalLayout()));
     }
+    else
+    {
+        // The opaque pass leaves its color for the copy and keeps the depth (and the multisampled color) for the
+        // Hi-Z chain and the water pass, which loads all of them back. The copy and the chain only live in the frame.
+        //
+        const VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT | ((m_depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+        const VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        const VkAccessFlags        depthAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        const VkAccessFlags        colorAccess = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+        const uint32_t depth = m_graph.importImage("depth", screen.depthImage, depthAspect);
+        const uint32_t msaa  = (m_samples != VK_SAMPLE_COUNT_1_BIT) ? m_graph.importImage("msaa color", screen.msaaImage, VK_IMAGE_ASPECT_COLOR_BIT)
+                                                                    : renderGraph::NO_RESOURCE;
+        const uint32_t copy  = m_graph.createImage("scene copy", reflections.colorImageInfo(screen.swapChainImageFormat, screen.swapChainExtent));
+        const uint32_t hiz   = m_graph.createImage("hi-z", reflections.hizImageInfo(screen.swapChainExtent));
+
+        const uint32_t opaque = m_graph.addPass("opaque", [this, a_imageIndex, a_slot](VkCommandBuffer a_cmd)
+        {
+            recordRenderPass(a_cmd, a_imageIndex, a_slot, SCENE_OPAQUE);
+        });
+        sceneReads(opaque, false);
+        m_graph.use(opaque, scene, imageAccess(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                               VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+        m_graph.use(opaque, depth, imageAccess(depthStages, depthAccess, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL));
+        if (msaa != renderGraph::NO_RESOURCE)
+            m_graph.use(opaque, msaa, imageAccess(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, colorAccess,
+                                                  VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+
+        const uint32_t inputs = m_graph.addPass("reflection inputs", [this, a_slot, scene, copy, hiz](VkCommandBuffer a_cmd)
+        {
+            recordReflectionInputs(a_cmd, a_slot, scene, copy, hiz);
+        });
+        m_graph.use(inputs, scene, imageAccess(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+        m_graph.use(inputs, depth, imageAccess(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL));
+        m_graph.use(inputs, copy,  imageAccess(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+        m_graph.use(inputs, hiz,   imageAccess(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                               VK_IMAGE_LAYOUT_GENERAL));
+
+        // without multisampling the water pass loads the scene it draws over, from the layout it leaves behind
+        //
+        const uint32_t pass = m_graph.addPass("water", [this, a_imageIndex, a_slot, copy, hiz](VkCommandBuffer a_cmd)
+        {
+            m_reflectionSet = reflections.writeSet(device, &framePools, m_graph.view(copy), m_graph.view(hiz));
+            recordRenderPass(a_cmd, a_imageIndex, a_slot, SCENE_WATER);
+        });
+        sceneReads(pass, true);
+        m_graph.use(pass, copy, imageAccess(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+        m_graph.use(pass, hiz,  imageAccess(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+        m_graph.use(pass, scene, imageAccess(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, colorAccess,
+                                             (msaa != renderGraph::NO_RESOURCE) ? VK_IMAGE_LAYOUT_UNDEFINED : sceneFinalLayout(), sceneFinalLayout()));
+        m_graph.use(pass, depth, imageAccess(depthStages, depthAccess, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL));
+        if (msaa != renderGraph::NO_RESOURCE)
+            m_graph.use(pass, msaa, imageAccess(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, colorAccess,
+                                                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+    }
+
+    if (m_scaledRendering)
+    {
+        const uint32_t pass = m_graph.addPass("upscale", [this, a_imageIndex, a_slot](VkCommandBuffer a_cmd)
+        {
+            profiler.cmdBeginScope(a_cmd, a_slot, GPU_SCOPE_UPSCALE);
+            cmdUpscale            (a_cmd, a_imageIndex);
+            profiler.cmdEndScope  (a_cmd, a_slot, GPU_SCOPE_UPSCALE);
+        });
+        m_graph.use(pass, scene,  imageAccess(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+        m_graph.use(pass, output, imageAccess(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+    }
+
+    // to presentation (the semaphore signal covers visibility), or to readback in headless mode
+    //
+    if (settings.headless)
+        m_graph.output(output, imageAccess(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+    else
+        m_graph.output(output, imageAccess(0, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR));
+
+    m_graph.compile();
+    m_graph.execute(a_cmdBuff);
+    profiler.setGraphStats(m_graph.stats().barrierCalls, m_graph.stats().transientBytes);
+
+    // the graph has allocated this frame's transient memory by now, so these are the frame's totals
+    //
+    const allocatorStats memory = allocator.stats();
+    profiler.setMemoryStats(memory.blockBytes, memory.usedBytes);
+
+    profiler.cmdEndScope     (a_cmdBuff, a_slot, GPU_SCOPE_FRAME);
+
+    if (vkEndCommandBuffer(a_cmdBuff) != VK_SUCCESS)
+        throw std::runtime_error("[recordFrame]: failed to record command buffer!");
+}
+
+void application::recordRenderPass(VkCommandBuffer a_cmdBuff, uint32_t a_imageIndex, uint32_t a_slot, scenePart a_part)
+{
+    // the two passes of the reflecting scene are timed and counted as one, the reflection inputs between them included
+    //
+    if (a_part != SCENE_WATER)
+        profiler.cmdBeginScope (a_cmdBuff, a_slot, GPU_SCOPE_RENDER_PASS);
+
+    // draws are split into one chunk per recording thread; a single chunk is recorded inline. The opaque pass only
+    // has the floating objects
+    //
+    const uint32_t chunks = (a_part == SCENE_OPAQUE) ? 1 : std::min<uint32_t>(recorder.threadCount(), settings.drawCalls);
+
+    VkRenderPass pass = renderPass;
+    if (a_part == SCENE_OPAQUE)
+        pass = m_opaquePass;
+    else if (a_part == SCENE_WATER)
+        pass = m_waterPass;
+
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass        = pass;
+    renderPassInfo.framebuffer       = m_scaledRendering ? screen.sceneFramebuffer : screen.swapChainFramebuffers[a_imageIndex];
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = m_renderExtent;
+
+    VkClearValue clearValues[3] = {};   // as m_passDesc numbers the attachments
+    clearValues[0].color        = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+    clearValues[1].depthStencil = { 0.0f, 0 };   // reverse-Z far plane
+    clearValues[2].color        = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+    renderPassInfo.clearValueCount = m_passDesc.attachmentCount();
+    renderPassInfo.pClearValues    = clearValues;
+
+    // with the depth pre-pass all chunks record the water depth first, then all of them shade it
+    //
+    const uint32_t passes = (settings.depthPrepass && a_part != SCENE_OPAQUE) ? 2 : 1;
+
+    if (chunks <= 1)
+    {
+        vkCmdBeginRenderPass(a_cmdBuff, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        if (passes == 2)
+            recordDraws(a_cmdBuff, 0, settings.drawCalls, true, a_part);
+        recordDraws(a_cmdBuff, 0, settings.drawCalls, false, a_part);
+    }
+    else
+    {
+        vkCmdBeginRenderPass(a_cmdBuff, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        VkCommandBufferInheritanceInfo inheritance = {};
+        inheritance.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass         = pass;
+        inheritance.subpass            = 0;
+        inheritance.framebuffer        = renderPassInfo.framebuffer;
+        inheritance.pipelineStatistics = profiler.statisticsFlags();   // 0 unless inheritedQueries is enabled, see initVulkan()
+
+        const uint32_t drawCalls = settings.drawCalls;
+        std::function<void(VkCommandBuffer, uint32_t)> record = [this, chunks, passes, drawCalls, a_part](VkCommandBuffer a_secondary, uint32_t a_index)
+        {
+            const uint32_t chunk = a_index % chunks;
+            const uint32_t first = uint32_t(uint64_t(chunk) * drawCalls / chunks);
+            const uint32_t last  = uint32_t(uint64_t(chunk + 1) * drawCalls / chunks);
+            recordDraws(a_secondary, first, last - first, passes == 2 && a_index < chunks, a_part);
+        };
+        recorder.recordSecondaries(device, chunks * passes, inheritance, record, &m_secondaries);
+
+        vkCmdExecuteCommands(a_cmdBuff, uint32_t(m_secondaries.size()), m_secondaries.data());
+    }
+
+    vkCmdEndRenderPass(a_cmdBuff);
+
+    if (a_part == SCENE_OPAQUE)
+        return;
+    profiler.cmdEndScope     (a_cmdBuff, a_slot, GPU_SCOPE_RENDER_PASS);
+    profiler.cmdEndStatistics(a_cmdBuff, a_slot);
+}
+
+void application::recordReflectionInputs(VkCommandBuffer a_cmdBuff, uint32_t a_slot, uint32_t a_scene, uint32_t a_copy, uint32_t a_hiz)
+{
+    // the render graph has the scene in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, the copy in
+    // VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL and the chain in VK_IMAGE_LAYOUT_GENERAL, and hands both to the water pass
+    //
+    profiler.cmdBeginScope(a_cmdBuff, a_slot, GPU_SCOPE_REFLECTIONS);
+
+    VkImageView levels[waterReflections::HIZ_LEVELS];
+    for (uint32_t i = 0; i < waterReflections::HIZ_LEVELS; i++)
+        levels[i] = m_graph.view(a_hiz, i);
+
+    const VkImageCreateInfo hizInfo = reflections.hizImageInfo(screen.swapChainExtent);
+    const VkExtent2D        hizExtent = { hizInfo.extent.width, hizInfo.extent.height };
+
+    reflections.cmdCopyColor(a_cmdBuff, m_graph.image(a_scene), m_graph.image(a_copy), m_renderExtent);
+    reflections.cmdBuildHiZ (a_cmdBuff, device, &framePools, screen.depthView, levels, m_renderExtent, hizExtent);
+
+    profiler.cmdEndScope  (a_cmdBuff, a_slot, GPU_SCOPE_REFLECTIONS);
+}
+
+void application::cmdUpscale(VkCommandBuffer a_cmdBuff, uint32_t a_imageIndex)
+{
+    // the render graph's upscale pass has the scene in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL and the output in
+    // VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, and moves the output on to presentation or readback after it
+    //
+    VkImageBlit region = {};
+    region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.layerCount = 1;
+    region.srcOffsets[1]             = { int32_t(m_renderExtent.width), int32_t(m_renderExtent.height), 1 };
+    region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.dstSubresource.layerCount = 1;
+    region.dstOffsets[1]             = { int32_t(screen.swapChainExtent.width), int32_t(screen.swapChainExtent.height), 1 };
+
+    vkCmdBlitImage(a_cmdBuff, screen.sceneImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, screen.swapChainImages[a_imageIndex],
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, m_upscaleFilter);
+}
+
+void application::updateRenderScale(void)
+{
+    // GPU times arrive framesInFlight frames late; frames rendered before the last scale change
+    // describe the old scale and are skipped
+    //
+    const uint64_t latest = profiler.latestGpuFrame();
+    if (latest <= m_lastControlledFrame)
+        return;
+    m_lastControlledFrame = latest;
+
+    const frameRecord& rec = profiler.latestGpuRecord();
+    if (!(rec.gpuValid & (1u << GPU_SCOPE_RENDER_PASS)) || rec.renderScale != resolution.scale())
+        return;
+
+    resolution.update(rec.gpu[GPU_SCOPE_FRAME], rec.gpu[GPU_SCOPE_RENDER_PASS]);
+}
+
+void application::updateReflectionSteps(void)
+{
+    // like updateRenderScale(): frames marched with the old step count are skipped, and so are the frames
+    // without reflections
+    //
+    const uint64_t latest = profiler.latestGpuFrame();
+    if (latest <= m_lastReflectionFrame)
+        return;
+    m_lastReflectionFrame = latest;
+
+    const frameRecord& rec = profiler.latestGpuRecord();
+    if (!(rec.gpuValid & (1u << GPU_SCOPE_REFLECTIONS)))
+        return;
+
+    if (reflections.update(rec.gpu[GPU_SCOPE_FRAME]))
+        m_lastReflectionFrame = profiler.frameCount() - 1;
 }
 
 void application::createSyncObjects(VkDevice a_device, syncObj* a_pSyncObjs)
 {
-    a_pSyncObjs->imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    a_pSyncObjs->renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    a_pSyncObjs->inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    a_pSyncObjs->imageAvailableSemaphores.resize(settings.framesInFlight);
+    a_pSyncObjs->renderFinishedSemaphores.resize(settings.framesInFlight);
+    a_pSyncObjs->inFlightFences.resize(settings.framesInFlight);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -796,7 +2672,7 @@ void application::createSyncObjects(VkDevice a_device, syncObj* a_pSyncObjs)
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < settings.framesInFlight; i++)
     {
         if (vkCreateSemaphore(a_device, &semaphoreInfo, nullptr, &a_pSyncObjs->imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(a_device, &semaphoreInfo, nullptr, &a_pSyncObjs->renderFinishedSemaphores[i]) != VK_SUCCESS ||
@@ -805,6 +2681,16 @@ void application::createSyncObjects(VkDevice a_device, syncObj* a_pSyncObjs)
             throw std::runtime_error("[CreateSyncObjects]: failed to create synchronization objects for a frame!");
         }
     }
+
+    if (m_computeFamily == m_graphicsFamily)
+        return;
+
+    a_pSyncObjs->simulationFinishedSemaphores.resize(settings.framesInFlight);
+    for (size_t i = 0; i < settings.framesInFlight; i++)
+    {
+        if (vkCreateSemaphore(a_device, &semaphoreInfo, nullptr, &a_pSyncObjs->simulationFinishedSemaphores[i]) != VK_SUCCESS)
+            throw std::runtime_error("[CreateSyncObjects]: failed to create simulation semaphore for a frame!");
+    }
 }
 
 void application::runCommandBuffer(VkCommandBuffer a_cmdBuff, VkQueue a_queue, VkDevice a_device)
@@ -834,13 +2720,23 @@ void application::runCommandBuffer(VkCommandBuffer a_cmdBuff, VkQueue a_queue, V
     vkDestroyFence(a_device, fence, NULL);
 }
 
-void application::putTriangleVerticesToVBO_Now(VkDevice       a_device,
-                                               VkCommandPool  a_pool,
-                                               VkQueue        a_queue,
-                                               float*         a_triPos,
-                                               int            a_floatsNum,
-                                               VkBuffer       a_buffer)
+void application::putDataToBuffer_Now(VkDevice         a_device,
+                                      deviceAllocator* a_pAllocator,
+                                      VkCommandPool    a_pool,
+                                      VkQueue          a_queue,
+                                      const void*      a_data,
+                                      size_t           a_size,
+                                      VkBuffer         a_buffer)
 {
+    // vkCmdUpdateBuffer is limited to 64 KB, so larger data goes through a host visible staging buffer
+    //
+    VkBuffer         staging;
+    deviceAllocation stagingMem;
+    a_pAllocator->createBuffer(a_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging, &stagingMem);
+
+    memcpy(stagingMem.mapped, a_data, a_size);
+
     VkCommandBufferAllocateInfo allocInfo = {
         .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
         .commandPool        = a_pool,
@@ -850,121 +2746,454 @@ void application::putTriangleVerticesToVBO_Now(VkDevice       a_device,
 
     VkCommandBuffer cmdBuff;
     if (vkAllocateCommandBuffers(a_device, &allocInfo, &cmdBuff) != VK_SUCCESS)
-        throw std::runtime_error("[putTriangleVerticesToVBO_Now]: failed to allocate command buffer!");
+        throw std::runtime_error("[putDataToBuffer_Now]: failed to allocate command buffer!");
 
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
+    VkBufferCopy region = {};
+    region.size = a_size;
+
     vkBeginCommandBuffer(cmdBuff, &beginInfo);
-    vkCmdUpdateBuffer   (cmdBuff, a_buffer, 0, a_floatsNum * sizeof(float), a_triPos);
+    vkCmdCopyBuffer     (cmdBuff, staging, a_buffer, 1, &region);
     vkEndCommandBuffer  (cmdBuff);
 
     runCommandBuffer(cmdBuff, a_queue, a_device);
 
     vkFreeCommandBuffers(a_device, a_pool, 1, &cmdBuff);
+    a_pAllocator->destroyBuffer(staging, stagingMem);
 }
 
-void application::drawFrame(void)
+void application::readbackBuffer_Now(VkDevice         a_device,
+                                     deviceAllocator* a_pAllocator,
+                                     VkCommandPool    a_pool,
+                                     VkQueue          a_queue,
+                                     VkBuffer         a_buffer,
+                                     size_t           a_size,
+                                     void*            a_data)
 {
-    vkWaitForFences(device, 1, &m_sync.inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
-    vkResetFences  (device, 1, &m_sync.inFlightFences[currentFrame]);
+    VkBuffer         staging;
+    deviceAllocation stagingMem;
+    a_pAllocator->createBuffer(a_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging, &stagingMem);
 
-    uint32_t imageIndex;
-    vkAcquireNextImageKHR(device, screen.swapChain, UINT64_MAX, m_sync.imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkCommandBufferAllocateInfo allocInfo = {
+        .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool        = a_pool,
+        .level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1
+    };
 
-    VkSemaphore      waitSemaphores[] = { m_sync.imageAvailableSemaphores[currentFrame] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    VkCommandBuffer cmdBuff;
+    if (vkAllocateCommandBuffers(a_device, &allocInfo, &cmdBuff) != VK_SUCCESS)
+        throw std::runtime_error("[readbackBuffer_Now]: failed to allocate command buffer!");
 
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores    = waitSemaphores;
-    submitInfo.pWaitDstStageMask  = waitStages;
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &commandBuffers[imageIndex];
+    VkBufferCopy region = {};
+    region.size = a_size;
 
-    VkSemaphore signalSemaphores[]  = { m_sync.renderFinishedSemaphores[currentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores    = signalSemaphores;
+    VkBufferMemoryBarrier barrier = vk_utils::bufferBarrier(a_buffer, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, m_sync.inFlightFences[currentFrame]) != VK_SUCCESS)
-        throw std::runtime_error("[DrawFrame]: failed to submit draw command buffer!");
+    vkBeginCommandBuffer(cmdBuff, &beginInfo);
+    vkCmdPipelineBarrier(cmdBuff, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 1, &barrier, 0, NULL);
+    vkCmdCopyBuffer     (cmdBuff, a_buffer, staging, 1, &region);
+    vkEndCommandBuffer  (cmdBuff);
 
-    VkPresentInfoKHR presentInfo = {};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+    runCommandBuffer(cmdBuff, a_queue, a_device);
 
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores    = signalSemaphores;
+    memcpy(a_data, stagingMem.mapped, a_size);
 
-    VkSwapchainKHR swapChains[] = { screen.swapChain };
-    presentInfo.swapchainCount  = 1;
-    presentInfo.pSwapchains     = swapChains;
-    presentInfo.pImageIndices   = &imageIndex;
+    vkFreeCommandBuffers(a_device, a_pool, 1, &cmdBuff);
+    a_pAllocator->destroyBuffer(staging, stagingMem);
+}
 
-    vkQueuePresentKHR(presentQueue, &presentInfo);
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+void application::updateLod(void)
+{
+    // a fixed path circling the ocean, so benchmark runs see the same views
+    //
+    const float angle  = float(m_lodFrame++) * 0.001f;
+    const float radius = settings.oceanSize * 0.25f;
+    m_lodCamera.position[0] = radius * std::cos(angle);
+    m_lodCamera.position[1] = 30.0f;
+    m_lodCamera.position[2] = radius * std::sin(angle);
+    m_lodCamera.target[0]   = m_lodCamera.position[0] - 300.0f * std::sin(angle);
+    m_lodCamera.target[1]   = 0.0f;
+    m_lodCamera.target[2]   = m_lodCamera.position[2] + 300.0f * std::cos(angle);
+
+    // with GPU culling the selection is made in the cull pass, from the nodes of uploadLodNodes()
+    //
+    const float aspect = float(m_renderExtent.width) / float(m_renderExtent.height);
+    if (m_gpuCulling)
+    {
+        oceanLod.view(m_lodCamera, aspect);
+        return;
+    }
+
+    oceanLod.select(m_lodCamera, aspect);
+
+    const std::vector<lodPatch>& patches = oceanLod.patches();
+    if (!patches.empty() && !uploadRing.upload(m_lodInstances, 0, patches.data(), patches.size() * sizeof(lodPatch)))
+        throw std::runtime_error("[updateLod]: staging ring is too small for the LOD patches!");
 }
 
-uint32_t application::findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags properties, VkPhysicalDevice physicalDevice)
+void application::uploadLodNodes(void)
 {
-    VkPhysicalDeviceMemoryProperties memoryProperties;
+    // every node as an instance and its quadrants as cull candidates; they change with the tree, not with the camera,
+    // so they stay in device memory and only a new configuration uploads them again
+    //
+    std::vector<lodPatch> nodes;
+    oceanLod.allNodes(&nodes);
 
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    std::vector<cullCandidate> candidates(nodes.size() * 4);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        for (uint32_t q = 0; q < 4; q++)
+        {
+            cullCandidate& candidate = candidates[i * 4 + q];
+            oceanLod.quadrantBounds(nodes[i], q, candidate.boundsMin, candidate.boundsMax);
+            candidate.segment    = q;
+            candidate.instance   = uint32_t(i);
+            candidate.nodeMin[0] = nodes[i].offsetX;
+            candidate.nodeMin[1] = nodes[i].offsetZ;
+            candidate.nodeSize   = nodes[i].size;
+            candidate.level      = uint32_t(nodes[i].level);
+        }
+    }
+
+    culler.setCandidates(uint32_t(candidates.size()), oceanLod.finestRange(), oceanLod.levels);
+    putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, nodes.data(), nodes.size() * sizeof(lodPatch), m_lodInstances);
+    putDataToBuffer_Now(device, &allocator, commandPool, graphicsQueue, candidates.data(), candidates.size() * sizeof(cullCandidate), culler.candidateBuffer());
+    m_lodNodes = uint32_t(nodes.size());
+}
 
-    /*How does this search work?
-    See the documentation of VkPhysicalDeviceMemoryProperties for a detailed description.*/
-    for (size_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+sweepPoint application::measureSweepPoint(uint32_t a_count, int a_frames)
+{
+    for (int i = 0; i < 8; i++)
     {
-        if ((memoryTypeBits & (1 << i)) && ((memoryProperties.memoryTypes[i].propertyFlags & properties) == properties))
-            return i;
+        pollInput();
+        drawFrame();
     }
-    return -1;
+    vkDeviceWaitIdle(device);
+    profiler.collectAll(device);
+
+    sweepPoint point;
+    point.count = a_count;
+    for (int i = 0; i < a_frames; i++)
+    {
+        auto frameStart = std::chrono::steady_clock::now();
+        pollInput();
+        drawFrame();
+        point.frameMs += elapsedMs(frameStart, std::chrono::steady_clock::now()) / double(a_frames);
+    }
+    vkDeviceWaitIdle(device);
+    profiler.collectAll(device);
+
+    std::vector<frameRecord> records = profiler.records();
+    double gpuSum = 0.0, recordSum = 0.0, cpuSum = 0.0;
+    int    gpuFrames = 0, cpuFrames = 0;
+    for (size_t i = (records.size() > size_t(a_frames)) ? records.size() - a_frames : 0; i < records.size(); i++)
+    {
+        if (records[i].gpuValid & (1u << GPU_SCOPE_FRAME))
+        {
+            gpuSum += records[i].gpu[GPU_SCOPE_FRAME];
+            gpuFrames++;
+        }
+        recordSum += records[i].cpu[CPU_SCOPE_RECORD];
+        cpuSum    += records[i].cpuFrame - records[i].cpu[CPU_SCOPE_FENCE_WAIT] - records[i].cpu[CPU_SCOPE_ACQUIRE];
+        cpuFrames++;
+    }
+    if (gpuFrames > 0)
+        point.gpuMs = gpuSum / double(gpuFrames);
+    point.recordMs = recordSum / double(std::max(cpuFrames, 1));
+    point.cpuMs    = cpuSum / double(std::max(cpuFrames, 1));
+    return point;
 }
 
-VkShaderModule application::createShaderModule(VkDevice a_device, const std::vector<uint32_t>& code)
+void application::uploadCpuHeights(void)
 {
-    VkShaderModuleCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size() * sizeof(uint32_t);
-    createInfo.pCode = code.data();
+    // the solver writes its own memory, so this is one memcpy into the frame's staging ring part
+    //
+    if (!uploadRing.upload(water.heightBuffer(0), 0, cpuWater.heights(), water.heightBufferSize()))
+        throw std::runtime_error("[uploadCpuHeights]: staging ring is too small for the heightfield!");
+}
 
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(a_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-        throw std::runtime_error("[CreateShaderModule]: failed to create shader module!");
+void application::uploadCpuOcean(void)
+{
+    // evaluated straight into the frame's staging ring part, the outputs are written once
+    //
+    void* heights = uploadRing.allocate(ocean.heightBuffer(), 0, ocean.heightBufferSize());
+    void* maps    = uploadRing.allocate(ocean.mapBuffer(), 0, ocean.mapBufferSize());
+    if (heights == nullptr || maps == nullptr)
+        throw std::runtime_error("[uploadCpuOcean]: staging ring is too small for the ocean!");
 
-    return shaderModule;
+    cpuWaves.evaluate(m_oceanTime, static_cast<float*>(heights), static_cast<float*>(maps));
 }
 
-std::vector<uint32_t> application::readFile(const char* filename)
+void application::pollInput(void)
 {
-    FILE* fp = fopen(filename, "rb");
-    if (fp == NULL)
+    // the limiter waits before the input is sampled, so the frame that follows renders fresh input
+    //
+    pacer.waitForFrame();
+    if (!settings.headless)
+        glfwPollEvents();
+    pacer.inputSampled();
+}
+
+void application::drawFrame(void)
+{
+    profiler.beginFrame();
+    {
+        scopedTimer timer(&profiler, CPU_SCOPE_FENCE_WAIT);
+        vkWaitForFences(device, 1, &m_sync.inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    releaseRetiredScreens(false);
+
+    if (m_pendingExtent.width != 0)
+    {
+        settings.width  = int(m_pendingExtent.width);
+        settings.height = int(m_pendingExtent.height);
+        m_pendingExtent = { 0, 0 };
+        recreateScreen();
+    }
+
+    // the fence above retired the previous use of this frame's staging ring part and descriptor pools
+    //
+    uploadRing.beginFrame(uint32_t(currentFrame));
+    framePools.beginFrame(uint32_t(currentFrame));
+
+    m_oceanTime = float(profiler.frameCount()) / 60.0f;
+    if (settings.cpuSolver)
+    {
+        scopedTimer timer(&profiler, CPU_SCOPE_SIMULATION);
+        if (settings.fftOcean)
+            uploadCpuOcean();
+        else
+        {
+            cpuWater.step(waterSimulation::STEPS_PER_FRAME);
+            uploadCpuHeights();
+        }
+    }
+
+    // offscreen targets are allocated one per frame in flight, so the fence above already guarantees that the image is free
+    //
+    uint32_t imageIndex = uint32_t(currentFrame);
+    if (!settings.headless)
+    {
+        VkResult result;
+        {
+            scopedTimer timer(&profiler, CPU_SCOPE_ACQUIRE);
+            result = vkAcquireNextImageKHR(device, screen.swapChain, UINT64_MAX, m_sync.imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+        }
+
+        // nothing is submitted for this frame, its fence was not reset and stays signaled for the next attempt;
+        // the simulation step above is not lost, the CPU heights are uploaded whole every frame
+        //
+        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        {
+            recreateScreen();
+            profiler.endFrame();
+            return;
+        }
+        if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+            throw std::runtime_error("[DrawFrame]: failed to acquire swap chain image!");
+    }
+
+    vkResetFences(device, 1, &m_sync.inFlightFences[currentFrame]);
+
+    // queries of the previous use of this frame's slot are read back here, before they are reset again
+    //
+    profiler.setFrameSlot(device, uint32_t(currentFrame));
+
+    if (m_scaledRendering && settings.dynamicResolution)
+        updateRenderScale();
+    if (m_reflections && settings.adaptiveReflections)
+        updateReflectionSteps();
+
+    const float scale = m_scaledRendering ? resolution.scale() : 1.0f;
+    m_renderExtent.width  = std::max(1u, uint32_t(float(screen.swapChainExtent.width)  * scale + 0.5f));
+    m_renderExtent.height = std::max(1u, uint32_t(float(screen.swapChainExtent.height) * scale + 0.5f));
+    profiler.setRenderScale(scale);
+    profiler.setRenderPixels(uint64_t(m_renderExtent.width) * m_renderExtent.height);
+
+    if (settings.lod)
+    {
+        scopedTimer timer(&profiler, CPU_SCOPE_LOD);
+        updateLod();
+    }
+
+    // background copies are retired and the chunks the loader thread has read are submitted, without waiting
+    //
+    streamer.poll(device);
+    if (m_heightmapStream != NO_STREAM)
+    {
+        const streamState state = streamer.state(m_heightmapStream);
+        if (state == STREAM_READY)
+        {
+            m_loadHeightmap = true;
+            m_heightmapTime = streamer.loadTime(m_heightmapStream);
+            std::cout << "[assetStreamer]: " << settings.heightmapFile << " streamed in " << m_heightmapTime << " ms" << std::endl;
+        }
+        else if (state == STREAM_FAILED)
+            std::cout << "[assetStreamer]: failed to read " << settings.heightmapFile << std::endl;
+    }
+
+    VkCommandBuffer frameCmd;
+    {
+        scopedTimer timer(&profiler, CPU_SCOPE_RECORD);
+        frameCmd = recorder.beginFrame(device, uint32_t(currentFrame));
+        recordFrame(frameCmd, imageIndex, uint32_t(currentFrame));
+        if (water.async())
+            recordSimulation(m_computeCmds[currentFrame], uint32_t(currentFrame));
+    }
+    if (m_loadHeightmap)
+    {
+        m_loadHeightmap   = false;
+        m_heightmapStream = NO_STREAM;
+    }
+    else if (m_heightmapStream != NO_STREAM && streamer.state(m_heightmapStream) == STREAM_FAILED)
+        m_heightmapStream = NO_STREAM;
+
+    profiler.setUploadBytes(uploadRing.frameBytes());
+
+    // the simulation goes first so the compute queue works on it while the graphics queue still finishes
+    // the previous frame; the graphics submit only waits for it at the vertex shader
+    //
+    if (water.async())
+    {
+        VkSubmitInfo computeInfo = {};
+        computeInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        computeInfo.commandBufferCount   = 1;
+        computeInfo.pCommandBuffers      = &m_computeCmds[currentFrame];
+        computeInfo.signalSemaphoreCount = 1;
+        computeInfo.pSignalSemaphores    = &m_sync.simulationFinishedSemaphores[currentFrame];
+
+        scopedTimer timer(&profiler, CPU_SCOPE_SUBMIT);
+        if (vkQueueSubmit(computeQueue, 1, &computeInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+            throw std::runtime_error("[DrawFrame]: failed to submit simulation command buffer!");
+    }
+
+    VkSemaphore          waitSemaphores[2];
+    VkPipelineStageFlags waitStages[2];
+    uint32_t             waitCount = 0;
+    if (!settings.headless)
+    {
+        waitSemaphores[waitCount] = m_sync.imageAvailableSemaphores[currentFrame];
+        waitStages[waitCount++]   = m_scaledRendering ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    }
+    if (water.async())
+    {
+        waitSemaphores[waitCount] = m_sync.simulationFinishedSemaphores[currentFrame];
+        waitStages[waitCount++]   = particles.capacity() > 0 ? (VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
+                                                             : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = waitCount;
+    submitInfo.pWaitSemaphores    = waitSemaphores;
+    submitInfo.pWaitDstStageMask  = waitStages;
+
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &frameCmd;
+
+    VkSemaphore signalSemaphores[]  = { m_sync.renderFinishedSemaphores[currentFrame] };
+    submitInfo.signalSemaphoreCount = settings.headless ? 0 : 1;
+    submitInfo.pSignalSemaphores    = signalSemaphores;
+
     {
-        std::string errorMsg = std::string("readFile, can't open file ") + std::string(filename);
-        RUN_TIME_ERROR(errorMsg.c_str());
+        scopedTimer timer(&profiler, CPU_SCOPE_SUBMIT);
+        auto submitStart = std::chrono::steady_clock::now();
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, m_sync.inFlightFences[currentFrame]) != VK_SUCCESS)
+            throw std::runtime_error("[DrawFrame]: failed to submit draw command buffer!");
+        lastSubmitTime = elapsedMs(submitStart, std::chrono::steady_clock::now());
     }
+    lastImageIndex = imageIndex;
+    m_submittedFrames++;
 
-    // get file size.
-    fseek(fp, 0, SEEK_END);
-    long filesize = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
+    VkResult presentResult = VK_SUCCESS;
+    if (!settings.headless)
+    {
+        scopedTimer timer(&profiler, CPU_SCOPE_PRESENT);
+
+        VkPresentInfoKHR presentInfo = {};
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores    = signalSemaphores;
+
+        VkSwapchainKHR swapChains[] = { screen.swapChain };
+        presentInfo.swapchainCount  = 1;
+        presentInfo.pSwapchains     = swapChains;
+        presentInfo.pImageIndices   = &imageIndex;
+
+        presentResult = vkQueuePresentKHR(presentQueue, &presentInfo);
+        profiler.setInputLatency(pacer.presented());
+    }
+    currentFrame = (currentFrame + 1) % settings.framesInFlight;
+
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR || m_framebufferResized)
+        recreateScreen();
+    else if (presentResult != VK_SUCCESS)
+        throw std::runtime_error("[DrawFrame]: failed to present swap chain image!");
+
+    profiler.endFrame();
+}
+
+void application::readbackFrame(std::vector<uint32_t>* a_pPixels, int* a_pWidth, int* a_pHeight)
+{
+    if (!settings.headless)
+        RUN_TIME_ERROR("readbackFrame, only offscreen targets can be read back");
+
+    vkDeviceWaitIdle(device);
+
+    const VkExtent2D   extent     = screen.swapChainExtent;
+    const VkDeviceSize bufferSize = VkDeviceSize(extent.width) * extent.height * sizeof(uint32_t);
+
+    VkBuffer         readbackBuffer;
+    deviceAllocation readbackMemory;
+    allocator.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &readbackBuffer, &readbackMemory);
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool        = commandPool;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer cmdBuff;
+    if (vkAllocateCommandBuffers(device, &allocInfo, &cmdBuff) != VK_SUCCESS)
+        throw std::runtime_error("[readbackFrame]: failed to allocate command buffer!");
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    // the render pass leaves offscreen images in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+    //
+    VkBufferImageCopy region = {};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent                 = { extent.width, extent.height, 1 };
 
-    long filesizepadded = long(ceil(filesize / 4.0)) * 4;
+    vkBeginCommandBuffer  (cmdBuff, &beginInfo);
+    vkCmdCopyImageToBuffer(cmdBuff, screen.swapChainImages[lastImageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+    vkEndCommandBuffer    (cmdBuff);
 
-    std::vector<uint32_t> resData(filesizepadded/4);
+    runCommandBuffer(cmdBuff, graphicsQueue, device);
+    vkFreeCommandBuffers(device, commandPool, 1, &cmdBuff);
 
-    // read file contents.
-    char *str = (char*)resData.data();
-    fread(str, filesize, sizeof(char), fp);
-    fclose(fp);
+    a_pPixels->resize(size_t(extent.width) * extent.height);
+    memcpy(a_pPixels->data(), readbackMemory.mapped, size_t(bufferSize));
 
-    // data padding.
-    for (int i = filesize; i < filesizepadded; i++)
-        str[i] = 0;
+    allocator.destroyBuffer(readbackBuffer, readbackMemory);
 
-    return resData;
+    (*a_pWidth)  = int(extent.width);
+    (*a_pHeight) = int(extent.height);
 }
 
 void application::runTimeError(const char* file, int line, const char* msg)
@@ -7,6 +7,30 @@
 #include <cmath>
 #include <iostream>
 
+#include "assetStreamer.hpp"
+#include "commandRecorder.hpp"
+#include "cpuOcean.hpp"
+#include "cpuWaterSolver.hpp"
+#include "descriptorCache.hpp"
+#include "deviceAllocator.hpp"
+#include "frameConstants.hpp"
+#include "framePacer.hpp"
+#include "floatingObjects.hpp"
+#include "gpuCuller.hpp"
+#include "gpuMesh.hpp"
+#include "oceanFft.hpp"
+#include "particleSystem.hpp"
+#include "pipelineCache.hpp"
+#include "profiler.hpp"
+#include "renderGraph.hpp"
+#include "renderPassBuilder.hpp"
+#include "resolutionController.hpp"
+#include "stagingRing.hpp"
+#include "vkUtils.hpp"
+#include "waterLod.hpp"
+#include "waterReflections.hpp"
+#include "waterSimulation.hpp"
+
 #define VK_VERSION_1_0 1
 #define RUN_TIME_ERROR(e) (runTimeError(__FILE__,__LINE__,(e)))
 #define VK_CHECK_RESULT(f)                                                              \
@@ -27,11 +51,174 @@ namespace app
 const int WIDTH  = 800;
 const int HEIGHT = 600;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+const int MAX_FRAMES_IN_FLIGHT = 4; // upper bound of appSettings::framesInFlight
+const uint32_t NO_STREAM = 0xFFFFFFFF;
 
 static const char* g_validationLayerData = "VK_LAYER_LUNARG_standard_validation";
 static const char* g_debugReportExtName  = VK_EXT_DEBUG_REPORT_EXTENSION_NAME;
 
+class appSettings
+{
+public:
+    bool     headless   = false;  // render into offscreen images, no window/surface/swapchain
+#ifdef QT_NO_DEBUG
+    bool     validation = false;  // enable VK_LAYER_LUNARG_standard_validation; release builds only on request
+#else
+    bool     validation = true;   // enable VK_LAYER_LUNARG_standard_validation
+#endif
+    int      width      = WIDTH;
+    int      height     = HEIGHT;
+    uint64_t deviceId   = 0;
+    int      frames     = 0;      // stop after this number of frames; 0 - until the window is closed
+    std::string profileOutput;    // per-frame timings dump on exit: *.json - Chrome trace, anything else - CSV
+    std::string pipelineCacheDir = "."; // where the VkPipelineCache file lives; empty - don't use a persistent cache
+    uint32_t gridSize   = 256;    // heightfield resolution, cells per side
+    bool     cpuSolver  = false;  // integrate the heightfield on the CPU and upload it every frame instead of the compute pass
+    unsigned solverThreads = 0;   // CPU solver threads, 0 - one per hardware thread
+    bool     validateSolver = false; // runBenchmark(): rerun the GPU simulation on the CPU and compare the heights
+    unsigned recordThreads = 0;   // command recording threads, 0 - one per hardware thread
+    uint32_t drawCalls  = 1;      // the grid is drawn as this many strips, to load the recording path
+    uint32_t stagingMB  = 4;      // per frame in flight staging ring part for dynamic uploads, grown to fit the CPU solver heights
+    int      resizeEvery = 0;     // runBenchmark(): toggle the targets between full and half size every N frames; 0 - never
+    bool     dynamicResolution = false; // scale the scene resolution so that the GPU frame time stays within targetFrameMs
+    float    targetFrameMs  = 16.0f;
+    float    minRenderScale = 0.5f;
+    float    maxRenderScale = 1.0f;   // below 1 the scene is rendered smaller and upscaled even without dynamicResolution
+    float    scaleUpThreshold   = 0.80f; // hysteresis band, fractions of targetFrameMs, see resolutionController
+    float    scaleDownThreshold = 1.00f;
+    uint32_t scaleSettleFrames  = 8;  // consecutive frames outside the band before the scale changes
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR; // falls back to FIFO, which is always supported
+    uint32_t framesInFlight = 2;      // frames the CPU may record ahead of the GPU, 1..MAX_FRAMES_IN_FLIGHT
+    double   maxFps         = 0.0;    // CPU side frame limiter, 0 - off
+    bool     asyncCompute   = true;   // simulate on a compute-only queue family when the device has one
+    meshFormat mesh;                  // layout of the water grid mesh, see gpuMesh
+    std::string heightmapFile;        // raw float32 gridSize x gridSize heights, streamed in the background and loaded into the water when ready
+    uint32_t streamStagingMB = 8;     // staging of the background streamer, split into assetStreamer::SLOT_COUNT chunks
+    bool     lod          = false;    // draw an oceanSize ocean with CDLOD patches around a moving camera instead of the single grid, see waterLod
+    float    oceanSize    = 8192.0f;  // world units per side
+    float    lodTileSize  = 256.0f;   // world units covered by the simulated heightfield, it repeats over the ocean
+    uint32_t lodLevels    = 8;
+    uint32_t lodPatchRes  = 32;       // quads per patch side, even
+    bool     gpuCulling   = false;    // --lod: frustum cull the patches in a compute pass and draw them indirectly, see gpuCuller
+    uint32_t objects      = 0;        // floating buoys, boats and debris drawn instanced on the water, see floatingObjects
+    bool     objectSweep  = false;    // runBenchmark(): measure again with the active object count doubling up to objects
+    bool     cullSweep    = false;    // runBenchmark(), --gpu-cull: measure again with lodLevels growing from 1, four times the candidates per level
+    uint32_t particles    = 0;        // spray particle capacity, emitted from breaking crests, simulated and sorted on the GPU, see particleSystem
+    bool     particleSort = true;     // sort back to front and blend "over"; off - additive blending, no sort passes
+    float    windSpeed     = 6.0f;    // m/s, drives the detail waves on top of the simulation, see frameUniforms
+    float    windDirection = 30.0f;   // degrees from water space x towards z
+    bool     fftOcean     = false;    // open ocean from a wave spectrum, evaluated with FFTs every frame instead of the simulation, see oceanFft
+    uint32_t fftSize      = 256;      // FFT size, power of two in [128, 1024]; also the heightfield resolution
+    uint32_t fftCascades  = 1;        // patches of decreasing size summed on top of each other, 1..4
+    oceanSpectrumType fftSpectrum = OCEAN_SPECTRUM_PHILLIPS;
+    bool     depthPrepass = false;    // draw the water depth only first, then shade it with an EQUAL depth test: one fragment per pixel
+    uint32_t msaa         = 1;        // samples per pixel, lowered to what the device supports; above 1 the scene is resolved into the output
+    reflectionQuality reflections = REFLECTIONS_MEDIUM; // screen-space reflections and refraction of the water, see waterReflections; 'R' cycles them
+    bool     adaptiveReflections = true; // move the march steps within the preset to keep the GPU frame within targetFrameMs
+};
+
+class sweepPoint
+{
+public:
+    uint32_t count     = 0;      // active objects, or cull candidates
+    double   frameMs   = 0.0;    // means over the point's frames
+    double   gpuMs     = -1.0;   // -1 - no timestamps
+    double   recordMs  = 0.0;
+    double   cpuMs     = 0.0;    // drawFrame() without the fence wait and the image acquire: the CPU work of a frame
+};
+
+class benchmarkResults
+{
+public:
+    std::vector<double> frameTimes;   // ms, wall time of each measured drawFrame() iteration
+    std::vector<double> submitTimes;  // ms, CPU time spent inside vkQueueSubmit
+    std::vector<double> gpuFrameTimes; // ms, from timestamp queries, only frames whose results were available
+    std::vector<double> recordTimes;  // ms, CPU time spent recording the frame command buffers
+    std::vector<double> recreateTimes; // ms, swapchain (or offscreen targets) recreation, measured frames only
+    std::vector<double> renderScales; // scene resolution relative to the output, every measured frame
+    std::vector<double> inputLatencies; // ms, glfwPollEvents() to vkQueuePresentKHR(), window mode only
+    std::string         presentMode;
+    bool                asyncCompute = false;   // the simulation ran on its own queue
+    uint32_t            computeFamily = 0;
+    std::vector<double> simulationTimes;        // ms, GPU_SCOPE_SIMULATION, frames whose results were available
+    uint32_t            streamFamily = 0;       // queue family of the background streaming copies
+    double              heightmapTime = -1.0;   // ms, request to loaded; -1 - no heightmap or not finished
+    meshIndexType       meshIndices   = MESH_INDEX_NONE; // as built, never MESH_INDEX_AUTO
+    VkDeviceSize        meshBytes     = 0;
+    double              meshAcmr      = 3.0;
+    uint32_t            meshTriangles = 0;
+    std::vector<double> vsInvocations;          // per frame, pipeline statistics, frames whose results were available
+    std::vector<double> fsInvocations;          // per frame, likewise
+    std::vector<double> overdraw;               // per frame, fragment shader invocations per scene pixel
+    std::string         depthFormat;
+    uint32_t            msaaSamples     = 1;
+    uint32_t            passAttachments = 0;      // of the scene render pass
+    uint32_t            transientAttachments = 0; // never loaded or stored, see renderPassBuilder::transient()
+    bool                lazyMemory      = false;  // the transient ones got lazily allocated memory
+    double              attachmentMB    = 0.0;    // per frame at the output size, renderPassBuilder::attachmentTraffic()
+    double              attachmentNaiveMB = 0.0;  // likewise if every attachment was loaded and stored
+    uint32_t            graphPasses     = 0;      // render graph passes of the last measured frame
+    uint32_t            graphCulledPasses = 0;
+    uint32_t            graphBufferBarriers = 0;  // likewise, in graphBarriers calls
+    uint32_t            graphImageBarriers  = 0;
+    std::vector<double> graphBarriers;            // per measured frame, vkCmdPipelineBarrier calls of the render graph
+    std::vector<double> transientMB;              // per measured frame, memory behind the graph's transient resources
+    double              transientUnaliasedMB = 0.0; // last measured frame, if no two transient resources shared memory
+    double              peakBlockMB     = 0.0;    // measured frames, the most device memory the allocator held
+    double              peakUsedMB      = 0.0;    // likewise, the most handed out of it
+    std::vector<double> lodPatches;             // per measured frame, --lod only; with --gpu-cull every node and its triangles
+    std::vector<double> lodTriangles;
+    std::string         lodDraws;                 // how the patches were drawn: "direct", or the gpuCuller path
+    uint32_t            objects         = 0;      // floating objects drawn in the measured frames
+    uint32_t            objectDraws     = 0;      // draw calls for them
+    uint64_t            objectTriangles = 0;
+    std::vector<sweepPoint> objectSweep;          // settings.objectSweep only
+    std::vector<sweepPoint> cullSweep;            // settings.cullSweep only
+    uint32_t            particles       = 0;      // particle capacity, 0 - no particles
+    bool                particlesSorted = false;
+    uint32_t            particleSortDispatches = 0; // recorded per frame, the indirect ones find nothing to do beyond the live count
+    uint32_t            particlesAlive  = 0;      // after the last measured frame
+    std::vector<double> particleTimes;            // ms, GPU_SCOPE_PARTICLES, frames whose results were available
+    std::string         oceanPath;                // FFT ocean: "gpu", or "cpu" with the CPU solver; empty - simulation
+    uint32_t            oceanSize       = 0;
+    uint32_t            oceanCascades   = 0;
+    uint32_t            oceanDispatches = 0;      // per frame, GPU path only
+    std::vector<double> oceanSpectrumTimes;       // ms per stage: the GPU_SCOPE_OCEAN_* scopes, or the cpuOcean stages
+    std::vector<double> oceanFftTimes;
+    std::vector<double> oceanResolveTimes;
+    std::string         reflections;              // quality preset at the end, "off" - the single scene pass
+    std::vector<double> reflectionTimes;          // ms, GPU_SCOPE_REFLECTIONS, frames whose results were available
+    std::vector<double> reflectionSteps;          // per measured frame, the march length used
+    double              totalTime = 0.0; // ms, from the first measured frame to the GPU going idle
+    double              uploadBytes = 0.0; // through the staging ring, all measured frames
+    std::string         deviceName;
+    double              startupTime        = 0.0;   // ms, initVulkan() + createResources()
+    double              pipelineCreateTime = 0.0;   // ms, all vkCreate*Pipelines calls
+    bool                pipelineCacheWarm  = false;
+    allocatorStats      memoryStats;                // device memory after startup
+    uint32_t            setLayouts       = 0;       // distinct descriptor set layouts, after all subsystems asked for theirs
+    uint32_t            setLayoutRequests = 0;
+    uint32_t            frameSets        = 0;       // descriptor sets allocated by the last frame
+    uint32_t            descriptorPools  = 0;       // per-frame pools, all frames in flight, at the end
+    VkDeviceSize        frameUniformStride = 0;     // bytes between the frameUniforms parts of two frames in flight
+
+    double              solverMaxError = -1.0;  // max |gpu - cpu| height after the run, validateSolver only; the last frame's ocean with fftOcean
+    uint64_t            solverSteps    = 0;
+
+    std::vector<uint32_t> lastFrame;      // BGRA8 pixels of the last rendered frame, headless mode only
+    int                   lastFrameWidth  = 0;
+    int                   lastFrameHeight = 0;
+};
+
+// the render pass a draw list goes into: the whole scene, or one of the two passes the water reflections split it in
+//
+enum scenePart
+{
+    SCENE_WHOLE = 0,
+    SCENE_OPAQUE,      // the floating objects, copied for the water to reflect
+    SCENE_WATER,       // the water and the spray over them
+};
+
 class swapChainSupportDetails
 {
 public:
@@ -43,26 +230,109 @@ public:
 class application
 {
 public:
+    application(const appSettings& a_settings = appSettings()) : settings(a_settings) {}
+
     void run();
+    void runBenchmark(int a_warmupFrames, int a_frames, bool a_readbackLastFrame, benchmarkResults* a_pResults);
+
+    // resizes the window, or the offscreen targets in headless mode; applied by the next drawFrame()
+    //
+    void requestResize(int a_width, int a_height);
+
+    // from the next frame on; REFLECTIONS_OFF draws the scene in one pass again. Nothing to switch if the
+    // reflections were off or unsupported at startup, their passes and pipelines don't exist then
+    //
+    void setReflectionQuality(reflectionQuality a_quality);
 
 private:
-    GLFWwindow*                     windowApp;
+    appSettings                     settings;
+    GLFWwindow*                     windowApp = nullptr;
     VkInstance                      instance;
     vector<const char*>             enabledLayers;
     VkDebugUtilsMessengerEXT        debugMessenger;
-    VkSurfaceKHR                    surface;
+    VkSurfaceKHR                    surface = VK_NULL_HANDLE;
     VkPhysicalDevice                physicalDevice = VK_NULL_HANDLE;
     VkDevice                        device;
     VkQueue                         graphicsQueue;
     VkQueue                         presentQueue;
+    VkQueue                         computeQueue;                 // == graphicsQueue without async compute
+    uint32_t                        m_graphicsFamily = 0;
+    uint32_t                        m_computeFamily  = 0;
+    bool                            m_computeTimestamps = true;  // the compute family can write timestamps
+    VkCommandPool                   m_computePool = VK_NULL_HANDLE;  // async compute only
+    std::vector<VkCommandBuffer>    m_computeCmds;                // one per frame in flight
+    uint32_t                        m_recordSlot = 0;             // frame in flight slot of the command buffers being recorded
+    VkQueue                         streamQueue;                  // == graphicsQueue without a transfer-only family
+    uint32_t                        m_transferFamily = 0;
+    assetStreamer                   streamer;
+    uint32_t                        m_heightmapStream = NO_STREAM; // streamer id of settings.heightmapFile until it was loaded
+    bool                            m_loadHeightmap = false;       // the frame being recorded copies the streamed heightmap into the water
+    double                          m_heightmapTime = -1.0;        // ms, request to loaded
     VkCommandPool                   commandPool;
     VkRenderPass                    renderPass;
     VkPipelineLayout                pipelineLayout;
     VkPipeline                      graphicsPipeline;
-    VkBuffer                        m_vbo;     //
-    VkDeviceMemory                  m_vboMem;  // we will store our vertices data here
-    std::vector<VkCommandBuffer>    commandBuffers;
+    VkPipeline                      m_depthPipeline = VK_NULL_HANDLE;  // settings.depthPrepass: the water without fragment shader
+    VkFormat                        m_depthFormat   = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits           m_samples       = VK_SAMPLE_COUNT_1_BIT;   // settings.msaa as supported
+    renderPassBuilder               m_passDesc;     // renderPass as described: attachment 0 - output, 1 - depth, 2 - multisampled color
+    VkRenderPass                    m_opaquePass = VK_NULL_HANDLE;   // m_reflections only: the scene split in two, compatible with renderPass
+    VkRenderPass                    m_waterPass  = VK_NULL_HANDLE;
+    renderPassBuilder               m_opaqueDesc;
+    renderPassBuilder               m_waterDesc;
+    deviceAllocator                 allocator;
+    descriptorLayoutCache           layoutCache;    // every descriptor set layout of the application
+    frameDescriptorPools            framePools;     // sets allocated while recording a frame, reset with its slot
+    VkDescriptorSetLayout           m_frameSetLayout = VK_NULL_HANDLE;  // binding 0: heights, binding 1: frameUniforms (dynamic)
+    VkDescriptorSet                 m_frameSet = VK_NULL_HANDLE;  // of the frame being recorded: the heights it draws and constants
+    frameConstants                  constants;      // frameUniforms, a part per frame in flight
+    gpuMesh                         waterMesh;   // grid coordinates, heights come from the simulation; the CDLOD patch with settings.lod
+    waterLod                        oceanLod;       // settings.lod only
+    lodCamera                       m_lodCamera;
+    uint32_t                        m_lodFrame = 0;  // drives the camera path
+    VkBuffer                        m_lodInstances = VK_NULL_HANDLE; // lodPatch per selected patch, uploaded every frame; every node with m_gpuCulling
+    deviceAllocation                m_lodInstanceMem;
+    uint32_t                        m_lodNodes = 0;  // in m_lodInstances, m_gpuCulling only
+    gpuCuller                       culler;         // settings.gpuCulling, when the device allows it
+    floatingObjects                 floating;       // settings.objects > 0
+    particleSystem                  particles;      // settings.particles > 0
+    waterReflections                reflections;    // m_reflections only
+    VkPipeline                      m_reflectPipeline = VK_NULL_HANDLE;  // the water with fragReflect.spv, in m_waterPass
+    VkDescriptorSet                 m_reflectionSet   = VK_NULL_HANDLE;  // set 1 of the frame being recorded
+    bool                            m_reflections = false;   // settings.reflections as supported: the split passes exist
+    bool                            m_reflecting  = false;   // the frame being recorded uses them
+    uint64_t                        m_lastReflectionFrame = 0;   // profiler frame last fed to reflections.update()
+    bool                            m_gpuCulling  = false;
+    bool                            m_multiDraw   = false;  // multiDrawIndirect enabled
+    bool                            m_drawIndirectCount = false;  // VK_KHR_draw_indirect_count enabled
+    waterSimulation                 water;
+    cpuWaterSolver                  cpuWater;       // settings.cpuSolver only
+    oceanFft                        ocean;          // settings.fftOcean only; with the CPU solver only its output buffers are used
+    cpuOcean                        cpuWaves;       // settings.fftOcean with settings.cpuSolver
+    float                           m_oceanTime = 0.0f;  // seconds, the ocean of the frame being recorded
+    stagingRing                     uploadRing;     // per-frame dynamic uploads
+    commandRecorder                 recorder;
+    std::vector<VkCommandBuffer>    m_secondaries;   // of the frame being recorded
+    renderGraph                     m_graph;         // the passes of the frame being recorded, declared anew every frame
+    frameProfiler                   profiler;
+    framePacer                      pacer;
+    VkPresentModeKHR                m_presentMode = VK_PRESENT_MODE_FIFO_KHR; // of the current swapchain
+    pipelineCacheFile               pipelineCacheStore;
+    VkPipelineCache                 pipelineCache = VK_NULL_HANDLE;
+    double                          startupTime        = 0.0; // ms
+    double                          pipelineCreateTime = 0.0; // ms
     size_t                          currentFrame = 0;
+    uint64_t                        m_submittedFrames = 0;
+    bool                            m_framebufferResized = false;
+    VkExtent2D                      m_pendingExtent = { 0, 0 };   // headless requestResize(), 0 - none
+    std::vector<double>             m_recreateTimes;              // ms
+    resolutionController            resolution;
+    bool                            m_scaledRendering = false;   // the scene goes to screen.sceneImage and is blitted to the output
+    VkFilter                        m_upscaleFilter   = VK_FILTER_LINEAR;
+    VkExtent2D                      m_renderExtent    = { 0, 0 }; // of the frame being recorded
+    uint64_t                        m_lastControlledFrame = 0;    // profiler frame last fed to the resolution controller
+    uint32_t                        lastImageIndex = 0;
+    double                          lastSubmitTime = 0.0; // ms
 
     struct screenBufferResources
     {
@@ -72,10 +342,40 @@ private:
         VkExtent2D                 swapChainExtent;
         std::vector<VkImageView>   swapChainImageViews;
         std::vector<VkFramebuffer> swapChainFramebuffers;
+        std::vector<deviceAllocation> offscreenImagesMemory; // headless mode only, swapChainImages are owned by us
+
+        // scaled rendering only: sized as the output, the scene uses its top left m_renderExtent part
+        //
+        VkImage                    sceneImage       = VK_NULL_HANDLE;
+        deviceAllocation           sceneMemory;
+        VkImageView                sceneView        = VK_NULL_HANDLE;
+        VkFramebuffer              sceneFramebuffer = VK_NULL_HANDLE;
+
+        // shared by all framebuffers like the scene target, the render pass orders the frames' depth accesses
+        //
+        VkImage                    depthImage       = VK_NULL_HANDLE;
+        deviceAllocation           depthMemory;
+        VkImageView                depthView        = VK_NULL_HANDLE;
+
+        // m_samples above 1 only: rendered to and resolved into the output within the pass, transient like the depth
+        //
+        VkImage                    msaaImage        = VK_NULL_HANDLE;
+        deviceAllocation           msaaMemory;
+        VkImageView                msaaView         = VK_NULL_HANDLE;
     };
 
     screenBufferResources screen;
 
+    // replaced screen resources stay alive until the frames that still reference them have retired
+    //
+    struct retiredScreen
+    {
+        screenBufferResources resources;
+        uint64_t              lastFrame;   // m_submittedFrames at retirement, frames below it may use the resources
+    };
+
+    std::vector<retiredScreen> m_retiredScreens;
+
     swapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR a_surface);
 
     const std::vector<const char*>  deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -85,6 +385,7 @@ private:
       std::vector<VkSemaphore> imageAvailableSemaphores;
       std::vector<VkSemaphore> renderFinishedSemaphores;
       std::vector<VkFence>     inFlightFences;
+      std::vector<VkSemaphore> simulationFinishedSemaphores; // async compute only
     } m_sync;
 
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugReportCallbackFn(VkDebugReportFlagsEXT       flags,
@@ -111,6 +412,7 @@ private:
     void initWindow();
     void initVulkan();
     void createResources();
+    void startup();
     void mainLoop();
     void cleanup();
     VkInstance createInstance(bool                  a_enableValidationLayers,
@@ -122,53 +424,97 @@ private:
     void runTimeError(const char* file, int line, const char* msg);
     VkPhysicalDevice findPhysicalDevice(VkInstance a_instance, bool a_printInfo, int a_preferredDeviceId);
     uint32_t getQueueFamilyIndex(VkPhysicalDevice a_physicalDevice, VkQueueFlagBits a_bits);
-    VkDevice createLogicalDevice(uint32_t                       queueFamilyIndex,
+    uint32_t findDedicatedQueueFamily(VkPhysicalDevice a_physicalDevice, VkQueueFlags a_required, VkQueueFlags a_excluded, uint32_t a_fallback);
+    bool hasDeviceExtension(VkPhysicalDevice a_physicalDevice, const char* a_name);
+    VkDevice createLogicalDevice(const vector<uint32_t>&        a_queueFamilies,
                                  VkPhysicalDevice               physicalDevice,
                                  const vector<const char *>&    a_enabledLayers,
-                                 vector<const char *>           a_extentions);
+                                 vector<const char *>           a_extentions,
+                                 const VkPhysicalDeviceFeatures& a_features);
     void createCwapChain(VkPhysicalDevice          a_physDevice,
                          VkDevice                  a_device,
                          VkSurfaceKHR              a_surface,
                          int                       a_width,
                          int                       a_height,
+                         VkSwapchainKHR            a_oldSwapChain,
                          screenBufferResources*    a_buff);
+    void createOffscreenTargets(deviceAllocator*          a_pAllocator,
+                                VkDevice                  a_device,
+                                int                       a_width,
+                                int                       a_height,
+                                uint32_t                  a_imageCount,
+                                screenBufferResources*    a_buff);
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, VkPresentModeKHR a_preferred);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, int a_width, int a_height);
     void createScreenImageViews(VkDevice a_device, screenBufferResources* pScreen);
-    void createRenderPass(VkDevice a_device, VkFormat a_swapChainImageFormat, VkRenderPass* a_pRenderPass);
+    VkFormat chooseDepthFormat(VkPhysicalDevice a_physDevice);
+    VkSampleCountFlagBits chooseSampleCount(VkPhysicalDevice a_physDevice, uint32_t a_requested);
+    void createRenderPass(VkDevice a_device, VkFormat a_swapChainImageFormat, VkFormat a_depthFormat, VkSampleCountFlagBits a_samples,
+                          VkImageLayout a_finalLayout, scenePart a_part, renderPassBuilder* a_pDesc, VkRenderPass* a_pRenderPass);
+
     void createGraphicsPipeline(VkDevice             a_device,
-                                VkExtent2D           a_screenExtent,
+                                const gpuMesh&       a_mesh,
+                                bool                 a_lodPatches,
+                                VkPipelineCache      a_pipelineCache,
                                 VkRenderPass         a_renderPass,
+                                VkDescriptorSetLayout a_setLayout,
+                                VkDescriptorSetLayout a_reflectionSetLayout,
+                                VkSampleCountFlagBits a_samples,
                                 VkPipelineLayout*    a_pLayout,
-                                VkPipeline*          a_pPipiline);
+                                VkPipeline*          a_pPipiline,
+                                VkPipeline*          a_pDepthPipeline,
+                                VkPipeline*          a_pReflectPipeline);
+    void createPassAttachments(deviceAllocator* a_pAllocator, VkDevice a_device, screenBufferResources* pScreen);
+    bool transientAttachment(uint32_t a_attachment) const;
     void createScreenFrameBuffers(VkDevice a_device, VkRenderPass a_renderPass, screenBufferResources* pScreen);
-    void createVertexBuffer(VkDevice         a_device,
-                            VkPhysicalDevice a_physDevice,
-                            const size_t     a_bufferSize,
-                            VkBuffer         *a_pBuffer,
-                            VkDeviceMemory   *a_pBufferMemory);
-    void createAndWriteCommandBuffers(VkDevice                       a_device,
-                                             VkCommandPool                  a_cmdPool,
-                                             std::vector<VkFramebuffer>     a_swapChainFramebuffers,
-                                             VkExtent2D                     a_frameBufferExtent,
-                                             VkRenderPass                   a_renderPass,
-                                             VkPipeline                     a_graphicsPipeline,
-                                             VkBuffer                       a_vPosBuffer,
-                                             std::vector<VkCommandBuffer>*  a_cmdBuffers);
+    void createSceneTarget(deviceAllocator* a_pAllocator, VkDevice a_device, VkRenderPass a_renderPass, screenBufferResources* pScreen);
+    VkImageLayout sceneFinalLayout(void) const;
+    void destroyScreenResources(VkDevice a_device, deviceAllocator* a_pAllocator, screenBufferResources* pScreen);
+    void recreateScreen(void);
+    void releaseRetiredScreens(bool a_all);
+    static void framebufferResizeCallback(GLFWwindow* a_window, int a_width, int a_height);
+    static void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action, int a_mods);
+    void createWaterMesh(void);
+    void createFloatingObjects(void);
+    void createParticles(void);
+    void waterSpace(float a_toClip[16], float* a_pCellsPerUnit, float* a_pHeightToWorld, float* a_pWrap) const;
+    float metresPerUnit(void) const { return settings.lod ? 1.0f : 20.0f; }   // of water space: the ocean is in metres, the grid a 20 m pond
+    oceanSettings oceanConfig(void) const;
+    void writeFrameConstants(uint32_t a_slot);
+    void updateLod(void);
+    void uploadLodNodes(void);
+    sweepPoint measureSweepPoint(uint32_t a_count, int a_frames);
+    void recordFrame(VkCommandBuffer a_cmdBuff, uint32_t a_imageIndex, uint32_t a_slot);
+    void recordRenderPass(VkCommandBuffer a_cmdBuff, uint32_t a_imageIndex, uint32_t a_slot, scenePart a_part);
+    void recordDraws(VkCommandBuffer a_cmdBuff, uint32_t a_firstDraw, uint32_t a_drawCount, bool a_depthOnly, scenePart a_part);
+    void recordReflectionInputs(VkCommandBuffer a_cmdBuff, uint32_t a_slot, uint32_t a_scene, uint32_t a_copy, uint32_t a_hiz);
+    void recordSimulation(VkCommandBuffer a_cmdBuff, uint32_t a_slot);
+    void cmdUpscale(VkCommandBuffer a_cmdBuff, uint32_t a_imageIndex);
+    void updateRenderScale(void);
+    void updateReflectionSteps(void);
     void createSyncObjects(VkDevice a_device, syncObj* a_pSyncObjs);
-    void putTriangleVerticesToVBO_Now(VkDevice       a_device,
-                                             VkCommandPool  a_pool,
-                                             VkQueue        a_queue,
-                                             float*         a_triPos,
-                                             int            a_floatsNum,
-                                             VkBuffer       a_buffer);
+    void putDataToBuffer_Now(VkDevice         a_device,
+                             deviceAllocator* a_pAllocator,
+                             VkCommandPool    a_pool,
+                             VkQueue          a_queue,
+                             const void*      a_data,
+                             size_t           a_size,
+                             VkBuffer         a_buffer);
+    void readbackBuffer_Now(VkDevice         a_device,
+                            deviceAllocator* a_pAllocator,
+                            VkCommandPool    a_pool,
+                            VkQueue          a_queue,
+                            VkBuffer         a_buffer,
+                            size_t           a_size,
+                            void*            a_data);
+    void uploadCpuHeights(void);
+    void uploadCpuOcean(void);
     void runCommandBuffer(VkCommandBuffer a_cmdBuff, VkQueue a_queue, VkDevice a_device);
+    void pollInput(void);
     void drawFrame(void);
-    uint32_t findMemoryType(uint32_t memoryTypeBits, VkMemoryPropertyFlags properties, VkPhysicalDevice physicalDevice);
+    void readbackFrame(std::vector<uint32_t>* a_pPixels, int* a_pWidth, int* a_pHeight);
     VkPhysicalDevice findPhysicalDevice(VkInstance a_instance, bool a_printInfo, uint64_t a_preferredDeviceId);
-    VkShaderModule createShaderModule(VkDevice a_device, const std::vector<uint32_t>& code);
-    std::vector<uint32_t> readFile(const char* filename);
 };
 }
 #endif // WATERAPP_HPP
@@ -0,0 +1,189 @@
+#include "createApp.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace app;
+
+static uint64_t hashBindings(const std::vector<VkDescriptorSetLayoutBinding>& a_bindings)
+{
+    // FNV-1a over the fields that make two layouts different
+    //
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint32_t a_value) { hash = (hash ^ a_value) * 1099511628211ull; };
+    for (const VkDescriptorSetLayoutBinding& binding : a_bindings)
+    {
+        mix(binding.binding);
+        mix(uint32_t(binding.descriptorType));
+        mix(binding.descriptorCount);
+        mix(binding.stageFlags);
+    }
+    return hash;
+}
+
+static bool sameBindings(const std::vector<VkDescriptorSetLayoutBinding>& a, const std::vector<VkDescriptorSetLayoutBinding>& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].binding != b[i].binding || a[i].descriptorType != b[i].descriptorType ||
+            a[i].descriptorCount != b[i].descriptorCount || a[i].stageFlags != b[i].stageFlags)
+            return false;
+    }
+    return true;
+}
+
+void descriptorLayoutCache::destroy()
+{
+    for (auto& bucket : m_layouts)
+        for (const entry& e : bucket.second)
+            vkDestroyDescriptorSetLayout(m_device, e.layout, NULL);
+
+    m_layouts.clear();
+    m_layoutCount = 0;
+}
+
+VkDescriptorSetLayout descriptorLayoutCache::get(std::vector<VkDescriptorSetLayoutBinding> a_bindings)
+{
+    for (const VkDescriptorSetLayoutBinding& binding : a_bindings)
+    {
+        if (binding.pImmutableSamplers != NULL)
+            throw std::runtime_error("[descriptorLayoutCache::get]: immutable samplers are not supported!");
+    }
+
+    std::sort(a_bindings.begin(), a_bindings.end(),
+              [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+    m_requests++;
+    std::vector<entry>& bucket = m_layouts[hashBindings(a_bindings)];
+    for (const entry& e : bucket)
+    {
+        if (sameBindings(e.bindings, a_bindings))
+            return e.layout;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = uint32_t(a_bindings.size());
+    layoutInfo.pBindings    = a_bindings.data();
+
+    entry e;
+    e.bindings = a_bindings;
+    VK_CHECK_RESULT(vkCreateDescriptorSetLayout(m_device, &layoutInfo, NULL, &e.layout));
+    bucket.push_back(e);
+    m_layoutCount++;
+
+    return e.layout;
+}
+
+VkDescriptorSetLayout descriptorLayoutCache::get(VkDescriptorType a_type, uint32_t a_count, VkShaderStageFlags a_stages)
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings(a_count);
+    for (uint32_t i = 0; i < a_count; i++)
+    {
+        bindings[i]                 = VkDescriptorSetLayoutBinding();
+        bindings[i].binding         = i;
+        bindings[i].descriptorType  = a_type;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags      = a_stages;
+    }
+    return get(bindings);
+}
+
+void frameDescriptorPools::init(VkDevice a_device, uint32_t a_frameCount)
+{
+    m_device = a_device;
+    m_frames.resize(a_frameCount);
+    for (framePools& frame : m_frames)
+        frame.pools.push_back(createPool());
+}
+
+void frameDescriptorPools::destroy()
+{
+    for (framePools& frame : m_frames)
+        for (VkDescriptorPool pool : frame.pools)
+            vkDestroyDescriptorPool(m_device, pool, NULL);
+    m_frames.clear();
+}
+
+VkDescriptorPool frameDescriptorPools::createPool()
+{
+    // room for SETS_PER_POOL sets of a few descriptors each, of the types the application uses
+    //
+    VkDescriptorPoolSize poolSizes[5] = {};
+    poolSizes[0].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = SETS_PER_POOL * 4;
+    poolSizes[1].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[1].descriptorCount = SETS_PER_POOL;
+    poolSizes[2].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[2].descriptorCount = SETS_PER_POOL;
+    poolSizes[3].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[3].descriptorCount = SETS_PER_POOL;
+    poolSizes[4].type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[4].descriptorCount = SETS_PER_POOL * 2;
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets       = SETS_PER_POOL;
+    poolInfo.poolSizeCount = 5;
+    poolInfo.pPoolSizes    = poolSizes;
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VK_CHECK_RESULT(vkCreateDescriptorPool(m_device, &poolInfo, NULL, &pool));
+    return pool;
+}
+
+void frameDescriptorPools::beginFrame(uint32_t a_frame)
+{
+    m_frame     = a_frame;
+    m_frameSets = 0;
+    m_used      = false;
+
+    framePools& frame = m_frames[a_frame];
+    for (uint32_t i = 0; i <= frame.current && i < frame.pools.size(); i++)
+        vkResetDescriptorPool(m_device, frame.pools[i], 0);
+    frame.current = 0;
+}
+
+VkDescriptorSet frameDescriptorPools::allocate(VkDescriptorSetLayout a_layout)
+{
+    framePools& frame = m_frames[m_frame];
+
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &a_layout;
+
+    // Without VK_KHR_maintenance1 a full pool may report any allocation error, so every failure moves on to the
+    // next pool; only a failure in a pool that was empty is real.
+    //
+    for (;;)
+    {
+        allocInfo.descriptorPool = frame.pools[frame.current];
+
+        VkDescriptorSet set    = VK_NULL_HANDLE;
+        VkResult        result = vkAllocateDescriptorSets(m_device, &allocInfo, &set);
+        if (result == VK_SUCCESS)
+        {
+            m_used = true;
+            m_frameSets++;
+            return set;
+        }
+        if (!m_used)
+            throw std::runtime_error("[frameDescriptorPools::allocate]: failed to allocate descriptor set!");
+
+        frame.current++;
+        if (frame.current == frame.pools.size())
+            frame.pools.push_back(createPool());
+        m_used = false;
+    }
+}
+
+uint32_t frameDescriptorPools::poolCount() const
+{
+    uint32_t count = 0;
+    for (const framePools& frame : m_frames)
+        count += uint32_t(frame.pools.size());
+    return count;
+}
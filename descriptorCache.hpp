@@ -0,0 +1,83 @@
+#ifndef WATERAPP_DESCRIPTORCACHE_HPP
+#define WATERAPP_DESCRIPTORCACHE_HPP
+#include <vulkan/vulkan.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace app
+{
+
+// Owns every VkDescriptorSetLayout of the application. Subsystems describe their bindings and get back the one
+// layout for that description, so equal interfaces share a layout (and sets become compatible between their
+// pipelines). Lookups hash the sorted bindings; layouts live until destroy().
+//
+class descriptorLayoutCache
+{
+public:
+    void init(VkDevice a_device) { m_device = a_device; }
+    void destroy();
+
+    VkDescriptorSetLayout get(std::vector<VkDescriptorSetLayoutBinding> a_bindings);
+
+    // a_count bindings 0..a_count-1 of the same type and stages, the common case
+    //
+    VkDescriptorSetLayout get(VkDescriptorType a_type, uint32_t a_count, VkShaderStageFlags a_stages);
+
+    uint32_t layoutCount() const  { return m_layoutCount; }
+    uint32_t requestCount() const { return m_requests; }
+
+private:
+    struct entry
+    {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        VkDescriptorSetLayout                     layout;
+    };
+
+    VkDevice                                             m_device = VK_NULL_HANDLE;
+    std::unordered_map<uint64_t, std::vector<entry> >    m_layouts;   // hash -> layouts with that hash
+    uint32_t                                             m_layoutCount = 0;
+    uint32_t                                             m_requests    = 0;
+};
+
+// Descriptor sets that live for one frame. Every frame in flight has its own pools; beginFrame() resets them
+// with vkResetDescriptorPool, which returns all their sets at once, so sets are never freed one by one and
+// allocating is a pointer bump in the driver. A frame that needs more sets than its pools hold gets another
+// pool, which is kept for the following frames.
+//
+class frameDescriptorPools
+{
+public:
+    static const uint32_t SETS_PER_POOL = 64;
+
+    void init(VkDevice a_device, uint32_t a_frameCount);
+    void destroy();
+
+    // a_frame must not be in flight any more: call after its fence was waited
+    //
+    void beginFrame(uint32_t a_frame);
+
+    // From the pools of the current frame; valid until the frame's pools are reset again.
+    //
+    VkDescriptorSet allocate(VkDescriptorSetLayout a_layout);
+
+    uint32_t frameSets() const { return m_frameSets; }   // allocated in the current frame
+    uint32_t poolCount() const;
+
+private:
+    VkDescriptorPool createPool();
+
+    struct framePools
+    {
+        std::vector<VkDescriptorPool> pools;
+        uint32_t                      current = 0;   // pools before this one are full
+    };
+
+    VkDevice                m_device = VK_NULL_HANDLE;
+    std::vector<framePools> m_frames;
+    uint32_t                m_frame     = 0;
+    uint32_t                m_frameSets = 0;
+    bool                    m_used      = false;   // the current pool already holds sets of this frame
+};
+
+}
+#endif // WATERAPP_DESCRIPTORCACHE_HPP
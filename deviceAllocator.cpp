@@ -0,0 +1,461 @@
+#include "createApp.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace app;
+
+namespace app
+{
+
+struct tlsfNode
+{
+    VkDeviceSize offset   = 0;
+    VkDeviceSize size     = 0;
+    bool         free     = true;
+    tlsfNode*    prevPhys = nullptr;   // neighbours in address order
+    tlsfNode*    nextPhys = nullptr;   //
+    tlsfNode*    prevFree = nullptr;   // neighbours in the free list of the node size class
+    tlsfNode*    nextFree = nullptr;   //
+};
+
+// One VkDeviceMemory and its TLSF state. Size classes: the first level is the highest set bit of the size,
+// the second level splits every power of two range into SL_COUNT equal parts. A free range is always
+// coalesced with free neighbours, so two free nodes are never adjacent.
+//
+class memoryBlock
+{
+public:
+    static const int          SL_LOG2    = 4;
+    static const int          SL_COUNT   = 1 << SL_LOG2;
+    static const int          FL_COUNT   = 64 - SL_LOG2 + 1;
+    static const VkDeviceSize SMALL_SIZE = VkDeviceSize(1) << SL_LOG2;
+    static const VkDeviceSize MIN_SPLIT  = 256;  // smaller tails stay with the allocation
+
+    VkDeviceMemory                  memory     = VK_NULL_HANDLE;
+    VkDeviceSize                    size       = 0;
+    uint32_t                        memoryType = 0;
+    deviceAllocator::resourceKind   kind       = deviceAllocator::RESOURCE_LINEAR;
+    bool                            dedicated  = false;
+    void*                           mapped     = nullptr;
+    VkDeviceSize                    used       = 0;
+    uint32_t                        allocationCount = 0;
+
+    explicit memoryBlock(VkDeviceSize a_size) : size(a_size)
+    {
+        for (int i = 0; i < FL_COUNT; i++)
+        {
+            m_slBitmap[i] = 0;
+            for (int j = 0; j < SL_COUNT; j++) m_freeLists[i][j] = nullptr;
+        }
+        m_first       = new tlsfNode();
+        m_first->size = a_size;
+        insertFree(m_first);
+    }
+
+    ~memoryBlock()
+    {
+        for (tlsfNode* node = m_first; node != nullptr; )
+        {
+            tlsfNode* next = node->nextPhys;
+            delete node;
+            node = next;
+        }
+    }
+
+    tlsfNode* allocate(VkDeviceSize a_size, VkDeviceSize a_alignment)
+    {
+        // search for a range that fits even in the worst alignment case, the padding goes back to the free lists
+        //
+        VkDeviceSize search = a_size + (a_alignment > 1 ? a_alignment - 1 : 0);
+        tlsfNode*    node   = findSuitable(search);
+        if (node == nullptr)
+            return nullptr;
+        removeFree(node);
+
+        const VkDeviceSize aligned = (node->offset + a_alignment - 1) & ~(a_alignment - 1);
+        if (aligned > node->offset)
+        {
+            tlsfNode* head = new tlsfNode();
+            head->offset   = node->offset;
+            head->size     = aligned - node->offset;
+            head->prevPhys = node->prevPhys;
+            head->nextPhys = node;
+            if (node->prevPhys) node->prevPhys->nextPhys = head; else m_first = head;
+            node->prevPhys = head;
+            node->offset   = aligned;
+            node->size    -= head->size;
+            insertFree(head);
+        }
+
+        if (node->size - a_size >= MIN_SPLIT)
+        {
+            tlsfNode* tail = new tlsfNode();
+            tail->offset   = node->offset + a_size;
+            tail->size     = node->size - a_size;
+            tail->prevPhys = node;
+            tail->nextPhys = node->nextPhys;
+            if (node->nextPhys) node->nextPhys->prevPhys = tail;
+            node->nextPhys = tail;
+            node->size     = a_size;
+            insertFree(tail);
+        }
+
+        node->free      = false;
+        used += node->size;
+        allocationCount++;
+        return node;
+    }
+
+    void free(tlsfNode* a_node)
+    {
+        used -= a_node->size;
+        allocationCount--;
+        a_node->free = true;
+
+        tlsfNode* prev = a_node->prevPhys;
+        if (prev != nullptr && prev->free)
+        {
+            removeFree(prev);
+            prev->size    += a_node->size;
+            prev->nextPhys = a_node->nextPhys;
+            if (a_node->nextPhys) a_node->nextPhys->prevPhys = prev;
+            delete a_node;
+            a_node = prev;
+        }
+
+        tlsfNode* next = a_node->nextPhys;
+        if (next != nullptr && next->free)
+        {
+            removeFree(next);
+            a_node->size    += next->size;
+            a_node->nextPhys = next->nextPhys;
+            if (next->nextPhys) next->nextPhys->prevPhys = a_node;
+            delete next;
+        }
+
+        insertFree(a_node);
+    }
+
+    VkDeviceSize largestFreeRange() const
+    {
+        VkDeviceSize largest = 0;
+        for (const tlsfNode* node = m_first; node != nullptr; node = node->nextPhys)
+            if (node->free) largest = std::max(largest, node->size);
+        return largest;
+    }
+
+private:
+    static int highestBit(VkDeviceSize a_value) { return 63 - __builtin_clzll(a_value); }
+
+    static void mapping(VkDeviceSize a_size, int* a_fl, int* a_sl)
+    {
+        if (a_size < SMALL_SIZE)
+        {
+            *a_fl = 0;
+            *a_sl = int(a_size);
+        }
+        else
+        {
+            const int fl = highestBit(a_size);
+            *a_sl = int((a_size >> (fl - SL_LOG2)) ^ SMALL_SIZE);
+            *a_fl = fl - SL_LOG2 + 1;
+        }
+    }
+
+    tlsfNode* findSuitable(VkDeviceSize a_size)
+    {
+        // round up to the next size class, so any node of the found list is large enough
+        //
+        if (a_size >= SMALL_SIZE)
+            a_size += (VkDeviceSize(1) << (highestBit(a_size) - SL_LOG2)) - 1;
+
+        int fl, sl;
+        mapping(a_size, &fl, &sl);
+        if (fl >= FL_COUNT)
+            return nullptr;
+
+        uint32_t slMap = m_slBitmap[fl] & (~0u << sl);
+        if (slMap == 0)
+        {
+            const uint64_t flMap = (fl + 1 < 64) ? (m_flBitmap & (~0ull << (fl + 1))) : 0;
+            if (flMap == 0)
+                return nullptr;
+            fl    = __builtin_ctzll(flMap);
+            slMap = m_slBitmap[fl];
+        }
+        sl = __builtin_ctz(slMap);
+        return m_freeLists[fl][sl];
+    }
+
+    void insertFree(tlsfNode* a_node)
+    {
+        int fl, sl;
+        mapping(a_node->size, &fl, &sl);
+        a_node->free     = true;
+        a_node->prevFree = nullptr;
+        a_node->nextFree = m_freeLists[fl][sl];
+        if (a_node->nextFree) a_node->nextFree->prevFree = a_node;
+        m_freeLists[fl][sl] = a_node;
+        m_flBitmap     |= (1ull << fl);
+        m_slBitmap[fl] |= (1u << sl);
+    }
+
+    void removeFree(tlsfNode* a_node)
+    {
+        int fl, sl;
+        mapping(a_node->size, &fl, &sl);
+        if (a_node->prevFree) a_node->prevFree->nextFree = a_node->nextFree;
+        else                  m_freeLists[fl][sl]        = a_node->nextFree;
+        if (a_node->nextFree) a_node->nextFree->prevFree = a_node->prevFree;
+        a_node->prevFree = a_node->nextFree = nullptr;
+
+        if (m_freeLists[fl][sl] == nullptr)
+        {
+            m_slBitmap[fl] &= ~(1u << sl);
+            if (m_slBitmap[fl] == 0)
+                m_flBitmap &= ~(1ull << fl);
+        }
+    }
+
+    uint64_t  m_flBitmap = 0;
+    uint32_t  m_slBitmap[FL_COUNT];
+    tlsfNode* m_freeLists[FL_COUNT][SL_COUNT];
+    tlsfNode* m_first = nullptr;
+};
+
+}
+
+deviceAllocator::deviceAllocator()  {}
+deviceAllocator::~deviceAllocator() { destroy(); }
+
+void deviceAllocator::init(VkPhysicalDevice a_physDevice, VkDevice a_device, VkDeviceSize a_blockSize)
+{
+    m_device    = a_device;
+    m_blockSize = a_blockSize;
+
+    // queried once; findMemoryType() is called for every allocation
+    //
+    vkGetPhysicalDeviceMemoryProperties(a_physDevice, &m_memoryProperties);
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(a_physDevice, &props);
+    m_maxAllocationCount = props.limits.maxMemoryAllocationCount;
+}
+
+void deviceAllocator::destroy()
+{
+    for (auto& block : m_blocks)
+        destroyBlock(block.get());
+    m_blocks.clear();
+}
+
+uint32_t deviceAllocator::findMemoryType(uint32_t a_memoryTypeBits, VkMemoryPropertyFlags a_properties) const
+{
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+    {
+        if ((a_memoryTypeBits & (1 << i)) && ((m_memoryProperties.memoryTypes[i].propertyFlags & a_properties) == a_properties))
+            return i;
+    }
+    throw std::runtime_error("[deviceAllocator::findMemoryType]: no suitable memory type!");
+}
+
+VkMemoryPropertyFlags deviceAllocator::propertyFlags(const deviceAllocation& a_allocation) const
+{
+    if (a_allocation.block == nullptr)
+        return 0;
+    return m_memoryProperties.memoryTypes[a_allocation.block->memoryType].propertyFlags;
+}
+
+memoryBlock* deviceAllocator::createBlock(uint32_t a_memoryType, resourceKind a_kind, VkDeviceSize a_size, bool a_dedicated)
+{
+    if (m_maxAllocationCount != 0 && m_blocks.size() >= m_maxAllocationCount)
+        throw std::runtime_error("[deviceAllocator::createBlock]: maxMemoryAllocationCount reached!");
+
+    VkMemoryAllocateInfo allocateInfo = {};
+    allocateInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.allocationSize  = a_size;
+    allocateInfo.memoryTypeIndex = a_memoryType;
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(m_device, &allocateInfo, NULL, &memory) != VK_SUCCESS)
+        throw std::runtime_error("[deviceAllocator::createBlock]: failed to allocate device memory!");
+
+    std::unique_ptr<memoryBlock> block(new memoryBlock(a_size));
+    block->memory     = memory;
+    block->memoryType = a_memoryType;
+    block->kind       = a_kind;
+    block->dedicated  = a_dedicated;
+
+    if (m_memoryProperties.memoryTypes[a_memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        VK_CHECK_RESULT(vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &block->mapped));
+
+    m_blocks.push_back(std::move(block));
+    return m_blocks.back().get();
+}
+
+void deviceAllocator::destroyBlock(memoryBlock* a_block)
+{
+    if (a_block->mapped != nullptr)
+        vkUnmapMemory(m_device, a_block->memory);
+    vkFreeMemory(m_device, a_block->memory, NULL);
+}
+
+deviceAllocation deviceAllocator::allocate(const VkMemoryRequirements& a_requirements, VkMemoryPropertyFlags a_properties, resourceKind a_kind)
+{
+    // lazily allocated memory is only a preference: desktop GPUs have none, plain device local memory does there
+    //
+    if (a_properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+    {
+        bool found = false;
+        for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount && !found; ++i)
+            found = (a_requirements.memoryTypeBits & (1 << i)) && ((m_memoryProperties.memoryTypes[i].propertyFlags & a_properties) == a_properties);
+        if (!found)
+            a_properties &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    }
+
+    // lazy memory is committed per allocation on tile based GPUs, so it never shares a block
+    //
+    const uint32_t memoryType = findMemoryType(a_requirements.memoryTypeBits, a_properties);
+    const bool     dedicated  = a_requirements.size > m_blockSize / 2 || (a_properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+    memoryBlock* block = nullptr;
+    tlsfNode*    node  = nullptr;
+
+    if (!dedicated)
+    {
+        for (auto& candidate : m_blocks)
+        {
+            if (candidate->dedicated || candidate->memoryType != memoryType || candidate->kind != a_kind)
+                continue;
+            node = candidate->allocate(a_requirements.size, a_requirements.alignment);
+            if (node != nullptr)
+            {
+                block = candidate.get();
+                break;
+            }
+        }
+    }
+
+    if (node == nullptr)
+    {
+        block = createBlock(memoryType, a_kind, dedicated ? a_requirements.size : m_blockSize, dedicated);
+        node  = block->allocate(a_requirements.size, a_requirements.alignment);
+    }
+
+    deviceAllocation allocation;
+    allocation.memory = block->memory;
+    allocation.offset = node->offset;
+    allocation.size   = node->size;
+    allocation.mapped = block->mapped ? (char*)block->mapped + node->offset : nullptr;
+    allocation.block  = block;
+    allocation.node   = node;
+    return allocation;
+}
+
+void deviceAllocator::free(const deviceAllocation& a_allocation)
+{
+    if (a_allocation.block == nullptr)
+        return;
+
+    memoryBlock* block = a_allocation.block;
+    block->free(a_allocation.node);
+
+    // dedicated memory is returned at once; regular blocks are kept for reuse until releaseEmptyBlocks()
+    //
+    if (block->dedicated)
+    {
+        destroyBlock(block);
+        m_blocks.erase(std::find_if(m_blocks.begin(), m_blocks.end(),
+                                    [block](const std::unique_ptr<memoryBlock>& b) { return b.get() == block; }));
+    }
+}
+
+void deviceAllocator::releaseEmptyBlocks()
+{
+    for (size_t i = 0; i < m_blocks.size(); )
+    {
+        if (m_blocks[i]->allocationCount == 0)
+        {
+            destroyBlock(m_blocks[i].get());
+            m_blocks.erase(m_blocks.begin() + i);
+        }
+        else
+            i++;
+    }
+}
+
+void deviceAllocator::createBuffer(VkDeviceSize a_size, VkBufferUsageFlags a_usage, VkMemoryPropertyFlags a_properties,
+                                   VkBuffer* a_pBuffer, deviceAllocation* a_pAllocation,
+                                   const std::vector<uint32_t>& a_sharedFamilies)
+{
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size        = a_size;
+    bufferCreateInfo.usage       = a_usage;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (a_sharedFamilies.size() > 1)
+    {
+        bufferCreateInfo.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+        bufferCreateInfo.queueFamilyIndexCount = uint32_t(a_sharedFamilies.size());
+        bufferCreateInfo.pQueueFamilyIndices   = a_sharedFamilies.data();
+    }
+
+    if (vkCreateBuffer(m_device, &bufferCreateInfo, NULL, a_pBuffer) != VK_SUCCESS)
+        throw std::runtime_error("[deviceAllocator::createBuffer]: failed to create buffer!");
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_device, (*a_pBuffer), &memoryRequirements);
+
+    (*a_pAllocation) = allocate(memoryRequirements, a_properties, RESOURCE_LINEAR);
+
+    if (vkBindBufferMemory(m_device, (*a_pBuffer), a_pAllocation->memory, a_pAllocation->offset) != VK_SUCCESS)
+        throw std::runtime_error("[deviceAllocator::createBuffer]: failed to bind buffer memory!");
+}
+
+void deviceAllocator::destroyBuffer(VkBuffer a_buffer, const deviceAllocation& a_allocation)
+{
+    vkDestroyBuffer(m_device, a_buffer, NULL);
+    free(a_allocation);
+}
+
+void deviceAllocator::createImage(const VkImageCreateInfo& a_createInfo, VkMemoryPropertyFlags a_properties,
+                                  VkImage* a_pImage, deviceAllocation* a_pAllocation)
+{
+    if (vkCreateImage(m_device, &a_createInfo, NULL, a_pImage) != VK_SUCCESS)
+        throw std::runtime_error("[deviceAllocator::createImage]: failed to create image!");
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(m_device, (*a_pImage), &memoryRequirements);
+
+    const resourceKind kind = (a_createInfo.tiling == VK_IMAGE_TILING_LINEAR) ? RESOURCE_LINEAR : RESOURCE_OPTIMAL;
+    (*a_pAllocation) = allocate(memoryRequirements, a_properties, kind);
+
+    if (vkBindImageMemory(m_device, (*a_pImage), a_pAllocation->memory, a_pAllocation->offset) != VK_SUCCESS)
+        throw std::runtime_error("[deviceAllocator::createImage]: failed to bind image memory!");
+}
+
+void deviceAllocator::destroyImage(VkImage a_image, const deviceAllocation& a_allocation)
+{
+    vkDestroyImage(m_device, a_image, NULL);
+    free(a_allocation);
+}
+
+allocatorStats deviceAllocator::stats() const
+{
+    allocatorStats result;
+    for (auto& block : m_blocks)
+    {
+        result.blockBytes      += block->size;
+        result.usedBytes       += block->used;
+        result.freeBytes       += block->size - block->used;
+        result.allocationCount += block->allocationCount;
+        result.blockCount++;
+        if (block->dedicated)
+            result.dedicatedCount++;
+        result.largestFreeRange = std::max(result.largestFreeRange, block->largestFreeRange());
+    }
+    if (result.freeBytes != 0)
+        result.fragmentation = 1.0 - double(result.largestFreeRange) / double(result.freeBytes);
+    return result;
+}
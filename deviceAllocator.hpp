@@ -0,0 +1,96 @@
+#ifndef WATERAPP_DEVICEALLOCATOR_HPP
+#define WATERAPP_DEVICEALLOCATOR_HPP
+#include <vulkan/vulkan.hpp>
+#include <memory>
+#include <vector>
+
+namespace app
+{
+
+class memoryBlock;
+struct tlsfNode;
+
+// A range of a VkDeviceMemory owned by deviceAllocator. Copyable handle; free it exactly once.
+//
+class deviceAllocation
+{
+public:
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize   offset = 0;
+    VkDeviceSize   size   = 0;
+    void*          mapped = nullptr;   // host visible memory types stay mapped for the lifetime of the block
+
+    memoryBlock*   block  = nullptr;   // allocator bookkeeping
+    tlsfNode*      node   = nullptr;   //
+};
+
+class allocatorStats
+{
+public:
+    VkDeviceSize blockBytes       = 0;  // all VkDeviceMemory owned by the allocator
+    VkDeviceSize usedBytes        = 0;  // handed out, including alignment padding
+    VkDeviceSize freeBytes        = 0;
+    VkDeviceSize largestFreeRange = 0;
+    uint32_t     blockCount       = 0;  // vkAllocateMemory calls currently alive, dedicated ones included
+    uint32_t     dedicatedCount   = 0;
+    uint32_t     allocationCount  = 0;
+    double       fragmentation    = 0.0; // 1 - largestFreeRange / freeBytes: 0 - all free space is one range
+};
+
+// Sub-allocates buffers and images out of large per-memory-type VkDeviceMemory blocks, so the application
+// stays far below maxMemoryAllocationCount and vkAllocateMemory is only called when a block is full.
+//
+// Every block is managed by a TLSF (two-level segregated fit) free list: O(1) allocation and free,
+// immediate coalescing of neighbouring free ranges. Buffers (linear resources) and images (optimal tiling)
+// never share a block, which satisfies bufferImageGranularity without padding every allocation to it.
+// Requests larger than half a block get a dedicated VkDeviceMemory.
+//
+class deviceAllocator
+{
+public:
+    static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+    enum resourceKind { RESOURCE_LINEAR = 0, RESOURCE_OPTIMAL, RESOURCE_KIND_COUNT };
+
+    deviceAllocator();
+    ~deviceAllocator();
+
+    void init(VkPhysicalDevice a_physDevice, VkDevice a_device, VkDeviceSize a_blockSize = DEFAULT_BLOCK_SIZE);
+    void destroy();   // frees all blocks; outstanding allocations become invalid
+
+    // VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT is dropped from a_properties when no memory type has it
+    //
+    deviceAllocation allocate(const VkMemoryRequirements& a_requirements, VkMemoryPropertyFlags a_properties, resourceKind a_kind);
+    void             free(const deviceAllocation& a_allocation);
+
+    // a_sharedFamilies: two or more queue families make the buffer VK_SHARING_MODE_CONCURRENT between them
+    //
+    void createBuffer(VkDeviceSize a_size, VkBufferUsageFlags a_usage, VkMemoryPropertyFlags a_properties,
+                      VkBuffer* a_pBuffer, deviceAllocation* a_pAllocation,
+                      const std::vector<uint32_t>& a_sharedFamilies = std::vector<uint32_t>());
+    void destroyBuffer(VkBuffer a_buffer, const deviceAllocation& a_allocation);
+    void createImage(const VkImageCreateInfo& a_createInfo, VkMemoryPropertyFlags a_properties,
+                     VkImage* a_pImage, deviceAllocation* a_pAllocation);
+    void destroyImage(VkImage a_image, const deviceAllocation& a_allocation);
+
+    void releaseEmptyBlocks();   // returns the blocks without allocations to the driver
+
+    uint32_t              findMemoryType(uint32_t a_memoryTypeBits, VkMemoryPropertyFlags a_properties) const;
+    VkMemoryPropertyFlags propertyFlags(const deviceAllocation& a_allocation) const;   // of the memory type it came from
+    allocatorStats        stats() const;
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties() const { return m_memoryProperties; }
+
+private:
+    memoryBlock* createBlock(uint32_t a_memoryType, resourceKind a_kind, VkDeviceSize a_size, bool a_dedicated);
+    void         destroyBlock(memoryBlock* a_block);
+
+    VkDevice                                  m_device     = VK_NULL_HANDLE;
+    VkDeviceSize                              m_blockSize  = DEFAULT_BLOCK_SIZE;
+    VkPhysicalDeviceMemoryProperties          m_memoryProperties;
+    uint32_t                                  m_maxAllocationCount = 0;
+    std::vector<std::unique_ptr<memoryBlock>> m_blocks;
+};
+
+}
+#endif // WATERAPP_DEVICEALLOCATOR_HPP
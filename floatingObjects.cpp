@@ -0,0 +1,372 @@
+#include "createApp.hpp"
+
+#include <cmath>
+#include <random>
+
+using namespace std;
+using namespace app;
+
+// flat shaded: every face gets its own vertices; the winding is made counter-clockwise seen from outside,
+// which works for the convex meshes below (a_center is inside)
+//
+static void addTriangle(meshSource* a_pMesh, const float* a, const float* b, const float* c, const float* a_center)
+{
+    const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+    const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (len == 0.0f)
+        return;
+
+    float outward = 0.0f;
+    for (int i = 0; i < 3; i++)
+        outward += n[i] * ((a[i] + b[i] + c[i]) / 3.0f - a_center[i]);
+
+    const float* corners[3] = { a, b, c };
+    if (outward < 0.0f)
+    {
+        std::swap(corners[1], corners[2]);
+        for (int i = 0; i < 3; i++) n[i] = -n[i];
+    }
+
+    for (int v = 0; v < 3; v++)
+    {
+        a_pMesh->indices.push_back(uint32_t(a_pMesh->positions.size() / 3));
+        for (int i = 0; i < 3; i++)
+        {
+            a_pMesh->positions.push_back(corners[v][i]);
+            a_pMesh->normals.push_back(n[i] / len);
+        }
+    }
+}
+
+// a_outline: a_count points (x, z) of a convex polygon, extruded from a_y0 to a_y1
+//
+static void addPrism(meshSource* a_pMesh, const float* a_outline, int a_count, float a_y0, float a_y1, const float* a_center)
+{
+    for (int i = 0; i < a_count; i++)
+    {
+        const int   j = (i + 1) % a_count;
+        const float p00[3] = { a_outline[i * 2], a_y0, a_outline[i * 2 + 1] };
+        const float p10[3] = { a_outline[j * 2], a_y0, a_outline[j * 2 + 1] };
+        const float p01[3] = { a_outline[i * 2], a_y1, a_outline[i * 2 + 1] };
+        const float p11[3] = { a_outline[j * 2], a_y1, a_outline[j * 2 + 1] };
+        addTriangle(a_pMesh, p00, p10, p11, a_center);
+        addTriangle(a_pMesh, p00, p11, p01, a_center);
+    }
+    for (int i = 1; i + 1 < a_count; i++)
+    {
+        for (float y : { a_y0, a_y1 })
+        {
+            const float p0[3] = { a_outline[0],         y, a_outline[1] };
+            const float p1[3] = { a_outline[i * 2],     y, a_outline[i * 2 + 1] };
+            const float p2[3] = { a_outline[i * 2 + 2], y, a_outline[i * 2 + 3] };
+            addTriangle(a_pMesh, p0, p1, p2, a_center);
+        }
+    }
+}
+
+// sides of a pyramid from the outline at a_y0 to an apex above its origin
+//
+static void addSpire(meshSource* a_pMesh, const float* a_outline, int a_count, float a_y0, float a_apexY, const float* a_center)
+{
+    const float apex[3] = { 0.0f, a_apexY, 0.0f };
+    for (int i = 0; i < a_count; i++)
+    {
+        const int   j = (i + 1) % a_count;
+        const float p0[3] = { a_outline[i * 2], a_y0, a_outline[i * 2 + 1] };
+        const float p1[3] = { a_outline[j * 2], a_y0, a_outline[j * 2 + 1] };
+        addTriangle(a_pMesh, p0, p1, apex, a_center);
+    }
+}
+
+void floatingObjects::buildMesh(floatingType a_type, meshSource* a_pMesh)
+{
+    *a_pMesh = meshSource();
+    a_pMesh->positionComponents = 3;
+
+    switch (a_type)
+    {
+    case FLOATING_DEBRIS:
+    {
+        const float center[3]  = { 0.0f, 0.0f, 0.0f };
+        const float outline[8] = { -0.5f, -0.3f,  0.5f, -0.3f,  0.5f, 0.3f,  -0.5f, 0.3f };
+        addPrism(a_pMesh, outline, 4, -0.2f, 0.2f, center);
+        break;
+    }
+    case FLOATING_BUOY:
+    {
+        const int   sides = 12;
+        const float center[3] = { 0.0f, 0.1f, 0.0f };
+        float outline[sides * 2];
+        for (int i = 0; i < sides; i++)
+        {
+            const float angle = 6.2831853f * float(i) / float(sides);
+            outline[i * 2 + 0] = 0.3f * std::cos(angle);
+            outline[i * 2 + 1] = 0.3f * std::sin(angle);
+        }
+        addPrism(a_pMesh, outline, sides, -0.4f, 0.2f, center);
+        addSpire(a_pMesh, outline, sides, 0.2f, 0.7f, center);
+        break;
+    }
+    case FLOATING_BOAT:
+    default:
+    {
+        const float center[3]   = { 0.0f, 0.0f, 0.0f };
+        const float outline[10] = { -0.5f, -0.2f,  0.25f, -0.2f,  0.5f, 0.0f,  0.25f, 0.2f,  -0.5f, 0.2f };  // bow towards +x
+        addPrism(a_pMesh, outline, 5, -0.15f, 0.15f, center);
+        break;
+    }
+    }
+}
+
+void floatingObjects::init(deviceAllocator* a_pAllocator, uint32_t a_count, const floatingArea& a_area, uint32_t a_seed)
+{
+    // the meshes are tiny, they are only cache ordered; the layout must be the same for all of them,
+    // since they share the pipeline
+    //
+    meshFormat format;
+    format.indexType = MESH_INDEX_16;
+
+    for (uint32_t t = 0; t < FLOATING_TYPE_COUNT; t++)
+    {
+        meshSource source;
+        buildMesh(floatingType(t), &source);
+        m_meshes[t].build(source, format);
+        m_meshes[t].createBuffers(a_pAllocator);
+    }
+
+    m_count[FLOATING_BOAT]   = a_count / 10;
+    m_count[FLOATING_BUOY]   = a_count / 10;
+    m_count[FLOATING_DEBRIS] = a_count - m_count[FLOATING_BOAT] - m_count[FLOATING_BUOY];
+    for (uint32_t t = 1; t < FLOATING_TYPE_COUNT; t++)
+        m_first[t] = m_first[t - 1] + m_count[t - 1];
+
+    std::mt19937                          rng(a_seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    m_instances.resize(a_count);
+    for (uint32_t t = 0; t < FLOATING_TYPE_COUNT; t++)
+    {
+        for (uint32_t i = m_first[t]; i < m_first[t] + m_count[t]; i++)
+        {
+            // uniform over the annulus area
+            //
+            const float r2     = a_area.innerRadius * a_area.innerRadius +
+                                 unit(rng) * (a_area.outerRadius * a_area.outerRadius - a_area.innerRadius * a_area.innerRadius);
+            const float angle  = 6.2831853f * unit(rng);
+            const float radius = std::sqrt(r2);
+
+            floatingInstance& inst = m_instances[i];
+            inst.x       = a_area.centerX + radius * std::cos(angle);
+            inst.z       = a_area.centerZ + radius * std::sin(angle);
+            inst.heading = 6.2831853f * unit(rng);
+            inst.type    = float(t);
+
+            // boats keep their heading, the rest drifts wherever
+            //
+            float speed = a_area.drift * unit(rng), direction = 6.2831853f * unit(rng);
+            switch (t)
+            {
+            case FLOATING_BOAT:   inst.scale = a_area.scale * 2.0f;                       inst.draft = 0.05f; direction = inst.heading; speed *= 4.0f; break;
+            case FLOATING_BUOY:   inst.scale = a_area.scale * 0.8f;                       inst.draft = 0.25f; speed = 0.0f; break;
+            default:              inst.scale = a_area.scale * (0.4f + 0.6f * unit(rng));  inst.draft = 0.1f;  break;
+            }
+            inst.driftX = speed * std::cos(direction);
+            inst.driftZ = speed * std::sin(direction);
+        }
+    }
+
+    a_pAllocator->createBuffer(std::max<VkDeviceSize>(m_instances.size(), 1) * sizeof(floatingInstance),
+                               VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_instanceBuffer, &m_instanceMem);
+    m_activeCount = a_count;
+}
+
+void floatingObjects::destroy(VkDevice a_device, deviceAllocator* a_pAllocator)
+{
+    destroyPipeline(a_device);
+    for (uint32_t t = 0; t < FLOATING_TYPE_COUNT; t++)
+        m_meshes[t].destroy(a_pAllocator);
+    if (m_instanceBuffer != VK_NULL_HANDLE)
+        a_pAllocator->destroyBuffer(m_instanceBuffer, m_instanceMem);
+
+    m_instanceBuffer = VK_NULL_HANDLE;
+    m_instances.clear();
+    m_activeCount = 0;
+}
+
+void floatingObjects::createPipeline(VkDevice a_device, VkPipelineCache a_pipelineCache, VkRenderPass a_renderPass, VkDescriptorSetLayout a_frameSetLayout,
+                                     VkSampleCountFlagBits a_samples)
+{
+    auto vertShaderCode = vk_utils::readFile("../WaterApp/shaders/floatingVert.spv");
+    auto fragShaderCode = vk_utils::readFile("../WaterApp/shaders/floatingFrag.spv");
+
+    VkShaderModule vertShaderModule = vk_utils::createShaderModule(a_device, vertShaderCode);
+    VkShaderModule fragShaderModule = vk_utils::createShaderModule(a_device, fragShaderCode);
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+    shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName  = "main";
+    shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName  = "main";
+
+    // mesh streams first, then the instances at instance rate
+    //
+    std::vector<VkVertexInputBindingDescription>   vInputBindings;
+    std::vector<VkVertexInputAttributeDescription> vAttributes;
+    m_meshes[0].vertexInput(&vInputBindings, &vAttributes);
+
+    VkVertexInputBindingDescription instanceBinding = {};
+    instanceBinding.binding   = uint32_t(vInputBindings.size());
+    instanceBinding.stride    = sizeof(floatingInstance);
+    instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    vInputBindings.push_back(instanceBinding);
+
+    VkVertexInputAttributeDescription placement = {};
+    placement.location = 2;
+    placement.binding  = instanceBinding.binding;
+    placement.format   = VK_FORMAT_R32G32B32A32_SFLOAT;
+    placement.offset   = offsetof(floatingInstance, x);
+    vAttributes.push_back(placement);
+
+    VkVertexInputAttributeDescription motion = placement;
+    motion.location = 3;
+    motion.offset   = offsetof(floatingInstance, driftX);
+    vAttributes.push_back(motion);
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount   = uint32_t(vInputBindings.size());
+    vertexInputInfo.vertexAttributeDescriptionCount = uint32_t(vAttributes.size());
+    vertexInputInfo.pVertexBindingDescriptions      = vInputBindings.data();
+    vertexInputInfo.pVertexAttributeDescriptions    = vAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount  = 1;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates    = dynamicStates;
+
+    // back faces are culled, the meshes are convex
+    //
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth   = 1.0f;
+    rasterizer.cullMode    = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace   = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = a_samples;
+
+    // reverse-Z like the water pipeline
+    //
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable  = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp   = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments    = &colorBlendAttachment;
+
+    VkPushConstantRange pushConstant = {};
+    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstant.size       = sizeof(floatingRenderParams);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 1;
+    pipelineLayoutInfo.pSetLayouts            = &a_frameSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(a_device, &pipelineLayoutInfo, NULL, &m_pipelineLayout));
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = 2;
+    pipelineInfo.pStages             = shaderStages;
+    pipelineInfo.pVertexInputState   = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState  = &depthStencil;
+    pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.pDynamicState       = &dynamicState;
+    pipelineInfo.layout              = m_pipelineLayout;
+    pipelineInfo.renderPass          = a_renderPass;
+    pipelineInfo.subpass             = 0;
+
+    if (vkCreateGraphicsPipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, &m_pipeline) != VK_SUCCESS)
+        throw std::runtime_error("[floatingObjects::createPipeline]: failed to create graphics pipeline!");
+
+    vkDestroyShaderModule(a_device, fragShaderModule, NULL);
+    vkDestroyShaderModule(a_device, vertShaderModule, NULL);
+}
+
+void floatingObjects::destroyPipeline(VkDevice a_device)
+{
+    if (m_pipeline != VK_NULL_HANDLE)
+        vkDestroyPipeline(a_device, m_pipeline, NULL);
+    if (m_pipelineLayout != VK_NULL_HANDLE)
+        vkDestroyPipelineLayout(a_device, m_pipelineLayout, NULL);
+
+    m_pipeline       = VK_NULL_HANDLE;
+    m_pipelineLayout = VK_NULL_HANDLE;
+}
+
+void floatingObjects::cmdDraw(VkCommandBuffer a_cmdBuff, VkDescriptorSet a_frameSet, uint32_t a_frameOffset, const floatingRenderParams& a_params) const
+{
+    if (m_activeCount == 0)
+        return;
+
+    vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &a_frameSet, 1, &a_frameOffset);
+    vkCmdPushConstants     (a_cmdBuff, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(a_params), &a_params);
+
+    // one draw per type, whatever the instance count is
+    //
+    for (uint32_t t = 0; t < FLOATING_TYPE_COUNT; t++)
+    {
+        const uint32_t count = uint32_t(uint64_t(m_count[t]) * m_activeCount / capacity());
+        if (count == 0)
+            continue;
+
+        const gpuMesh& mesh   = m_meshes[t];
+        VkDeviceSize   offset = 0;
+        mesh.cmdBind(a_cmdBuff);
+        vkCmdBindVertexBuffers(a_cmdBuff, mesh.streamCount(), 1, &m_instanceBuffer, &offset);
+        mesh.cmdDrawSegments(a_cmdBuff, 0, mesh.segmentCount(), count, m_first[t]);
+    }
+}
+
+uint64_t floatingObjects::triangleCount() const
+{
+    uint64_t total = 0;
+    for (uint32_t t = 0; t < FLOATING_TYPE_COUNT && capacity() > 0; t++)
+        total += uint64_t(m_count[t]) * m_activeCount / capacity() * m_meshes[t].triangleCount();
+    return total;
+}
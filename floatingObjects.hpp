@@ -0,0 +1,103 @@
+#ifndef WATERAPP_FLOATINGOBJECTS_HPP
+#define WATERAPP_FLOATINGOBJECTS_HPP
+#include <vulkan/vulkan.hpp>
+#include <algorithm>
+#include <vector>
+
+#include "deviceAllocator.hpp"
+#include "gpuMesh.hpp"
+
+namespace app
+{
+
+enum floatingType { FLOATING_DEBRIS = 0, FLOATING_BUOY, FLOATING_BOAT, FLOATING_TYPE_COUNT };
+
+// Per instance vertex attributes of shaders/floating.vert (locations 2 and 3), keep in sync with the shader.
+//
+struct floatingInstance
+{
+    float x, z;              // water space position at time 0
+    float scale;             // water space size of the unit mesh
+    float heading;           // radians around the up axis
+    float driftX, driftZ;    // water space units per second
+    float draft;             // depth of the mesh origin below the surface, in scales
+    float type;              // floatingType, picks the color
+};
+
+// Push constants of shaders/floating.vert, keep in sync with the shader. The view, time and water space come
+// from frameUniforms.
+//
+struct floatingRenderParams
+{
+    uint32_t gridSize;
+};
+
+// Where the objects are scattered: an annulus around (centerX, centerZ) in water space.
+//
+class floatingArea
+{
+public:
+    float centerX     = 0.5f;
+    float centerZ     = 0.5f;
+    float innerRadius = 0.0f;
+    float outerRadius = 0.5f;
+    float scale       = 0.01f;   // mean object size
+    float drift       = 0.005f;  // max drift speed
+};
+
+// Buoys, boats and debris floating on the heightfield.
+//
+// Every type is one small gpuMesh and one instanced draw; the instances live in a single vertex buffer at instance
+// rate, sorted by type, so a type's draw is a firstInstance range. The vertex shader samples the heightfield at the
+// instance position: the object sits at the surface height minus its draft and is tilted to the surface normal.
+// Floating is treated as the hydrostatic rest state, so nothing is integrated and the instance data stays static.
+//
+class floatingObjects
+{
+public:
+    // Builds the meshes and the instances; buffers are created, their data stays in mesh() and instanceData()
+    // until destroy() for the caller to upload.
+    //
+    void init(deviceAllocator* a_pAllocator, uint32_t a_count, const floatingArea& a_area, uint32_t a_seed = 1);
+    void destroy(VkDevice a_device, deviceAllocator* a_pAllocator);
+
+    // The pipeline depends on the render pass, so it is recreated with it.
+    //
+    void createPipeline (VkDevice a_device, VkPipelineCache a_pipelineCache, VkRenderPass a_renderPass, VkDescriptorSetLayout a_frameSetLayout,
+                         VkSampleCountFlagBits a_samples);
+    void destroyPipeline(VkDevice a_device);
+
+    // Inside the render pass; a_frameSet and a_frameOffset are the set and dynamic offset the water is drawn with.
+    //
+    void cmdDraw(VkCommandBuffer a_cmdBuff, VkDescriptorSet a_frameSet, uint32_t a_frameOffset, const floatingRenderParams& a_params) const;
+
+    // Draws only this many objects, spread over the types like the whole set; for scaling measurements.
+    //
+    void setActiveCount(uint32_t a_count) { m_activeCount = std::min(a_count, capacity()); }
+
+    // unit size meshes, y up, origin at the waterline of the rest state
+    //
+    static void buildMesh(floatingType a_type, meshSource* a_pMesh);
+
+    uint32_t                              capacity() const           { return uint32_t(m_instances.size()); }
+    uint32_t                              activeCount() const        { return m_activeCount; }
+    const gpuMesh&                        mesh(uint32_t a_type) const { return m_meshes[a_type]; }
+    const std::vector<floatingInstance>&  instanceData() const       { return m_instances; }
+    VkBuffer                              instanceBuffer() const     { return m_instanceBuffer; }
+    uint64_t                              triangleCount() const;     // of the active objects
+
+private:
+    gpuMesh                       m_meshes[FLOATING_TYPE_COUNT];
+    uint32_t                      m_first[FLOATING_TYPE_COUNT] = {};
+    uint32_t                      m_count[FLOATING_TYPE_COUNT] = {};
+    std::vector<floatingInstance> m_instances;
+    uint32_t                      m_activeCount = 0;
+
+    VkBuffer                      m_instanceBuffer = VK_NULL_HANDLE;
+    deviceAllocation              m_instanceMem;
+    VkPipelineLayout              m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline                    m_pipeline       = VK_NULL_HANDLE;
+};
+
+}
+#endif // WATERAPP_FLOATINGOBJECTS_HPP
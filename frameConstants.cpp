@@ -0,0 +1,73 @@
+#include "createApp.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace app;
+
+void frameConstants::init(deviceAllocator* a_pAllocator, VkPhysicalDevice a_physDevice, uint32_t a_frameCount)
+{
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(a_physDevice, &props);
+
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(props.limits.minUniformBufferOffsetAlignment, 1);
+    m_stride = (sizeof(frameUniforms) + alignment - 1) / alignment * alignment;
+
+    a_pAllocator->createBuffer(m_stride * a_frameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_buffer, &m_memory);
+}
+
+void frameConstants::destroy(deviceAllocator* a_pAllocator)
+{
+    if (m_buffer != VK_NULL_HANDLE)
+        a_pAllocator->destroyBuffer(m_buffer, m_memory);
+    m_buffer = VK_NULL_HANDLE;
+}
+
+void frameConstants::write(uint32_t a_frame, const frameUniforms& a_uniforms)
+{
+    memcpy((char*)m_memory.mapped + offset(a_frame), &a_uniforms, sizeof(a_uniforms));
+}
+
+bool app::invertMatrix(const float a_m[16], float a_out[16])
+{
+    // the adjugate over the determinant, by 2x2 sub-determinants of the lower and upper two rows
+    //
+    const float* m = a_m;
+    const float s0 = m[0] * m[5]  - m[1] * m[4];
+    const float s1 = m[0] * m[9]  - m[1] * m[8];
+    const float s2 = m[0] * m[13] - m[1] * m[12];
+    const float s3 = m[4] * m[9]  - m[5] * m[8];
+    const float s4 = m[4] * m[13] - m[5] * m[12];
+    const float s5 = m[8] * m[13] - m[9] * m[12];
+    const float c5 = m[10] * m[15] - m[11] * m[14];
+    const float c4 = m[6]  * m[15] - m[7]  * m[14];
+    const float c3 = m[6]  * m[11] - m[7]  * m[10];
+    const float c2 = m[2]  * m[15] - m[3]  * m[14];
+    const float c1 = m[2]  * m[11] - m[3]  * m[10];
+    const float c0 = m[2]  * m[7]  - m[3]  * m[6];
+
+    const float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (std::fabs(det) < 1e-20f)
+        return false;
+
+    const float inv = 1.0f / det;
+    a_out[0]  = ( m[5]  * c5 - m[9]  * c4 + m[13] * c3) * inv;
+    a_out[1]  = (-m[1]  * c5 + m[9]  * c2 - m[13] * c1) * inv;
+    a_out[2]  = ( m[1]  * c4 - m[5]  * c2 + m[13] * c0) * inv;
+    a_out[3]  = (-m[1]  * c3 + m[5]  * c1 - m[9]  * c0) * inv;
+    a_out[4]  = (-m[4]  * c5 + m[8]  * c4 - m[12] * c3) * inv;
+    a_out[5]  = ( m[0]  * c5 - m[8]  * c2 + m[12] * c1) * inv;
+    a_out[6]  = (-m[0]  * c4 + m[4]  * c2 - m[12] * c0) * inv;
+    a_out[7]  = ( m[0]  * c3 - m[4]  * c1 + m[8]  * c0) * inv;
+    a_out[8]  = ( m[7]  * s5 - m[11] * s4 + m[15] * s3) * inv;
+    a_out[9]  = (-m[3]  * s5 + m[11] * s2 - m[15] * s1) * inv;
+    a_out[10] = ( m[3]  * s4 - m[7]  * s2 + m[15] * s0) * inv;
+    a_out[11] = (-m[3]  * s3 + m[7]  * s1 - m[11] * s0) * inv;
+    a_out[12] = (-m[6]  * s5 + m[10] * s4 - m[14] * s3) * inv;
+    a_out[13] = ( m[2]  * s5 - m[10] * s2 + m[14] * s1) * inv;
+    a_out[14] = (-m[2]  * s4 + m[6]  * s2 - m[14] * s0) * inv;
+    a_out[15] = ( m[2]  * s3 - m[6]  * s1 + m[10] * s0) * inv;
+    return true;
+}
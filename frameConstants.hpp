@@ -0,0 +1,56 @@
+#ifndef WATERAPP_FRAMECONSTANTS_HPP
+#define WATERAPP_FRAMECONSTANTS_HPP
+#include <vulkan/vulkan.hpp>
+
+#include "deviceAllocator.hpp"
+
+namespace app
+{
+
+// Uniform block "Frame" (set 0, binding 1) of shaders/frame.glsl, included by vertex.vert, waterLod.vert, floating.vert
+// and the reflecting fragment.frag, std140; keep in sync with it.
+//
+struct frameUniforms
+{
+    float toClip[16];   // water space to clip space, column major: the LOD camera, or the fixed oblique view of the grid
+    float camera[4];    // xyz - water space camera position (0 for the grid view), w - seconds since start
+    float wind[4];      // xy - direction (x, z), unit length; z - speed, m/s; w - frame time step, seconds
+    float waves[4];     // detail waves: x - amplitude, height units; y - longest wavelength, water space units; z - phase speed; w - count
+    float space[4];     // x - heightfield cells per water space unit, y - water space units per height unit, z - wrap period, 0 - none
+    float ocean[4];     // FFT ocean: x - cascades, 0 - off; y - map size; z - cascade 0 patch size, water space units; w - cascade ratio
+    float fromClip[16]; // the inverse of toClip
+    float screen[4];    // xy - rendered pixels; zw - 1 / size of the scene copy, see waterReflections
+    float reflections[4]; // waterReflections::uniforms(), all 0 - off
+};
+
+// a_out = a_m^-1, both column major; false (and a_out untouched) for a singular a_m
+//
+bool invertMatrix(const float a_m[16], float a_out[16]);
+
+// Per-frame shader constants in one persistently mapped, host coherent uniform buffer with a part per frame in
+// flight. The CPU writes the part of the frame being recorded, whose previous use the frame fence already
+// retired, so there is no map/unmap, flush or extra wait; shaders see their part through a dynamic offset.
+//
+class frameConstants
+{
+public:
+    void init(deviceAllocator* a_pAllocator, VkPhysicalDevice a_physDevice, uint32_t a_frameCount);
+    void destroy(deviceAllocator* a_pAllocator);
+
+    // a_frame must not be in flight any more: call after its fence was waited
+    //
+    void write(uint32_t a_frame, const frameUniforms& a_uniforms);
+
+    VkBuffer     buffer() const                 { return m_buffer; }
+    VkDeviceSize range() const                  { return sizeof(frameUniforms); }   // of the descriptor
+    uint32_t     offset(uint32_t a_frame) const { return uint32_t(m_stride * a_frame); }   // dynamic offset of a frame's part
+    VkDeviceSize stride() const                 { return m_stride; }
+
+private:
+    VkBuffer         m_buffer = VK_NULL_HANDLE;
+    deviceAllocation m_memory;
+    VkDeviceSize     m_stride = 0;   // sizeof(frameUniforms) rounded up to minUniformBufferOffsetAlignment
+};
+
+}
+#endif // WATERAPP_FRAMECONSTANTS_HPP
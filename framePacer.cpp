@@ -0,0 +1,79 @@
+#include "framePacer.hpp"
+
+#include <cstring>
+#include <thread>
+
+using namespace app;
+
+constexpr double framePacer::SPIN_MS;
+
+static const struct { VkPresentModeKHR mode; const char* name; } g_presentModes[] =
+{
+    { VK_PRESENT_MODE_IMMEDIATE_KHR,    "immediate"    },
+    { VK_PRESENT_MODE_MAILBOX_KHR,      "mailbox"      },
+    { VK_PRESENT_MODE_FIFO_KHR,         "fifo"         },
+    { VK_PRESENT_MODE_FIFO_RELAXED_KHR, "fifo_relaxed" },
+};
+
+const char* app::presentModeName(VkPresentModeKHR a_mode)
+{
+    for (const auto& entry : g_presentModes)
+        if (entry.mode == a_mode) return entry.name;
+    return "unknown";
+}
+
+bool app::parsePresentMode(const char* a_name, VkPresentModeKHR* a_pMode)
+{
+    for (const auto& entry : g_presentModes)
+    {
+        if (strcmp(entry.name, a_name) == 0)
+        {
+            (*a_pMode) = entry.mode;
+            return true;
+        }
+    }
+    return false;
+}
+
+void framePacer::init(double a_maxFps)
+{
+    m_maxFps     = a_maxFps > 0.0 ? a_maxFps : 0.0;
+    m_period     = m_maxFps > 0.0 ? std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / m_maxFps))
+                                  : clock::duration::zero();
+    m_deadline   = clock::now();
+    m_inputValid = false;
+}
+
+void framePacer::waitForFrame()
+{
+    if (m_maxFps <= 0.0)
+        return;
+
+    const auto spin = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(SPIN_MS));
+
+    auto now = clock::now();
+    if (m_deadline - now > spin)
+        std::this_thread::sleep_for(m_deadline - now - spin);
+    while (clock::now() < m_deadline)
+        std::this_thread::yield();
+
+    // the next deadline is one period after this one, unless this frame is already late by a period:
+    // then pacing restarts from now instead of letting several frames through back to back
+    //
+    now        = clock::now();
+    m_deadline = (now - m_deadline > m_period) ? now + m_period : m_deadline + m_period;
+}
+
+void framePacer::inputSampled()
+{
+    m_input      = clock::now();
+    m_inputValid = true;
+}
+
+double framePacer::presented()
+{
+    if (!m_inputValid)
+        return -1.0;
+    m_inputValid = false;
+    return std::chrono::duration<double, std::milli>(clock::now() - m_input).count();
+}
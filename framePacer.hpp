@@ -0,0 +1,41 @@
+#ifndef WATERAPP_FRAMEPACER_HPP
+#define WATERAPP_FRAMEPACER_HPP
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+
+namespace app
+{
+
+// "immediate", "mailbox", "fifo", "fifo_relaxed"
+//
+const char* presentModeName(VkPresentModeKHR a_mode);
+bool        parsePresentMode(const char* a_name, VkPresentModeKHR* a_pMode);
+
+// CPU side frame limiter and input-to-present latency measurement. The limiter sleeps before the input
+// of a frame is sampled rather than after present, so a capped frame rate does not add input latency.
+//
+class framePacer
+{
+public:
+    void   init(double a_maxFps);   // 0 - no limit
+
+    void   waitForFrame();          // returns at the frame's deadline; deadlines that were missed are not caught up
+    void   inputSampled();          // right after glfwPollEvents()
+    double presented();             // right after vkQueuePresentKHR(), ms since inputSampled(); -1 if there was none
+
+    double maxFps() const { return m_maxFps; }
+
+private:
+    typedef std::chrono::steady_clock clock;
+
+    static constexpr double SPIN_MS = 1.5; // sleeps are only that precise on common schedulers; the rest is spent yielding
+
+    double            m_maxFps     = 0.0;
+    clock::duration   m_period     = clock::duration::zero();
+    clock::time_point m_deadline;
+    clock::time_point m_input;
+    bool              m_inputValid = false;
+};
+
+}
+#endif // WATERAPP_FRAMEPACER_HPP
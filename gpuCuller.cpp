@@ -0,0 +1,188 @@
+#include "createApp.hpp"
+
+using namespace std;
+using namespace app;
+
+void gpuCuller::init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+                     const gpuMesh& a_mesh, uint32_t a_maxCandidates, bool a_multiDraw, bool a_drawCount)
+{
+    if (a_mesh.indexType() == MESH_INDEX_NONE)
+        throw std::runtime_error("[gpuCuller::init]: indirect draws need an indexed mesh!");
+
+    m_maxCandidates  = std::max(1u, a_maxCandidates);
+    m_candidateCount = 0;
+    m_multiDraw      = a_multiDraw;
+    m_drawCount      = a_drawCount;
+
+    if (m_drawCount)
+    {
+        m_cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(a_device, "vkCmdDrawIndexedIndirectCountKHR");
+        if (m_cmdDrawIndexedIndirectCount == nullptr)
+            m_drawCount = false;
+    }
+
+    a_pAllocator->createBuffer(VkDeviceSize(m_maxCandidates) * sizeof(cullCandidate), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_candidates, &m_candidatesMem);
+    a_pAllocator->createBuffer(VkDeviceSize(m_maxCandidates) * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_commands, &m_commandsMem);
+    a_pAllocator->createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_count, &m_countMem);
+
+    // the segment table is written once, small enough to stay in host visible memory
+    //
+    const uint32_t segmentCount = a_mesh.segmentCount();
+    a_pAllocator->createBuffer(VkDeviceSize(segmentCount) * 4 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_segments, &m_segmentsMem);
+    {
+        uint32_t* dst = (uint32_t*)m_segmentsMem.mapped;
+        for (uint32_t i = 0; i < segmentCount; i++)
+        {
+            const meshSegment& segment = a_mesh.segment(i);
+            dst[i * 4 + 0] = segment.indexCount;
+            dst[i * 4 + 1] = segment.firstIndex;
+            dst[i * 4 + 2] = uint32_t(segment.vertexOffset);
+            dst[i * 4 + 3] = 0;
+        }
+    }
+
+    {
+        m_setLayout = a_pLayouts->get(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, VK_SHADER_STAGE_COMPUTE_BIT);
+
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = 4;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets       = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes    = &poolSize;
+        VK_CHECK_RESULT(vkCreateDescriptorPool(a_device, &poolInfo, NULL, &m_descriptorPool));
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool     = m_descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts        = &m_setLayout;
+        VK_CHECK_RESULT(vkAllocateDescriptorSets(a_device, &allocInfo, &m_set));
+
+        const VkBuffer buffers[4] = { m_candidates, m_segments, m_commands, m_count };
+
+        VkDescriptorBufferInfo bufferInfos[4] = {};
+        VkWriteDescriptorSet   writes[4]      = {};
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            bufferInfos[i].buffer = buffers[i];
+            bufferInfos[i].offset = 0;
+            bufferInfos[i].range  = VK_WHOLE_SIZE;
+
+            writes[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet          = m_set;
+            writes[i].dstBinding      = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].pBufferInfo     = &bufferInfos[i];
+        }
+        vkUpdateDescriptorSets(a_device, 4, writes, 0, NULL);
+    }
+
+    {
+        VkPushConstantRange pushConstant = {};
+        pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstant.offset     = 0;
+        pushConstant.size       = sizeof(cullParams);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount         = 1;
+        pipelineLayoutInfo.pSetLayouts            = &m_setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+        VK_CHECK_RESULT(vkCreatePipelineLayout(a_device, &pipelineLayoutInfo, NULL, &m_pipelineLayout));
+
+        auto           shaderCode   = vk_utils::readFile("../WaterApp/shaders/cull.spv");
+        VkShaderModule shaderModule = vk_utils::createShaderModule(a_device, shaderCode);
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shaderModule;
+        pipelineInfo.stage.pName  = "main";
+        pipelineInfo.layout       = m_pipelineLayout;
+
+        if (vkCreateComputePipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, &m_pipeline) != VK_SUCCESS)
+            throw std::runtime_error("[gpuCuller::init]: failed to create compute pipeline!");
+
+        vkDestroyShaderModule(a_device, shaderModule, NULL);
+    }
+}
+
+void gpuCuller::destroy(VkDevice a_device, deviceAllocator* a_pAllocator)
+{
+    vkDestroyPipeline           (a_device, m_pipeline, NULL);
+    vkDestroyPipelineLayout     (a_device, m_pipelineLayout, NULL);
+    vkDestroyDescriptorPool     (a_device, m_descriptorPool, NULL);
+
+    a_pAllocator->destroyBuffer(m_candidates, m_candidatesMem);
+    a_pAllocator->destroyBuffer(m_segments, m_segmentsMem);
+    a_pAllocator->destroyBuffer(m_commands, m_commandsMem);
+    a_pAllocator->destroyBuffer(m_count, m_countMem);
+
+    m_pipeline   = VK_NULL_HANDLE;
+    m_candidates = VK_NULL_HANDLE;
+}
+
+void gpuCuller::setCandidates(uint32_t a_count, float a_lodRange, uint32_t a_lodLevels)
+{
+    if (a_count > m_maxCandidates)
+        throw std::runtime_error("[gpuCuller::setCandidates]: " + std::to_string(a_count) + " candidates, capacity " + std::to_string(m_maxCandidates) + "!");
+
+    m_candidateCount = a_count;
+    m_lodRange       = a_lodRange;
+    m_lodLevels      = a_lodLevels;
+}
+
+void gpuCuller::cmdCull(VkCommandBuffer a_cmdBuff, const float a_planes[6][4], const float a_camera[3])
+{
+    if (m_candidateCount == 0)
+        return;
+
+    if (m_drawCount)
+    {
+        vkCmdFillBuffer(a_cmdBuff, m_count, 0, sizeof(uint32_t), 0);
+
+        VkBufferMemoryBarrier cleared = vk_utils::bufferBarrier(m_count, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 1, &cleared, 0, NULL);
+    }
+
+    cullParams params = {};
+    memcpy(params.planes, a_planes, sizeof(params.planes));
+    params.candidateCount = m_candidateCount;
+    params.compact        = m_drawCount ? 1 : 0;
+    params.lodRange       = m_lodRange;
+    params.lodLevels      = m_lodLevels;
+    memcpy(params.camera, a_camera, sizeof(params.camera));
+
+    vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_set, 0, NULL);
+    vkCmdPushConstants     (a_cmdBuff, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+    vkCmdDispatch          (a_cmdBuff, (m_candidateCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+}
+
+void gpuCuller::cmdDraw(VkCommandBuffer a_cmdBuff) const
+{
+    if (m_candidateCount == 0)
+        return;
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (m_drawCount)
+        m_cmdDrawIndexedIndirectCount(a_cmdBuff, m_commands, 0, m_count, 0, m_candidateCount, stride);
+    else if (m_multiDraw)
+        vkCmdDrawIndexedIndirect(a_cmdBuff, m_commands, 0, m_candidateCount, stride);
+    else
+    {
+        for (uint32_t i = 0; i < m_candidateCount; i++)
+            vkCmdDrawIndexedIndirect(a_cmdBuff, m_commands, VkDeviceSize(i) * stride, 1, stride);
+    }
+}
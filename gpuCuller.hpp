@@ -0,0 +1,112 @@
+#ifndef WATERAPP_GPUCULLER_HPP
+#define WATERAPP_GPUCULLER_HPP
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+#include "descriptorCache.hpp"
+#include "deviceAllocator.hpp"
+#include "gpuMesh.hpp"
+
+namespace app
+{
+
+// Input of shaders/cull.comp, keep in sync with the shader.
+//
+struct cullCandidate
+{
+    float    boundsMin[3];   // world space box
+    uint32_t segment;        // mesh segment to draw
+    float    boundsMax[3];
+    uint32_t instance;       // firstInstance of the draw
+    float    nodeMin[2];     // x, z of the CDLOD node the candidate is a quadrant of, with lodRange only
+    float    nodeSize;
+    uint32_t level;
+};
+
+// Push constants of shaders/cull.comp, keep in sync with the shader.
+//
+struct cullParams
+{
+    float    planes[6][4];   // see frustumPlanes(), a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+    uint32_t candidateCount;
+    uint32_t compact;        // append visible draws and count them, for vkCmdDrawIndexedIndirectCount
+    float    lodRange;       // range of CDLOD level 0, see waterLod; 0 - frustum culling only
+    uint32_t lodLevels;
+    float    camera[3];
+};
+
+// GPU driven drawing of an indexed gpuMesh: a compute pass tests the bounds of every candidate against the frustum and
+// writes a VkDrawIndexedIndirectCommand per candidate, then cmdDraw() issues all of them with a fixed number of calls,
+// whatever the candidate count is.
+//
+// With VK_KHR_draw_indirect_count the visible draws are appended and the GPU written count is the draw count; the
+// append order depends on the invocation order, so draw order is not kept. Without it every candidate keeps its slot
+// and culled ones get instanceCount 0, so the draws stay in candidate order. Without multiDrawIndirect the commands
+// are issued one call each, which brings back the per draw CPU cost but still skips the culled geometry on the GPU.
+//
+// Instances are addressed through firstInstance, which needs the drawIndirectFirstInstance feature.
+//
+// The candidates stay in device memory and are written only when they change. With a lod range the cull pass also
+// makes the CDLOD choices of waterLod::select(), so the candidates can be every quadrant of every quadtree node and
+// the CPU cost of a frame does not depend on their count; only the one indirect call per candidate without
+// multiDrawIndirect does.
+//
+class gpuCuller
+{
+public:
+    static const uint32_t WORKGROUP_SIZE = 64;  // local_size_x of cull.comp
+
+    void init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+              const gpuMesh& a_mesh, uint32_t a_maxCandidates, bool a_multiDraw, bool a_drawCount);
+    void destroy(VkDevice a_device, deviceAllocator* a_pAllocator);
+
+    // The first a_count cullCandidate of candidateBuffer() are culled from now on; the caller writes them there, e.g.
+    // with putDataToBuffer_Now(), when they change. a_lodRange 0 - no CDLOD selection. More than maxCandidates() throws.
+    //
+    void setCandidates(uint32_t a_count, float a_lodRange = 0.0f, uint32_t a_lodLevels = 0);
+
+    // Outside of the render pass. Writes commandBuffer() and countBuffer() at the transfer and compute stages; ordering
+    // them against the indirect reads of this and the previous frame is the caller's business.
+    //
+    void cmdCull(VkCommandBuffer a_cmdBuff, const float a_planes[6][4], const float a_camera[3]);
+
+    // Inside the render pass, with the mesh and the instance buffers bound.
+    //
+    void cmdDraw(VkCommandBuffer a_cmdBuff) const;
+
+    VkBuffer candidateBuffer() const { return m_candidates; }
+    VkBuffer commandBuffer() const { return m_commands; }
+    VkBuffer countBuffer() const   { return m_count; }   // the visible draw count, used with VK_KHR_draw_indirect_count
+
+    uint32_t candidateCount() const { return m_candidateCount; }
+    uint32_t maxCandidates() const  { return m_maxCandidates; }
+    bool     drawCount() const      { return m_drawCount; }
+    bool     multiDraw() const      { return m_multiDraw; }
+
+private:
+    uint32_t              m_maxCandidates  = 0;
+    uint32_t              m_candidateCount = 0;
+    float                 m_lodRange       = 0.0f;
+    uint32_t              m_lodLevels      = 0;
+    bool                  m_multiDraw      = false;
+    bool                  m_drawCount      = false;
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_cmdDrawIndexedIndirectCount = nullptr;
+
+    VkBuffer              m_candidates = VK_NULL_HANDLE;
+    deviceAllocation      m_candidatesMem;
+    VkBuffer              m_segments   = VK_NULL_HANDLE;  // indexCount, firstIndex, vertexOffset, 0 per mesh segment
+    deviceAllocation      m_segmentsMem;
+    VkBuffer              m_commands   = VK_NULL_HANDLE;
+    deviceAllocation      m_commandsMem;
+    VkBuffer              m_count      = VK_NULL_HANDLE;
+    deviceAllocation      m_countMem;
+
+    VkDescriptorSetLayout m_setLayout      = VK_NULL_HANDLE;   // owned by the descriptorLayoutCache
+    VkDescriptorPool      m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet       m_set            = VK_NULL_HANDLE;
+    VkPipelineLayout      m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline            m_pipeline       = VK_NULL_HANDLE;
+};
+
+}
+#endif // WATERAPP_GPUCULLER_HPP
@@ -0,0 +1,469 @@
+#include "createApp.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace app;
+
+static const char* g_indexTypeNames[] = { "none", "16", "32", "auto" };
+
+const char* app::meshIndexTypeName(meshIndexType a_type)
+{
+    return g_indexTypeNames[a_type];
+}
+
+bool app::parseMeshIndexType(const char* a_name, meshIndexType* a_pType)
+{
+    for (int i = 0; i <= MESH_INDEX_AUTO; i++)
+    {
+        if (strcmp(g_indexTypeNames[i], a_name) == 0)
+        {
+            (*a_pType) = meshIndexType(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// scoring of "Linear-Speed Vertex Cache Optimisation", with the constants from the paper
+//
+static const float CACHE_DECAY_POWER   = 1.5f;
+static const float LAST_TRI_SCORE      = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static float vertexScore(int a_cachePos, uint32_t a_remainingTris, uint32_t a_cacheSize)
+{
+    if (a_remainingTris == 0)
+        return -1.0f;
+
+    // the vertices of the last triangle get a fixed score, so the next one does not simply reuse two of them
+    //
+    float score = 0.0f;
+    if (a_cachePos >= 0)
+    {
+        if (a_cachePos < 3)
+            score = LAST_TRI_SCORE;
+        else
+            score = powf(1.0f - float(a_cachePos - 3) / float(a_cacheSize - 3), CACHE_DECAY_POWER);
+    }
+
+    // vertices with few triangles left are finished first, so they do not get stranded
+    //
+    return score + VALENCE_BOOST_SCALE * powf(float(a_remainingTris), -VALENCE_BOOST_POWER);
+}
+
+void app::optimizeVertexCache(uint32_t* a_indices, size_t a_indexCount, uint32_t a_vertexCount, uint32_t a_cacheSize)
+{
+    const uint32_t triCount = uint32_t(a_indexCount / 3);
+    if (triCount < 2)
+        return;
+    a_cacheSize = std::max(a_cacheSize, 4u);
+
+    // triangles of every vertex; the first remaining[v] entries of a vertex's range are the ones not emitted yet
+    //
+    std::vector<uint32_t> remaining(a_vertexCount, 0);
+    for (size_t i = 0; i < a_indexCount; i++)
+        remaining[a_indices[i]]++;
+
+    std::vector<uint32_t> offsets(a_vertexCount + 1, 0);
+    for (uint32_t v = 0; v < a_vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> vertexTris(a_indexCount);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < a_indexCount; i++)
+            vertexTris[fill[a_indices[i]]++] = uint32_t(i / 3);
+    }
+
+    std::vector<int>   cachePos(a_vertexCount, -1);
+    std::vector<float> vScore(a_vertexCount);
+    for (uint32_t v = 0; v < a_vertexCount; v++)
+        vScore[v] = vertexScore(-1, remaining[v], a_cacheSize);
+
+    std::vector<float>   tScore(triCount);
+    std::vector<uint8_t> emitted(triCount, 0);
+    uint32_t best = 0;
+    for (uint32_t t = 0; t < triCount; t++)
+    {
+        tScore[t] = vScore[a_indices[3 * t]] + vScore[a_indices[3 * t + 1]] + vScore[a_indices[3 * t + 2]];
+        if (tScore[t] > tScore[best])
+            best = t;
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(a_indexCount);
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(a_cacheSize + 3);
+    newCache.reserve(a_cacheSize + 3);
+    uint32_t cursor = 0;
+
+    while (order.size() < a_indexCount)
+    {
+        // nothing left around the cached vertices: continue with the first triangle not emitted yet
+        //
+        if (best == UINT32_MAX)
+        {
+            while (emitted[cursor]) cursor++;
+            best = cursor;
+        }
+
+        emitted[best] = 1;
+        const uint32_t* tri = a_indices + 3 * size_t(best);
+        order.insert(order.end(), tri, tri + 3);
+
+        for (int k = 0; k < 3; k++)
+        {
+            const uint32_t v     = tri[k];
+            uint32_t*      list  = vertexTris.data() + offsets[v];
+            uint32_t*      found = std::find(list, list + remaining[v], best);
+            std::swap(*found, list[remaining[v] - 1]);
+            remaining[v]--;
+        }
+
+        // LRU: the triangle's vertices move to the front, the ones pushed past the end leave the cache
+        //
+        newCache.assign(tri, tri + 3);
+        for (uint32_t v : cache)
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache.push_back(v);
+
+        for (size_t i = 0; i < newCache.size(); i++)
+        {
+            const uint32_t v = newCache[i];
+            cachePos[v] = (i < a_cacheSize) ? int(i) : -1;
+            vScore[v]   = vertexScore(cachePos[v], remaining[v], a_cacheSize);
+        }
+
+        // only triangles touching the changed vertices change their score; the next one is picked among them
+        //
+        best = UINT32_MAX;
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < newCache.size(); i++)
+        {
+            const uint32_t  v    = newCache[i];
+            const uint32_t* list = vertexTris.data() + offsets[v];
+            for (uint32_t j = 0; j < remaining[v]; j++)
+            {
+                const uint32_t t = list[j];
+                tScore[t] = vScore[a_indices[3 * t]] + vScore[a_indices[3 * t + 1]] + vScore[a_indices[3 * t + 2]];
+                if (i < a_cacheSize && tScore[t] > bestScore)
+                {
+                    bestScore = tScore[t];
+                    best      = t;
+                }
+            }
+        }
+
+        if (newCache.size() > a_cacheSize)
+            newCache.resize(a_cacheSize);
+        std::swap(cache, newCache);
+    }
+
+    std::copy(order.begin(), order.end(), a_indices);
+}
+
+double app::vertexCacheMissRatio(const uint32_t* a_indices, size_t a_indexCount, uint32_t a_cacheSize)
+{
+    if (a_indexCount < 3)
+        return 0.0;
+
+    const uint32_t vertexCount = *std::max_element(a_indices, a_indices + a_indexCount) + 1;
+
+    // a vertex is in the FIFO while fewer than a_cacheSize misses happened after its own
+    //
+    std::vector<int64_t> insertedAt(vertexCount, INT64_MIN / 2);
+    int64_t misses = 0;
+    for (size_t i = 0; i < a_indexCount; i++)
+    {
+        const uint32_t v = a_indices[i];
+        if (misses - insertedAt[v] >= int64_t(a_cacheSize))
+            insertedAt[v] = misses++;
+    }
+    return double(misses) / double(a_indexCount / 3);
+}
+
+void gpuMesh::build(const meshSource& a_source, const meshFormat& a_format)
+{
+    const uint32_t components = a_source.positionComponents;
+    if (components != 2 && components != 3)
+        throw std::runtime_error("[gpuMesh::build]: positions must have 2 or 3 components!");
+
+    const uint32_t sourceVertices = uint32_t(a_source.positions.size() / components);
+    const bool     hasNormals     = !a_source.normals.empty();
+    if (hasNormals && a_source.normals.size() != size_t(sourceVertices) * 3)
+        throw std::runtime_error("[gpuMesh::build]: normal count does not match the vertex count!");
+    if (a_source.indices.size() % 3 != 0)
+        throw std::runtime_error("[gpuMesh::build]: index count is not a multiple of 3!");
+
+    m_triangleCount = uint32_t(a_source.indices.size() / 3);
+
+    std::vector<uint32_t> bounds = a_source.segments;
+    if (bounds.empty())
+        bounds.push_back(0);
+    bounds.push_back(m_triangleCount);
+
+    // every segment gets its own vertex range in first-use order, so its indices are small and its fetches sequential
+    //
+    const size_t segmentCount = bounds.size() - 1;
+    std::vector<std::vector<uint32_t>> localIndices(segmentCount);
+    std::vector<std::vector<uint32_t>> localVertices(segmentCount);   // source vertex of every local one
+    std::vector<uint32_t> remap(sourceVertices, UINT32_MAX);
+    uint32_t maxSegmentVertices = 0;
+
+    for (size_t s = 0; s < segmentCount; s++)
+    {
+        std::vector<uint32_t>& indices  = localIndices[s];
+        std::vector<uint32_t>& vertices = localVertices[s];
+
+        for (size_t i = size_t(bounds[s]) * 3; i < size_t(bounds[s + 1]) * 3; i++)
+        {
+            const uint32_t v = a_source.indices[i];
+            if (remap[v] == UINT32_MAX)
+            {
+                remap[v] = uint32_t(vertices.size());
+                vertices.push_back(v);
+            }
+            indices.push_back(remap[v]);
+        }
+        for (uint32_t v : vertices)
+            remap[v] = UINT32_MAX;
+
+        if (a_format.optimizeOrder && a_format.indexType != MESH_INDEX_NONE)
+        {
+            optimizeVertexCache(indices.data(), indices.size(), uint32_t(vertices.size()), a_format.cacheSize);
+
+            std::vector<uint32_t> renumber(vertices.size(), UINT32_MAX);
+            std::vector<uint32_t> ordered;
+            ordered.reserve(vertices.size());
+            for (uint32_t& index : indices)
+            {
+                if (renumber[index] == UINT32_MAX)
+                {
+                    renumber[index] = uint32_t(ordered.size());
+                    ordered.push_back(vertices[index]);
+                }
+                index = renumber[index];
+            }
+            vertices.swap(ordered);
+        }
+        maxSegmentVertices = std::max(maxSegmentVertices, uint32_t(vertices.size()));
+    }
+
+    m_indexType = a_format.indexType;
+    if (m_indexType == MESH_INDEX_AUTO)
+        m_indexType = (maxSegmentVertices <= 65536) ? MESH_INDEX_16 : MESH_INDEX_32;
+    if (m_indexType == MESH_INDEX_16 && maxSegmentVertices > 65536)
+        throw std::runtime_error("[gpuMesh::build]: a segment has more than 65536 vertices for 16 bit indices!");
+
+    // positions are normalized into [0,1] by the bounds when quantized
+    //
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        m_positionOffset[c] = 0.0f;
+        m_positionScale[c]  = 1.0f;
+    }
+    if (a_format.quantizePositions && sourceVertices > 0)
+    {
+        for (uint32_t c = 0; c < components; c++)
+        {
+            float lo = a_source.positions[c], hi = lo;
+            for (uint32_t v = 1; v < sourceVertices; v++)
+            {
+                lo = std::min(lo, a_source.positions[size_t(v) * components + c]);
+                hi = std::max(hi, a_source.positions[size_t(v) * components + c]);
+            }
+            m_positionOffset[c] = lo;
+            m_positionScale[c]  = (hi > lo) ? (hi - lo) : 1.0f;
+        }
+    }
+
+    m_positionFormat = a_format.quantizePositions ? (components == 2 ? VK_FORMAT_R16G16_UNORM  : VK_FORMAT_R16G16B16A16_UNORM)
+                                                  : (components == 2 ? VK_FORMAT_R32G32_SFLOAT : VK_FORMAT_R32G32B32_SFLOAT);
+    m_positionBytes  = a_format.quantizePositions ? (components == 2 ? 4 : 8) : components * 4;
+    m_normalFormat   = !hasNormals ? VK_FORMAT_UNDEFINED : (a_format.quantizeNormals ? VK_FORMAT_R8G8B8A8_SNORM : VK_FORMAT_R32G32B32_SFLOAT);
+    m_normalBytes    = !hasNormals ? 0 : (a_format.quantizeNormals ? 4 : 12);
+
+    // the vertex list as drawn: the compact ranges, or every index expanded without an index buffer
+    //
+    std::vector<uint32_t> drawnVertices;
+    std::vector<uint32_t> drawnIndices;
+    m_segments.assign(segmentCount, meshSegment());
+    double missSum = 0.0;
+    for (size_t s = 0; s < segmentCount; s++)
+    {
+        meshSegment& segment = m_segments[s];
+        segment.vertexCount  = uint32_t(localVertices[s].size());
+
+        if (m_indexType == MESH_INDEX_NONE)
+        {
+            segment.firstIndex = uint32_t(drawnVertices.size());
+            segment.indexCount = uint32_t(localIndices[s].size());
+            for (uint32_t index : localIndices[s])
+                drawnVertices.push_back(localVertices[s][index]);
+        }
+        else
+        {
+            segment.firstIndex   = uint32_t(drawnIndices.size());
+            segment.indexCount   = uint32_t(localIndices[s].size());
+            segment.vertexOffset = int32_t(drawnVertices.size());
+            drawnIndices.insert (drawnIndices.end(),  localIndices[s].begin(),  localIndices[s].end());
+            drawnVertices.insert(drawnVertices.end(), localVertices[s].begin(), localVertices[s].end());
+            missSum += vertexCacheMissRatio(localIndices[s].data(), localIndices[s].size(), a_format.cacheSize) * double(localIndices[s].size() / 3);
+        }
+    }
+    m_vertexCount = uint32_t(drawnVertices.size());
+    m_acmr        = (m_indexType == MESH_INDEX_NONE || m_triangleCount == 0) ? 3.0 : missSum / double(m_triangleCount);
+
+    const bool split = (a_format.streams == MESH_SPLIT) && hasNormals;
+    m_streams.assign(split ? 2 : 1, vertexStream());
+    m_streams[0].stride = split ? m_positionBytes : m_positionBytes + m_normalBytes;
+    if (split)
+        m_streams[1].stride = m_normalBytes;
+    for (vertexStream& stream : m_streams)
+        stream.data.resize(size_t(stream.stride) * m_vertexCount);
+
+    for (uint32_t i = 0; i < m_vertexCount; i++)
+    {
+        const uint32_t v   = drawnVertices[i];
+        const float*   pos = &a_source.positions[size_t(v) * components];
+        uint8_t*       out = &m_streams[0].data[size_t(i) * m_streams[0].stride];
+
+        if (a_format.quantizePositions)
+        {
+            uint16_t q[4] = { 0, 0, 0, 0 };
+            for (uint32_t c = 0; c < components; c++)
+            {
+                const float unorm = std::max(0.0f, std::min(1.0f, (pos[c] - m_positionOffset[c]) / m_positionScale[c]));
+                q[c] = uint16_t(unorm * 65535.0f + 0.5f);
+            }
+            memcpy(out, q, m_positionBytes);
+        }
+        else
+            memcpy(out, pos, m_positionBytes);
+
+        if (!hasNormals)
+            continue;
+
+        const float* normal = &a_source.normals[size_t(v) * 3];
+        uint8_t*     dst    = split ? &m_streams[1].data[size_t(i) * m_streams[1].stride] : out + m_positionBytes;
+        if (a_format.quantizeNormals)
+        {
+            int8_t q[4] = { 0, 0, 0, 0 };
+            for (int c = 0; c < 3; c++)
+                q[c] = int8_t(std::floor(std::max(-1.0f, std::min(1.0f, normal[c])) * 127.0f + 0.5f));
+            memcpy(dst, q, sizeof(q));
+        }
+        else
+            memcpy(dst, normal, 3 * sizeof(float));
+    }
+
+    m_indexData.clear();
+    if (m_indexType == MESH_INDEX_16)
+    {
+        m_indexData.resize(drawnIndices.size() * sizeof(uint16_t));
+        uint16_t* out = (uint16_t*)m_indexData.data();
+        for (size_t i = 0; i < drawnIndices.size(); i++)
+            out[i] = uint16_t(drawnIndices[i]);
+    }
+    else if (m_indexType == MESH_INDEX_32)
+    {
+        m_indexData.resize(drawnIndices.size() * sizeof(uint32_t));
+        memcpy(m_indexData.data(), drawnIndices.data(), m_indexData.size());
+    }
+}
+
+void gpuMesh::createBuffers(deviceAllocator* a_pAllocator)
+{
+    for (vertexStream& stream : m_streams)
+    {
+        a_pAllocator->createBuffer(std::max<VkDeviceSize>(stream.data.size(), 4), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &stream.buffer, &stream.memory);
+    }
+    if (!m_indexData.empty())
+    {
+        a_pAllocator->createBuffer(m_indexData.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_indexBuffer, &m_indexMemory);
+    }
+}
+
+void gpuMesh::destroy(deviceAllocator* a_pAllocator)
+{
+    for (vertexStream& stream : m_streams)
+        if (stream.buffer != VK_NULL_HANDLE)
+            a_pAllocator->destroyBuffer(stream.buffer, stream.memory);
+    if (m_indexBuffer != VK_NULL_HANDLE)
+        a_pAllocator->destroyBuffer(m_indexBuffer, m_indexMemory);
+
+    m_streams.clear();
+    m_indexData.clear();
+    m_segments.clear();
+    m_indexBuffer = VK_NULL_HANDLE;
+}
+
+void gpuMesh::vertexInput(std::vector<VkVertexInputBindingDescription>* a_pBindings, std::vector<VkVertexInputAttributeDescription>* a_pAttributes) const
+{
+    a_pBindings->clear();
+    a_pAttributes->clear();
+
+    for (uint32_t i = 0; i < streamCount(); i++)
+    {
+        VkVertexInputBindingDescription binding = {};
+        binding.binding   = i;
+        binding.stride    = m_streams[i].stride;
+        binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        a_pBindings->push_back(binding);
+    }
+
+    VkVertexInputAttributeDescription position = {};
+    position.binding  = 0;
+    position.location = 0;
+    position.format   = m_positionFormat;
+    position.offset   = 0;
+    a_pAttributes->push_back(position);
+
+    if (m_normalFormat != VK_FORMAT_UNDEFINED)
+    {
+        VkVertexInputAttributeDescription normal = {};
+        normal.binding  = streamCount() > 1 ? 1 : 0;
+        normal.location = 1;
+        normal.format   = m_normalFormat;
+        normal.offset   = streamCount() > 1 ? 0 : m_positionBytes;
+        a_pAttributes->push_back(normal);
+    }
+}
+
+void gpuMesh::cmdBind(VkCommandBuffer a_cmdBuff) const
+{
+    VkBuffer     buffers[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    VkDeviceSize offsets[2] = { 0, 0 };
+    for (uint32_t i = 0; i < streamCount(); i++)
+        buffers[i] = m_streams[i].buffer;
+    vkCmdBindVertexBuffers(a_cmdBuff, 0, streamCount(), buffers, offsets);
+
+    if (m_indexType != MESH_INDEX_NONE)
+        vkCmdBindIndexBuffer(a_cmdBuff, m_indexBuffer, 0, m_indexType == MESH_INDEX_16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+}
+
+void gpuMesh::cmdDrawSegments(VkCommandBuffer a_cmdBuff, uint32_t a_first, uint32_t a_count, uint32_t a_instances, uint32_t a_firstInstance) const
+{
+    for (uint32_t i = a_first; i < a_first + a_count && i < segmentCount(); i++)
+    {
+        const meshSegment& segment = m_segments[i];
+        if (segment.indexCount == 0)
+            continue;
+        if (m_indexType == MESH_INDEX_NONE)
+            vkCmdDraw(a_cmdBuff, segment.indexCount, a_instances, segment.firstIndex, a_firstInstance);
+        else
+            vkCmdDrawIndexed(a_cmdBuff, segment.indexCount, a_instances, segment.firstIndex, segment.vertexOffset, a_firstInstance);
+    }
+}
+
+VkDeviceSize gpuMesh::bytes() const
+{
+    VkDeviceSize total = m_indexData.size();
+    for (const vertexStream& stream : m_streams)
+        total += stream.data.size();
+    return total;
+}
@@ -0,0 +1,130 @@
+#ifndef WATERAPP_GPUMESH_HPP
+#define WATERAPP_GPUMESH_HPP
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+#include "deviceAllocator.hpp"
+
+namespace app
+{
+
+enum meshIndexType { MESH_INDEX_NONE = 0, MESH_INDEX_16, MESH_INDEX_32, MESH_INDEX_AUTO };  // AUTO - 16 bit when every segment fits
+enum meshStreams   { MESH_INTERLEAVED = 0, MESH_SPLIT };                                     // one binding, or one per attribute
+
+// "none", "16", "32", "auto"
+//
+const char* meshIndexTypeName(meshIndexType a_type);
+bool        parseMeshIndexType(const char* a_name, meshIndexType* a_pType);
+
+// Reorders the triangles of an indexed triangle list for a post-transform vertex cache of a_cacheSize entries
+// (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"). Indices must be < a_vertexCount.
+//
+void optimizeVertexCache(uint32_t* a_indices, size_t a_indexCount, uint32_t a_vertexCount, uint32_t a_cacheSize);
+
+// Average cache miss ratio: vertex shader invocations per triangle with a FIFO cache of a_cacheSize entries.
+// 3 without any reuse, about 0.5 for a regular grid in an ideal order.
+//
+double vertexCacheMissRatio(const uint32_t* a_indices, size_t a_indexCount, uint32_t a_cacheSize);
+
+// What build() produces from a meshSource.
+//
+class meshFormat
+{
+public:
+    meshIndexType indexType         = MESH_INDEX_AUTO;
+    meshStreams   streams           = MESH_INTERLEAVED;
+    bool          quantizePositions = false;  // R16G16(B16A16)_UNORM within the bounds, see positionScale()
+    bool          quantizeNormals   = false;  // R8G8B8A8_SNORM
+    bool          optimizeOrder     = true;   // optimizeVertexCache() on every segment
+    uint32_t      cacheSize         = 32;
+};
+
+// Indexed triangle list on the CPU. Draws never cross a segment, so every segment is optimized and
+// addressed on its own; with 16 bit indices a segment may reference at most 65536 vertices.
+//
+class meshSource
+{
+public:
+    uint32_t              positionComponents = 3;  // 2 or 3
+    std::vector<float>    positions;
+    std::vector<float>    normals;                 // 3 per vertex, or empty
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> segments;                // first triangle of every segment; empty - a single segment
+};
+
+class meshSegment
+{
+public:
+    uint32_t firstIndex   = 0;   // or the first vertex without an index buffer
+    uint32_t indexCount   = 0;   // or the vertex count without an index buffer
+    int32_t  vertexOffset = 0;
+    uint32_t vertexCount  = 0;   // distinct vertices
+};
+
+// A mesh laid out for the vertex fetch and the post-transform cache: segments have their own compact vertex ranges
+// in first-use order, so 16 bit indices work for any mesh size and vertex fetches stay sequential.
+// Attribute locations: 0 - position, 1 - normal (if the source has normals).
+//
+class gpuMesh
+{
+public:
+    void build(const meshSource& a_source, const meshFormat& a_format);
+
+    // Creates the buffers; the data to put into them stays in vertexData() and indexData() until destroy().
+    //
+    void createBuffers(deviceAllocator* a_pAllocator);
+    void destroy(deviceAllocator* a_pAllocator);
+
+    void vertexInput(std::vector<VkVertexInputBindingDescription>* a_pBindings, std::vector<VkVertexInputAttributeDescription>* a_pAttributes) const;
+
+    void cmdBind(VkCommandBuffer a_cmdBuff) const;
+    void cmdDrawSegments(VkCommandBuffer a_cmdBuff, uint32_t a_first, uint32_t a_count, uint32_t a_instances = 1, uint32_t a_firstInstance = 0) const;
+
+    uint32_t                         streamCount() const         { return uint32_t(m_streams.size()); }
+    const std::vector<uint8_t>&      vertexData(uint32_t i) const { return m_streams[i].data; }
+    VkBuffer                         vertexBuffer(uint32_t i) const { return m_streams[i].buffer; }
+    const std::vector<uint8_t>&      indexData() const           { return m_indexData; }
+    VkBuffer                         indexBuffer() const         { return m_indexBuffer; }
+
+    uint32_t      segmentCount() const  { return uint32_t(m_segments.size()); }
+    const meshSegment& segment(uint32_t i) const { return m_segments[i]; }
+    meshIndexType indexType() const     { return m_indexType; }
+    uint32_t      vertexCount() const   { return m_vertexCount; }    // after the per-segment split (and expansion without indices)
+    uint32_t      triangleCount() const { return m_triangleCount; }
+    VkDeviceSize  bytes() const;
+    double        acmr() const          { return m_acmr; }           // vertexCacheMissRatio() of the order as drawn
+
+    // quantized positions decode as offset + scale * stored; identity for float positions
+    //
+    const float*  positionOffset() const { return m_positionOffset; }
+    const float*  positionScale() const  { return m_positionScale; }
+
+private:
+    struct vertexStream
+    {
+        std::vector<uint8_t> data;
+        uint32_t             stride = 0;
+        VkBuffer             buffer = VK_NULL_HANDLE;
+        deviceAllocation     memory;
+    };
+
+    std::vector<vertexStream> m_streams;
+    std::vector<uint8_t>      m_indexData;
+    VkBuffer                  m_indexBuffer = VK_NULL_HANDLE;
+    deviceAllocation          m_indexMemory;
+    std::vector<meshSegment>  m_segments;
+
+    meshIndexType m_indexType      = MESH_INDEX_NONE;
+    VkFormat      m_positionFormat = VK_FORMAT_R32G32B32_SFLOAT;
+    VkFormat      m_normalFormat   = VK_FORMAT_UNDEFINED;     // no normals
+    uint32_t      m_positionBytes  = 0;
+    uint32_t      m_normalBytes    = 0;
+    uint32_t      m_vertexCount    = 0;
+    uint32_t      m_triangleCount  = 0;
+    double        m_acmr           = 3.0;
+    float         m_positionOffset[3] = { 0.0f, 0.0f, 0.0f };
+    float         m_positionScale[3]  = { 1.0f, 1.0f, 1.0f };
+};
+
+}
+#endif // WATERAPP_GPUMESH_HPP
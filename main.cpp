@@ -1,13 +1,81 @@
 #include <iostream>
+#include <cstring>
 
 #include "createApp.hpp"
 
 using namespace std;
 using namespace app;
 
-int main()
+int main(int argc, char** argv)
 {
-    application app;
+    appSettings settings;
+    for (int i = 1; i < argc; i++)
+    {
+        if      (strcmp(argv[i], "--headless") == 0)                    settings.headless   = true;
+        else if (strcmp(argv[i], "--validation") == 0)                  settings.validation = true;
+        else if (strcmp(argv[i], "--no-validation") == 0)               settings.validation = false;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)      settings.frames     = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--width")  == 0 && i + 1 < argc)      settings.width      = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc)      settings.height     = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc)      settings.deviceId   = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc)        settings.gridSize   = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--cpu-solver") == 0)                  settings.cpuSolver  = true;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)     settings.solverThreads = unsigned(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--staging-mb") == 0 && i + 1 < argc)  settings.stagingMB  = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) settings.recordThreads = unsigned(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc)       settings.drawCalls  = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--dynamic-res") == 0 && i + 1 < argc) { settings.dynamicResolution = true; settings.targetFrameMs = float(atof(argv[++i])); }
+        else if (strcmp(argv[i], "--min-scale") == 0 && i + 1 < argc)   settings.minRenderScale = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--max-scale") == 0 && i + 1 < argc)   settings.maxRenderScale = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--scale-band") == 0 && i + 2 < argc)
+        {
+            settings.scaleUpThreshold   = float(atof(argv[++i]));
+            settings.scaleDownThreshold = float(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--scale-settle") == 0 && i + 1 < argc) settings.scaleSettleFrames = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc && parsePresentMode(argv[i + 1], &settings.presentMode)) i++;
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) settings.framesInFlight = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc)   settings.maxFps     = atof(argv[++i]);
+        else if (strcmp(argv[i], "--no-async-compute") == 0)            settings.asyncCompute = false;
+        else if (strcmp(argv[i], "--heightmap") == 0 && i + 1 < argc)   settings.heightmapFile = argv[++i];
+        else if (strcmp(argv[i], "--mesh-index") == 0 && i + 1 < argc && parseMeshIndexType(argv[i + 1], &settings.mesh.indexType)) i++;
+        else if (strcmp(argv[i], "--mesh-split") == 0)                  settings.mesh.streams = MESH_SPLIT;
+        else if (strcmp(argv[i], "--mesh-quantize") == 0)               settings.mesh.quantizePositions = settings.mesh.quantizeNormals = true;
+        else if (strcmp(argv[i], "--no-mesh-optimize") == 0)            settings.mesh.optimizeOrder = false;
+        else if (strcmp(argv[i], "--lod") == 0)                         settings.lod        = true;
+        else if (strcmp(argv[i], "--ocean-size") == 0 && i + 1 < argc)  settings.oceanSize  = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--lod-tile") == 0 && i + 1 < argc)    settings.lodTileSize = float(atof(argv[++i]));
+        else if (strcmp(argv[i], "--lod-levels") == 0 && i + 1 < argc)  settings.lodLevels  = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--lod-patch") == 0 && i + 1 < argc)   settings.lodPatchRes = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--gpu-cull") == 0)                    settings.gpuCulling = true;
+        else if (strcmp(argv[i], "--objects") == 0 && i + 1 < argc)     settings.objects = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--particles") == 0 && i + 1 < argc)   settings.particles = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--no-particle-sort") == 0)            settings.particleSort = false;
+        else if (strcmp(argv[i], "--wind") == 0 && i + 2 < argc)
+        {
+            settings.windSpeed     = float(atof(argv[++i]));
+            settings.windDirection = float(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--fft-ocean") == 0)                   settings.fftOcean = true;
+        else if (strcmp(argv[i], "--fft-size") == 0 && i + 1 < argc)    settings.fftSize = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--fft-cascades") == 0 && i + 1 < argc) settings.fftCascades = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--spectrum") == 0 && i + 1 < argc && parseOceanSpectrum(argv[i + 1], &settings.fftSpectrum)) i++;
+        else if (strcmp(argv[i], "--depth-prepass") == 0)               settings.depthPrepass = true;
+        else if (strcmp(argv[i], "--msaa") == 0 && i + 1 < argc)        settings.msaa = uint32_t(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--reflections") == 0 && i + 1 < argc && parseReflectionQuality(argv[i + 1], &settings.reflections)) i++;
+        else if (strcmp(argv[i], "--fixed-reflection-steps") == 0)      settings.adaptiveReflections = false;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)     settings.profileOutput = argv[++i];
+        else if (strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc) settings.pipelineCacheDir = argv[++i];
+        else if (strcmp(argv[i], "--no-pipeline-cache") == 0)           settings.pipelineCacheDir.clear();
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--headless] [--validation] [--no-validation] [--frames N] [--width W] [--height H] [--device ID] [--grid N] [--cpu-solver] [--threads N] [--staging-mb N] [--record-threads N] [--draws N] [--dynamic-res MS] [--min-scale F] [--max-scale F] [--scale-band UP DOWN] [--scale-settle N] [--present-mode immediate|mailbox|fifo|fifo_relaxed] [--frames-in-flight N] [--fps-limit N] [--no-async-compute] [--heightmap file.raw] [--mesh-index none|16|32|auto] [--mesh-split] [--mesh-quantize] [--no-mesh-optimize] [--lod] [--ocean-size F] [--lod-tile F] [--lod-levels N] [--lod-patch N] [--gpu-cull] [--objects N] [--particles N] [--no-particle-sort] [--wind SPEED DEG] [--fft-ocean] [--fft-size N] [--fft-cascades N] [--spectrum phillips|jonswap] [--depth-prepass] [--msaa N] [--reflections off|low|medium|high] [--fixed-reflection-steps] [--profile out.csv|out.json]"
+                      << " [--pipeline-cache DIR] [--no-pipeline-cache]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    application app(settings);
     try
     {
         app.run();
@@ -0,0 +1,230 @@
+#include "createApp.hpp"
+
+using namespace std;
+using namespace app;
+
+static VkPipeline createComputePipeline(VkDevice a_device, VkPipelineCache a_pipelineCache, VkPipelineLayout a_layout, const char* a_shaderFile)
+{
+    auto           shaderCode   = vk_utils::readFile(a_shaderFile);
+    VkShaderModule shaderModule = vk_utils::createShaderModule(a_device, shaderCode);
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName  = "main";
+    pipelineInfo.layout       = a_layout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateComputePipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("[oceanFft::init]: failed to create compute pipeline!");
+
+    vkDestroyShaderModule(a_device, shaderModule, NULL);
+    return pipeline;
+}
+
+// the writes of the previous pass become visible to the next one
+//
+static void cmdPassBarrier(VkCommandBuffer a_cmdBuff)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+void oceanFft::init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+                    const oceanSettings& a_settings)
+{
+    a_settings.validate();
+    m_settings = a_settings;
+
+    m_stages = 0;
+    while ((1u << m_stages) < a_settings.size)
+        m_stages++;
+
+    const VkDeviceSize planesSize = VkDeviceSize(a_settings.cascades) * 2 * a_settings.size * a_settings.size * 4 * sizeof(float);
+
+    a_pAllocator->createBuffer(initialBufferSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_initial, &m_initialMem);
+    for (int i = 0; i < 2; i++)
+    {
+        a_pAllocator->createBuffer(planesSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_planes[i], &m_planesMem[i]);
+    }
+
+    // the outputs are also written by the CPU path and read back for validation
+    //
+    a_pAllocator->createBuffer(heightBufferSize(),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_heights, &m_heightsMem);
+    a_pAllocator->createBuffer(mapBufferSize(),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_maps, &m_mapsMem);
+
+    // one layout for all three shaders: 0 - source, 1 - destination (the planes), 2 - heights, 3 - maps
+    //
+    m_setLayout = a_pLayouts->get(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    {
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = 12;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets       = 3;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes    = &poolSize;
+        VK_CHECK_RESULT(vkCreateDescriptorPool(a_device, &poolInfo, NULL, &m_descriptorPool));
+
+        VkDescriptorSetLayout layouts[3] = { m_setLayout, m_setLayout, m_setLayout };
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool     = m_descriptorPool;
+        allocInfo.descriptorSetCount = 3;
+        allocInfo.pSetLayouts        = layouts;
+        VK_CHECK_RESULT(vkAllocateDescriptorSets(a_device, &allocInfo, m_sets));
+
+        const VkBuffer buffers[3][4] = { { m_initial,   m_planes[0], m_heights, m_maps },
+                                         { m_planes[0], m_planes[1], m_heights, m_maps },
+                                         { m_planes[1], m_planes[0], m_heights, m_maps } };
+
+        VkDescriptorBufferInfo bufferInfos[3][4] = {};
+        VkWriteDescriptorSet   writes[12];
+        for (uint32_t s = 0; s < 3; s++)
+        {
+            for (uint32_t b = 0; b < 4; b++)
+            {
+                bufferInfos[s][b].buffer = buffers[s][b];
+                bufferInfos[s][b].offset = 0;
+                bufferInfos[s][b].range  = VK_WHOLE_SIZE;
+
+                VkWriteDescriptorSet& write = writes[s * 4 + b];
+                write                 = VkWriteDescriptorSet();
+                write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.dstSet          = m_sets[s];
+                write.dstBinding      = b;
+                write.descriptorCount = 1;
+                write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                write.pBufferInfo     = &bufferInfos[s][b];
+            }
+        }
+        vkUpdateDescriptorSets(a_device, 12, writes, 0, NULL);
+    }
+
+    {
+        VkPushConstantRange pushConstant = {};
+        pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstant.offset     = 0;
+        pushConstant.size       = sizeof(oceanSpectrumParams);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount         = 1;
+        pipelineLayoutInfo.pSetLayouts            = &m_setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+        VK_CHECK_RESULT(vkCreatePipelineLayout(a_device, &pipelineLayoutInfo, NULL, &m_pipelineLayout));
+
+        m_spectrumPipeline = createComputePipeline(a_device, a_pipelineCache, m_pipelineLayout, "../WaterApp/shaders/oceanSpectrum.spv");
+        m_fftPipeline      = createComputePipeline(a_device, a_pipelineCache, m_pipelineLayout, "../WaterApp/shaders/oceanFft.spv");
+        m_resolvePipeline  = createComputePipeline(a_device, a_pipelineCache, m_pipelineLayout, "../WaterApp/shaders/oceanResolve.spv");
+    }
+}
+
+void oceanFft::destroy(VkDevice a_device, deviceAllocator* a_pAllocator)
+{
+    vkDestroyPipeline           (a_device, m_spectrumPipeline, NULL);
+    vkDestroyPipeline           (a_device, m_fftPipeline, NULL);
+    vkDestroyPipeline           (a_device, m_resolvePipeline, NULL);
+    vkDestroyPipelineLayout     (a_device, m_pipelineLayout, NULL);
+    vkDestroyDescriptorPool     (a_device, m_descriptorPool, NULL);
+
+    a_pAllocator->destroyBuffer(m_initial, m_initialMem);
+    for (int i = 0; i < 2; i++)
+        a_pAllocator->destroyBuffer(m_planes[i], m_planesMem[i]);
+    a_pAllocator->destroyBuffer(m_heights, m_heightsMem);
+    a_pAllocator->destroyBuffer(m_maps, m_mapsMem);
+}
+
+void oceanFft::initialSpectrum(std::vector<float>* a_pData) const
+{
+    const size_t texels = size_t(m_settings.size) * m_settings.size;
+    a_pData->resize(texels * 4 * m_settings.cascades);
+    for (uint32_t c = 0; c < m_settings.cascades; c++)
+        app::initialSpectrum(m_settings, c, a_pData->data() + texels * 4 * c);
+}
+
+void oceanFft::cmdSpectrum(VkCommandBuffer a_cmdBuff, float a_time)
+{
+    // the previous frame's resolve still reads the planes (WAR); the outputs are the caller's render graph's business
+    //
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         0, NULL, 0, NULL, 0, NULL);
+
+    oceanSpectrumParams params = {};
+    params.size       = m_settings.size;
+    params.cascades   = m_settings.cascades;
+    params.time       = a_time;
+    params.choppiness = m_settings.choppiness;
+    params.gravity    = m_settings.gravity;
+    for (uint32_t c = 0; c < oceanSettings::MAX_CASCADES; c++)
+        params.lengths[c] = m_settings.cascadeLength(c);
+
+    const uint32_t groups = (m_settings.size + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+
+    vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_spectrumPipeline);
+    vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_sets[0], 0, NULL);
+    vkCmdPushConstants     (a_cmdBuff, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+    vkCmdDispatch          (a_cmdBuff, groups, groups, m_settings.cascades);
+
+    cmdPassBarrier(a_cmdBuff);
+}
+
+void oceanFft::cmdFft(VkCommandBuffer a_cmdBuff)
+{
+    oceanFftParams params = {};
+    params.size = m_settings.size;
+
+    const uint32_t groups = (m_settings.size / 2 + FFT_WORKGROUP_SIZE - 1) / FFT_WORKGROUP_SIZE;
+
+    vkCmdBindPipeline(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_fftPipeline);
+
+    // an even number of passes, the last one writes planes[0] again
+    //
+    uint32_t pass = 0;
+    for (uint32_t axis = 0; axis < 2; axis++)
+    {
+        for (uint32_t stage = 1; stage < m_settings.size; stage *= 2, pass++)
+        {
+            params.axis  = axis;
+            params.stage = stage;
+
+            vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_sets[1 + pass % 2], 0, NULL);
+            vkCmdPushConstants     (a_cmdBuff, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+            vkCmdDispatch          (a_cmdBuff, groups, m_settings.size, m_settings.cascades * 2);
+
+            cmdPassBarrier(a_cmdBuff);
+        }
+    }
+}
+
+void oceanFft::cmdResolve(VkCommandBuffer a_cmdBuff)
+{
+    oceanResolveParams params = {};
+    params.size                = m_settings.size;
+    params.cascades            = m_settings.cascades;
+    params.unitsPerMetre       = m_settings.unitsPerMetre;
+    params.heightUnitsPerMetre = m_settings.heightUnitsPerMetre;
+
+    const uint32_t groups = (m_settings.size + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+
+    vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_resolvePipeline);
+    vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_sets[0], 0, NULL);
+    vkCmdPushConstants     (a_cmdBuff, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+    vkCmdDispatch          (a_cmdBuff, groups, groups, 1);
+}
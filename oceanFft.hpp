@@ -0,0 +1,120 @@
+#ifndef WATERAPP_OCEANFFT_HPP
+#define WATERAPP_OCEANFFT_HPP
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+#include "descriptorCache.hpp"
+#include "deviceAllocator.hpp"
+#include "oceanSpectrum.hpp"
+
+namespace app
+{
+
+// Push constants of shaders/oceanSpectrum.comp, keep in sync with the shader. The push constant range of the
+// ocean pipelines; oceanFftParams and oceanResolveParams are pushed at the start of it.
+//
+struct oceanSpectrumParams
+{
+    uint32_t size;
+    uint32_t cascades;
+    float    time;        // seconds
+    float    choppiness;
+    float    gravity;     // m/s^2
+    float    pad[3];
+    float    lengths[4];  // oceanSettings::cascadeLength()
+};
+
+// Push constants of shaders/oceanFft.comp, keep in sync with the shader.
+//
+struct oceanFftParams
+{
+    uint32_t size;
+    uint32_t stage;   // 1, 2, ... size / 2
+    uint32_t axis;    // 0 - rows, 1 - columns
+    uint32_t pad;
+};
+
+// Push constants of shaders/oceanResolve.comp, keep in sync with the shader.
+//
+struct oceanResolveParams
+{
+    uint32_t size;
+    uint32_t cascades;
+    float    unitsPerMetre;
+    float    heightUnitsPerMetre;
+};
+
+// Open ocean from a wave spectrum (Tessendorf): every frame the initial spectrum h0 of every cascade is advanced
+// to the current time and turned into heights, horizontal displacements, slopes and displacement derivatives by
+// inverse 2D FFTs, all in compute passes before the render pass:
+//
+//   spectrum - one invocation per texel; four complex planes per cascade, each the spectrum of two real fields
+//              (the fields are real, so X + iY transforms into x + iy), stored as two vec4 planes
+//   fft      - log2(size) Stockham stages over the rows, then as many over the columns; every stage is one
+//              dispatch over all planes of all cascades, ping-ponging between two buffers through global memory
+//   resolve  - undoes the shift of the wave numbers and writes the outputs:
+//
+//   heightBuffer() - size^2 floats in the height units of the water mesh, all cascades summed on the grid of
+//                    cascade 0; what the particles and the readback see, it stands in for the simulation heights
+//   mapBuffer()    - per cascade size^2 texels of two vec4: (dx, h, dz, dDx/dx) with lengths in water units and
+//                    (slope x, slope z, dDz/dz, dDx/dz); the vertex shaders sample these for the surface, normals
+//                    and foam (the jacobian of the displacement)
+//
+// The CPU counterpart (cpuOcean) can fill the two output buffers instead, through the staging ring.
+//
+class oceanFft
+{
+public:
+    static const uint32_t WORKGROUP_SIZE     = 16;   // local_size_x/y of oceanSpectrum.comp and oceanResolve.comp
+    static const uint32_t FFT_WORKGROUP_SIZE = 64;   // local_size_x of oceanFft.comp
+
+    void init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+              const oceanSettings& a_settings);
+    void destroy(VkDevice a_device, deviceAllocator* a_pAllocator);
+
+    // h0 of every cascade (initialSpectrum()), data for the caller to upload into initialBuffer() once.
+    //
+    void initialSpectrum(std::vector<float>* a_pData) const;
+
+    // The three passes of a frame, in this order. They synchronise their own intermediate planes; the outputs are
+    // written by compute shaders in cmdResolve(), ordering them against their readers is the caller's business.
+    //
+    void cmdSpectrum(VkCommandBuffer a_cmdBuff, float a_time);
+    void cmdFft     (VkCommandBuffer a_cmdBuff);
+    void cmdResolve (VkCommandBuffer a_cmdBuff);
+
+    const oceanSettings& settings() const       { return m_settings; }
+    uint32_t             size() const           { return m_settings.size; }
+    uint32_t             cascades() const       { return m_settings.cascades; }
+    uint32_t             fftDispatches() const  { return 2 * m_stages; }
+    VkBuffer             initialBuffer() const  { return m_initial; }
+    VkBuffer             heightBuffer() const   { return m_heights; }
+    VkBuffer             mapBuffer() const      { return m_maps; }
+    VkDeviceSize         initialBufferSize() const { return VkDeviceSize(m_settings.cascades) * m_settings.size * m_settings.size * 4 * sizeof(float); }
+    VkDeviceSize         heightBufferSize() const  { return VkDeviceSize(m_settings.size) * m_settings.size * sizeof(float); }
+    VkDeviceSize         mapBufferSize() const     { return VkDeviceSize(m_settings.cascades) * m_settings.size * m_settings.size * 8 * sizeof(float); }
+
+private:
+    oceanSettings         m_settings;
+    uint32_t              m_stages = 0;   // log2(size)
+
+    VkBuffer              m_initial = VK_NULL_HANDLE;
+    deviceAllocation      m_initialMem;
+    VkBuffer              m_planes[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };   // [cascade][pair][y][x] vec4, FFT ping-pong
+    deviceAllocation      m_planesMem[2];
+    VkBuffer              m_heights = VK_NULL_HANDLE;
+    deviceAllocation      m_heightsMem;
+    VkBuffer              m_maps    = VK_NULL_HANDLE;
+    deviceAllocation      m_mapsMem;
+
+    VkDescriptorSetLayout m_setLayout      = VK_NULL_HANDLE;   // owned by the descriptorLayoutCache
+    VkDescriptorPool      m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet       m_sets[3];       // [0]: h0 -> planes[0] -> outputs, [1]: FFT planes[0] -> planes[1], [2]: planes[1] -> planes[0]
+    VkPipelineLayout      m_pipelineLayout   = VK_NULL_HANDLE;
+    VkPipeline            m_spectrumPipeline = VK_NULL_HANDLE;
+    VkPipeline            m_fftPipeline      = VK_NULL_HANDLE;
+    VkPipeline            m_resolvePipeline  = VK_NULL_HANDLE;
+};
+
+}
+#endif // WATERAPP_OCEANFFT_HPP
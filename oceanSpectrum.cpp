@@ -0,0 +1,159 @@
+#include "oceanSpectrum.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+using namespace app;
+
+static const float PI = 3.14159265358979f;
+
+void oceanSettings::validate() const
+{
+    if (size < MIN_SIZE || size > MAX_SIZE || (size & (size - 1)) != 0)
+        throw std::runtime_error("[oceanSettings::validate]: FFT size must be a power of two in [128, 1024]!");
+    if (cascades < 1 || cascades > MAX_CASCADES)
+        throw std::runtime_error("[oceanSettings::validate]: cascade count is out of range!");
+    if (length <= 0.0f || windSpeed < 0.0f)
+        throw std::runtime_error("[oceanSettings::validate]: bad patch length or wind speed!");
+}
+
+float oceanSettings::cascadeLength(uint32_t a_cascade) const
+{
+    return length / powf(float(CASCADE_RATIO), float(a_cascade));
+}
+
+static const char* g_spectrumNames[] = { "phillips", "jonswap" };
+
+const char* app::oceanSpectrumName(oceanSpectrumType a_type)
+{
+    return g_spectrumNames[a_type];
+}
+
+bool app::parseOceanSpectrum(const char* a_name, oceanSpectrumType* a_pType)
+{
+    for (int i = 0; i <= OCEAN_SPECTRUM_JONSWAP; i++)
+    {
+        if (strcmp(g_spectrumNames[i], a_name) == 0)
+        {
+            (*a_pType) = oceanSpectrumType(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+float app::spectrumDensity(const oceanSettings& a_settings, float a_kx, float a_kz)
+{
+    const float k = sqrtf(a_kx * a_kx + a_kz * a_kz);
+    if (k < 1e-6f || a_settings.windSpeed <= 0.0f)
+        return 0.0f;
+
+    const float g      = a_settings.gravity;
+    const float cosine = (a_kx * cosf(a_settings.windDirection) + a_kz * sinf(a_settings.windDirection)) / k;
+
+    if (a_settings.spectrum == OCEAN_SPECTRUM_PHILLIPS)
+    {
+        // A exp(-1/(kL)^2) / k^4 |k.w|^2 integrates to A pi L^2 / 2, so this A gives the fully developed
+        // (Pierson-Moskowitz) significant wave height 0.21 V^2/g; waves much shorter than L are damped away
+        //
+        const float A = 1.755e-3f;
+        const float L = a_settings.windSpeed * a_settings.windSpeed / g;
+        const float l = L * 0.001f;
+        return A * expf(-1.0f / (k * L * k * L)) / (k * k * k * k) * cosine * cosine * expf(-k * k * l * l);
+    }
+
+    // JONSWAP over frequencies with deep water dispersion w = sqrt(g k), spread around the wind with
+    // (2/pi) cos^2 over the downwind half plane:  Psi(k) = S(w) D(theta) (dw/dk) / k
+    //
+    if (cosine <= 0.0f)
+        return 0.0f;
+
+    const float U     = a_settings.windSpeed;
+    const float F     = a_settings.fetch;
+    const float w     = sqrtf(g * k);
+    const float alpha = 0.076f * powf(U * U / (F * g), 0.22f);
+    const float wp    = 22.0f * powf(g * g / (U * F), 1.0f / 3.0f);
+    const float sigma = (w <= wp) ? 0.07f : 0.09f;
+    const float r     = expf(-(w - wp) * (w - wp) / (2.0f * sigma * sigma * wp * wp));
+    const float S     = alpha * g * g / powf(w, 5.0f) * expf(-1.25f * powf(wp / w, 4.0f)) * powf(3.3f, r);
+    const float D     = 2.0f / PI * cosine * cosine;
+    return S * D * (g / (2.0f * w)) / k;
+}
+
+// The band of cascade a_cascade, see oceanSettings.
+//
+static bool inBand(const oceanSettings& a_settings, uint32_t a_cascade, float a_k)
+{
+    const float nyquist = PI * float(a_settings.size) / a_settings.cascadeLength(a_cascade);
+    const float low     = (a_cascade == 0) ? 0.0f : 0.5f * PI * float(a_settings.size) / a_settings.cascadeLength(a_cascade - 1);
+    const float high    = (a_cascade + 1 == a_settings.cascades) ? nyquist : 0.5f * nyquist;
+    return a_k > low && a_k <= high;
+}
+
+void app::initialSpectrum(const oceanSettings& a_settings, uint32_t a_cascade, float* a_pOut)
+{
+    const uint32_t n  = a_settings.size;
+    const float    dk = 2.0f * PI / a_settings.cascadeLength(a_cascade);
+
+    std::mt19937                    rng(a_settings.seed * 7919u + a_cascade);
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+
+    // h0(k) = (xi_r + i xi_i) / sqrt(2) * sqrt(Psi(k) dk^2 / 2): h(k, t) adds the mode of -k, so the
+    // variance of the heights is the integral of Psi
+    //
+    for (uint32_t y = 0; y < n; y++)
+    {
+        for (uint32_t x = 0; x < n; x++)
+        {
+            const float xiR = gauss(rng);
+            const float xiI = gauss(rng);
+            const float kx  = (float(x) - float(n / 2)) * dk;
+            const float kz  = (float(y) - float(n / 2)) * dk;
+
+            // the Nyquist row and column have no -k partner, leaving them out keeps the fields real
+            //
+            float amplitude = 0.0f;
+            if (x != 0 && y != 0 && inBand(a_settings, a_cascade, sqrtf(kx * kx + kz * kz)))
+                amplitude = sqrtf(spectrumDensity(a_settings, kx, kz) * dk * dk * 0.5f) * 0.70710678f;
+
+            float* texel = a_pOut + (size_t(y) * n + x) * 4;
+            texel[0] = xiR * amplitude;
+            texel[1] = xiI * amplitude;
+        }
+    }
+
+    for (uint32_t y = 0; y < n; y++)
+    {
+        for (uint32_t x = 0; x < n; x++)
+        {
+            const float* mirror = a_pOut + (size_t((n - y) % n) * n + (n - x) % n) * 4;
+            float*       texel  = a_pOut + (size_t(y) * n + x) * 4;
+            texel[2] =  mirror[0];
+            texel[3] = -mirror[1];
+        }
+    }
+}
+
+float app::significantHeight(const oceanSettings& a_settings)
+{
+    const uint32_t n = a_settings.size;
+
+    double variance = 0.0;
+    for (uint32_t c = 0; c < a_settings.cascades; c++)
+    {
+        const float dk = 2.0f * PI / a_settings.cascadeLength(c);
+        for (uint32_t y = 1; y < n; y++)
+        {
+            for (uint32_t x = 1; x < n; x++)
+            {
+                const float kx = (float(x) - float(n / 2)) * dk;
+                const float kz = (float(y) - float(n / 2)) * dk;
+                if (inBand(a_settings, c, sqrtf(kx * kx + kz * kz)))
+                    variance += double(spectrumDensity(a_settings, kx, kz)) * dk * dk;
+            }
+        }
+    }
+    return 4.0f * float(sqrt(variance));
+}
@@ -0,0 +1,65 @@
+#ifndef WATERAPP_OCEANSPECTRUM_HPP
+#define WATERAPP_OCEANSPECTRUM_HPP
+#include <cstdint>
+
+namespace app
+{
+
+enum oceanSpectrumType
+{
+    OCEAN_SPECTRUM_PHILLIPS = 0,   // Tessendorf's Phillips spectrum, scaled to the Pierson-Moskowitz wave height
+    OCEAN_SPECTRUM_JONSWAP,        // fetch limited, sharper peak; waves only travel downwind
+};
+
+// What the GPU (oceanFft) and CPU (cpuOcean) evaluation of the ocean share. Lengths in metres, time in seconds.
+//
+// Cascade c is a periodic patch of length / CASCADE_RATIO^c metres sampled with size x size texels. Every
+// cascade keeps only its band of wave numbers: from where the previous cascade stops (half its Nyquist
+// frequency) up to half its own, the last one up to its Nyquist frequency, so summing them counts no wave twice.
+//
+class oceanSettings
+{
+public:
+    static const uint32_t MIN_SIZE      = 128;
+    static const uint32_t MAX_SIZE      = 1024;
+    static const uint32_t MAX_CASCADES  = 4;
+    static const uint32_t CASCADE_RATIO = 4;
+
+    uint32_t size          = 256;      // FFT size, power of two
+    uint32_t cascades      = 1;
+    oceanSpectrumType spectrum = OCEAN_SPECTRUM_PHILLIPS;
+    float    length        = 256.0f;   // of cascade 0
+    float    windSpeed     = 6.0f;     // m/s, 10 m above the surface
+    float    windDirection = 0.0f;     // radians from x towards z
+    float    fetch         = 100000.0f; // JONSWAP only
+    float    choppiness    = 1.0f;     // horizontal displacement scale, lambda in Tessendorf's notes
+    float    gravity       = 9.81f;
+    uint32_t seed          = 1;
+    float    unitsPerMetre       = 1.0f;   // water space units per metre, scales the displacement maps
+    float    heightUnitsPerMetre = 1.0f;   // height units per metre, scales the heights buffer
+
+    void  validate() const;   // throws for sizes and cascade counts out of range
+    float cascadeLength(uint32_t a_cascade) const;
+};
+
+// Variance density of the wave heights over wave number vectors, m^4: integrated over all (kx, kz) it gives
+// the height variance. Band limits are not applied here.
+//
+float spectrumDensity(const oceanSettings& a_settings, float a_kx, float a_kz);
+
+// h0(k) and conj(h0(-k)) of cascade a_cascade, 4 floats per texel, size^2 texels, row y / column x holding the
+// wave number k = 2 pi (x - size/2, y - size/2) / cascadeLength. Deterministic for a given seed.
+//
+void initialSpectrum(const oceanSettings& a_settings, uint32_t a_cascade, float* a_pOut);
+
+// 4 sqrt(height variance) of all cascades together, metres
+//
+float significantHeight(const oceanSettings& a_settings);
+
+// "phillips", "jonswap"
+//
+const char* oceanSpectrumName(oceanSpectrumType a_type);
+bool        parseOceanSpectrum(const char* a_name, oceanSpectrumType* a_pType);
+
+}
+#endif // WATERAPP_OCEANSPECTRUM_HPP
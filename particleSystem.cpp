@@ -0,0 +1,400 @@
+#include "createApp.hpp"
+
+using namespace std;
+using namespace app;
+
+static VkPipeline createComputePipeline(VkDevice a_device, VkPipelineCache a_pipelineCache, VkPipelineLayout a_layout, const char* a_shaderFile)
+{
+    auto           shaderCode   = vk_utils::readFile(a_shaderFile);
+    VkShaderModule shaderModule = vk_utils::createShaderModule(a_device, shaderCode);
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName  = "main";
+    pipelineInfo.layout       = a_layout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateComputePipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("[particleSystem::init]: failed to create compute pipeline!");
+
+    vkDestroyShaderModule(a_device, shaderModule, NULL);
+    return pipeline;
+}
+
+void particleSystem::init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+                          uint32_t a_capacity, bool a_sort, const std::vector<VkBuffer>& a_heights)
+{
+    // the bitonic sort works on powers of two, whole workgroups of keys
+    //
+    const uint32_t capacity = a_capacity < MAX_PARTICLES ? a_capacity : MAX_PARTICLES;
+    m_capacity = SORT_BLOCK;
+    while (m_capacity < capacity)
+        m_capacity *= 2;
+    m_sort = a_sort;
+
+    a_pAllocator->createBuffer(VkDeviceSize(m_capacity) * sizeof(particle), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_particles, &m_particlesMem);
+    a_pAllocator->createBuffer(VkDeviceSize(m_capacity) * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_freeList, &m_freeListMem);
+    a_pAllocator->createBuffer(VkDeviceSize(m_capacity) * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_drawList, &m_drawListMem);
+    a_pAllocator->createBuffer(STATE_WORDS * sizeof(uint32_t),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_state, &m_stateMem);
+
+    // heights, particles, free list, draw list, state; the vertex shader reads the particles through the draw list
+    //
+    {
+        m_setLayout = a_pLayouts->get(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT);
+
+        const uint32_t setCount = uint32_t(a_heights.size());
+
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = 5 * setCount;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets       = setCount;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes    = &poolSize;
+        VK_CHECK_RESULT(vkCreateDescriptorPool(a_device, &poolInfo, NULL, &m_descriptorPool));
+
+        std::vector<VkDescriptorSetLayout> layouts(setCount, m_setLayout);
+        m_sets.resize(setCount);
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool     = m_descriptorPool;
+        allocInfo.descriptorSetCount = setCount;
+        allocInfo.pSetLayouts        = layouts.data();
+        VK_CHECK_RESULT(vkAllocateDescriptorSets(a_device, &allocInfo, m_sets.data()));
+
+        std::vector<VkDescriptorBufferInfo> bufferInfos(5 * setCount);
+        std::vector<VkWriteDescriptorSet>   writes(5 * setCount);
+        for (uint32_t s = 0; s < setCount; s++)
+        {
+            const VkBuffer buffers[5] = { a_heights[s], m_particles, m_freeList, m_drawList, m_state };
+            for (uint32_t i = 0; i < 5; i++)
+            {
+                VkDescriptorBufferInfo& info = bufferInfos[s * 5 + i];
+                info.buffer = buffers[i];
+                info.offset = 0;
+                info.range  = VK_WHOLE_SIZE;
+
+                VkWriteDescriptorSet& write = writes[s * 5 + i];
+                write                 = VkWriteDescriptorSet();
+                write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.dstSet          = m_sets[s];
+                write.dstBinding      = i;
+                write.descriptorCount = 1;
+                write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                write.pBufferInfo     = &info;
+            }
+        }
+        vkUpdateDescriptorSets(a_device, uint32_t(writes.size()), writes.data(), 0, NULL);
+    }
+
+    {
+        VkPushConstantRange pushConstant = {};
+        pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstant.offset     = 0;
+        pushConstant.size       = sizeof(particleParams);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount         = 1;
+        pipelineLayoutInfo.pSetLayouts            = &m_setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+        VK_CHECK_RESULT(vkCreatePipelineLayout(a_device, &pipelineLayoutInfo, NULL, &m_computeLayout));
+
+        pushConstant.size = sizeof(particleSortParams);
+        VK_CHECK_RESULT(vkCreatePipelineLayout(a_device, &pipelineLayoutInfo, NULL, &m_sortLayout));
+
+        m_emitPipeline   = createComputePipeline(a_device, a_pipelineCache, m_computeLayout, "../WaterApp/shaders/particleEmit.spv");
+        m_updatePipeline = createComputePipeline(a_device, a_pipelineCache, m_computeLayout, "../WaterApp/shaders/particleUpdate.spv");
+        if (m_sort)
+            m_sortPipeline = createComputePipeline(a_device, a_pipelineCache, m_sortLayout, "../WaterApp/shaders/particleSort.spv");
+    }
+}
+
+void particleSystem::destroy(VkDevice a_device, deviceAllocator* a_pAllocator)
+{
+    if (m_particles == VK_NULL_HANDLE)
+        return;
+
+    destroyPipeline(a_device);
+    if (m_sortPipeline != VK_NULL_HANDLE)
+        vkDestroyPipeline(a_device, m_sortPipeline, NULL);
+    vkDestroyPipeline           (a_device, m_updatePipeline, NULL);
+    vkDestroyPipeline           (a_device, m_emitPipeline, NULL);
+    vkDestroyPipelineLayout     (a_device, m_sortLayout, NULL);
+    vkDestroyPipelineLayout     (a_device, m_computeLayout, NULL);
+    vkDestroyDescriptorPool     (a_device, m_descriptorPool, NULL);
+
+    a_pAllocator->destroyBuffer(m_particles, m_particlesMem);
+    a_pAllocator->destroyBuffer(m_freeList, m_freeListMem);
+    a_pAllocator->destroyBuffer(m_drawList, m_drawListMem);
+    a_pAllocator->destroyBuffer(m_state, m_stateMem);
+
+    m_particles    = VK_NULL_HANDLE;
+    m_sortPipeline = VK_NULL_HANDLE;
+    m_sets.clear();
+    m_capacity = 0;
+}
+
+void particleSystem::initialState(std::vector<particle>* a_pParticles, std::vector<uint32_t>* a_pFreeList, std::vector<uint32_t>* a_pState) const
+{
+    a_pParticles->assign(m_capacity, particle());
+
+    // a stack, slot 0 on top
+    //
+    a_pFreeList->resize(m_capacity);
+    for (uint32_t i = 0; i < m_capacity; i++)
+        (*a_pFreeList)[i] = m_capacity - 1 - i;
+
+    a_pState->assign(STATE_WORDS, 0);
+    (*a_pState)[STATE_FREE]         = m_capacity;
+    (*a_pState)[STATE_SORT_SIZE]    = SORT_BLOCK;
+    (*a_pState)[STATE_DISPATCH + 0] = 1;
+    (*a_pState)[STATE_DISPATCH + 1] = 1;
+    (*a_pState)[STATE_DISPATCH + 2] = 1;
+    (*a_pState)[STATE_DRAW + 0]     = 6;  // a quad per instance
+}
+
+void particleSystem::createPipeline(VkDevice a_device, VkPipelineCache a_pipelineCache, VkRenderPass a_renderPass, VkSampleCountFlagBits a_samples)
+{
+    auto vertShaderCode = vk_utils::readFile("../WaterApp/shaders/particleVert.spv");
+    auto fragShaderCode = vk_utils::readFile("../WaterApp/shaders/particleFrag.spv");
+
+    VkShaderModule vertShaderModule = vk_utils::createShaderModule(a_device, vertShaderCode);
+    VkShaderModule fragShaderModule = vk_utils::createShaderModule(a_device, fragShaderCode);
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+    shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName  = "main";
+    shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName  = "main";
+
+    // no vertex buffers: the quad corners come from gl_VertexIndex, the particle from the draw list
+    //
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+    inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount  = 1;
+
+    VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates    = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer = {};
+    rasterizer.sType       = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth   = 1.0f;
+    rasterizer.cullMode    = VK_CULL_MODE_NONE;
+    rasterizer.frontFace   = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = a_samples;
+
+    // hidden behind the water and the objects, but translucent: tested against the depth, never written
+    //
+    VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+    depthStencil.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable  = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_FALSE;
+    depthStencil.depthCompareOp   = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+    // the fragment shader writes premultiplied alpha: "over" for the sorted list, additive when unsorted
+    //
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+    colorBlendAttachment.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable         = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstColorBlendFactor = m_sort ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments    = &colorBlendAttachment;
+
+    VkPushConstantRange pushConstant = {};
+    pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstant.size       = sizeof(particleParams);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 1;
+    pipelineLayoutInfo.pSetLayouts            = &m_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(a_device, &pipelineLayoutInfo, NULL, &m_drawLayout));
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = 2;
+    pipelineInfo.pStages             = shaderStages;
+    pipelineInfo.pVertexInputState   = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState  = &depthStencil;
+    pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.pDynamicState       = &dynamicState;
+    pipelineInfo.layout              = m_drawLayout;
+    pipelineInfo.renderPass          = a_renderPass;
+    pipelineInfo.subpass             = 0;
+
+    if (vkCreateGraphicsPipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, &m_drawPipeline) != VK_SUCCESS)
+        throw std::runtime_error("[particleSystem::createPipeline]: failed to create graphics pipeline!");
+
+    vkDestroyShaderModule(a_device, fragShaderModule, NULL);
+    vkDestroyShaderModule(a_device, vertShaderModule, NULL);
+}
+
+void particleSystem::destroyPipeline(VkDevice a_device)
+{
+    if (m_drawPipeline != VK_NULL_HANDLE)
+        vkDestroyPipeline(a_device, m_drawPipeline, NULL);
+    if (m_drawLayout != VK_NULL_HANDLE)
+        vkDestroyPipelineLayout(a_device, m_drawLayout, NULL);
+
+    m_drawPipeline = VK_NULL_HANDLE;
+    m_drawLayout   = VK_NULL_HANDLE;
+}
+
+void particleSystem::cmdUpdate(VkCommandBuffer a_cmdBuff, uint32_t a_frame, const particleParams& a_params)
+{
+    // live count and emitted count restart, the sort keys beyond the live ones must sort last
+    //
+    vkCmdFillBuffer(a_cmdBuff, m_state, STATE_ALIVE * sizeof(uint32_t), 3 * sizeof(uint32_t), 0);
+    if (m_sort)
+        vkCmdFillBuffer(a_cmdBuff, m_drawList, 0, VK_WHOLE_SIZE, 0xFFFFFFFF);
+
+    VkMemoryBarrier cleared = {};
+    cleared.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cleared.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    cleared.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cleared, 0, NULL, 0, NULL);
+
+    VkMemoryBarrier written = {};
+    written.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    written.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    written.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    particleParams params = a_params;
+    params.capacity = m_capacity;
+    params.mode     = 0;
+
+    const uint32_t emitGroups = (a_params.gridSize + EMIT_GROUP_SIZE - 1) / EMIT_GROUP_SIZE;
+
+    vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_computeLayout, 0, 1, &m_sets[a_frame], 0, NULL);
+    vkCmdPushConstants     (a_cmdBuff, m_computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+
+    vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_emitPipeline);
+    vkCmdDispatch          (a_cmdBuff, emitGroups, emitGroups, 1);
+    vkCmdPipelineBarrier   (a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &written, 0, NULL, 0, NULL);
+
+    vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_updatePipeline);
+    vkCmdDispatch          (a_cmdBuff, m_capacity / WORKGROUP_SIZE, 1, 1);
+    vkCmdPipelineBarrier   (a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &written, 0, NULL, 0, NULL);
+
+    params.mode = 1;
+    vkCmdPushConstants     (a_cmdBuff, m_computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, offsetof(particleParams, mode), sizeof(params.mode), &params.mode);
+    vkCmdDispatch          (a_cmdBuff, 1, 1, 1);
+
+    if (!m_sort)
+        return;
+
+    // the sort dispatches are sized by the arguments just written
+    //
+    VkMemoryBarrier arguments = {};
+    arguments.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    arguments.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    arguments.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &arguments, 0, NULL, 0, NULL);
+
+    // ascending keys are back to front. Blocks of SORT_BLOCK keys are sorted in shared memory first; every longer
+    // merge runs its long compare distances globally and finishes the last SORT_BLOCK / 2 of them in shared memory
+    //
+    vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_sortPipeline);
+    vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_sortLayout, 0, 1, &m_sets[a_frame], 0, NULL);
+
+    cmdSortDispatch(a_cmdBuff, a_frame, SORT_BLOCK, SORT_BLOCK / 2, PARTICLE_SORT_LOCAL);
+    for (uint32_t k = SORT_BLOCK * 2; k <= m_capacity; k *= 2)
+    {
+        for (uint32_t j = k / 2; j >= SORT_BLOCK; j /= 2)
+            cmdSortDispatch(a_cmdBuff, a_frame, k, j, PARTICLE_SORT_GLOBAL);
+        cmdSortDispatch(a_cmdBuff, a_frame, k, SORT_BLOCK / 2, PARTICLE_SORT_LOCAL_MERGE);
+    }
+}
+
+void particleSystem::cmdSortDispatch(VkCommandBuffer a_cmdBuff, uint32_t a_frame, uint32_t a_k, uint32_t a_j, particleSortMode a_mode)
+{
+    // sized by the args pass to the live count rounded up to a power of two; the shader skips merges longer than that
+    //
+    particleSortParams params = {};
+    params.k    = a_k;
+    params.j    = a_j;
+    params.mode = uint32_t(a_mode);
+
+    vkCmdPushConstants    (a_cmdBuff, m_sortLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+    vkCmdDispatchIndirect (a_cmdBuff, m_state, STATE_DISPATCH * sizeof(uint32_t));
+
+    VkMemoryBarrier written = {};
+    written.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    written.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    written.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &written, 0, NULL, 0, NULL);
+}
+
+uint32_t particleSystem::sortDispatches() const
+{
+    if (!m_sort)
+        return 0;
+
+    uint32_t count = 1;
+    for (uint32_t k = SORT_BLOCK * 2; k <= m_capacity; k *= 2)
+    {
+        for (uint32_t j = k / 2; j >= SORT_BLOCK; j /= 2)
+            count++;
+        count++;
+    }
+    return count;
+}
+
+void particleSystem::cmdDraw(VkCommandBuffer a_cmdBuff, uint32_t a_frame, const particleParams& a_params) const
+{
+    particleParams params = a_params;
+    params.capacity = m_capacity;
+
+    vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawPipeline);
+    vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawLayout, 0, 1, &m_sets[a_frame], 0, NULL);
+    vkCmdPushConstants     (a_cmdBuff, m_drawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(params), &params);
+    vkCmdDrawIndirect      (a_cmdBuff, m_state, STATE_DRAW * sizeof(uint32_t), 1, sizeof(VkDrawIndirectCommand));
+}
@@ -0,0 +1,150 @@
+#ifndef WATERAPP_PARTICLESYSTEM_HPP
+#define WATERAPP_PARTICLESYSTEM_HPP
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+#include "descriptorCache.hpp"
+#include "deviceAllocator.hpp"
+
+namespace app
+{
+
+// One particle of shaders/particle*.comp and particle.vert, keep in sync with the shaders.
+//
+struct particle
+{
+    float position[3];   // water space
+    float life;          // seconds left, <= 0 - the slot is on the free list
+    float velocity[3];   // water space units per second
+    float size;          // water space units
+};
+
+// Push constants of shaders/particleEmit.comp, particleUpdate.comp and particle.vert; keep in sync with the shaders.
+//
+struct particleParams
+{
+    float    toClip[16];     // water space to clip space, column major; also gives the sort depth
+    uint32_t gridSize;
+    float    cellsPerUnit;   // heightfield cells per water space unit
+    float    heightToWorld;  // water space units per height unit
+    float    wrap;           // positions repeat with this period, 0 - no wrapping
+    float    dt;             // seconds
+    uint32_t seed;           // changes every frame
+    float    threshold;      // surface slope (height per cell) above which a crest breaks
+    float    rate;           // chance per breaking cell and frame to emit a particle
+    uint32_t mode;           // particleUpdate.comp: 0 - integrate, 1 - write the sort and draw arguments
+    uint32_t capacity;
+    float    gravity;        // water space units per second squared
+    float    origin[2];      // water space x, z where the emit pass puts heightfield cell (0, 0); a multiple of the heightfield period
+    float    pad;
+};
+
+// Push constants of shaders/particleSort.comp, keep in sync with the shader.
+//
+struct particleSortParams
+{
+    uint32_t k;      // size of the bitonic sequences being merged
+    uint32_t j;      // compare distance
+    uint32_t mode;   // PARTICLE_SORT_*
+    uint32_t pad;
+};
+
+enum particleSortMode { PARTICLE_SORT_LOCAL = 0, PARTICLE_SORT_LOCAL_MERGE, PARTICLE_SORT_GLOBAL };
+
+// Spray and foam, emitted where the heightfield is steep enough to break.
+//
+// Everything stays on the GPU. The particles live in one storage buffer; dead slots are kept on a free list
+// (index stack + counter). Every frame three compute passes run before the render pass:
+//
+//   emit   - one invocation per heightfield cell; breaking cells pop slots off the free list (consume)
+//   update - one invocation per slot; integrates the live ones, pushes the ones that died (append) and
+//            appends the survivors with their depth to the draw list
+//   args   - one invocation; rounds the live count up to the sort size and writes the indirect arguments
+//
+// The draw list is then sorted back to front with a bitonic sort: sequences up to SORT_BLOCK keys are sorted and
+// merged in shared memory, only the longer compare distances go through global memory, so a million particles
+// take ~66 dispatches. All sort dispatches are indirect and sized by the live count rounded up to a power of two;
+// stages longer than that find nothing to swap. The draw is one vkCmdDrawIndirect of a quad per live particle,
+// blended with premultiplied alpha.
+//
+// Without sorting (a software ICD, or --no-particle-sort) the draw list keeps the append order and the particles
+// are blended additively, which does not depend on the order.
+//
+class particleSystem
+{
+public:
+    static const uint32_t WORKGROUP_SIZE  = 256;    // local_size_x of particleUpdate.comp
+    static const uint32_t EMIT_GROUP_SIZE = 16;     // local_size_x/y of particleEmit.comp
+    static const uint32_t SORT_BLOCK      = 1024;   // keys per particleSort.comp workgroup, two per invocation
+    static const uint32_t MAX_PARTICLES   = 1u << 22;
+
+    float threshold = 0.05f;
+    float rate      = 0.05f;
+
+    // Rounds a_capacity up to a power of two of at least SORT_BLOCK. a_heights: the buffer the water is drawn
+    // from in every frame in flight.
+    //
+    void init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+              uint32_t a_capacity, bool a_sort, const std::vector<VkBuffer>& a_heights);
+    void destroy(VkDevice a_device, deviceAllocator* a_pAllocator);
+
+    // Initial state: every particle dead, every slot on the free list; data for the caller to upload once.
+    //
+    void initialState(std::vector<particle>* a_pParticles, std::vector<uint32_t>* a_pFreeList, std::vector<uint32_t>* a_pState) const;
+
+    // The pipeline depends on the render pass, so it is recreated with it.
+    //
+    void createPipeline (VkDevice a_device, VkPipelineCache a_pipelineCache, VkRenderPass a_renderPass, VkSampleCountFlagBits a_samples);
+    void destroyPipeline(VkDevice a_device);
+
+    // Outside of the render pass, after the heights of the frame are written. Reads the heights and writes all four
+    // buffers below at the transfer, compute and (sort dispatches) draw indirect stages; ordering them against the
+    // heights' writers and the draws of this and the previous frame is the caller's business.
+    //
+    void cmdUpdate(VkCommandBuffer a_cmdBuff, uint32_t a_frame, const particleParams& a_params);
+
+    // Inside the render pass, after everything opaque.
+    //
+    void cmdDraw(VkCommandBuffer a_cmdBuff, uint32_t a_frame, const particleParams& a_params) const;
+
+    uint32_t capacity() const       { return m_capacity; }
+    bool     sorted() const         { return m_sort; }
+    uint32_t sortDispatches() const;
+    VkBuffer particleBuffer() const { return m_particles; }
+    VkBuffer freeListBuffer() const { return m_freeList; }
+    VkBuffer drawListBuffer() const { return m_drawList; }
+    VkBuffer stateBuffer() const    { return m_state; }   // free count, live count, sort size, emitted, sort dispatch, draw arguments
+
+    // uint32 offsets into stateBuffer()
+    //
+    enum stateField { STATE_FREE = 0, STATE_ALIVE, STATE_SORT_SIZE, STATE_EMITTED, STATE_DISPATCH, STATE_DRAW = 8, STATE_WORDS = 12 };
+
+private:
+    void cmdSortDispatch(VkCommandBuffer a_cmdBuff, uint32_t a_frame, uint32_t a_k, uint32_t a_j, particleSortMode a_mode);
+
+    uint32_t              m_capacity = 0;
+    bool                  m_sort     = true;
+
+    VkBuffer              m_particles = VK_NULL_HANDLE;
+    deviceAllocation      m_particlesMem;
+    VkBuffer              m_freeList  = VK_NULL_HANDLE;
+    deviceAllocation      m_freeListMem;
+    VkBuffer              m_drawList  = VK_NULL_HANDLE;   // (key, index) pairs
+    deviceAllocation      m_drawListMem;
+    VkBuffer              m_state     = VK_NULL_HANDLE;
+    deviceAllocation      m_stateMem;
+
+    VkDescriptorSetLayout m_setLayout      = VK_NULL_HANDLE;   // owned by the descriptorLayoutCache
+    VkDescriptorPool      m_descriptorPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_sets;               // per frame in flight, they differ in the heights only
+    VkPipelineLayout      m_computeLayout  = VK_NULL_HANDLE;
+    VkPipelineLayout      m_sortLayout     = VK_NULL_HANDLE;
+    VkPipeline            m_emitPipeline   = VK_NULL_HANDLE;
+    VkPipeline            m_updatePipeline = VK_NULL_HANDLE;
+    VkPipeline            m_sortPipeline   = VK_NULL_HANDLE;
+    VkPipelineLayout      m_drawLayout     = VK_NULL_HANDLE;
+    VkPipeline            m_drawPipeline   = VK_NULL_HANDLE;
+};
+
+}
+#endif // WATERAPP_PARTICLESYSTEM_HPP
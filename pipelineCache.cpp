@@ -0,0 +1,186 @@
+#include "createApp.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+
+using namespace std;
+using namespace app;
+
+static const uint32_t PIPELINE_CACHE_MAGIC   = 0x46435057; // "WPCF"
+static const uint32_t PIPELINE_CACHE_VERSION = 1;
+
+struct pipelineCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t payloadSize;
+    uint64_t payloadHash;
+};
+
+// the header vkGetPipelineCacheData() writes at the beginning of its data (VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+//
+struct vulkanPipelineCacheHeader
+{
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+static uint64_t hashFNV1a(const char* a_data, size_t a_size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < a_size; i++)
+    {
+        hash ^= uint8_t(a_data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+VkPipelineCache pipelineCacheFile::load(VkPhysicalDevice a_physDevice, VkDevice a_device, const std::string& a_directory)
+{
+    vkGetPhysicalDeviceProperties(a_physDevice, &m_props);
+
+    std::stringstream name;
+    name << a_directory << "/pipeline_cache_" << std::hex << m_props.vendorID << "_" << m_props.deviceID << "_" << m_props.driverVersion << "_";
+    for (int i = 0; i < VK_UUID_SIZE; i++)
+        name << std::setw(2) << std::setfill('0') << uint32_t(m_props.pipelineCacheUUID[i]);
+    name << ".bin";
+    m_fileName = name.str();
+
+    std::vector<char> payload;
+    std::ifstream     in(m_fileName.c_str(), std::ios::binary);
+    if (in.is_open())
+    {
+        std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::string       reason;
+        if (!validate(file, &payload, &reason))
+        {
+            std::cout << "[pipelineCacheFile]: ignoring " << m_fileName << ": " << reason << std::endl;
+            payload.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo = {};
+    cacheInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = payload.size();
+    cacheInfo.pInitialData    = payload.empty() ? nullptr : payload.data();
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    if (vkCreatePipelineCache(a_device, &cacheInfo, NULL, &cache) != VK_SUCCESS)
+    {
+        // drivers may still reject data that passed our checks; an empty cache is always valid
+        //
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData    = nullptr;
+        payload.clear();
+        VK_CHECK_RESULT(vkCreatePipelineCache(a_device, &cacheInfo, NULL, &cache));
+    }
+
+    m_warm = !payload.empty();
+    return cache;
+}
+
+bool pipelineCacheFile::validate(const std::vector<char>& a_file, std::vector<char>* a_pPayload, std::string* a_pReason) const
+{
+    pipelineCacheFileHeader header;
+    if (a_file.size() < sizeof(header))
+    {
+        (*a_pReason) = "file is too small";
+        return false;
+    }
+    memcpy(&header, a_file.data(), sizeof(header));
+
+    if (header.magic != PIPELINE_CACHE_MAGIC || header.version != PIPELINE_CACHE_VERSION)
+    {
+        (*a_pReason) = "unknown file format";
+        return false;
+    }
+    if (header.vendorID != m_props.vendorID || header.deviceID != m_props.deviceID || header.driverVersion != m_props.driverVersion ||
+        memcmp(header.pipelineCacheUUID, m_props.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        (*a_pReason) = "device or driver version mismatch";
+        return false;
+    }
+    if (header.payloadSize != a_file.size() - sizeof(header))
+    {
+        (*a_pReason) = "truncated payload";
+        return false;
+    }
+
+    const char* payload = a_file.data() + sizeof(header);
+    if (hashFNV1a(payload, size_t(header.payloadSize)) != header.payloadHash)
+    {
+        (*a_pReason) = "checksum mismatch";
+        return false;
+    }
+
+    vulkanPipelineCacheHeader vkHeader;
+    if (header.payloadSize < sizeof(vkHeader))
+    {
+        (*a_pReason) = "payload has no Vulkan pipeline cache header";
+        return false;
+    }
+    memcpy(&vkHeader, payload, sizeof(vkHeader));
+
+    if (vkHeader.headerSize < sizeof(vkHeader) || vkHeader.headerSize > header.payloadSize ||
+        vkHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        vkHeader.vendorID != m_props.vendorID || vkHeader.deviceID != m_props.deviceID ||
+        memcmp(vkHeader.pipelineCacheUUID, m_props.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        (*a_pReason) = "Vulkan pipeline cache header mismatch";
+        return false;
+    }
+
+    a_pPayload->assign(payload, payload + header.payloadSize);
+    return true;
+}
+
+void pipelineCacheFile::save(VkDevice a_device, VkPipelineCache a_cache)
+{
+    if (a_cache == VK_NULL_HANDLE || m_fileName.empty()) return;
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(a_device, a_cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) return;
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(a_device, a_cache, &dataSize, data.data()) != VK_SUCCESS) return;
+
+    pipelineCacheFileHeader header = {};
+    header.magic         = PIPELINE_CACHE_MAGIC;
+    header.version       = PIPELINE_CACHE_VERSION;
+    header.vendorID      = m_props.vendorID;
+    header.deviceID      = m_props.deviceID;
+    header.driverVersion = m_props.driverVersion;
+    memcpy(header.pipelineCacheUUID, m_props.pipelineCacheUUID, VK_UUID_SIZE);
+    header.payloadSize   = dataSize;
+    header.payloadHash   = hashFNV1a(data.data(), dataSize);
+
+    // write next to the target and rename, so a crash or a concurrent instance never leaves a half-written cache
+    //
+    const std::string tmpName = m_fileName + ".tmp";
+    {
+        std::ofstream out(tmpName.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            std::cout << "[pipelineCacheFile]: can't write " << tmpName << std::endl;
+            return;
+        }
+        out.write((const char*)&header, sizeof(header));
+        out.write(data.data(), std::streamsize(dataSize));
+    }
+
+    if (std::rename(tmpName.c_str(), m_fileName.c_str()) != 0)
+    {
+        std::cout << "[pipelineCacheFile]: can't rename " << tmpName << " to " << m_fileName << std::endl;
+        std::remove(tmpName.c_str());
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef WATERAPP_PIPELINECACHE_HPP
+#define WATERAPP_PIPELINECACHE_HPP
+#include <vulkan/vulkan.hpp>
+#include <string>
+
+namespace app
+{
+
+// On-disk VkPipelineCache. One file per device + driver version:
+//   <directory>/pipeline_cache_<vendor>_<device>_<driverVersion>_<pipelineCacheUUID>.bin
+// The file starts with our own header (magic, ids, payload size and checksum); the payload is
+// vkGetPipelineCacheData() output, whose own header is validated as well before it is handed to the driver.
+// Any mismatch or corruption falls back to an empty cache, so a stale file only costs a cold start.
+//
+class pipelineCacheFile
+{
+public:
+    VkPipelineCache load(VkPhysicalDevice a_physDevice, VkDevice a_device, const std::string& a_directory);
+    void            save(VkDevice a_device, VkPipelineCache a_cache);
+
+    bool               warm() const     { return m_warm; }     // true if data was loaded from disk
+    const std::string& fileName() const { return m_fileName; }
+
+private:
+    bool validate(const std::vector<char>& a_file, std::vector<char>* a_pPayload, std::string* a_pReason) const;
+
+    VkPhysicalDeviceProperties m_props;
+    std::string                m_fileName;
+    bool                       m_warm = false;
+};
+
+}
+#endif // WATERAPP_PIPELINECACHE_HPP
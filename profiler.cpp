@@ -0,0 +1,329 @@
+#include "createApp.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+
+using namespace std;
+using namespace app;
+
+const char* app::cpuScopeName(cpuScope a_scope)
+{
+    static const char* names[CPU_SCOPE_COUNT] = { "fence_wait", "simulation", "acquire", "record", "submit", "present", "lod" };
+    return names[a_scope];
+}
+
+const char* app::gpuScopeName(gpuScope a_scope)
+{
+    static const char* names[GPU_SCOPE_COUNT] = { "gpu_frame", "upload", "simulation", "render_pass", "upscale", "cull", "particles",
+                                                  "ocean_spectrum", "ocean_fft", "ocean_resolve", "reflections" };
+    return names[a_scope];
+}
+
+const char* app::pipelineStatisticName(pipelineStatistic a_stat)
+{
+    static const char* names[STAT_COUNT] = { "ia_vertices", "ia_primitives", "vs_invocations", "clipping_invocations",
+                                             "clipping_primitives", "fs_invocations", "cs_invocations" };
+    return names[a_stat];
+}
+
+frameRecord::frameRecord()
+{
+    for (int i = 0; i < CPU_SCOPE_COUNT; i++) { cpu[i] = 0.0; cpuOffset[i] = 0.0; }
+    for (int i = 0; i < GPU_SCOPE_COUNT; i++) { gpu[i] = 0.0; gpuOffset[i] = 0.0; }
+    for (int i = 0; i < STAT_COUNT; i++)        stats[i] = 0;
+}
+
+void frameProfiler::init(VkPhysicalDevice a_physDevice, VkDevice a_device, uint32_t a_queueFamilyIndex,
+                         uint32_t a_slotCount, bool a_pipelineStatistics)
+{
+    m_start       = std::chrono::steady_clock::now();
+    m_slotCount   = a_slotCount;
+    m_frameNumber = 0;
+    m_latestGpuFrame = 0;
+    m_slotFrame.assign(a_slotCount, 0);
+    m_ring.assign(RING_SIZE, frameRecord());
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(a_physDevice, &props);
+    m_timestampPeriod = double(props.limits.timestampPeriod);
+
+    uint32_t queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(a_physDevice, &queueFamilyCount, NULL);
+    vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(a_physDevice, &queueFamilyCount, queueFamilies.data());
+
+    const uint32_t validBits = queueFamilies[a_queueFamilyIndex].timestampValidBits;
+    m_timestampMask = (validBits >= 64) ? ~0ULL : ((1ULL << validBits) - 1ULL);
+
+    // timestampValidBits == 0 means the queue can't write timestamps at all; keep CPU timing only
+    //
+    if (validBits != 0)
+    {
+        VkQueryPoolCreateInfo poolInfo = {};
+        poolInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = a_slotCount * GPU_SCOPE_COUNT * 2;
+        VK_CHECK_RESULT(vkCreateQueryPool(a_device, &poolInfo, NULL, &m_timestampPool));
+    }
+    else
+        std::cout << "[frameProfiler]: queue family " << a_queueFamilyIndex << " has no timestamp support, GPU timing disabled" << std::endl;
+
+    if (a_pipelineStatistics)
+    {
+        VkQueryPoolCreateInfo poolInfo = {};
+        poolInfo.sType              = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount         = a_slotCount;
+        m_statisticsFlags           = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT    |
+                                      VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT  |
+                                      VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT  |
+                                      VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT       |
+                                      VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT        |
+                                      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT|
+                                      VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+        poolInfo.pipelineStatistics = m_statisticsFlags;
+        VK_CHECK_RESULT(vkCreateQueryPool(a_device, &poolInfo, NULL, &m_statisticsPool));
+    }
+}
+
+void frameProfiler::destroy(VkDevice a_device)
+{
+    if (m_timestampPool  != VK_NULL_HANDLE) vkDestroyQueryPool(a_device, m_timestampPool, NULL);
+    if (m_statisticsPool != VK_NULL_HANDLE) vkDestroyQueryPool(a_device, m_statisticsPool, NULL);
+    m_timestampPool   = VK_NULL_HANDLE;
+    m_statisticsPool  = VK_NULL_HANDLE;
+    m_statisticsFlags = 0;
+}
+
+void frameProfiler::cmdResetSlot(VkCommandBuffer a_cmdBuff, uint32_t a_slot, uint32_t a_skipScopes)
+{
+    if (m_timestampPool != VK_NULL_HANDLE && a_skipScopes == 0)
+        vkCmdResetQueryPool(a_cmdBuff, m_timestampPool, a_slot * GPU_SCOPE_COUNT * 2, GPU_SCOPE_COUNT * 2);
+    else if (m_timestampPool != VK_NULL_HANDLE)
+    {
+        for (int scope = 0; scope < GPU_SCOPE_COUNT; scope++)
+            if (!(a_skipScopes & (1u << scope))) cmdResetScope(a_cmdBuff, a_slot, gpuScope(scope));
+    }
+    if (m_statisticsPool != VK_NULL_HANDLE)
+        vkCmdResetQueryPool(a_cmdBuff, m_statisticsPool, a_slot, 1);
+}
+
+void frameProfiler::cmdResetScope(VkCommandBuffer a_cmdBuff, uint32_t a_slot, gpuScope a_scope)
+{
+    if (m_timestampPool != VK_NULL_HANDLE)
+        vkCmdResetQueryPool(a_cmdBuff, m_timestampPool, (a_slot * GPU_SCOPE_COUNT + a_scope) * 2, 2);
+}
+
+void frameProfiler::cmdBeginScope(VkCommandBuffer a_cmdBuff, uint32_t a_slot, gpuScope a_scope)
+{
+    if (m_timestampPool != VK_NULL_HANDLE)
+        vkCmdWriteTimestamp(a_cmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool, (a_slot * GPU_SCOPE_COUNT + a_scope) * 2 + 0);
+}
+
+void frameProfiler::cmdEndScope(VkCommandBuffer a_cmdBuff, uint32_t a_slot, gpuScope a_scope)
+{
+    if (m_timestampPool != VK_NULL_HANDLE)
+        vkCmdWriteTimestamp(a_cmdBuff, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, (a_slot * GPU_SCOPE_COUNT + a_scope) * 2 + 1);
+}
+
+void frameProfiler::cmdBeginStatistics(VkCommandBuffer a_cmdBuff, uint32_t a_slot)
+{
+    if (m_statisticsPool != VK_NULL_HANDLE)
+        vkCmdBeginQuery(a_cmdBuff, m_statisticsPool, a_slot, 0);
+}
+
+void frameProfiler::cmdEndStatistics(VkCommandBuffer a_cmdBuff, uint32_t a_slot)
+{
+    if (m_statisticsPool != VK_NULL_HANDLE)
+        vkCmdEndQuery(a_cmdBuff, m_statisticsPool, a_slot);
+}
+
+double frameProfiler::nowMs() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void frameProfiler::beginFrame()
+{
+    m_frameNumber++;
+    frameRecord& rec = current();
+    rec             = frameRecord();
+    rec.frameNumber = m_frameNumber;
+    rec.cpuStart    = nowMs();
+}
+
+void frameProfiler::setFrameSlot(VkDevice a_device, uint32_t a_slot)
+{
+    if (m_slotFrame[a_slot] != 0)
+        collectSlot(a_device, a_slot);
+    m_slotFrame[a_slot] = m_frameNumber;
+}
+
+void frameProfiler::endFrame()
+{
+    frameRecord& rec = current();
+    rec.cpuFrame = nowMs() - rec.cpuStart;
+}
+
+void frameProfiler::addCpuTime(cpuScope a_scope, double a_startMs, double a_durationMs)
+{
+    frameRecord& rec = current();
+    rec.cpuOffset[a_scope] = a_startMs - rec.cpuStart;
+    rec.cpu[a_scope]      += a_durationMs;
+}
+
+void frameProfiler::collectAll(VkDevice a_device)
+{
+    for (uint32_t slot = 0; slot < m_slotCount; slot++)
+    {
+        if (m_slotFrame[slot] != 0)
+            collectSlot(a_device, slot);
+        m_slotFrame[slot] = 0;
+    }
+}
+
+void frameProfiler::collectSlot(VkDevice a_device, uint32_t a_slot)
+{
+    const uint64_t frameNumber = m_slotFrame[a_slot];
+    if (m_frameNumber - frameNumber >= RING_SIZE) return; // the record was already overwritten
+
+    frameRecord& rec = m_ring[frameNumber % RING_SIZE];
+
+    if (m_timestampPool != VK_NULL_HANDLE)
+    {
+        uint64_t data[GPU_SCOPE_COUNT * 2][2]; // value, availability
+        vkGetQueryPoolResults(a_device, m_timestampPool, a_slot * GPU_SCOPE_COUNT * 2, GPU_SCOPE_COUNT * 2,
+                              sizeof(data), data, sizeof(data[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        const bool   frameAvailable = data[GPU_SCOPE_FRAME * 2][1] != 0;
+        const uint64_t frameBegin   = data[GPU_SCOPE_FRAME * 2][0] & m_timestampMask;
+
+        for (int scope = 0; scope < GPU_SCOPE_COUNT && frameAvailable; scope++)
+        {
+            if (data[scope * 2][1] == 0 || data[scope * 2 + 1][1] == 0) continue;
+
+            const uint64_t begin = data[scope * 2 + 0][0] & m_timestampMask;
+            const uint64_t end   = data[scope * 2 + 1][0] & m_timestampMask;
+
+            // scopes written by another queue (async compute) may start before the frame scope
+            //
+            uint64_t offset = (begin - frameBegin) & m_timestampMask;
+            double   signedOffset = double(offset);
+            if (offset > (m_timestampMask >> 1))
+                signedOffset = -double((frameBegin - begin) & m_timestampMask);
+
+            rec.gpu[scope]       = double((end - begin) & m_timestampMask) * m_timestampPeriod * 1e-6;
+            rec.gpuOffset[scope] = signedOffset * m_timestampPeriod * 1e-6;
+            rec.gpuValid        |= (1u << scope);
+        }
+
+        if ((rec.gpuValid & (1u << GPU_SCOPE_FRAME)) && frameNumber > m_latestGpuFrame)
+            m_latestGpuFrame = frameNumber;
+    }
+
+    if (m_statisticsPool != VK_NULL_HANDLE)
+    {
+        uint64_t data[STAT_COUNT + 1];
+        vkGetQueryPoolResults(a_device, m_statisticsPool, a_slot, 1, sizeof(data), data, sizeof(data),
+                              VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (data[STAT_COUNT] != 0)
+        {
+            for (int i = 0; i < STAT_COUNT; i++) rec.stats[i] = data[i];
+            rec.statsValid = true;
+        }
+    }
+}
+
+static void forEachRecord(const std::vector<frameRecord>& a_ring, uint64_t a_frameNumber, std::function<void(const frameRecord&)> a_func)
+{
+    const uint64_t count = std::min<uint64_t>(a_frameNumber, frameProfiler::RING_SIZE);
+    for (uint64_t frame = a_frameNumber - count + 1; frame <= a_frameNumber; frame++)
+        a_func(a_ring[frame % frameProfiler::RING_SIZE]);
+}
+
+std::vector<frameRecord> frameProfiler::records() const
+{
+    std::vector<frameRecord> result;
+    forEachRecord(m_ring, m_frameNumber, [&result](const frameRecord& rec) { result.push_back(rec); });
+    return result;
+}
+
+void frameProfiler::dumpCSV(const std::string& a_fileName) const
+{
+    std::ofstream out(a_fileName.c_str());
+    if (!out.is_open())
+    {
+        std::cout << "[frameProfiler]: can't open " << a_fileName << std::endl;
+        return;
+    }
+
+    out << "frame,cpu_frame_ms,upload_bytes,render_scale,input_latency_ms";
+    for (int i = 0; i < CPU_SCOPE_COUNT; i++) out << ",cpu_" << cpuScopeName(cpuScope(i)) << "_ms";
+    for (int i = 0; i < GPU_SCOPE_COUNT; i++) out << "," << gpuScopeName(gpuScope(i)) << "_ms";
+    for (int i = 0; i < STAT_COUNT; i++)      out << "," << pipelineStatisticName(pipelineStatistic(i));
+    out << ",overdraw,barriers,transient_mb,memory_block_mb,memory_used_mb";
+    out << "\n" << std::fixed << std::setprecision(4);
+
+    forEachRecord(m_ring, m_frameNumber, [&out](const frameRecord& rec)
+    {
+        out << rec.frameNumber << "," << rec.cpuFrame << "," << rec.uploadBytes << "," << rec.renderScale << ",";
+        if (rec.inputLatency >= 0.0) out << rec.inputLatency;
+        for (int i = 0; i < CPU_SCOPE_COUNT; i++) out << "," << rec.cpu[i];
+        for (int i = 0; i < GPU_SCOPE_COUNT; i++)
+        {
+            if (rec.gpuValid & (1u << i)) out << "," << rec.gpu[i];
+            else                          out << ",";
+        }
+        for (int i = 0; i < STAT_COUNT; i++)
+        {
+            if (rec.statsValid) out << "," << rec.stats[i];
+            else                out << ",";
+        }
+        if (rec.statsValid && rec.renderPixels > 0) out << "," << double(rec.stats[STAT_FS_INVOCATIONS]) / double(rec.renderPixels);
+        else                                        out << ",";
+        out << "," << rec.barriers << "," << double(rec.transientBytes) / (1024.0 * 1024.0);
+        out << "," << double(rec.memoryBlockBytes) / (1024.0 * 1024.0) << "," << double(rec.memoryUsedBytes) / (1024.0 * 1024.0);
+        out << "\n";
+    });
+}
+
+void frameProfiler::dumpChromeTrace(const std::string& a_fileName) const
+{
+    std::ofstream out(a_fileName.c_str());
+    if (!out.is_open())
+    {
+        std::cout << "[frameProfiler]: can't open " << a_fileName << std::endl;
+        return;
+    }
+
+    // chrome://tracing and Perfetto take microseconds. GPU clocks are not calibrated against the CPU one,
+    // so the GPU track of every frame is anchored at the moment its command buffer was submitted.
+    //
+    out << "{\"traceEvents\":[\n" << std::fixed << std::setprecision(3);
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    forEachRecord(m_ring, m_frameNumber, [&out](const frameRecord& rec)
+    {
+        out << ",\n{\"name\":\"frame " << rec.frameNumber << "\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << rec.cpuStart * 1000.0
+            << ",\"dur\":" << rec.cpuFrame * 1000.0 << "}";
+        for (int i = 0; i < CPU_SCOPE_COUNT; i++)
+        {
+            out << ",\n{\"name\":\"" << cpuScopeName(cpuScope(i)) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+                << (rec.cpuStart + rec.cpuOffset[i]) * 1000.0 << ",\"dur\":" << rec.cpu[i] * 1000.0 << "}";
+        }
+
+        const double gpuAnchor = rec.cpuStart + rec.cpuOffset[CPU_SCOPE_SUBMIT];
+        for (int i = 0; i < GPU_SCOPE_COUNT; i++)
+        {
+            if ((rec.gpuValid & (1u << i)) == 0) continue;
+            out << ",\n{\"name\":\"" << gpuScopeName(gpuScope(i)) << "\",\"ph\":\"X\",\"pid\":2,\"tid\":" << i << ",\"ts\":"
+                << (gpuAnchor + rec.gpuOffset[i]) * 1000.0 << ",\"dur\":" << rec.gpu[i] * 1000.0
+                << ",\"args\":{\"frame\":" << rec.frameNumber << "}}";
+        }
+    });
+
+    out << "\n]}\n";
+}
@@ -0,0 +1,170 @@
+#ifndef WATERAPP_PROFILER_HPP
+#define WATERAPP_PROFILER_HPP
+#include <vulkan/vulkan.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace app
+{
+
+// CPU side parts of drawFrame() measured with scopedTimer.
+//
+enum cpuScope
+{
+    CPU_SCOPE_FENCE_WAIT = 0,
+    CPU_SCOPE_SIMULATION,     // CPU solver step (or cpuOcean evaluation) + upload, --cpu-solver only
+    CPU_SCOPE_ACQUIRE,
+    CPU_SCOPE_RECORD,
+    CPU_SCOPE_SUBMIT,
+    CPU_SCOPE_PRESENT,
+    CPU_SCOPE_LOD,            // CDLOD patch selection + instance upload, only the view with --gpu-cull; --lod only
+    CPU_SCOPE_COUNT
+};
+
+// GPU side parts of a frame, every scope is a pair of timestamps written into the frame command buffer.
+//
+enum gpuScope
+{
+    GPU_SCOPE_FRAME = 0,
+    GPU_SCOPE_UPLOAD,
+    GPU_SCOPE_SIMULATION,
+    GPU_SCOPE_RENDER_PASS,
+    GPU_SCOPE_UPSCALE,        // blit of the scene target to the output image, scaled rendering only
+    GPU_SCOPE_CULL,           // gpuCuller pass, --gpu-cull only
+    GPU_SCOPE_PARTICLES,      // particleSystem emit, update and sort, --particles only
+    GPU_SCOPE_OCEAN_SPECTRUM, // oceanFft passes inside GPU_SCOPE_SIMULATION, --fft-ocean only
+    GPU_SCOPE_OCEAN_FFT,
+    GPU_SCOPE_OCEAN_RESOLVE,
+    GPU_SCOPE_REFLECTIONS,    // waterReflections scene copy and Hi-Z build, between the opaque and the water pass
+    GPU_SCOPE_COUNT
+};
+
+// Counters of VK_QUERY_TYPE_PIPELINE_STATISTICS, in the order the driver writes them (bit order).
+//
+enum pipelineStatistic
+{
+    STAT_IA_VERTICES = 0,
+    STAT_IA_PRIMITIVES,
+    STAT_VS_INVOCATIONS,
+    STAT_CLIPPING_INVOCATIONS,
+    STAT_CLIPPING_PRIMITIVES,
+    STAT_FS_INVOCATIONS,
+    STAT_CS_INVOCATIONS,
+    STAT_COUNT
+};
+
+const char* cpuScopeName(cpuScope a_scope);
+const char* gpuScopeName(gpuScope a_scope);
+const char* pipelineStatisticName(pipelineStatistic a_stat);
+
+class frameRecord
+{
+public:
+    uint64_t frameNumber = 0;
+    double   cpuStart    = 0.0;                  // ms since the profiler was created
+    double   cpuFrame    = 0.0;                  // ms, whole drawFrame()
+    double   cpu[CPU_SCOPE_COUNT];               // ms
+    double   cpuOffset[CPU_SCOPE_COUNT];         // ms, scope start relative to cpuStart
+    uint32_t gpuValid    = 0;                    // bit per gpuScope; GPU results arrive framesInFlight frames later
+    double   gpu[GPU_SCOPE_COUNT];               // ms
+    double   gpuOffset[GPU_SCOPE_COUNT];         // ms, scope start relative to GPU_SCOPE_FRAME start
+    bool     statsValid  = false;
+    uint64_t stats[STAT_COUNT];
+    uint64_t uploadBytes = 0;                    // staging ring copies recorded for the frame
+    float    renderScale = 1.0f;                 // scene resolution relative to the output image
+    uint64_t renderPixels = 0;                   // of the scene, the overdraw is stats[STAT_FS_INVOCATIONS] / renderPixels
+    double   inputLatency = -1.0;                // ms, input sampling to present, -1 - not presented
+    uint32_t barriers    = 0;                    // vkCmdPipelineBarrier calls the render graph recorded
+    uint64_t transientBytes = 0;                 // memory behind the render graph's transient resources
+    uint64_t memoryBlockBytes = 0;               // device memory the allocator held once the frame was recorded
+    uint64_t memoryUsedBytes  = 0;               // likewise, handed out of it
+
+    frameRecord();
+};
+
+class frameProfiler
+{
+public:
+    static const uint32_t RING_SIZE = 4096;
+
+    void init(VkPhysicalDevice a_physDevice, VkDevice a_device, uint32_t a_queueFamilyIndex,
+              uint32_t a_slotCount, bool a_pipelineStatistics);
+    void destroy(VkDevice a_device);
+
+    // Command buffer side. A slot is a set of queries owned by one frame in flight;
+    // it is reset by the frame command buffer itself.
+    //
+    // a_skipScopes: bit per gpuScope whose queries are reset elsewhere with cmdResetScope(), e.g. by the command buffer
+    // of another queue that writes them
+    //
+    void cmdResetSlot       (VkCommandBuffer a_cmdBuff, uint32_t a_slot, uint32_t a_skipScopes = 0);
+    void cmdResetScope      (VkCommandBuffer a_cmdBuff, uint32_t a_slot, gpuScope a_scope);
+    void cmdBeginScope      (VkCommandBuffer a_cmdBuff, uint32_t a_slot, gpuScope a_scope);
+    void cmdEndScope        (VkCommandBuffer a_cmdBuff, uint32_t a_slot, gpuScope a_scope);
+    void cmdBeginStatistics (VkCommandBuffer a_cmdBuff, uint32_t a_slot);
+    void cmdEndStatistics   (VkCommandBuffer a_cmdBuff, uint32_t a_slot);
+
+    // CPU side. beginFrame() must be called after the fence of the frame that used a_slot last time was waited,
+    // so its queries are read back without stalling: nothing is fetched with VK_QUERY_RESULT_WAIT_BIT.
+    //
+    void          beginFrame();
+    void          setFrameSlot(VkDevice a_device, uint32_t a_slot);
+    void          endFrame();
+    void          collectAll(VkDevice a_device);  // after vkDeviceWaitIdle, fetches whatever is still pending
+    void          addCpuTime(cpuScope a_scope, double a_startMs, double a_durationMs);
+    void          setUploadBytes(uint64_t a_bytes) { current().uploadBytes = a_bytes; }
+    void          setRenderScale(float a_scale)    { current().renderScale = a_scale; }
+    void          setRenderPixels(uint64_t a_pixels) { current().renderPixels = a_pixels; }
+    void          setInputLatency(double a_ms)     { current().inputLatency = a_ms; }
+    void          setGraphStats(uint32_t a_barriers, uint64_t a_transientBytes) { current().barriers = a_barriers; current().transientBytes = a_transientBytes; }
+    void          setMemoryStats(uint64_t a_blockBytes, uint64_t a_usedBytes) { current().memoryBlockBytes = a_blockBytes; current().memoryUsedBytes = a_usedBytes; }
+    double        nowMs() const;
+
+    std::vector<frameRecord> records() const;       // the ring contents, oldest frame first
+    uint64_t           frameCount() const { return m_frameNumber; }
+
+    // the newest frame whose GPU_SCOPE_FRAME time was read back, 0 - none yet; for feedback controllers
+    //
+    uint64_t           latestGpuFrame() const { return m_latestGpuFrame; }
+    const frameRecord& latestGpuRecord() const { return m_ring[m_latestGpuFrame % RING_SIZE]; }
+    bool               gpuTimingSupported() const { return m_timestampPool != VK_NULL_HANDLE; }
+    bool               statisticsSupported() const { return m_statisticsPool != VK_NULL_HANDLE; }
+    VkQueryPipelineStatisticFlags statisticsFlags() const { return m_statisticsFlags; } // for secondary command buffer inheritance
+
+    void dumpCSV(const std::string& a_fileName) const;
+    void dumpChromeTrace(const std::string& a_fileName) const;
+
+private:
+    void collectSlot(VkDevice a_device, uint32_t a_slot);
+    frameRecord& current() { return m_ring[m_frameNumber % RING_SIZE]; }
+
+    VkQueryPool                m_timestampPool  = VK_NULL_HANDLE;
+    VkQueryPool                m_statisticsPool = VK_NULL_HANDLE;
+    VkQueryPipelineStatisticFlags m_statisticsFlags = 0;
+    uint32_t                   m_slotCount      = 0;
+    double                     m_timestampPeriod = 1.0; // ns per tick
+    uint64_t                   m_timestampMask  = ~0ULL;
+    uint64_t                   m_frameNumber    = 0;
+    uint64_t                   m_latestGpuFrame = 0;
+    std::vector<uint64_t>      m_slotFrame;             // frame number that last used a slot, 0 - unused (frames count from 1)
+    std::vector<frameRecord>   m_ring;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Adds the time spent in its own lifetime to the current frame record.
+//
+class scopedTimer
+{
+public:
+    scopedTimer(frameProfiler* a_pProfiler, cpuScope a_scope) : m_pProfiler(a_pProfiler), m_scope(a_scope), m_start(a_pProfiler->nowMs()) {}
+    ~scopedTimer() { m_pProfiler->addCpuTime(m_scope, m_start, m_pProfiler->nowMs() - m_start); }
+
+private:
+    frameProfiler* m_pProfiler;
+    cpuScope       m_scope;
+    double         m_start;
+};
+
+}
+#endif // WATERAPP_PROFILER_HPP
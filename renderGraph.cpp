@@ -0,0 +1,730 @@
+#include "createApp.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+using namespace app;
+
+static const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                          VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+static VkImageAspectFlags formatAspect(VkFormat a_format)
+{
+    switch (a_format)
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:          return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:  return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:                            return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+static VkImageMemoryBarrier imageBarrier(VkImage a_image, VkImageAspectFlags a_aspect, VkAccessFlags a_srcAccess, VkAccessFlags a_dstAccess,
+                                         VkImageLayout a_oldLayout, VkImageLayout a_newLayout)
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask                   = a_srcAccess;
+    barrier.dstAccessMask                   = a_dstAccess;
+    barrier.oldLayout                       = a_oldLayout;
+    barrier.newLayout                       = a_newLayout;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = a_image;
+    barrier.subresourceRange.aspectMask     = a_aspect;
+    barrier.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.layerCount     = VK_REMAINING_ARRAY_LAYERS;
+    return barrier;
+}
+
+bool renderGraph::isWrite(VkAccessFlags a_access)
+{
+    return (a_access & WRITE_ACCESS) != 0;
+}
+
+void renderGraph::init(deviceAllocator* a_pAllocator, VkDevice a_device, uint32_t a_framesInFlight)
+{
+    m_pAllocator     = a_pAllocator;
+    m_device         = a_device;
+    m_framesInFlight = std::max(1u, a_framesInFlight);
+    m_frame          = 0;
+}
+
+void renderGraph::destroy()
+{
+    releaseRetired(true);
+    destroySet(m_physical, m_blocks);
+    m_signature.clear();
+    m_bufferStates.clear();
+    m_imageStates.clear();
+    reset();
+}
+
+void renderGraph::reset()
+{
+    m_resources.clear();
+    m_passes.clear();
+    m_barriers.clear();
+    m_compiled = false;
+    m_stats    = renderGraphStats();
+}
+
+void renderGraph::invalidate()
+{
+    m_imageStates.clear();
+}
+
+uint32_t renderGraph::importBuffer(const char* a_name, VkBuffer a_buffer)
+{
+    for (uint32_t i = 0; i < m_resources.size(); i++)
+    {
+        if (m_resources[i].kind == GRAPH_IMPORTED_BUFFER && m_resources[i].buffer == a_buffer)
+            return i;
+    }
+
+    resource res;
+    res.name   = a_name;
+    res.kind   = GRAPH_IMPORTED_BUFFER;
+    res.buffer = a_buffer;
+    res.needed = true;   // the next frame uses it
+
+    auto known = m_bufferStates.find(a_buffer);
+    if (known != m_bufferStates.end())
+        res.state = known->second;
+
+    m_resources.push_back(res);
+    return uint32_t(m_resources.size() - 1);
+}
+
+uint32_t renderGraph::importImage(const char* a_name, VkImage a_image, VkImageAspectFlags a_aspect, VkImageLayout a_layout)
+{
+    for (uint32_t i = 0; i < m_resources.size(); i++)
+    {
+        if (m_resources[i].kind == GRAPH_IMPORTED_IMAGE && m_resources[i].image == a_image)
+            return i;
+    }
+
+    resource res;
+    res.name         = a_name;
+    res.kind         = GRAPH_IMPORTED_IMAGE;
+    res.image        = a_image;
+    res.aspect       = a_aspect;
+    res.needed       = true;
+    res.state.layout = a_layout;
+
+    auto known = m_imageStates.find(a_image);
+    if (known != m_imageStates.end())
+        res.state = known->second;
+
+    m_resources.push_back(res);
+    return uint32_t(m_resources.size() - 1);
+}
+
+uint32_t renderGraph::acquireImage(const char* a_name, VkImage a_image, VkImageAspectFlags a_aspect, VkPipelineStageFlags a_stages)
+{
+    const uint32_t id = importImage(a_name, a_image, a_aspect);
+
+    resourceState& state = m_resources[id].state;
+    state             = resourceState();
+    state.writeStages = a_stages;
+    state.acquired    = true;
+    return id;
+}
+
+uint32_t renderGraph::createImage(const char* a_name, const VkImageCreateInfo& a_info)
+{
+    resource res;
+    res.name      = a_name;
+    res.kind      = GRAPH_TRANSIENT_IMAGE;
+    res.imageInfo = a_info;
+    res.imageInfo.pNext                 = nullptr;
+    res.imageInfo.sharingMode           = VK_SHARING_MODE_EXCLUSIVE;
+    res.imageInfo.queueFamilyIndexCount = 0;
+    res.imageInfo.pQueueFamilyIndices   = nullptr;
+    res.imageInfo.initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED;
+    res.aspect    = formatAspect(a_info.format);
+    m_resources.push_back(res);
+    return uint32_t(m_resources.size() - 1);
+}
+
+uint32_t renderGraph::createBuffer(const char* a_name, VkDeviceSize a_size, VkBufferUsageFlags a_usage)
+{
+    resource res;
+    res.name  = a_name;
+    res.kind  = GRAPH_TRANSIENT_BUFFER;
+    res.size  = a_size;
+    res.usage = a_usage;
+    m_resources.push_back(res);
+    return uint32_t(m_resources.size() - 1);
+}
+
+uint32_t renderGraph::addPass(const char* a_name, std::function<void(VkCommandBuffer)> a_record)
+{
+    pass p;
+    p.name   = a_name;
+    p.record = a_record;
+    m_passes.push_back(p);
+    return uint32_t(m_passes.size() - 1);
+}
+
+void renderGraph::use(uint32_t a_pass, uint32_t a_resource, const graphAccess& a_access)
+{
+    if (a_pass >= m_passes.size() || a_resource >= m_resources.size())
+        throw std::runtime_error("[renderGraph::use]: no such pass or resource!");
+
+    // several uses of one resource in a pass are one use with all their stages and accesses
+    //
+    for (passUse& u : m_passes[a_pass].uses)
+    {
+        if (u.resource != a_resource)
+            continue;
+        if (u.access.layout != a_access.layout)
+            throw std::runtime_error("[renderGraph::use]: a pass uses an image in two layouts!");
+        u.access.stages |= a_access.stages;
+        u.access.access |= a_access.access;
+        if (a_access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+            u.access.finalLayout = a_access.finalLayout;
+        return;
+    }
+
+    passUse u;
+    u.resource = a_resource;
+    u.access   = a_access;
+    m_passes[a_pass].uses.push_back(u);
+}
+
+void renderGraph::output(uint32_t a_resource, const graphAccess& a_access)
+{
+    if (a_resource >= m_resources.size())
+        throw std::runtime_error("[renderGraph::output]: no such resource!");
+    m_resources[a_resource].hasOutput    = true;
+    m_resources[a_resource].outputAccess = a_access;
+    m_resources[a_resource].needed       = true;
+}
+
+void renderGraph::cull()
+{
+    // backwards: a pass is needed if something needed is written by it; what it reads becomes needed then.
+    // Passes that write nothing are kept, the graph can't tell what else they do
+    //
+    for (size_t i = m_passes.size(); i-- > 0; )
+    {
+        pass& p = m_passes[i];
+
+        bool writes = false, live = false;
+        for (const passUse& u : p.uses)
+        {
+            if (!isWrite(u.access.access) && u.access.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+                continue;
+            writes = true;
+            live   = live || m_resources[u.resource].needed;
+        }
+        p.live = live || !writes;
+
+        if (!p.live)
+        {
+            m_stats.culledPasses++;
+            continue;
+        }
+        for (const passUse& u : p.uses)
+        {
+            if (!isWrite(u.access.access) || (u.access.access & ~WRITE_ACCESS) != 0)
+                m_resources[u.resource].needed = true;
+        }
+    }
+}
+
+std::string renderGraph::transientSignature() const
+{
+    std::ostringstream out;
+    for (const resource& res : m_resources)
+    {
+        if (res.kind == GRAPH_TRANSIENT_BUFFER && res.firstPass != NO_RESOURCE)
+            out << "b" << res.size << "," << res.usage << "," << res.firstPass << "," << res.lastPass << ";";
+        else if (res.kind == GRAPH_TRANSIENT_IMAGE && res.firstPass != NO_RESOURCE)
+        {
+            const VkImageCreateInfo& info = res.imageInfo;
+            out << "i" << info.flags << "," << info.imageType << "," << info.format << "," << info.extent.width << "x" << info.extent.height
+                << "x" << info.extent.depth << "," << info.mipLevels << "," << info.arrayLayers << "," << info.samples << ","
+                << info.tiling << "," << info.usage << "," << res.firstPass << "," << res.lastPass << ";";
+        }
+    }
+    return out.str();
+}
+
+void renderGraph::createPhysical(physicalResource* a_pPhysical, const resource& a_desc)
+{
+    a_pPhysical->isImage   = (a_desc.kind == GRAPH_TRANSIENT_IMAGE);
+    a_pPhysical->firstPass = a_desc.firstPass;
+    a_pPhysical->lastPass  = a_desc.lastPass;
+
+    if (a_pPhysical->isImage)
+    {
+        if (vkCreateImage(m_device, &a_desc.imageInfo, NULL, &a_pPhysical->image) != VK_SUCCESS)
+            throw std::runtime_error("[renderGraph::createPhysical]: failed to create image!");
+    }
+    else
+    {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size        = a_desc.size;
+        bufferInfo.usage       = a_desc.usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (vkCreateBuffer(m_device, &bufferInfo, NULL, &a_pPhysical->buffer) != VK_SUCCESS)
+            throw std::runtime_error("[renderGraph::createPhysical]: failed to create buffer!");
+    }
+}
+
+void renderGraph::allocateTransients()
+{
+    // lifetimes over the live passes
+    //
+    for (uint32_t i = 0; i < m_passes.size(); i++)
+    {
+        if (!m_passes[i].live)
+            continue;
+        for (const passUse& u : m_passes[i].uses)
+        {
+            resource& res = m_resources[u.resource];
+            if (res.firstPass == NO_RESOURCE)
+                res.firstPass = i;
+            res.lastPass = i;
+        }
+    }
+
+    std::vector<uint32_t> transients;
+    for (uint32_t i = 0; i < m_resources.size(); i++)
+    {
+        const resource& res = m_resources[i];
+        if ((res.kind == GRAPH_TRANSIENT_BUFFER || res.kind == GRAPH_TRANSIENT_IMAGE) && res.firstPass != NO_RESOURCE)
+            transients.push_back(i);
+    }
+
+    const std::string signature = transientSignature();
+    if (signature != m_signature)
+    {
+        if (!m_physical.empty())
+        {
+            retiredSet retired;
+            retired.physical.swap(m_physical);
+            retired.blocks.swap(m_blocks);
+            retired.lastFrame = m_frame;
+            m_retired.push_back(retired);
+        }
+        m_signature = signature;
+
+        m_physical.resize(transients.size());
+        std::vector<VkMemoryRequirements> requirements(transients.size());
+        for (size_t i = 0; i < transients.size(); i++)
+        {
+            createPhysical(&m_physical[i], m_resources[transients[i]]);
+            if (m_physical[i].isImage)
+                vkGetImageMemoryRequirements(m_device, m_physical[i].image, &requirements[i]);
+            else
+                vkGetBufferMemoryRequirements(m_device, m_physical[i].buffer, &requirements[i]);
+            m_physical[i].size = requirements[i].size;
+        }
+
+        // largest first, each at the lowest offset of a compatible block that no resource alive at the same
+        // time overlaps; buffers and images never share a block, like in deviceAllocator
+        //
+        std::vector<size_t> order(transients.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&requirements](size_t a, size_t b) { return requirements[a].size > requirements[b].size; });
+
+        std::vector<std::vector<size_t> > placed;   // per block
+        for (size_t i : order)
+        {
+            physicalResource&           phys = m_physical[i];
+            const VkMemoryRequirements& req  = requirements[i];
+
+            bool done = false;
+            for (uint32_t b = 0; b < m_blocks.size() && !done; b++)
+            {
+                memoryBlockDesc& block = m_blocks[b];
+                if (block.isImage != phys.isImage || (block.memoryTypeBits & req.memoryTypeBits) == 0)
+                    continue;
+
+                std::vector<VkDeviceSize> candidates(1, 0);
+                for (size_t other : placed[b])
+                    candidates.push_back(m_physical[other].offset + m_physical[other].size);
+
+                VkDeviceSize best = ~VkDeviceSize(0);
+                for (VkDeviceSize offset : candidates)
+                {
+                    offset = (offset + req.alignment - 1) / req.alignment * req.alignment;
+                    bool free = true;
+                    for (size_t other : placed[b])
+                    {
+                        const physicalResource& o = m_physical[other];
+                        const bool together = phys.firstPass <= o.lastPass && o.firstPass <= phys.lastPass;
+                        const bool overlap  = offset < o.offset + o.size && o.offset < offset + phys.size;
+                        free = free && !(together && overlap);
+                    }
+                    if (free)
+                        best = std::min(best, offset);
+                }
+
+                phys.block  = b;
+                phys.offset = best;
+                block.memoryTypeBits &= req.memoryTypeBits;
+                block.alignment       = std::max(block.alignment, req.alignment);
+                block.size            = std::max(block.size, best + phys.size);
+                placed[b].push_back(i);
+                done = true;
+            }
+
+            if (!done)
+            {
+                memoryBlockDesc block;
+                block.isImage        = phys.isImage;
+                block.memoryTypeBits = req.memoryTypeBits;
+                block.alignment      = req.alignment;
+                block.size           = phys.size;
+                phys.block  = uint32_t(m_blocks.size());
+                phys.offset = 0;
+                m_blocks.push_back(block);
+                placed.push_back(std::vector<size_t>(1, i));
+            }
+        }
+
+        for (memoryBlockDesc& block : m_blocks)
+        {
+            VkMemoryRequirements req = {};
+            req.size           = block.size;
+            req.alignment      = block.alignment;
+            req.memoryTypeBits = block.memoryTypeBits;
+            block.memory = m_pAllocator->allocate(req, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                  block.isImage ? deviceAllocator::RESOURCE_OPTIMAL : deviceAllocator::RESOURCE_LINEAR);
+        }
+
+        for (size_t i = 0; i < transients.size(); i++)
+        {
+            physicalResource&        phys   = m_physical[i];
+            const deviceAllocation&  memory = m_blocks[phys.block].memory;
+            if (!phys.isImage)
+            {
+                VK_CHECK_RESULT(vkBindBufferMemory(m_device, phys.buffer, memory.memory, memory.offset + phys.offset));
+                continue;
+            }
+            VK_CHECK_RESULT(vkBindImageMemory(m_device, phys.image, memory.memory, memory.offset + phys.offset));
+
+            const resource& res    = m_resources[transients[i]];
+            const uint32_t  levels = res.imageInfo.mipLevels;
+            phys.views.resize(levels > 1 ? levels + 1 : 1);
+            for (uint32_t v = 0; v < phys.views.size(); v++)
+            {
+                VkImageViewCreateInfo viewInfo = {};
+                viewInfo.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                viewInfo.image                           = phys.image;
+                viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+                viewInfo.format                          = res.imageInfo.format;
+                viewInfo.subresourceRange.aspectMask     = res.aspect & ~VK_IMAGE_ASPECT_STENCIL_BIT;
+                viewInfo.subresourceRange.baseMipLevel   = (v == 0) ? 0 : v - 1;
+                viewInfo.subresourceRange.levelCount     = (v == 0) ? levels : 1;
+                viewInfo.subresourceRange.layerCount     = 1;
+                if (vkCreateImageView(m_device, &viewInfo, NULL, &phys.views[v]) != VK_SUCCESS)
+                    throw std::runtime_error("[renderGraph::allocateTransients]: failed to create image view!");
+            }
+        }
+    }
+
+    for (size_t i = 0; i < transients.size(); i++)
+    {
+        resource& res = m_resources[transients[i]];
+        res.physical = uint32_t(i);
+        res.buffer   = m_physical[i].buffer;
+        res.image    = m_physical[i].image;
+        m_stats.unaliasedBytes += m_physical[i].size;
+    }
+    for (const memoryBlockDesc& block : m_blocks)
+        m_stats.transientBytes += block.size;
+    m_stats.transientResources = uint32_t(transients.size());
+}
+
+void renderGraph::planFirstTransientUse(resource* a_pRes)
+{
+    // The memory was last used by the resources placed over it that ended earlier in this frame, and by
+    // whatever it held in the previous frame; the new contents start undefined after all of them
+    //
+    const physicalResource& phys  = m_physical[a_pRes->physical];
+    resourceState           state;
+
+    for (const resource& other : m_resources)
+    {
+        if (other.physical == NO_RESOURCE || &other == a_pRes)
+            continue;
+        const physicalResource& o = m_physical[other.physical];
+        const bool overlap = o.block == phys.block && phys.offset < o.offset + o.size && o.offset < phys.offset + phys.size;
+        if (overlap && o.lastPass < phys.firstPass)
+        {
+            state.writeStages |= other.state.writeStages | other.state.readStages;
+            state.writeAccess |= other.state.writeAccess;
+        }
+    }
+    for (const physicalResource& o : m_physical)
+    {
+        if (o.block == phys.block && phys.offset < o.offset + o.size && o.offset < phys.offset + phys.size)
+        {
+            state.writeStages |= o.lastStages;
+            state.writeAccess |= o.lastWrites;
+        }
+    }
+
+    a_pRes->state = state;
+}
+
+void renderGraph::planUse(resource* a_pRes, const graphAccess& a_access, plannedBarrier* a_pBarrier)
+{
+    resourceState&      state      = a_pRes->state;
+    const bool          isImage    = (a_pRes->kind == GRAPH_IMPORTED_IMAGE || a_pRes->kind == GRAPH_TRANSIENT_IMAGE);
+    const bool          write      = isWrite(a_access.access);
+    const VkAccessFlags reads      = a_access.access & ~WRITE_ACCESS;
+    const bool          transition = isImage && a_access.layout != VK_IMAGE_LAYOUT_UNDEFINED && a_access.layout != state.layout;
+
+    VkPipelineStageFlags srcStages = 0;
+    VkAccessFlags        srcAccess = 0;
+    bool                 memory    = false;   // a barrier struct is needed, not only the stages
+
+    if (state.acquired)
+    {
+        // the acquire semaphore orders everything after its wait stages; layout transitions have to start there
+        //
+        srcStages = transition ? state.writeStages : 0;
+        memory    = transition;
+    }
+    else if (transition)
+    {
+        srcStages = state.writeStages | state.readStages;
+        srcAccess = state.writeAccess;
+        memory    = true;
+    }
+    else if (write)
+    {
+        // WAR: waiting for the readers is enough, unless the pass also reads what they were not shown. WAW: the last write
+        //
+        const bool unseen = reads != 0 && ((a_access.stages & ~state.visibleStages) != 0 || (reads & ~state.visible) != 0);
+        srcStages = state.readStages;
+        if (state.readStages == 0 || unseen)
+        {
+            srcStages |= state.writeStages;
+            srcAccess  = state.writeAccess;
+            memory     = state.writeAccess != 0;
+        }
+    }
+    else if (state.writeStages != 0 && ((a_access.stages & ~state.visibleStages) != 0 || (reads & ~state.visible) != 0))
+    {
+        srcStages = state.writeStages;
+        srcAccess = state.writeAccess;
+        memory    = state.writeAccess != 0;
+    }
+
+    if (srcStages != 0 || memory)
+    {
+        a_pBarrier->srcStages |= srcStages;
+        a_pBarrier->dstStages |= a_access.stages;
+    }
+    if (memory)
+    {
+        if (!isImage)
+            a_pBarrier->buffers.push_back(vk_utils::bufferBarrier(a_pRes->buffer, srcAccess, a_access.access));
+        else if (transition)
+        {
+            // contents only written by the pass are not kept through the transition
+            //
+            const VkImageLayout oldLayout = (state.acquired || (write && reads == 0)) ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+            a_pBarrier->images.push_back(imageBarrier(a_pRes->image, a_pRes->aspect, srcAccess, a_access.access, oldLayout, a_access.layout));
+        }
+        else if (state.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+            a_pBarrier->images.push_back(imageBarrier(a_pRes->image, a_pRes->aspect, srcAccess, a_access.access, state.layout, state.layout));
+        else
+        {
+            // only the render pass of the last use knew the layout, an image barrier can't name it
+            //
+            a_pBarrier->globalSrc |= srcAccess;
+            a_pBarrier->globalDst |= a_access.access;
+        }
+    }
+
+    if (write || transition)
+    {
+        state.writeStages   = a_access.stages;
+        state.writeAccess   = a_access.access & WRITE_ACCESS;
+        state.readStages    = write ? 0 : a_access.stages;
+        state.visible       = write ? 0 : reads;
+        state.visibleStages = write ? 0 : a_access.stages;
+    }
+    else
+    {
+        state.readStages    |= a_access.stages;
+        state.visible       |= reads;
+        state.visibleStages |= a_access.stages;
+    }
+    if (transition)
+        state.layout = a_access.layout;
+    if (a_access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+        state.layout = a_access.finalLayout;
+    state.acquired = false;
+}
+
+void renderGraph::compile()
+{
+    releaseRetired(false);
+
+    m_stats.passes = uint32_t(m_passes.size());
+    cull();
+    allocateTransients();
+
+    m_barriers.assign(m_passes.size() + 1, plannedBarrier());
+    for (uint32_t i = 0; i < m_passes.size(); i++)
+    {
+        if (!m_passes[i].live)
+            continue;
+        for (const passUse& u : m_passes[i].uses)
+        {
+            resource& res = m_resources[u.resource];
+            if (res.physical != NO_RESOURCE && res.firstPass == i)
+            {
+                if (!isWrite(u.access.access))
+                    throw std::runtime_error(("[renderGraph::compile]: " + res.name + " is read before anything writes it!").c_str());
+                planFirstTransientUse(&res);
+            }
+            planUse(&res, u.access, &m_barriers[i]);
+        }
+    }
+
+    for (resource& res : m_resources)
+    {
+        if (!res.hasOutput || res.outputAccess.layout == VK_IMAGE_LAYOUT_UNDEFINED || res.outputAccess.layout == res.state.layout)
+            continue;
+        graphAccess access = res.outputAccess;
+        if (access.stages == 0)
+            access.stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        planUse(&res, access, &m_barriers[m_passes.size()]);
+    }
+
+    for (const plannedBarrier& barrier : m_barriers)
+    {
+        if (barrier.dstStages == 0)
+            continue;
+        m_stats.barrierCalls++;
+        m_stats.bufferBarriers += uint32_t(barrier.buffers.size());
+        m_stats.imageBarriers  += uint32_t(barrier.images.size());
+        m_stats.memoryBarriers += (barrier.globalSrc | barrier.globalDst) ? 1 : 0;
+    }
+
+    // how this frame leaves the imported resources and the transient memory is where the next one starts
+    //
+    for (const resource& res : m_resources)
+    {
+        if (res.kind == GRAPH_IMPORTED_BUFFER)
+            m_bufferStates[res.buffer] = res.state;
+        else if (res.kind == GRAPH_IMPORTED_IMAGE)
+            m_imageStates[res.image] = res.state;
+        else if (res.physical != NO_RESOURCE)
+        {
+            m_physical[res.physical].lastStages = res.state.writeStages | res.state.readStages;
+            m_physical[res.physical].lastWrites = res.state.writeAccess;
+        }
+    }
+
+    m_compiled = true;
+}
+
+void renderGraph::execute(VkCommandBuffer a_cmdBuff)
+{
+    if (!m_compiled)
+        throw std::runtime_error("[renderGraph::execute]: not compiled!");
+
+    for (uint32_t i = 0; i <= m_passes.size(); i++)
+    {
+        const plannedBarrier& barrier = m_barriers[i];
+        if (barrier.dstStages != 0)
+        {
+            VkMemoryBarrier global = {};
+            global.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            global.srcAccessMask = barrier.globalSrc;
+            global.dstAccessMask = barrier.globalDst;
+            const uint32_t globalCount = (barrier.globalSrc | barrier.globalDst) ? 1 : 0;
+
+            vkCmdPipelineBarrier(a_cmdBuff, barrier.srcStages ? barrier.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, barrier.dstStages, 0,
+                                 globalCount, &global, uint32_t(barrier.buffers.size()), barrier.buffers.data(),
+                                 uint32_t(barrier.images.size()), barrier.images.data());
+        }
+        if (i < m_passes.size() && m_passes[i].live)
+            m_passes[i].record(a_cmdBuff);
+    }
+
+    m_frame++;
+}
+
+VkBuffer renderGraph::buffer(uint32_t a_resource) const
+{
+    return m_resources[a_resource].buffer;
+}
+
+VkImage renderGraph::image(uint32_t a_resource) const
+{
+    return m_resources[a_resource].image;
+}
+
+VkImageView renderGraph::view(uint32_t a_resource) const
+{
+    const resource& res = m_resources[a_resource];
+    if (res.physical == NO_RESOURCE || m_physical[res.physical].views.empty())
+        return VK_NULL_HANDLE;
+    return m_physical[res.physical].views[0];
+}
+
+VkImageView renderGraph::view(uint32_t a_resource, uint32_t a_mip) const
+{
+    const resource& res = m_resources[a_resource];
+    if (res.physical == NO_RESOURCE)
+        return VK_NULL_HANDLE;
+    const std::vector<VkImageView>& views = m_physical[res.physical].views;
+    if (views.size() == 1)
+        return a_mip == 0 ? views[0] : VK_NULL_HANDLE;
+    return (a_mip + 1 < views.size()) ? views[a_mip + 1] : VK_NULL_HANDLE;
+}
+
+void renderGraph::destroySet(std::vector<physicalResource>& a_physical, std::vector<memoryBlockDesc>& a_blocks)
+{
+    for (physicalResource& phys : a_physical)
+    {
+        for (VkImageView view : phys.views)
+            vkDestroyImageView(m_device, view, NULL);
+        if (phys.image != VK_NULL_HANDLE)
+            vkDestroyImage(m_device, phys.image, NULL);
+        if (phys.buffer != VK_NULL_HANDLE)
+            vkDestroyBuffer(m_device, phys.buffer, NULL);
+    }
+    for (memoryBlockDesc& block : a_blocks)
+    {
+        if (block.memory.memory != VK_NULL_HANDLE)
+            m_pAllocator->free(block.memory);
+    }
+    a_physical.clear();
+    a_blocks.clear();
+}
+
+void renderGraph::releaseRetired(bool a_all)
+{
+    // a set retired while recording frame F was last used by frame F - 1, see application::releaseRetiredScreens()
+    //
+    for (size_t i = 0; i < m_retired.size(); )
+    {
+        if (a_all || m_frame + 1 >= m_retired[i].lastFrame + m_framesInFlight)
+        {
+            destroySet(m_retired[i].physical, m_retired[i].blocks);
+            m_retired.erase(m_retired.begin() + i);
+        }
+        else
+            i++;
+    }
+}
@@ -0,0 +1,242 @@
+#ifndef WATERAPP_RENDERGRAPH_HPP
+#define WATERAPP_RENDERGRAPH_HPP
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "deviceAllocator.hpp"
+
+namespace app
+{
+
+// How a pass accesses a resource; a use with any write bit in access writes it.
+//
+struct graphAccess
+{
+    VkPipelineStageFlags stages;
+    VkAccessFlags        access;
+    VkImageLayout        layout;        // images: the layout the pass needs; UNDEFINED - the pass handles layouts itself (render passes)
+    VkImageLayout        finalLayout;   // images: the layout the pass leaves behind; UNDEFINED - layout
+};
+
+inline graphAccess bufferAccess(VkPipelineStageFlags a_stages, VkAccessFlags a_access)
+{
+    graphAccess use = { a_stages, a_access, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED };
+    return use;
+}
+
+inline graphAccess imageAccess(VkPipelineStageFlags a_stages, VkAccessFlags a_access, VkImageLayout a_layout,
+                               VkImageLayout a_finalLayout = VK_IMAGE_LAYOUT_UNDEFINED)
+{
+    graphAccess use = { a_stages, a_access, a_layout, a_finalLayout };
+    return use;
+}
+
+class renderGraphStats
+{
+public:
+    uint32_t     passes             = 0;   // declared
+    uint32_t     culledPasses       = 0;   // nothing they wrote was used
+    uint32_t     barrierCalls       = 0;   // vkCmdPipelineBarrier, at most one before each pass and one after the last
+    uint32_t     bufferBarriers     = 0;
+    uint32_t     imageBarriers      = 0;   // layout transitions included
+    uint32_t     memoryBarriers     = 0;   // global ones, for images in a layout only their render pass knows
+    uint32_t     transientResources = 0;
+    VkDeviceSize transientBytes     = 0;   // memory behind the transient resources: the peak, as they alias
+    VkDeviceSize unaliasedBytes     = 0;   // what they would need each in its own memory
+};
+
+// The frame as a list of passes and the resources they read and write, declared anew every frame:
+//
+//   reset() - import*() / acquireImage() / create*() - addPass() + use() - output() - compile() - execute()
+//
+// compile() culls the passes whose writes nobody uses, then walks the remaining ones in declaration order
+// tracking the last writer and the readers since of every resource. Before each pass it records one
+// vkCmdPipelineBarrier with what the pass needs: read after write - the writer's stages and accesses made
+// visible to the reader; write after read - an execution dependency on the readers; write after write and
+// layout changes - both. Reads of data already visible to the reading stages need nothing. Barriers inside a
+// pass (between its own dispatches) stay the pass's business.
+//
+// Imported resources outlive the frame: the graph remembers how the last frame left them and synchronises the
+// next frame's first use with that, so all uses of an imported resource must be declared to the graph.
+//
+// Transient resources only live between their first and last use within the frame. They are placed in shared
+// memory blocks, and resources whose lifetimes do not overlap get the same memory. The placement and the
+// VkImage / VkBuffer objects are kept as long as the frames declare the same transient resources, so their
+// handles stay valid from one frame to the next; anything else recreates them, and the old ones are destroyed
+// once the frames in flight that used them have retired.
+//
+class renderGraph
+{
+public:
+    static const uint32_t NO_RESOURCE = 0xFFFFFFFF;
+
+    void init(deviceAllocator* a_pAllocator, VkDevice a_device, uint32_t a_framesInFlight);
+    void destroy();   // after vkDeviceWaitIdle
+
+    void reset();
+    void invalidate();   // forget how imported images were left, after the screen images were recreated
+
+    // a_layout - of an image the graph has not seen before
+    //
+    uint32_t importBuffer(const char* a_name, VkBuffer a_buffer);
+    uint32_t importImage (const char* a_name, VkImage a_image, VkImageAspectFlags a_aspect, VkImageLayout a_layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+    // A swapchain image: the contents are undefined and the acquire semaphore waits at a_stages, which must
+    // include the first stage that uses the image
+    //
+    uint32_t acquireImage(const char* a_name, VkImage a_image, VkImageAspectFlags a_aspect, VkPipelineStageFlags a_stages);
+
+    // transient; the handles and views are valid after compile()
+    //
+    uint32_t createImage (const char* a_name, const VkImageCreateInfo& a_info);
+    uint32_t createBuffer(const char* a_name, VkDeviceSize a_size, VkBufferUsageFlags a_usage);
+
+    uint32_t addPass(const char* a_name, std::function<void(VkCommandBuffer)> a_record);
+    void     use    (uint32_t a_pass, uint32_t a_resource, const graphAccess& a_access);
+
+    // a_resource is used after the frame (presented, read back): its writers are kept and it is left in
+    // a_access.layout. Visibility to that consumer is the submission's business (semaphores, fences).
+    //
+    void     output (uint32_t a_resource, const graphAccess& a_access);
+
+    void     compile();
+    void     execute(VkCommandBuffer a_cmdBuff);
+
+    VkBuffer    buffer(uint32_t a_resource) const;
+    VkImage     image (uint32_t a_resource) const;
+    VkImageView view  (uint32_t a_resource) const;                   // all mip levels
+    VkImageView view  (uint32_t a_resource, uint32_t a_mip) const;   // one mip level
+    bool        culled(uint32_t a_pass) const { return !m_passes[a_pass].live; }
+
+    const renderGraphStats& stats() const { return m_stats; }
+
+private:
+    enum resourceKind { GRAPH_IMPORTED_BUFFER = 0, GRAPH_IMPORTED_IMAGE, GRAPH_TRANSIENT_BUFFER, GRAPH_TRANSIENT_IMAGE };
+
+    // the state a resource was left in by its accesses so far
+    //
+    struct resourceState
+    {
+        VkPipelineStageFlags writeStages  = 0;   // of the last write, or the acquire wait
+        VkAccessFlags        writeAccess  = 0;
+        VkPipelineStageFlags readStages   = 0;   // readers since the last write
+        VkAccessFlags        visible      = 0;   // accesses the last write was made visible to
+        VkPipelineStageFlags visibleStages = 0;
+        VkImageLayout        layout       = VK_IMAGE_LAYOUT_UNDEFINED;
+        bool                 acquired     = false;
+    };
+
+    struct resource
+    {
+        std::string          name;
+        resourceKind         kind;
+        VkBuffer             buffer = VK_NULL_HANDLE;
+        VkImage              image  = VK_NULL_HANDLE;
+        VkImageAspectFlags   aspect = 0;
+        VkImageCreateInfo    imageInfo;               // transient images
+        VkDeviceSize         size   = 0;              // transient buffers
+        VkBufferUsageFlags   usage  = 0;
+        resourceState        state;
+        bool                 needed = false;
+        uint32_t             firstPass = NO_RESOURCE; // lifetime among the live passes
+        uint32_t             lastPass  = 0;
+        uint32_t             physical  = NO_RESOURCE; // index into m_physical
+        bool                 hasOutput = false;
+        graphAccess          outputAccess;
+    };
+
+    struct passUse
+    {
+        uint32_t    resource;
+        graphAccess access;
+    };
+
+    struct pass
+    {
+        std::string                           name;
+        std::function<void(VkCommandBuffer)>  record;
+        std::vector<passUse>                  uses;
+        bool                                  live = true;
+    };
+
+    // a barrier recorded before a pass (or after the last one, for the outputs)
+    //
+    struct plannedBarrier
+    {
+        VkPipelineStageFlags               srcStages = 0;
+        VkPipelineStageFlags               dstStages = 0;
+        std::vector<VkBufferMemoryBarrier> buffers;
+        std::vector<VkImageMemoryBarrier>  images;
+        VkAccessFlags                      globalSrc = 0;   // a VkMemoryBarrier, when non-zero
+        VkAccessFlags                      globalDst = 0;
+    };
+
+    // a transient resource as created, and where it lives
+    //
+    struct physicalResource
+    {
+        bool                     isImage = false;
+        VkImage                  image   = VK_NULL_HANDLE;
+        VkBuffer                 buffer  = VK_NULL_HANDLE;
+        std::vector<VkImageView> views;             // [0] - all mips, [1 + m] - mip m
+        uint32_t                 block   = 0;       // index into m_blocks
+        VkDeviceSize             offset  = 0;
+        VkDeviceSize             size    = 0;
+        uint32_t                 firstPass = 0;
+        uint32_t                 lastPass  = 0;
+        VkPipelineStageFlags     lastStages = 0;    // of the previous frame's last use
+        VkAccessFlags            lastWrites = 0;
+    };
+
+    struct memoryBlockDesc
+    {
+        bool             isImage        = false;
+        uint32_t         memoryTypeBits = 0;
+        VkDeviceSize     alignment      = 1;
+        VkDeviceSize     size           = 0;
+        deviceAllocation memory;
+    };
+
+    struct retiredSet
+    {
+        std::vector<physicalResource> physical;
+        std::vector<memoryBlockDesc>  blocks;
+        uint64_t                      lastFrame;
+    };
+
+    static bool isWrite(VkAccessFlags a_access);
+    std::string transientSignature() const;
+    void        cull();
+    void        allocateTransients();
+    void        createPhysical(physicalResource* a_pPhysical, const resource& a_desc);
+    void        destroySet(std::vector<physicalResource>& a_physical, std::vector<memoryBlockDesc>& a_blocks);
+    void        releaseRetired(bool a_all);
+    void        planUse(resource* a_pRes, const graphAccess& a_access, plannedBarrier* a_pBarrier);
+    void        planFirstTransientUse(resource* a_pRes);
+
+    deviceAllocator*              m_pAllocator = nullptr;
+    VkDevice                      m_device     = VK_NULL_HANDLE;
+    uint32_t                      m_framesInFlight = 1;
+    uint64_t                      m_frame      = 0;
+
+    std::vector<resource>         m_resources;
+    std::vector<pass>             m_passes;
+    std::vector<plannedBarrier>   m_barriers;   // [pass], [passes] - the outputs
+    bool                          m_compiled   = false;
+
+    std::map<VkBuffer, resourceState> m_bufferStates;   // imported resources as the last frame left them
+    std::map<VkImage, resourceState>  m_imageStates;
+
+    std::string                   m_signature;   // of the transient resources m_physical was made for
+    std::vector<physicalResource> m_physical;
+    std::vector<memoryBlockDesc>  m_blocks;
+    std::vector<retiredSet>       m_retired;
+
+    renderGraphStats              m_stats;
+};
+
+}
+#endif // WATERAPP_RENDERGRAPH_HPP
@@ -0,0 +1,379 @@
+#include "createApp.hpp"
+
+using namespace std;
+using namespace app;
+
+uint32_t app::attachmentFormatBytes(VkFormat a_format)
+{
+    switch (a_format)
+    {
+    case VK_FORMAT_D16_UNORM:                return 2;
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:       return 5;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:      return 8;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:      return 16;
+    default:                                 return 4;
+    }
+}
+
+void renderPassBuilder::reset()
+{
+    m_attachments.clear();
+    m_subpasses.clear();
+    m_dependencies.clear();
+}
+
+uint32_t renderPassBuilder::addAttachment(VkFormat a_format, VkSampleCountFlagBits a_samples, uint32_t a_flags, VkImageLayout a_finalLayout)
+{
+    attachmentDesc desc;
+    desc.format      = a_format;
+    desc.samples     = a_samples;
+    desc.flags       = a_flags;
+    desc.finalLayout = a_finalLayout;
+    m_attachments.push_back(desc);
+    return uint32_t(m_attachments.size() - 1);
+}
+
+uint32_t renderPassBuilder::addSubpass()
+{
+    m_subpasses.push_back(subpassDesc());
+    return uint32_t(m_subpasses.size() - 1);
+}
+
+void renderPassBuilder::addUse(uint32_t a_subpass, uint32_t a_attachment, useKind a_kind)
+{
+    if (a_subpass >= m_subpasses.size() || a_attachment >= m_attachments.size())
+        throw std::runtime_error("[renderPassBuilder::addUse]: no such subpass or attachment!");
+
+    use u;
+    u.attachment = a_attachment;
+    u.kind       = a_kind;
+    m_subpasses[a_subpass].uses.push_back(u);
+}
+
+void renderPassBuilder::color(uint32_t a_subpass, uint32_t a_attachment, uint32_t a_resolve)
+{
+    addUse(a_subpass, a_attachment, USE_COLOR);
+    if (a_resolve != VK_ATTACHMENT_UNUSED)
+    {
+        if (m_attachments[a_attachment].samples == VK_SAMPLE_COUNT_1_BIT || m_attachments[a_resolve].samples != VK_SAMPLE_COUNT_1_BIT)
+            throw std::runtime_error("[renderPassBuilder::color]: resolves go from a multisampled to a single sample attachment!");
+        addUse(a_subpass, a_resolve, USE_RESOLVE);
+    }
+    m_subpasses[a_subpass].colors.push_back(a_attachment);
+    m_subpasses[a_subpass].resolves.push_back(a_resolve);
+}
+
+void renderPassBuilder::depth(uint32_t a_subpass, uint32_t a_attachment, bool a_write)
+{
+    addUse(a_subpass, a_attachment, a_write ? USE_DEPTH_WRITE : USE_DEPTH_READ);
+    m_subpasses[a_subpass].depth = a_attachment;
+}
+
+void renderPassBuilder::input(uint32_t a_subpass, uint32_t a_attachment)
+{
+    addUse(a_subpass, a_attachment, USE_INPUT);
+    m_subpasses[a_subpass].inputs.push_back(a_attachment);
+}
+
+bool renderPassBuilder::isDepth(uint32_t a_attachment) const
+{
+    const VkFormat format = m_attachments[a_attachment].format;
+    return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT ||
+           format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+void renderPassBuilder::useScope(useKind a_kind, VkPipelineStageFlags* a_pStages, VkAccessFlags* a_pAccess, VkAccessFlags* a_pWrites)
+{
+    switch (a_kind)
+    {
+    case USE_COLOR:
+        *a_pStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        *a_pAccess = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        *a_pWrites = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        break;
+    case USE_RESOLVE:
+        *a_pStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        *a_pAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        *a_pWrites = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        break;
+    case USE_DEPTH_READ:
+        *a_pStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        *a_pAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        *a_pWrites = 0;
+        break;
+    case USE_DEPTH_WRITE:
+        *a_pStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        *a_pAccess = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        *a_pWrites = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        break;
+    default:   // USE_INPUT
+        *a_pStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        *a_pAccess = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+        *a_pWrites = 0;
+        break;
+    }
+}
+
+VkImageLayout renderPassBuilder::layoutIn(uint32_t a_subpass, uint32_t a_attachment) const
+{
+    // every reference to an attachment within a subpass must name the same layout
+    //
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    for (const use& u : m_subpasses[a_subpass].uses)
+    {
+        if (u.attachment != a_attachment)
+            continue;
+
+        VkImageLayout needed;
+        switch (u.kind)
+        {
+        case USE_COLOR:
+        case USE_RESOLVE:     needed = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL; break;
+        case USE_DEPTH_WRITE: needed = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL; break;
+        case USE_DEPTH_READ:  needed = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL; break;
+        default:              needed = isDepth(a_attachment) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; break;
+        }
+
+        if (layout == VK_IMAGE_LAYOUT_UNDEFINED)
+            layout = needed;
+        else if (layout != needed)
+            layout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+    return layout;
+}
+
+bool renderPassBuilder::transient(uint32_t a_attachment) const
+{
+    return (m_attachments[a_attachment].flags & (ATTACHMENT_PRESERVE | ATTACHMENT_OUTPUT)) == 0;
+}
+
+VkAttachmentLoadOp renderPassBuilder::loadOp(uint32_t a_attachment) const
+{
+    const uint32_t flags = m_attachments[a_attachment].flags;
+    if (flags & ATTACHMENT_CLEAR)    return VK_ATTACHMENT_LOAD_OP_CLEAR;
+    if (flags & ATTACHMENT_PRESERVE) return VK_ATTACHMENT_LOAD_OP_LOAD;
+    return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+}
+
+VkAttachmentStoreOp renderPassBuilder::storeOp(uint32_t a_attachment) const
+{
+    return (m_attachments[a_attachment].flags & ATTACHMENT_OUTPUT) ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+}
+
+VkDeviceSize renderPassBuilder::attachmentTraffic(uint32_t a_width, uint32_t a_height, bool a_naive) const
+{
+    VkDeviceSize bytes = 0;
+    for (uint32_t i = 0; i < m_attachments.size(); i++)
+    {
+        const VkDeviceSize size = VkDeviceSize(a_width) * a_height * uint32_t(m_attachments[i].samples) * attachmentFormatBytes(m_attachments[i].format);
+        if (a_naive || loadOp(i) == VK_ATTACHMENT_LOAD_OP_LOAD)    bytes += size;
+        if (a_naive || storeOp(i) == VK_ATTACHMENT_STORE_OP_STORE) bytes += size;
+    }
+    return bytes;
+}
+
+void renderPassBuilder::build(VkDevice a_device, VkRenderPass* a_pRenderPass)
+{
+    const uint32_t attachmentCount = uint32_t(m_attachments.size());
+    const uint32_t subpassCount    = uint32_t(m_subpasses.size());
+    if (subpassCount == 0)
+        throw std::runtime_error("[renderPassBuilder::build]: no subpasses!");
+
+    // first and last subpass using each attachment
+    //
+    std::vector<uint32_t> first(attachmentCount, VK_SUBPASS_EXTERNAL), last(attachmentCount, VK_SUBPASS_EXTERNAL);
+    for (uint32_t s = 0; s < subpassCount; s++)
+    {
+        for (const use& u : m_subpasses[s].uses)
+        {
+            if (first[u.attachment] == VK_SUBPASS_EXTERNAL)
+            {
+                first[u.attachment] = s;
+
+                // a depth test or an input read of contents nobody wrote
+                //
+                const bool reads = (u.kind == USE_DEPTH_READ || u.kind == USE_DEPTH_WRITE || u.kind == USE_INPUT);
+                if (reads && !(m_attachments[u.attachment].flags & (ATTACHMENT_CLEAR | ATTACHMENT_PRESERVE)))
+                    throw std::runtime_error("[renderPassBuilder::build]: an attachment is read before it is written, clear or preserve it!");
+            }
+            last[u.attachment] = s;
+        }
+    }
+
+    std::vector<VkAttachmentDescription> descriptions(attachmentCount);
+    for (uint32_t i = 0; i < attachmentCount; i++)
+    {
+        if (first[i] == VK_SUBPASS_EXTERNAL)
+            throw std::runtime_error("[renderPassBuilder::build]: an attachment is never used!");
+
+        const attachmentDesc& a = m_attachments[i];
+        const VkImageLayout finalLayout = (a.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED) ? a.finalLayout : layoutIn(last[i], i);
+
+        // the stencil aspect is never used
+        //
+        descriptions[i].format         = a.format;
+        descriptions[i].samples        = a.samples;
+        descriptions[i].loadOp         = loadOp(i);
+        descriptions[i].storeOp        = storeOp(i);
+        descriptions[i].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        descriptions[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        descriptions[i].initialLayout  = (a.flags & ATTACHMENT_PRESERVE) ? finalLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+        descriptions[i].finalLayout    = finalLayout;
+    }
+
+    // references live in these until vkCreateRenderPass; reserved, so the pointers into them stay valid
+    //
+    std::vector<VkAttachmentReference> references;
+    std::vector<uint32_t>              preserved;
+    size_t referenceCount = 0;
+    for (const subpassDesc& s : m_subpasses)
+        referenceCount += s.colors.size() * 2 + s.inputs.size() + 1;
+    references.reserve(referenceCount);
+    preserved.reserve(size_t(subpassCount) * attachmentCount);
+
+    auto reference = [&references, this](uint32_t a_subpass, uint32_t a_attachment) -> const VkAttachmentReference*
+    {
+        VkAttachmentReference ref = {};
+        ref.attachment = a_attachment;
+        ref.layout     = (a_attachment == VK_ATTACHMENT_UNUSED) ? VK_IMAGE_LAYOUT_UNDEFINED : layoutIn(a_subpass, a_attachment);
+        references.push_back(ref);
+        return &references.back();
+    };
+
+    std::vector<VkSubpassDescription> subpasses(subpassCount);
+    for (uint32_t s = 0; s < subpassCount; s++)
+    {
+        const subpassDesc& desc = m_subpasses[s];
+        bool anyResolve = false;
+
+        subpasses[s] = VkSubpassDescription();
+        subpasses[s].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+
+        subpasses[s].colorAttachmentCount = uint32_t(desc.colors.size());
+        for (size_t c = 0; c < desc.colors.size(); c++)
+        {
+            const VkAttachmentReference* ref = reference(s, desc.colors[c]);
+            if (c == 0) subpasses[s].pColorAttachments = ref;
+            anyResolve |= (desc.resolves[c] != VK_ATTACHMENT_UNUSED);
+        }
+        if (anyResolve)
+        {
+            for (size_t c = 0; c < desc.resolves.size(); c++)
+            {
+                const VkAttachmentReference* ref = reference(s, desc.resolves[c]);
+                if (c == 0) subpasses[s].pResolveAttachments = ref;
+            }
+        }
+
+        subpasses[s].inputAttachmentCount = uint32_t(desc.inputs.size());
+        for (size_t c = 0; c < desc.inputs.size(); c++)
+        {
+            const VkAttachmentReference* ref = reference(s, desc.inputs[c]);
+            if (c == 0) subpasses[s].pInputAttachments = ref;
+        }
+
+        if (desc.depth != VK_ATTACHMENT_UNUSED)
+            subpasses[s].pDepthStencilAttachment = reference(s, desc.depth);
+
+        // attachments used before and after this subpass but not in it keep their contents only when preserved
+        //
+        const size_t preserveBegin = preserved.size();
+        for (uint32_t i = 0; i < attachmentCount; i++)
+        {
+            if (first[i] >= s || last[i] <= s)
+                continue;
+            bool used = false;
+            for (const use& u : desc.uses)
+                used |= (u.attachment == i);
+            if (!used)
+                preserved.push_back(i);
+        }
+        subpasses[s].preserveAttachmentCount = uint32_t(preserved.size() - preserveBegin);
+        subpasses[s].pPreserveAttachments    = preserved.empty() ? nullptr : preserved.data() + preserveBegin;
+    }
+
+    // The images outlive the frame: the first use of every attachment waits for its last use in the previous
+    // frame. Between subpasses, every attachment written in one and used in a later one orders the two; the
+    // accesses are at the same pixel, so by region.
+    //
+    m_dependencies.clear();
+    auto addDependency = [this](uint32_t a_src, uint32_t a_dst, VkPipelineStageFlags a_srcStages, VkAccessFlags a_srcAccess,
+                                VkPipelineStageFlags a_dstStages, VkAccessFlags a_dstAccess)
+    {
+        for (VkSubpassDependency& dep : m_dependencies)
+        {
+            if (dep.srcSubpass == a_src && dep.dstSubpass == a_dst)
+            {
+                dep.srcStageMask  |= a_srcStages;
+                dep.srcAccessMask |= a_srcAccess;
+                dep.dstStageMask  |= a_dstStages;
+                dep.dstAccessMask |= a_dstAccess;
+                return;
+            }
+        }
+        VkSubpassDependency dep = {};
+        dep.srcSubpass      = a_src;
+        dep.dstSubpass      = a_dst;
+        dep.srcStageMask    = a_srcStages;
+        dep.srcAccessMask   = a_srcAccess;
+        dep.dstStageMask    = a_dstStages;
+        dep.dstAccessMask   = a_dstAccess;
+        dep.dependencyFlags = (a_src == VK_SUBPASS_EXTERNAL) ? 0 : VK_DEPENDENCY_BY_REGION_BIT;
+        m_dependencies.push_back(dep);
+    };
+
+    // stages and accesses of all uses of an attachment in a subpass
+    //
+    auto scope = [this](uint32_t a_subpass, uint32_t a_attachment, VkPipelineStageFlags* a_pStages, VkAccessFlags* a_pAccess, VkAccessFlags* a_pWrites)
+    {
+        *a_pStages = 0; *a_pAccess = 0; *a_pWrites = 0;
+        for (const use& u : m_subpasses[a_subpass].uses)
+        {
+            if (u.attachment != a_attachment)
+                continue;
+            VkPipelineStageFlags stages;
+            VkAccessFlags        access, writes;
+            useScope(u.kind, &stages, &access, &writes);
+            *a_pStages |= stages;
+            *a_pAccess |= access;
+            *a_pWrites |= writes;
+        }
+    };
+
+    for (uint32_t i = 0; i < attachmentCount; i++)
+    {
+        VkPipelineStageFlags srcStages, dstStages;
+        VkAccessFlags        srcAccess, dstAccess, srcWrites, dstWrites;
+        scope(last[i],  i, &srcStages, &srcAccess, &srcWrites);
+        scope(first[i], i, &dstStages, &dstAccess, &dstWrites);
+        addDependency(VK_SUBPASS_EXTERNAL, first[i], srcStages, srcWrites, dstStages, dstAccess);
+    }
+
+    for (uint32_t dst = 1; dst < subpassCount; dst++)
+    {
+        for (uint32_t src = 0; src < dst; src++)
+        {
+            for (uint32_t i = 0; i < attachmentCount; i++)
+            {
+                VkPipelineStageFlags srcStages, dstStages;
+                VkAccessFlags        srcAccess, dstAccess, srcWrites, dstWrites;
+                scope(src, i, &srcStages, &srcAccess, &srcWrites);
+                scope(dst, i, &dstStages, &dstAccess, &dstWrites);
+                if (srcStages != 0 && dstStages != 0 && (srcWrites | dstWrites) != 0)
+                    addDependency(src, dst, srcStages, srcWrites, dstStages, dstAccess);
+            }
+        }
+    }
+
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = attachmentCount;
+    renderPassInfo.pAttachments    = descriptions.data();
+    renderPassInfo.subpassCount    = subpassCount;
+    renderPassInfo.pSubpasses      = subpasses.data();
+    renderPassInfo.dependencyCount = uint32_t(m_dependencies.size());
+    renderPassInfo.pDependencies   = m_dependencies.data();
+
+    if (vkCreateRenderPass(a_device, &renderPassInfo, nullptr, a_pRenderPass) != VK_SUCCESS)
+        throw std::runtime_error("[renderPassBuilder::build]: failed to create render pass!");
+}
@@ -0,0 +1,109 @@
+#ifndef WATERAPP_RENDERPASSBUILDER_HPP
+#define WATERAPP_RENDERPASSBUILDER_HPP
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+namespace app
+{
+
+// What happens to an attachment outside the render pass; together with its uses inside the pass this is all
+// renderPassBuilder needs to pick the load and store ops.
+//
+enum attachmentFlags
+{
+    ATTACHMENT_CLEAR    = 1,   // cleared when the pass begins
+    ATTACHMENT_PRESERVE = 2,   // the contents from before the pass are used: loaded
+    ATTACHMENT_OUTPUT   = 4,   // read after the pass (presented, copied, sampled): stored
+};
+
+// Describes a render pass by how its attachments are used instead of by its ops, layouts and dependencies:
+//
+//   load op  - CLEAR with ATTACHMENT_CLEAR, LOAD with ATTACHMENT_PRESERVE, otherwise DONT_CARE
+//   store op - STORE for ATTACHMENT_OUTPUT, otherwise DONT_CARE
+//   layouts  - the optimal one of every use, GENERAL where a subpass uses an attachment in two incompatible ways
+//   dependencies - from outside the pass (the previous frame's use of the same images) to the first subpass using
+//              each attachment, and BY_REGION ones between subpasses sharing an attachment
+//
+// An attachment that is neither preserved nor an output only lives inside the pass: transient() tells the caller
+// to create it with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT in lazily allocated memory, which tile based GPUs never
+// back with physical memory. Passes that read each other's results at the same pixel belong in one render pass as
+// subpasses, the reads as input attachments, so those intermediates stay on chip too; anything read at other
+// pixels needs a separate pass.
+//
+// Attachments and subpasses are numbered in the order they were added. A preserved attachment must be in
+// a_finalLayout when the pass begins, as the same pass left it in the previous frame.
+//
+class renderPassBuilder
+{
+public:
+    void     reset();
+
+    uint32_t addAttachment(VkFormat a_format, VkSampleCountFlagBits a_samples, uint32_t a_flags,
+                           VkImageLayout a_finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    uint32_t addSubpass();
+
+    // uses of an attachment in a subpass; a_resolve receives the multisample resolve of a_attachment
+    //
+    void     color(uint32_t a_subpass, uint32_t a_attachment, uint32_t a_resolve = VK_ATTACHMENT_UNUSED);
+    void     depth(uint32_t a_subpass, uint32_t a_attachment, bool a_write);
+    void     input(uint32_t a_subpass, uint32_t a_attachment);
+
+    // derives the ops, layouts and dependencies and creates the pass; throws for attachments read before anything
+    // was written to them
+    //
+    void     build(VkDevice a_device, VkRenderPass* a_pRenderPass);
+
+    uint32_t           attachmentCount() const { return uint32_t(m_attachments.size()); }
+    uint32_t           subpassCount() const    { return uint32_t(m_subpasses.size()); }
+    uint32_t           dependencyCount() const { return uint32_t(m_dependencies.size()); }   // after build()
+    bool               transient(uint32_t a_attachment) const;
+    VkAttachmentLoadOp  loadOp(uint32_t a_attachment) const;
+    VkAttachmentStoreOp storeOp(uint32_t a_attachment) const;
+
+    // bytes an immediate mode GPU moves between the attachments and memory per pass over a_width x a_height
+    // pixels: loads and stores. a_naive - as if every attachment was loaded and stored
+    //
+    VkDeviceSize       attachmentTraffic(uint32_t a_width, uint32_t a_height, bool a_naive = false) const;
+
+private:
+    enum useKind { USE_COLOR = 0, USE_RESOLVE, USE_DEPTH_READ, USE_DEPTH_WRITE, USE_INPUT };
+
+    struct attachmentDesc
+    {
+        VkFormat              format;
+        VkSampleCountFlagBits samples;
+        uint32_t              flags;
+        VkImageLayout         finalLayout;
+    };
+
+    struct use
+    {
+        uint32_t attachment;
+        useKind  kind;
+    };
+
+    struct subpassDesc
+    {
+        std::vector<use>      uses;
+        std::vector<uint32_t> colors;
+        std::vector<uint32_t> resolves;   // parallel to colors
+        std::vector<uint32_t> inputs;
+        uint32_t              depth = VK_ATTACHMENT_UNUSED;
+    };
+
+    bool          isDepth(uint32_t a_attachment) const;
+    static void   useScope(useKind a_kind, VkPipelineStageFlags* a_pStages, VkAccessFlags* a_pAccess, VkAccessFlags* a_pWrites);
+    VkImageLayout layoutIn(uint32_t a_subpass, uint32_t a_attachment) const;
+    void          addUse(uint32_t a_subpass, uint32_t a_attachment, useKind a_kind);
+
+    std::vector<attachmentDesc>      m_attachments;
+    std::vector<subpassDesc>         m_subpasses;
+    std::vector<VkSubpassDependency> m_dependencies;
+};
+
+// bytes per sample of the attachment formats the application uses, 4 for anything else
+//
+uint32_t attachmentFormatBytes(VkFormat a_format);
+
+}
+#endif // WATERAPP_RENDERPASSBUILDER_HPP
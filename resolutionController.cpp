@@ -0,0 +1,64 @@
+#include "resolutionController.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace app;
+
+constexpr float resolutionController::SCALE_QUANTUM;
+constexpr float resolutionController::MAX_GROWTH;
+
+void resolutionController::reset(float a_scale)
+{
+    m_scale      = std::max(minScale, std::min(maxScale, a_scale));
+    m_overCount  = 0;
+    m_underCount = 0;
+    m_frameMs    = 0.0;
+    m_scaledMs   = 0.0;
+}
+
+bool resolutionController::update(double a_frameMs, double a_scaledMs)
+{
+    const bool over  = a_frameMs > double(targetMs * downThreshold);
+    const bool under = a_frameMs < double(targetMs * upThreshold);
+
+    // a frame inside the band, or on the other side of it, restarts the count
+    //
+    if (!over)  m_overCount  = 0;
+    if (!under) m_underCount = 0;
+    if (!over && !under)
+        return false;
+
+    const uint32_t count = over ? ++m_overCount : ++m_underCount;
+    if (count == 1)
+    {
+        m_frameMs  = 0.0;
+        m_scaledMs = 0.0;
+    }
+    m_frameMs  += (a_frameMs - m_frameMs) / double(count);
+    m_scaledMs += (std::min(a_scaledMs, a_frameMs) - m_scaledMs) / double(count);
+
+    if (count < settleFrames)
+        return false;
+
+    m_overCount  = 0;
+    m_underCount = 0;
+
+    // the scaled part is proportional to scale^2
+    //
+    const double goalMs   = double(targetMs) * 0.5 * double(upThreshold + downThreshold);
+    const double fixedMs  = m_frameMs - m_scaledMs;
+    float        newScale = minScale;
+    if (goalMs > fixedMs && m_scaledMs > 0.0)
+        newScale = m_scale * float(std::sqrt((goalMs - fixedMs) / m_scaledMs));
+
+    newScale = std::min(newScale, m_scale * MAX_GROWTH);
+    newScale = std::floor(newScale / SCALE_QUANTUM + 0.5f) * SCALE_QUANTUM;
+    newScale = std::max(minScale, std::min(maxScale, newScale));
+
+    if (newScale == m_scale)
+        return false;
+
+    m_scale = newScale;
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef WATERAPP_RESOLUTIONCONTROLLER_HPP
+#define WATERAPP_RESOLUTIONCONTROLLER_HPP
+#include <cstdint>
+
+namespace app
+{
+
+// Picks the render scale (fraction of the output width and height) from measured GPU frame times.
+// The frame is split into a part that scales with the pixel count (the scene render pass) and a fixed
+// part (simulation, uploads, upscale); the next scale is the one that would bring the frame to the middle
+// of the [upThreshold, downThreshold] * targetMs band. Changes need settleFrames consecutive frames
+// outside the band, and growth is limited per change, so the scale does not oscillate around the budget.
+//
+class resolutionController
+{
+public:
+    static constexpr float SCALE_QUANTUM = 1.0f / 64.0f; // scales are rounded to this, tiny changes are not worth it
+    static constexpr float MAX_GROWTH    = 1.1f;         // per change; shrinking is not limited, a missed budget is worse
+
+    float    targetMs      = 16.0f;
+    float    minScale      = 0.5f;
+    float    maxScale      = 1.0f;
+    float    upThreshold   = 0.80f;  // grow while the frame takes less than targetMs * upThreshold
+    float    downThreshold = 1.00f;  // shrink while the frame takes more than targetMs * downThreshold
+    uint32_t settleFrames  = 8;
+
+    void  reset(float a_scale);
+
+    // a_frameMs - whole GPU frame, a_scaledMs - the part of it proportional to the rendered pixel count;
+    // both measured at the current scale. Returns true if the scale changed.
+    //
+    bool  update(double a_frameMs, double a_scaledMs);
+    float scale() const { return m_scale; }
+
+private:
+    float    m_scale      = 1.0f;
+    uint32_t m_overCount  = 0;
+    uint32_t m_underCount = 0;
+    double   m_frameMs    = 0.0;  // averaged over the frames counted in m_overCount or m_underCount
+    double   m_scaledMs   = 0.0;
+};
+
+}
+#endif // WATERAPP_RESOLUTIONCONTROLLER_HPP
@@ -0,0 +1,24 @@
+#!/bin/sh
+# Rebuilds the SPIR-V binaries loaded by the application, run from this directory. The qmake build runs the
+# same commands (spirv() in WaterApp.pri); this is for working on the shaders without it.
+set -e
+glslangValidator -V vertex.vert    -o vert.spv
+glslangValidator -V fragment.frag  -o frag.spv
+glslangValidator -V waterSim.comp  -o waterSim.spv
+glslangValidator -V waterLod.vert  -o waterLod.spv
+glslangValidator -V cull.comp      -o cull.spv
+glslangValidator -V floating.vert  -o floatingVert.spv
+glslangValidator -V floating.frag  -o floatingFrag.spv
+glslangValidator -V particleEmit.comp   -o particleEmit.spv
+glslangValidator -V particleUpdate.comp -o particleUpdate.spv
+glslangValidator -V particleSort.comp   -o particleSort.spv
+glslangValidator -V particle.vert       -o particleVert.spv
+glslangValidator -V particle.frag       -o particleFrag.spv
+glslangValidator -V oceanSpectrum.comp  -o oceanSpectrum.spv
+glslangValidator -V oceanFft.comp       -o oceanFft.spv
+glslangValidator -V oceanResolve.comp   -o oceanResolve.spv
+glslangValidator -V -DREFLECTIONS fragment.frag              -o fragReflect.spv
+glslangValidator -V hiz.comp                                -o hizReduce.spv
+glslangValidator -V -DCOPY_DEPTH hiz.comp                   -o hizCopy.spv
+glslangValidator -V -DCOPY_DEPTH -DMULTISAMPLED hiz.comp    -o hizCopyMs.spv
+glslangValidator -V sky.comp                                -o sky.spv
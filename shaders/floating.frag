@@ -0,0 +1,17 @@
+#version 450
+
+layout(location = 0) in vec3 normal;
+layout(location = 1) flat in uint type;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+  // debris, buoy, boat; see floatingType
+  vec3 albedo[3] = vec3[3](vec3(0.45, 0.33, 0.20), vec3(0.85, 0.25, 0.10), vec3(0.90, 0.88, 0.80));
+
+  vec3  lightDir = normalize(vec3(0.4, 1.0, 0.5));
+  float diffuse  = max(dot(normalize(normal), lightDir), 0.0);
+
+  color = vec4(albedo[min(type, 2u)] * (0.35 + 0.65 * diffuse), 1.0);
+}
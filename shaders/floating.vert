@@ -0,0 +1,83 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+layout(location = 0) in vec3 vertex;       // unit mesh, y up, origin at the waterline, see floatingObjects::buildMesh()
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec4 placement;    // per instance: xy - water space position (x, z), z - scale, w - heading
+layout(location = 3) in vec4 motion;       // per instance: xy - drift per second, z - draft in scales, w - type
+
+layout(location = 0) out vec3 normal;
+layout(location = 1) flat out uint type;
+
+layout(std430, set = 0, binding = 0) readonly buffer Heights { float heights[]; };
+#include "frame.glsl"
+
+layout(push_constant) uniform Params
+{
+  uint gridSize;
+} params;
+
+float heightAt(ivec2 p)
+{
+  int n = int(params.gridSize);
+  p = ((p % n) + n) % n;
+  return heights[p.y * n + p.x];
+}
+
+float sampleHeight(vec2 xz)
+{
+  vec2  g = xz * frame.space.x;
+  ivec2 i = ivec2(floor(g));
+  vec2  f = g - vec2(i);
+  return mix(mix(heightAt(i),              heightAt(i + ivec2(1, 0)), f.x),
+             mix(heightAt(i + ivec2(0, 1)), heightAt(i + ivec2(1, 1)), f.x), f.y);
+}
+
+// short waves travelling with the wind on top of the simulation, fanned out around the wind direction;
+// x - height in height units, yz - its gradient along water space x, z
+vec3 detailWaves(vec2 xz)
+{
+  vec3  sum        = vec3(0.0);
+  float amplitude  = frame.waves.x;
+  float wavelength = frame.waves.y;
+  int   count      = int(frame.waves.w);
+  for (int i = 0; i < count; i++)
+  {
+    float angle = 0.5 * (float(i) - 0.5 * float(count - 1));
+    vec2  dir   = mat2(cos(angle), sin(angle), -sin(angle), cos(angle)) * frame.wind.xy;
+    float k     = 6.2831853 / wavelength;
+    float phase = k * (dot(dir, xz) - frame.waves.z * sqrt(wavelength / frame.waves.y) * frame.camera.w) + 1.7 * float(i);
+    sum        += amplitude * vec3(sin(phase), k * cos(phase) * dir);
+    amplitude  *= 0.55;
+    wavelength *= 0.63;
+  }
+  return sum;
+}
+
+void main(void)
+{
+  vec2 xz = placement.xy + motion.xy * frame.camera.w;
+  if (frame.space.z > 0.0)
+    xz = fract(xz / frame.space.z) * frame.space.z;
+
+  // buoyancy at rest: the origin floats draft scales below the surface, the up axis follows the surface normal
+  vec3  detail = detailWaves(xz);
+  float cell   = 1.0 / frame.space.x;
+  float h      = (sampleHeight(xz) + detail.x) * frame.space.y;
+  float dx     = (sampleHeight(xz + vec2(cell, 0.0)) - sampleHeight(xz - vec2(cell, 0.0)) + 2.0 * cell * detail.y) * frame.space.y;
+  float dz     = (sampleHeight(xz + vec2(0.0, cell)) - sampleHeight(xz - vec2(0.0, cell)) + 2.0 * cell * detail.z) * frame.space.y;
+
+  vec3 up      = normalize(vec3(-dx, 2.0 * cell, -dz));
+  vec3 heading = vec3(cos(placement.w), 0.0, sin(placement.w));
+  vec3 side    = normalize(cross(heading, up));
+  vec3 forward = cross(up, side);
+  mat3 basis   = mat3(forward, up, side);
+
+  float scale = placement.z;
+  vec3  world = vec3(xz.x, h - motion.z * scale, xz.y) + basis * (vertex * scale);
+
+  normal = basis * vertexNormal;
+  type   = uint(motion.w);
+
+  gl_Position = frame.toClip * vec4(world, 1.0);
+}
@@ -1,8 +1,170 @@
-#version 330 core
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// The water. Built twice: as is it shades the surface on its own; with -DREFLECTIONS (fragReflect.spv) it
+// reflects and refracts the opaque scene through the inputs of waterReflections.hpp, see there.
+
+layout(location = 0) in vec3 normal;     // z up
+layout(location = 1) in float height;
+layout(location = 2) in float foam;      // 0..1, FFT ocean only
 
 layout(location = 0) out vec4 color;
 
+#ifndef REFLECTIONS
+
+void main()
+{
+  vec3  lightDir = normalize(vec3(0.4, 0.5, 1.0));
+  vec3  n        = normalize(normal);
+  float diffuse  = max(dot(n, lightDir), 0.0);
+  float specular = pow(max(dot(reflect(-lightDir, n), vec3(0.0, 0.0, 1.0)), 0.0), 32.0);
+
+  vec3 deep    = vec3(0.02, 0.12, 0.25);
+  vec3 shallow = vec3(0.10, 0.45, 0.60);
+  vec3 water   = mix(deep, shallow, clamp(0.5 + 0.5 * height, 0.0, 1.0));
+
+  vec3 lit = water * (0.3 + 0.7 * diffuse) + vec3(specular);
+  color = vec4(mix(lit, vec3(0.85, 0.9, 0.92) * (0.6 + 0.4 * diffuse), foam), 1.0);
+}
+
+#else
+
+layout(location = 3) in vec3 position;   // water space
+
+#include "frame.glsl"
+
+layout(set = 1, binding = 0) uniform sampler2D   sceneColor;   // the opaque pass
+layout(set = 1, binding = 1) uniform sampler2D   hiZ;          // nearest depth of 2^level pixels, level 0 - the depth
+layout(set = 1, binding = 2) uniform samplerCube sky;
+
+const float NO_HIT = -1.0;
+
+// Walks the screen space ray o + d t, t in [0, tEnd] (pixels and depth), through the Hi-Z chain: a cell the ray
+// stays in front of is skipped and the walk goes up a level, otherwise down, until at level 0 the ray has gone
+// behind a pixel's surface. Returns the t of that pixel, NO_HIT if the steps ran out first.
+float traceHiZ(vec3 o, vec3 d, float tEnd)
+{
+  int   steps     = int(frame.reflections.x);
+  int   maxLevel  = int(frame.reflections.y) - 1;
+  float thickness = frame.reflections.z;
+  float pixel     = 1.0 / max(length(d.xy), 1e-6);   // t per pixel along the ray
+  vec2  ahead     = vec2(d.x >= 0.0 ? 1.0 : 0.0, d.y >= 0.0 ? 1.0 : 0.0);
+
+  int   level = 0;
+  float t     = pixel;   // the water itself is not in the depth, one pixel only keeps off the edges of what it hides
+  for (int i = 0; i < steps && t < tEnd; i++)
+  {
+    float size = float(1 << level);
+    vec3  p    = o + d * t;
+    vec2  cell = floor(p.xy / size);
+
+    vec2  boundary = (cell + ahead) * size;
+    vec2  tCell    = vec2(abs(d.x) > 1e-6 ? (boundary.x - o.x) / d.x : 1e30,
+                          abs(d.y) > 1e-6 ? (boundary.y - o.y) / d.y : 1e30);
+    float tExit    = min(min(tCell.x, tCell.y), tEnd);
+
+    float nearest = texelFetch(hiZ, ivec2(cell), level).r;
+    float zEntry  = p.z;
+    float zExit   = o.z + d.z * tExit;
+
+    if (min(zEntry, zExit) > nearest)
+    {
+      t     = tExit + 0.01 * pixel;
+      level = min(level + 1, maxLevel);
+    }
+    else if (level > 0)
+      level--;
+    else
+    {
+      // behind the surface of this pixel: a hit, unless the ray passes behind a thin object
+      if (max(zEntry, zExit) >= nearest * (1.0 - thickness))
+        return t;
+      t = tExit + 0.01 * pixel;
+    }
+  }
+  return NO_HIT;
+}
+
+// The scene color where the water space ray from origin along dir meets the opaque depth; a - confidence, it
+// fades out towards the screen edges. False if the ray leaves the screen or the steps run out.
+bool traceReflection(vec3 origin, vec3 dir, float reach, out vec4 hit)
+{
+  vec4 c0 = frame.toClip * vec4(origin, 1.0);
+  vec4 c1 = frame.toClip * vec4(origin + dir * reach, 1.0);
+
+  // the end stays in front of the near plane (reverse-Z: z <= w) and behind the far one (z >= 0)
+  float e0 = c0.w - c0.z;
+  float e1 = c1.w - c1.z;
+  if (e1 < 0.0)
+    c1 = mix(c0, c1, 0.999 * e0 / (e0 - e1));
+  if (c1.z < 0.0)
+    c1 = mix(c0, c1, c0.z / (c0.z - c1.z));
+
+  // depth is linear in screen space, so the ray is a straight line in pixels and depth
+  vec3 s0 = vec3((c0.xy / c0.w * 0.5 + 0.5) * frame.screen.xy, c0.z / c0.w);
+  vec3 s1 = vec3((c1.xy / c1.w * 0.5 + 0.5) * frame.screen.xy, c1.z / c1.w);
+  vec3 d  = s1 - s0;
+
+  float tEnd = 1.0;
+  if (d.x > 0.0) tEnd = min(tEnd, (frame.screen.x - 0.5 - s0.x) / d.x);
+  if (d.x < 0.0) tEnd = min(tEnd, (0.5 - s0.x) / d.x);
+  if (d.y > 0.0) tEnd = min(tEnd, (frame.screen.y - 0.5 - s0.y) / d.y);
+  if (d.y < 0.0) tEnd = min(tEnd, (0.5 - s0.y) / d.y);
+  if (tEnd <= 0.0)
+    return false;
+
+  float t = traceHiZ(s0, d, tEnd);
+  if (t == NO_HIT)
+    return false;
+
+  vec2 p    = s0.xy + d.xy * t;
+  vec2 edge = min(p, frame.screen.xy - p) / (0.1 * frame.screen.xy);
+  hit = vec4(texture(sceneColor, p * frame.screen.zw).rgb, clamp(min(edge.x, edge.y), 0.0, 1.0));
+  return true;
+}
+
 void main()
 {
-  color = vec4(1.0f, 0.0f, 0.0f, 1.0f);
-}
\ No newline at end of file
+  // water space, y up; the sun is in the sky cube, so it comes with the reflection
+  vec3  lightDir = normalize(vec3(0.4, 1.0, 0.5));
+  vec3  n        = normalize(vec3(normal.x, normal.z, normal.y));
+  float diffuse  = max(dot(n, lightDir), 0.0);
+
+  vec3 deep    = vec3(0.02, 0.12, 0.25);
+  vec3 shallow = vec3(0.10, 0.45, 0.60);
+  vec3 body    = mix(deep, shallow, clamp(0.5 + 0.5 * height, 0.0, 1.0)) * (0.3 + 0.7 * diffuse);
+
+  // the eye ray through this pixel starts on the near plane, for the perspective and the orthographic view alike
+  vec2  pixel   = gl_FragCoord.xy;
+  vec4  near    = frame.fromClip * vec4(pixel / frame.screen.xy * 2.0 - 1.0, 1.0, 1.0);
+  vec3  eye     = position - near.xyz / near.w;
+  vec3  view    = normalize(eye);
+  vec3  r       = reflect(view, n);
+
+  vec3 reflected = texture(sky, r).rgb;
+  vec4 hit;
+  if (traceReflection(position, r, 16.0 * length(eye), hit))
+    reflected = mix(reflected, hit.rgb, hit.a);
+
+  // what lies beneath, seen through the surface bent by its normal; anything the offset finds in front of the
+  // water belongs to something above it, then straight below. Light is absorbed with the depth behind the surface.
+  vec3 refracted = body;
+  if (frame.reflections.w > 0.0)
+  {
+    vec2  p     = clamp(pixel + n.xz * frame.reflections.w * 0.03 * frame.screen.y, vec2(0.5), frame.screen.xy - 0.5);
+    float below = texelFetch(hiZ, ivec2(p), 0).r;
+    if (below > gl_FragCoord.z)
+    {
+      p     = pixel;
+      below = texelFetch(hiZ, ivec2(p), 0).r;
+    }
+    float absorbed = 1.0 - exp(-40.0 * max(1.0 - below / gl_FragCoord.z, 0.0));
+    refracted = mix(texture(sceneColor, p * frame.screen.zw).rgb, body, absorbed);
+  }
+
+  float fresnel = 0.02 + 0.98 * pow(1.0 - max(dot(-view, n), 0.0), 5.0);
+  vec3  lit     = mix(refracted, reflected, fresnel);
+  color = vec4(mix(lit, vec3(0.85, 0.9, 0.92) * (0.6 + 0.4 * diffuse), foam), 1.0);
+}
+
+#endif
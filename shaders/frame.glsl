@@ -0,0 +1,15 @@
+// Included by every shader that reads the frame constants, so they all see the one layout of frameUniforms; the qmake
+// build recompiles all of them when it changes, see spirv() in WaterApp.pri.
+
+layout(std140, set = 0, binding = 1) uniform Frame   // frameUniforms in frameConstants.hpp
+{
+  mat4 toClip;         // water space to clip space
+  vec4 camera;         // xyz - water space camera position, w - seconds since start
+  vec4 wind;           // xy - direction (x, z), z - speed, w - frame time step
+  vec4 waves;          // detail waves: x - amplitude, y - longest wavelength, z - phase speed, w - count
+  vec4 space;          // x - heightfield cells per water space unit, y - water space units per height unit, z - wrap period
+  vec4 ocean;          // FFT ocean: x - cascades, 0 - off; y - map size; z - cascade 0 patch size, water space units; w - cascade ratio
+  mat4 fromClip;       // clip space to water space
+  vec4 screen;         // xy - rendered pixels, zw - 1 / size of the scene copy
+  vec4 reflections;    // x - march steps, y - Hi-Z levels, z - thickness, w - refraction strength
+} frame;
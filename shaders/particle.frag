@@ -0,0 +1,14 @@
+#version 450
+
+layout(location = 0) in vec2  corner;
+layout(location = 1) in float opacity;
+
+layout(location = 0) out vec4 color;
+
+void main()
+{
+  // a soft round sprite, premultiplied alpha
+  float r     = dot(corner, corner);
+  float alpha = opacity * 0.6 * clamp(1.0 - r, 0.0, 1.0);
+  color = vec4(vec3(0.92, 0.96, 1.0) * alpha, alpha);
+}
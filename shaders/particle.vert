@@ -0,0 +1,55 @@
+#version 450
+
+layout(location = 0) out vec2  corner;   // -1..1 across the sprite
+layout(location = 1) out float opacity;
+
+struct Particle        // particleSystem.hpp: particle
+{
+  vec3  position;
+  float life;
+  vec3  velocity;
+  float size;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Particles { Particle particles[]; };
+layout(std430, set = 0, binding = 3) readonly buffer DrawList  { uvec2 drawList[]; };   // (sort key, particle)
+
+layout(push_constant) uniform Params
+{
+  mat4  toClip;        // water space to clip space
+  uint  gridSize;
+  float cellsPerUnit;
+  float heightToWorld;
+  float wrap;
+  float dt;
+  uint  seed;
+  float threshold;
+  float rate;
+  uint  mode;
+  uint  capacity;
+} params;
+
+const vec2 corners[6] = vec2[6](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+                                vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main(void)
+{
+  uint index = drawList[gl_InstanceIndex].y;
+  if (index >= params.capacity)
+  {
+    gl_Position = vec4(2.0, 2.0, 2.0, 1.0);   // outside the clip volume
+    return;
+  }
+
+  Particle particle = particles[index];
+
+  // screen aligned: grow the corner in clip space by how much a water space unit moves x and y of the clip position
+  vec4 clip  = params.toClip * vec4(particle.position, 1.0);
+  vec2 scale = vec2(length(vec3(params.toClip[0][0], params.toClip[1][0], params.toClip[2][0])),
+                    length(vec3(params.toClip[0][1], params.toClip[1][1], params.toClip[2][1])));
+
+  corner  = corners[gl_VertexIndex];
+  opacity = clamp(2.0 * particle.life, 0.0, 1.0);
+
+  gl_Position = vec4(clip.xy + corner * particle.size * scale, clip.zw);
+}
@@ -1,9 +1,114 @@
-#version 330
+#version 450
+#extension GL_GOOGLE_include_directive : require
 
-layout(location = 0) in vec2 vertex;
+layout(location = 0) in vec2 vertex;   // grid coordinates in [0,1]
+
+layout(location = 0) out vec3 normal;
+layout(location = 1) out float height;
+layout(location = 2) out float foam;
+layout(location = 3) out vec3 position;   // water space, for the reflections
+
+invariant gl_Position;   // the depth pre-pass and the shading pass must rasterize the same depth
+
+layout(std430, set = 0, binding = 0) readonly buffer Heights { float heights[]; };
+#include "frame.glsl"
+layout(std430, set = 0, binding = 2) readonly buffer Maps    { vec4 maps[]; };   // oceanFft::mapBuffer(), [cascade][y][x][2]
+
+layout(push_constant) uniform Params
+{
+  uint  gridSize;
+  float heightScale;   // height units per grid cell, only affects shading
+} params;
+
+float heightAt(int x, int y)
+{
+  int n = int(params.gridSize) - 1;
+  return heights[clamp(y, 0, n) * int(params.gridSize) + clamp(x, 0, n)];
+}
+
+// the displacement maps of all cascades at water space xz, bilinear and repeating: a - (dx, height, dz) in water
+// space units and dDx/dx; b - slopes along x and z, dDz/dz, dDx/dz
+void sampleOcean(vec2 xz, out vec4 a, out vec4 b)
+{
+  int   n      = int(frame.ocean.y);
+  float size   = frame.ocean.z;
+  a = vec4(0.0);
+  b = vec4(0.0);
+  for (int c = 0; c < int(frame.ocean.x); c++)
+  {
+    vec2  g = xz / size * float(n);
+    ivec2 i = ivec2(floor(g));
+    vec2  f = g - vec2(i);
+    ivec2 p[4] = ivec2[4](i, i + ivec2(1, 0), i + ivec2(0, 1), i + ivec2(1, 1));
+    float w[4] = float[4]((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    for (int j = 0; j < 4; j++)
+    {
+      ivec2 q     = ((p[j] % n) + n) % n;
+      int   texel = ((c * n + q.y) * n + q.x) * 2;
+      a += maps[texel]     * w[j];
+      b += maps[texel + 1] * w[j];
+    }
+    size /= frame.ocean.w;
+  }
+}
+
+// the surface folds over where the jacobian of the horizontal displacement drops towards 0
+float foamAmount(vec4 a, vec4 b)
+{
+  float jacobian = (1.0 + a.w) * (1.0 + b.z) - b.w * b.w;
+  return 1.0 - smoothstep(0.2, 0.8, jacobian);
+}
+
+// short waves travelling with the wind on top of the simulation, fanned out around the wind direction;
+// x - height in height units, yz - its gradient along water space x, z
+vec3 detailWaves(vec2 xz)
+{
+  vec3  sum        = vec3(0.0);
+  float amplitude  = frame.waves.x;
+  float wavelength = frame.waves.y;
+  int   count      = int(frame.waves.w);
+  for (int i = 0; i < count; i++)
+  {
+    float angle = 0.5 * (float(i) - 0.5 * float(count - 1));
+    vec2  dir   = mat2(cos(angle), sin(angle), -sin(angle), cos(angle)) * frame.wind.xy;
+    float k     = 6.2831853 / wavelength;
+    float phase = k * (dot(dir, xz) - frame.waves.z * sqrt(wavelength / frame.waves.y) * frame.camera.w) + 1.7 * float(i);
+    sum        += amplitude * vec3(sin(phase), k * cos(phase) * dir);
+    amplitude  *= 0.55;
+    wavelength *= 0.63;
+  }
+  return sum;
+}
 
 void main(void)
 {
-  gl_Position = vec4(vertex,0.0,1.0);
-  gl_Position.y = -gl_Position.y;	// Vulkan coordinate system is different t OpenGL    
+  // FFT ocean: the surface is displaced horizontally as well, the maps carry the slopes
+  if (frame.ocean.x > 0.0)
+  {
+    vec4 a, b;
+    sampleOcean(vertex, a, b);
+
+    normal = normalize(vec3(-b.x, -b.y, 1.0));
+    height = a.y / frame.space.y;
+    foam   = foamAmount(a, b);
+
+    position    = vec3(vertex.x + a.x, a.y, vertex.y + a.z);
+    gl_Position = frame.toClip * vec4(position, 1.0);
+    return;
+  }
+
+  ivec2 p = ivec2(round(vertex * float(params.gridSize - 1)));
+
+  vec3  detail = detailWaves(vertex);
+  float h      = heightAt(p.x, p.y) + detail.x;
+  float dx     = (heightAt(p.x + 1, p.y) - heightAt(p.x - 1, p.y) + 2.0 * detail.y / frame.space.x) * params.heightScale;
+  float dy     = (heightAt(p.x, p.y + 1) - heightAt(p.x, p.y - 1) + 2.0 * detail.z / frame.space.x) * params.heightScale;
+
+  normal = normalize(vec3(-dx, -dy, 2.0));  // central differences span two cells
+  height = h;
+  foam   = 0.0;
+
+  // the grid lies in water space x, z with the height along y; frame.toClip is a slightly oblique view from the front
+  position    = vec3(vertex.x, h * frame.space.y, vertex.y);
+  gl_Position = frame.toClip * vec4(position, 1.0);
 }
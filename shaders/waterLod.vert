@@ -0,0 +1,136 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+layout(location = 0) in vec2 vertex;       // patch coordinates in [0,1], see waterLod::buildPatchMesh()
+layout(location = 2) in vec4 patchInfo;    // per instance: xy - world corner (x, z), z - size, w - level
+layout(location = 3) in vec2 morphRange;   // per instance: camera distances where the morph starts and ends
+
+layout(location = 0) out vec3 normal;
+layout(location = 1) out float height;
+layout(location = 2) out float foam;
+layout(location = 3) out vec3 position;   // water space, for the reflections
+
+invariant gl_Position;   // the depth pre-pass and the shading pass must rasterize the same depth
+
+layout(std430, set = 0, binding = 0) readonly buffer Heights { float heights[]; };
+#include "frame.glsl"
+layout(std430, set = 0, binding = 2) readonly buffer Maps    { vec4 maps[]; };   // oceanFft::mapBuffer(), [cascade][y][x][2]
+
+layout(push_constant) uniform Params
+{
+  uint  gridSize;
+  float heightScale;   // world units per height unit
+  float tileSize;      // world units covered by the heightfield, it repeats beyond
+  float patchRes;      // quads per patch side
+} params;
+
+float heightAt(ivec2 p)
+{
+  int n = int(params.gridSize);
+  p = ((p % n) + n) % n;
+  return heights[p.y * n + p.x];
+}
+
+float sampleHeight(vec2 world)
+{
+  vec2  g = world / params.tileSize * float(params.gridSize);
+  ivec2 i = ivec2(floor(g));
+  vec2  f = g - vec2(i);
+  return mix(mix(heightAt(i),              heightAt(i + ivec2(1, 0)), f.x),
+             mix(heightAt(i + ivec2(0, 1)), heightAt(i + ivec2(1, 1)), f.x), f.y);
+}
+
+// the displacement maps of all cascades at water space xz, bilinear and repeating: a - (dx, height, dz) in water
+// space units and dDx/dx; b - slopes along x and z, dDz/dz, dDx/dz
+void sampleOcean(vec2 xz, out vec4 a, out vec4 b)
+{
+  int   n      = int(frame.ocean.y);
+  float size   = frame.ocean.z;
+  a = vec4(0.0);
+  b = vec4(0.0);
+  for (int c = 0; c < int(frame.ocean.x); c++)
+  {
+    vec2  g = xz / size * float(n);
+    ivec2 i = ivec2(floor(g));
+    vec2  f = g - vec2(i);
+    ivec2 p[4] = ivec2[4](i, i + ivec2(1, 0), i + ivec2(0, 1), i + ivec2(1, 1));
+    float w[4] = float[4]((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    for (int j = 0; j < 4; j++)
+    {
+      ivec2 q     = ((p[j] % n) + n) % n;
+      int   texel = ((c * n + q.y) * n + q.x) * 2;
+      a += maps[texel]     * w[j];
+      b += maps[texel + 1] * w[j];
+    }
+    size /= frame.ocean.w;
+  }
+}
+
+// the surface folds over where the jacobian of the horizontal displacement drops towards 0
+float foamAmount(vec4 a, vec4 b)
+{
+  float jacobian = (1.0 + a.w) * (1.0 + b.z) - b.w * b.w;
+  return 1.0 - smoothstep(0.2, 0.8, jacobian);
+}
+
+// short waves travelling with the wind on top of the simulation, fanned out around the wind direction;
+// x - height in height units, yz - its gradient along water space x, z
+vec3 detailWaves(vec2 xz)
+{
+  vec3  sum        = vec3(0.0);
+  float amplitude  = frame.waves.x;
+  float wavelength = frame.waves.y;
+  int   count      = int(frame.waves.w);
+  for (int i = 0; i < count; i++)
+  {
+    float angle = 0.5 * (float(i) - 0.5 * float(count - 1));
+    vec2  dir   = mat2(cos(angle), sin(angle), -sin(angle), cos(angle)) * frame.wind.xy;
+    float k     = 6.2831853 / wavelength;
+    float phase = k * (dot(dir, xz) - frame.waves.z * sqrt(wavelength / frame.waves.y) * frame.camera.w) + 1.7 * float(i);
+    sum        += amplitude * vec3(sin(phase), k * cos(phase) * dir);
+    amplitude  *= 0.55;
+    wavelength *= 0.63;
+  }
+  return sum;
+}
+
+void main(void)
+{
+  float size  = patchInfo.z;
+  vec2  world = patchInfo.xy + vertex * size;
+
+  // geomorph: odd vertices slide onto the edge between their even neighbours, so at morphRange.y the patch
+  // matches the grid of the next coarser level and the switch is seamless
+  float dist  = distance(vec3(world.x, 0.0, world.y), frame.camera.xyz);
+  float morph = clamp((dist - morphRange.x) / max(morphRange.y - morphRange.x, 1e-3), 0.0, 1.0);
+  vec2  grid  = round(vertex * params.patchRes);
+  grid -= fract(grid * 0.5) * 2.0 * morph;
+  world = patchInfo.xy + grid / params.patchRes * size;
+
+  if (frame.ocean.x > 0.0)
+  {
+    vec4 a, b;
+    sampleOcean(world, a, b);
+
+    normal = normalize(vec3(-b.x, -b.y, 1.0));
+    height = a.y / frame.space.y;
+    foam   = foamAmount(a, b);
+
+    position    = vec3(world.x + a.x, a.y, world.y + a.z);
+    gl_Position = frame.toClip * vec4(position, 1.0);
+    return;
+  }
+
+  vec3  detail = detailWaves(world);
+  float cell   = params.tileSize / float(params.gridSize);
+  float h      = sampleHeight(world) + detail.x;
+  float dx     = (sampleHeight(world + vec2(cell, 0.0)) - sampleHeight(world - vec2(cell, 0.0)) + 2.0 * cell * detail.y) * params.heightScale;
+  float dz     = (sampleHeight(world + vec2(0.0, cell)) - sampleHeight(world - vec2(0.0, cell)) + 2.0 * cell * detail.z) * params.heightScale;
+
+  normal = normalize(vec3(-dx, -dz, 2.0 * cell));  // z up, as fragment.frag expects
+  height = h;
+  foam   = 0.0;
+
+  position    = vec3(world.x, h * params.heightScale, world.y);
+  gl_Position = frame.toClip * vec4(position, 1.0);
+}
@@ -0,0 +1,93 @@
+#include "createApp.hpp"
+
+#include <algorithm>
+
+using namespace std;
+using namespace app;
+
+// copies of one frame start at this alignment, a safe value for vkCmdCopyBuffer and any data written by the CPU
+//
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+void stagingRing::init(deviceAllocator* a_pAllocator, uint32_t a_frameCount, VkDeviceSize a_bytesPerFrame)
+{
+    m_partSize = (a_bytesPerFrame + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+    a_pAllocator->createBuffer(m_partSize * a_frameCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &m_buffer, &m_memory);
+}
+
+void stagingRing::destroy(deviceAllocator* a_pAllocator)
+{
+    if (m_buffer != VK_NULL_HANDLE)
+        a_pAllocator->destroyBuffer(m_buffer, m_memory);
+    m_buffer = VK_NULL_HANDLE;
+}
+
+void stagingRing::beginFrame(uint32_t a_frame)
+{
+    m_frame = a_frame;
+    m_used  = 0;
+    m_copies.clear();
+}
+
+void* stagingRing::allocate(VkBuffer a_dst, VkDeviceSize a_dstOffset, VkDeviceSize a_size)
+{
+    const VkDeviceSize offset = (m_used + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    if (offset + a_size > m_partSize)
+        return nullptr;
+
+    m_used = offset + a_size;
+
+    pendingCopy copy;
+    copy.dst              = a_dst;
+    copy.region.srcOffset = m_partSize * m_frame + offset;
+    copy.region.dstOffset = a_dstOffset;
+    copy.region.size      = a_size;
+    m_copies.push_back(copy);
+
+    return (char*)m_memory.mapped + copy.region.srcOffset;
+}
+
+bool stagingRing::upload(VkBuffer a_dst, VkDeviceSize a_dstOffset, const void* a_data, VkDeviceSize a_size)
+{
+    void* dst = allocate(a_dst, a_dstOffset, a_size);
+    if (dst == nullptr)
+        return false;
+    memcpy(dst, a_data, size_t(a_size));
+    return true;
+}
+
+void stagingRing::cmdCopies(VkCommandBuffer a_cmdBuff)
+{
+    if (m_copies.empty())
+        return;
+
+    VkCommandBuffer cmdBuff = a_cmdBuff;
+
+    // the previous frame may still read the destinations (WAR, execution dependency only)
+    //
+    const VkPipelineStageFlags readers = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    vkCmdPipelineBarrier(cmdBuff, readers, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 0, NULL);
+
+    // copies into the same buffer are merged into one call
+    //
+    std::stable_sort(m_copies.begin(), m_copies.end(), [](const pendingCopy& a, const pendingCopy& b) { return a.dst < b.dst; });
+    std::vector<VkBufferCopy> regions;
+    for (size_t i = 0; i < m_copies.size(); )
+    {
+        regions.clear();
+        size_t j = i;
+        for (; j < m_copies.size() && m_copies[j].dst == m_copies[i].dst; j++)
+            regions.push_back(m_copies[j].region);
+        vkCmdCopyBuffer(cmdBuff, m_buffer, m_copies[i].dst, uint32_t(regions.size()), regions.data());
+        i = j;
+    }
+
+    VkMemoryBarrier barrier = {};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, readers, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
@@ -0,0 +1,55 @@
+#ifndef WATERAPP_STAGINGRING_HPP
+#define WATERAPP_STAGINGRING_HPP
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+#include "deviceAllocator.hpp"
+
+namespace app
+{
+
+// Persistently mapped host visible buffer split into one part per frame in flight. During a frame the CPU
+// writes dynamic data (heights, particles, uniforms) linearly into the frame's part and every upload becomes
+// a vkCmdCopyBuffer recorded at the start of the frame's own command buffer.
+// A part is reused only after the fence of its frame was waited, so the CPU never waits for an upload.
+//
+class stagingRing
+{
+public:
+    void init(deviceAllocator* a_pAllocator, uint32_t a_frameCount, VkDeviceSize a_bytesPerFrame);
+    void destroy(deviceAllocator* a_pAllocator);
+
+    // a_frame must not be in flight any more: call after its fence was waited
+    //
+    void beginFrame(uint32_t a_frame);
+
+    // Reserves a_size bytes for a copy into a_dst at a_dstOffset and returns where to write them,
+    // nullptr if the frame's part is full. The data must be written before endFrame().
+    //
+    void* allocate(VkBuffer a_dst, VkDeviceSize a_dstOffset, VkDeviceSize a_size);
+    bool  upload  (VkBuffer a_dst, VkDeviceSize a_dstOffset, const void* a_data, VkDeviceSize a_size);
+
+    // Records the copies of the frame and the barriers around them, nothing if nothing was uploaded.
+    //
+    void cmdCopies(VkCommandBuffer a_cmdBuff);
+
+    VkDeviceSize frameBytes() const    { return m_used; }     // uploaded in the current frame
+    VkDeviceSize bytesPerFrame() const { return m_partSize; }
+
+private:
+    struct pendingCopy
+    {
+        VkBuffer     dst;
+        VkBufferCopy region;
+    };
+
+    VkBuffer                 m_buffer   = VK_NULL_HANDLE;
+    deviceAllocation         m_memory;
+    VkDeviceSize             m_partSize = 0;
+    uint32_t                 m_frame    = 0;
+    VkDeviceSize             m_used     = 0;
+    std::vector<pendingCopy> m_copies;
+};
+
+}
+#endif // WATERAPP_STAGINGRING_HPP
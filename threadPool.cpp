@@ -0,0 +1,104 @@
+#include "threadPool.hpp"
+
+#include <algorithm>
+
+using namespace app;
+
+threadPool::threadPool(unsigned a_threads) : m_next(0)
+{
+    if (a_threads == 0)
+        a_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (unsigned i = 1; i < a_threads; i++)
+        m_workers.emplace_back(&threadPool::workerLoop, this, i);
+}
+
+threadPool::~threadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void threadPool::parallelFor(uint32_t a_count, const std::function<void(uint32_t)>& a_job)
+{
+    std::function<void(uint32_t, unsigned)> job = [&a_job](uint32_t a_index, unsigned) { a_job(a_index); };
+    parallelFor(a_count, job);
+}
+
+void threadPool::parallelFor(uint32_t a_count, const std::function<void(uint32_t, unsigned)>& a_job)
+{
+    if (m_workers.empty() || a_count <= 1)
+    {
+        for (uint32_t i = 0; i < a_count; i++)
+            a_job(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job   = &a_job;
+        m_count = a_count;
+        m_next  = 0;
+        m_busy  = uint32_t(m_workers.size());
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runJobs(0);
+
+    // every worker has to leave runJobs() before a_job goes out of scope
+    //
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_job = nullptr;
+
+    if (m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void threadPool::runJobs(unsigned a_thread)
+{
+    for (uint32_t i = m_next++; i < m_count; i = m_next++)
+    {
+        try
+        {
+            (*m_job)(i, a_thread);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error)
+                m_error = std::current_exception();
+        }
+    }
+}
+
+void threadPool::workerLoop(unsigned a_thread)
+{
+    uint64_t seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seenGeneration; });
+            if (m_stop)
+                return;
+            seenGeneration = m_generation;
+        }
+
+        runJobs(a_thread);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy == 0)
+            m_done.notify_one();
+    }
+}
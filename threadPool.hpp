@@ -0,0 +1,53 @@
+#ifndef WATERAPP_THREADPOOL_HPP
+#define WATERAPP_THREADPOOL_HPP
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace app
+{
+
+// Fixed set of worker threads running one parallelFor() at a time.
+// The calling thread takes part in the work, so a pool of N threads uses N-1 workers.
+//
+class threadPool
+{
+public:
+    explicit threadPool(unsigned a_threads = 0);  // 0 - std::thread::hardware_concurrency()
+    ~threadPool();
+
+    threadPool(const threadPool&) = delete;
+    threadPool& operator=(const threadPool&) = delete;
+
+    // Calls a_job(i) for every i in [0, a_count) and returns when all calls are done.
+    // The second form also passes the index of the calling thread, in [0, threadCount()), 0 - the caller;
+    // jobs with the same thread index never run concurrently, so they may share per-thread state.
+    // The first exception thrown by a job is rethrown here after all jobs finished.
+    //
+    void     parallelFor(uint32_t a_count, const std::function<void(uint32_t)>& a_job);
+    void     parallelFor(uint32_t a_count, const std::function<void(uint32_t, unsigned)>& a_job);
+    unsigned threadCount() const { return unsigned(m_workers.size()) + 1; }
+
+private:
+    void workerLoop(unsigned a_thread);
+    void runJobs(unsigned a_thread);
+
+    std::vector<std::thread>               m_workers;
+    std::mutex                             m_mutex;
+    std::condition_variable                m_wake;
+    std::condition_variable                m_done;
+    const std::function<void(uint32_t, unsigned)>* m_job = nullptr;
+    uint32_t                               m_count    = 0;
+    std::atomic<uint32_t>                  m_next;
+    uint32_t                               m_busy     = 0;   // workers inside the current parallelFor
+    std::exception_ptr                     m_error;
+    uint64_t                               m_generation = 0;
+    bool                                   m_stop     = false;
+};
+
+}
+#endif // WATERAPP_THREADPOOL_HPP
@@ -0,0 +1,63 @@
+#include "vkUtils.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+VkBufferMemoryBarrier vk_utils::bufferBarrier(VkBuffer a_buffer, VkAccessFlags a_srcAccess, VkAccessFlags a_dstAccess)
+{
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = a_srcAccess;
+    barrier.dstAccessMask       = a_dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = a_buffer;
+    barrier.offset              = 0;
+    barrier.size                = VK_WHOLE_SIZE;
+    return barrier;
+}
+
+VkShaderModule vk_utils::createShaderModule(VkDevice a_device, const std::vector<uint32_t>& code)
+{
+    VkShaderModuleCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size() * sizeof(uint32_t);
+    createInfo.pCode = code.data();
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(a_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+        throw std::runtime_error("[CreateShaderModule]: failed to create shader module!");
+
+    return shaderModule;
+}
+
+std::vector<uint32_t> vk_utils::readFile(const char* filename)
+{
+    FILE* fp = fopen(filename, "rb");
+    if (fp == NULL)
+    {
+        std::string errorMsg = std::string("readFile, can't open file ") + std::string(filename);
+        throw std::runtime_error(errorMsg.c_str());
+    }
+
+    // get file size.
+    fseek(fp, 0, SEEK_END);
+    long filesize = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    long filesizepadded = long(ceil(filesize / 4.0)) * 4;
+
+    std::vector<uint32_t> resData(filesizepadded/4);
+
+    // read file contents.
+    char *str = (char*)resData.data();
+    fread(str, filesize, sizeof(char), fp);
+    fclose(fp);
+
+    // data padding.
+    for (int i = filesize; i < filesizepadded; i++)
+        str[i] = 0;
+
+    return resData;
+}
@@ -0,0 +1,17 @@
+#ifndef WATERAPP_VKUTILS_HPP
+#define WATERAPP_VKUTILS_HPP
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+// Small stateless helpers shared by the application and its subsystems.
+// Memory is allocated through deviceAllocator, which caches the memory properties.
+//
+namespace vk_utils
+{
+    VkShaderModule        createShaderModule(VkDevice a_device, const std::vector<uint32_t>& code);
+    std::vector<uint32_t> readFile(const char* filename);
+
+    VkBufferMemoryBarrier bufferBarrier(VkBuffer a_buffer, VkAccessFlags a_srcAccess, VkAccessFlags a_dstAccess);
+}
+
+#endif // WATERAPP_VKUTILS_HPP
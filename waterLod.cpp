@@ -0,0 +1,315 @@
+#include "waterLod.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace app;
+
+static void normalize3(float* a_v)
+{
+    const float len = std::sqrt(a_v[0] * a_v[0] + a_v[1] * a_v[1] + a_v[2] * a_v[2]);
+    for (int i = 0; i < 3; i++)
+        a_v[i] /= (len > 0.0f ? len : 1.0f);
+}
+
+static void cross3(const float* a, const float* b, float* a_out)
+{
+    a_out[0] = a[1] * b[2] - a[2] * b[1];
+    a_out[1] = a[2] * b[0] - a[0] * b[2];
+    a_out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+void lodCamera::viewProj(float a_aspect, float a_pMatrix[16]) const
+{
+    // view: right-handed look-at, the camera looks down -z
+    //
+    float forward[3] = { target[0] - position[0], target[1] - position[1], target[2] - position[2] };
+    normalize3(forward);
+    const float up[3] = { 0.0f, 1.0f, 0.0f };
+    float right[3], trueUp[3];
+    cross3(forward, up, right);
+    normalize3(right);
+    cross3(right, forward, trueUp);
+
+    float view[16] = {};
+    for (int i = 0; i < 3; i++)
+    {
+        view[i * 4 + 0] =  right[i];
+        view[i * 4 + 1] =  trueUp[i];
+        view[i * 4 + 2] = -forward[i];
+    }
+    view[12] = -(right[0]   * position[0] + right[1]   * position[1] + right[2]   * position[2]);
+    view[13] = -(trueUp[0]  * position[0] + trueUp[1]  * position[1] + trueUp[2]  * position[2]);
+    view[14] =  (forward[0] * position[0] + forward[1] * position[1] + forward[2] * position[2]);
+    view[15] = 1.0f;
+
+    // projection: y flipped for Vulkan, reverse-Z depth from 1 at nearZ to 0 at farZ; the float depth buffer
+    // has most of its precision near 0, where it offsets the 1/z falloff of the distant water
+    //
+    const float f = 1.0f / std::tan(fovY * 0.5f);
+    float proj[16] = {};
+    proj[0]  =  f / a_aspect;
+    proj[5]  = -f;
+    proj[10] =  nearZ / (farZ - nearZ);
+    proj[11] = -1.0f;
+    proj[14] =  nearZ * farZ / (farZ - nearZ);
+
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++)
+                sum += proj[k * 4 + r] * view[c * 4 + k];
+            a_pMatrix[c * 4 + r] = sum;
+        }
+}
+
+void app::frustumPlanes(const float a_viewProj[16], float a_planes[6][4])
+{
+    // planes from the rows of the matrix, column major
+    //
+    for (int i = 0; i < 4; i++)
+    {
+        const float r0 = a_viewProj[i * 4 + 0], r1 = a_viewProj[i * 4 + 1], r2 = a_viewProj[i * 4 + 2], r3 = a_viewProj[i * 4 + 3];
+        a_planes[0][i] = r3 + r0;
+        a_planes[1][i] = r3 - r0;
+        a_planes[2][i] = r3 + r1;
+        a_planes[3][i] = r3 - r1;
+        a_planes[4][i] = r2;
+        a_planes[5][i] = r3 - r2;
+    }
+}
+
+void waterLod::buildPatchMesh(uint32_t a_patchRes, meshSource* a_pMesh)
+{
+    const uint32_t side  = a_patchRes + 1;
+    const uint32_t half  = a_patchRes / 2;
+    const float    scale = 1.0f / float(a_patchRes);
+
+    a_pMesh->positionComponents = 2;
+    a_pMesh->normals.clear();
+    a_pMesh->positions.resize(size_t(side) * side * 2);
+    for (uint32_t y = 0; y < side; y++)
+    {
+        for (uint32_t x = 0; x < side; x++)
+        {
+            a_pMesh->positions[(size_t(y) * side + x) * 2 + 0] = float(x) * scale;
+            a_pMesh->positions[(size_t(y) * side + x) * 2 + 1] = float(y) * scale;
+        }
+    }
+
+    a_pMesh->indices.clear();
+    a_pMesh->segments.clear();
+    for (uint32_t q = 0; q < 4; q++)
+    {
+        a_pMesh->segments.push_back(uint32_t(a_pMesh->indices.size() / 3));
+
+        const uint32_t x0 = (q & 1) ? half : 0;
+        const uint32_t y0 = (q & 2) ? half : 0;
+        for (uint32_t y = y0; y < y0 + half; y++)
+        {
+            for (uint32_t x = x0; x < x0 + half; x++)
+            {
+                const uint32_t i00 = y * side + x, i10 = i00 + 1;
+                const uint32_t i01 = i00 + side,   i11 = i01 + 1;
+
+                const uint32_t quad[6] = { i00, i10, i11,  i00, i11, i01 };
+                a_pMesh->indices.insert(a_pMesh->indices.end(), quad, quad + 6);
+            }
+        }
+    }
+}
+
+void waterLod::updateRanges()
+{
+    if (levels == 0 || levels > MAX_LEVELS)
+        levels = (levels == 0) ? 1 : MAX_LEVELS;
+    patchRes = std::max(2u, patchRes & ~1u);
+
+    const float finestSize = worldSize / float(1u << (levels - 1));
+    for (uint32_t l = 0; l < levels; l++)
+    {
+        m_ranges[l]     = lodRatio * finestSize * float(1u << l);
+        const float low = (l == 0) ? 0.0f : m_ranges[l - 1];
+        m_morphStart[l] = low + (m_ranges[l] - low) * morphRatio;
+    }
+}
+
+void waterLod::view(const lodCamera& a_camera, float a_aspect)
+{
+    a_camera.viewProj(a_aspect, m_viewProj);
+    for (int i = 0; i < 3; i++)
+        m_camera[i] = a_camera.position[i];
+
+    frustumPlanes(m_viewProj, m_planes);
+}
+
+void waterLod::select(const lodCamera& a_camera, float a_aspect)
+{
+    updateRanges();
+    view(a_camera, a_aspect);
+
+    m_patches.clear();
+    m_draws.clear();
+
+    // beyond the coarsest range the whole ocean is a single patch
+    //
+    const float half = worldSize * 0.5f;
+    if (!selectNode(-half, -half, worldSize, levels - 1) && inFrustum(-half, -half, worldSize))
+        addPatch(-half, -half, worldSize, levels - 1, 0xF);
+
+    std::sort(m_draws.begin(), m_draws.end(), [](const lodDraw& a, const lodDraw& b) { return a.distance < b.distance; });
+}
+
+void waterLod::allNodes(std::vector<lodPatch>* a_pNodes)
+{
+    updateRanges();
+    if (nodeCount(levels) > MAX_NODES)
+        throw std::runtime_error("[waterLod::allNodes]: too many levels for the node limit!");
+
+    // level by level from the root; the children of a node are offset exactly as selectNode() offsets them, so
+    // their bounds match the parent's quadrant bounds bit for bit
+    //
+    a_pNodes->clear();
+    a_pNodes->reserve(size_t(nodeCount(levels)));
+
+    lodPatch root = {};
+    root.offsetX    = -worldSize * 0.5f;
+    root.offsetZ    = -worldSize * 0.5f;
+    root.size       = worldSize;
+    root.level      = float(levels - 1);
+    root.morphStart = m_morphStart[levels - 1];
+    root.morphEnd   = m_ranges[levels - 1];
+    a_pNodes->push_back(root);
+
+    for (size_t parent = 0; parent < a_pNodes->size(); parent++)
+    {
+        const lodPatch node = (*a_pNodes)[parent];
+        if (node.level == 0.0f)
+            continue;
+
+        const uint32_t level = uint32_t(node.level) - 1;
+        const float    half  = node.size * 0.5f;
+        for (uint32_t q = 0; q < 4; q++)
+        {
+            lodPatch child = {};
+            child.offsetX    = node.offsetX + ((q & 1) ? half : 0.0f);
+            child.offsetZ    = node.offsetZ + ((q & 2) ? half : 0.0f);
+            child.size       = half;
+            child.level      = float(level);
+            child.morphStart = m_morphStart[level];
+            child.morphEnd   = m_ranges[level];
+            a_pNodes->push_back(child);
+        }
+    }
+}
+
+bool waterLod::selectNode(float a_x, float a_z, float a_size, uint32_t a_level)
+{
+    // not within the own range: the parent covers this area
+    //
+    if (!inRange(a_x, a_z, a_size, m_ranges[a_level]))
+        return false;
+
+    if (!inFrustum(a_x, a_z, a_size))
+        return true;
+
+    if (a_level == 0 || !inRange(a_x, a_z, a_size, m_ranges[a_level - 1]))
+    {
+        addPatch(a_x, a_z, a_size, a_level, 0xF);
+        return true;
+    }
+
+    const float half = a_size * 0.5f;
+    uint32_t    left = 0;
+    for (uint32_t q = 0; q < 4; q++)
+    {
+        if (!selectNode(a_x + ((q & 1) ? half : 0.0f), a_z + ((q & 2) ? half : 0.0f), half, a_level - 1))
+            left |= 1u << q;
+    }
+    if (left != 0)
+        addPatch(a_x, a_z, a_size, a_level, left);
+    return true;
+}
+
+void waterLod::addPatch(float a_x, float a_z, float a_size, uint32_t a_level, uint32_t a_quadrants)
+{
+    if (m_patches.size() >= MAX_PATCHES)
+        throw std::runtime_error("[waterLod::addPatch]: more than MAX_PATCHES patches selected!");
+
+    lodPatch patch = {};
+    patch.offsetX    = a_x;
+    patch.offsetZ    = a_z;
+    patch.size       = a_size;
+    patch.level      = float(a_level);
+    patch.morphStart = m_morphStart[a_level];
+    patch.morphEnd   = m_ranges[a_level];
+
+    const float half = a_size * 0.5f;
+    for (uint32_t q = 0; q < 4; q++)
+    {
+        if (!(a_quadrants & (1u << q)))
+            continue;
+
+        const float cx = a_x + ((q & 1) ? 1.5f : 0.5f) * half;
+        const float cz = a_z + ((q & 2) ? 1.5f : 0.5f) * half;
+        const float dx = cx - m_camera[0], dy = m_camera[1], dz = cz - m_camera[2];
+
+        lodDraw draw;
+        draw.patch    = uint32_t(m_patches.size());
+        draw.quadrant = q;
+        draw.distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        m_draws.push_back(draw);
+    }
+    m_patches.push_back(patch);
+}
+
+bool waterLod::inRange(float a_x, float a_z, float a_size, float a_range) const
+{
+    // sphere around the camera against the node's bounding box
+    //
+    const float dx = std::max(std::max(a_x - m_camera[0], 0.0f), m_camera[0] - (a_x + a_size));
+    const float dz = std::max(std::max(a_z - m_camera[2], 0.0f), m_camera[2] - (a_z + a_size));
+    const float dy = std::max(std::fabs(m_camera[1]) - maxHeight, 0.0f);
+    return dx * dx + dy * dy + dz * dz <= a_range * a_range;
+}
+
+void waterLod::drawBounds(const lodDraw& a_draw, float a_min[3], float a_max[3]) const
+{
+    quadrantBounds(m_patches[a_draw.patch], a_draw.quadrant, a_min, a_max);
+}
+
+void waterLod::quadrantBounds(const lodPatch& a_patch, uint32_t a_quadrant, float a_min[3], float a_max[3]) const
+{
+    const float half = a_patch.size * 0.5f;
+
+    a_min[0] = a_patch.offsetX + ((a_quadrant & 1) ? half : 0.0f);
+    a_min[1] = -maxHeight;
+    a_min[2] = a_patch.offsetZ + ((a_quadrant & 2) ? half : 0.0f);
+    a_max[0] = a_min[0] + half;
+    a_max[1] = maxHeight;
+    a_max[2] = a_min[2] + half;
+}
+
+bool waterLod::inFrustum(float a_x, float a_z, float a_size) const
+{
+    if (!cullFrustum)
+        return true;
+
+    const float lo[3] = { a_x,          -maxHeight, a_z          };
+    const float hi[3] = { a_x + a_size,  maxHeight, a_z + a_size };
+
+    // the box is outside if its corner furthest along a plane normal is behind the plane
+    //
+    for (int p = 0; p < 6; p++)
+    {
+        const float* plane = m_planes[p];
+        float d = plane[3];
+        for (int i = 0; i < 3; i++)
+            d += plane[i] * (plane[i] >= 0.0f ? hi[i] : lo[i]);
+        if (d < 0.0f)
+            return false;
+    }
+    return true;
+}
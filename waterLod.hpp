@@ -0,0 +1,133 @@
+#ifndef WATERAPP_WATERLOD_HPP
+#define WATERAPP_WATERLOD_HPP
+#include <cstdint>
+#include <vector>
+
+#include "gpuMesh.hpp"
+
+namespace app
+{
+
+// Per instance vertex attributes of shaders/waterLod.vert (locations 2 and 3), keep in sync with the shader.
+//
+struct lodPatch
+{
+    float offsetX, offsetZ;        // world position of the patch corner
+    float size;                    // world size of the patch side
+    float level;
+    float morphStart, morphEnd;    // camera distances where the geomorph towards the next coarser level starts and ends
+    float pad[2];
+};
+
+// Push constants of shaders/waterLod.vert, keep in sync with the shader.
+//
+struct lodRenderParams
+{
+    uint32_t gridSize;             // of the simulation heightfield, which repeats every tileSize world units
+    float    heightScale;          // world units per height unit
+    float    tileSize;
+    float    patchRes;             // quads per patch side
+};
+
+// Perspective camera, y up. Builds matrices for Vulkan clip space: y down, reverse-Z depth from 1 at nearZ to 0 at farZ.
+//
+class lodCamera
+{
+public:
+    float position[3] = { 0.0f, 40.0f, 0.0f };
+    float target[3]   = { 0.0f, 0.0f, 200.0f };
+    float fovY        = 1.0f;      // radians
+    float nearZ       = 0.5f;
+    float farZ        = 20000.0f;
+
+    void viewProj(float a_aspect, float a_pMatrix[16]) const;
+};
+
+// Frustum planes of a view-projection matrix for depth in [0,1] (Gribb/Hartmann), not normalized:
+// a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all six. With reverse-Z the depth planes
+// swap, plane 4 is the far and plane 5 the near one.
+//
+void frustumPlanes(const float a_viewProj[16], float a_planes[6][4]);
+
+// Chosen patch quadrant, see waterLod::buildPatchMesh(); recorded as one draw of that mesh segment.
+//
+class lodDraw
+{
+public:
+    uint32_t patch    = 0;         // index into patches(), the instance of the draw
+    uint32_t quadrant = 0;
+    float    distance = 0.0f;
+};
+
+// CDLOD (Strugar, "Continuous Distance-Dependent Level of Detail for Rendering Heightmaps") for the water surface.
+//
+// A quadtree over the worldSize x worldSize ocean, centered at the origin. Every node is drawn with the same
+// patchRes x patchRes patch mesh, so a node of level L has 2^L times coarser vertices than the finest one. select()
+// walks the tree from the root: a node is subdivided while the camera is within the range of the next finer level;
+// quadrants the finer level does not cover are drawn by the node itself, nodes outside the frustum are dropped.
+// Ranges double per level, so the drawn triangle count depends on the view and the ranges, not on worldSize.
+//
+// Vertices morph into the next coarser level's grid while their distance goes from morphStart to morphEnd, so
+// neighbouring patches of different levels meet without cracks or popping.
+//
+// GPU driven drawing skips select(): allNodes() is every node of the tree, uploaded once, and the cull pass of
+// gpuCuller repeats the range tests of select() per node quadrant; the CPU only computes view() every frame.
+//
+class waterLod
+{
+public:
+    static const uint32_t MAX_LEVELS  = 16;
+    static const uint32_t MAX_PATCHES = 4096;  // capacity of the instance buffer
+    static const uint32_t MAX_NODES   = 1u << 20;  // of allNodes(), 10 levels
+
+    float    worldSize   = 8192.0f;
+    float    tileSize    = 256.0f;   // world size of the simulation heightfield, repeated over the ocean
+    float    heightScale = 2.0f;
+    float    maxHeight   = 4.0f;     // world units, bounds the displaced surface for culling
+    uint32_t levels      = 8;
+    uint32_t patchRes    = 32;       // even
+    float    lodRatio    = 2.0f;     // range of the finest level in finest patch sizes
+    float    morphRatio  = 0.7f;     // the morph starts at this fraction between the previous level's range and the own one
+    bool     cullFrustum = true;     // false - keep nodes outside the frustum
+
+    // (patchRes + 1)^2 vertices with patch coordinates in [0,1]^2; 4 segments, one per quadrant:
+    // 0 - low x low z, 1 - high x low z, 2 - low x high z, 3 - high x high z
+    //
+    static void buildPatchMesh(uint32_t a_patchRes, meshSource* a_pMesh);
+
+    static uint64_t nodeCount(uint32_t a_levels) { return ((uint64_t(1) << (2 * a_levels)) - 1) / 3; }
+
+    void view  (const lodCamera& a_camera, float a_aspect);   // viewProj() and the camera of the frame, part of select()
+    void select(const lodCamera& a_camera, float a_aspect);
+
+    // Every node, coarsest level first, with the morph ranges select() would give it. Throws beyond MAX_NODES.
+    //
+    void allNodes(std::vector<lodPatch>* a_pNodes);
+
+    const float*                 viewProj() const      { return m_viewProj; }
+    const float*                 camera() const        { return m_camera; }
+    float                        finestRange() const   { return m_ranges[0]; }   // after select() or allNodes()
+    const std::vector<lodPatch>& patches() const       { return m_patches; }
+    const std::vector<lodDraw>&  draws() const         { return m_draws; }     // front to back, for the early depth test
+    void                         drawBounds(const lodDraw& a_draw, float a_min[3], float a_max[3]) const;
+    void                         quadrantBounds(const lodPatch& a_patch, uint32_t a_quadrant, float a_min[3], float a_max[3]) const;
+    uint64_t                     triangleCount() const { return uint64_t(m_draws.size()) * (patchRes / 2) * (patchRes / 2) * 2; }
+
+private:
+    void updateRanges();
+    bool selectNode(float a_x, float a_z, float a_size, uint32_t a_level);
+    void addPatch  (float a_x, float a_z, float a_size, uint32_t a_level, uint32_t a_quadrants);
+    bool inRange   (float a_x, float a_z, float a_size, float a_range) const;
+    bool inFrustum (float a_x, float a_z, float a_size) const;
+
+    float                 m_ranges[MAX_LEVELS];
+    float                 m_morphStart[MAX_LEVELS];
+    float                 m_viewProj[16];
+    float                 m_planes[6][4];
+    float                 m_camera[3];
+    std::vector<lodPatch> m_patches;
+    std::vector<lodDraw>  m_draws;
+};
+
+}
+#endif // WATERAPP_WATERLOD_HPP
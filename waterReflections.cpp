@@ -0,0 +1,449 @@
+#include "createApp.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+using namespace app;
+
+// what a quality preset allows: the march length adapts between minSteps and maxSteps
+//
+struct reflectionPreset
+{
+    uint32_t minSteps;
+    uint32_t maxSteps;
+    uint32_t hizLevels;
+    float    thickness;    // of the depth buffer surfaces, a fraction of their depth
+    float    refraction;   // strength of the refraction offset, 0 - the water body colour only
+};
+
+static const reflectionPreset g_presets[REFLECTION_QUALITY_COUNT] = {
+    {  0,  0, 0, 0.0f,  0.0f },
+    {  8, 24, 4, 0.05f, 0.0f },
+    { 16, 48, 6, 0.03f, 0.6f },
+    { 32, 96, 8, 0.02f, 1.0f },
+};
+
+static const char* g_qualityNames[REFLECTION_QUALITY_COUNT] = { "off", "low", "medium", "high" };
+
+const char* app::reflectionQualityName(reflectionQuality a_quality)
+{
+    return g_qualityNames[a_quality];
+}
+
+bool app::parseReflectionQuality(const char* a_name, reflectionQuality* a_pQuality)
+{
+    for (int i = 0; i < REFLECTION_QUALITY_COUNT; i++)
+    {
+        if (strcmp(g_qualityNames[i], a_name) == 0)
+        {
+            (*a_pQuality) = reflectionQuality(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static VkPipeline createComputePipeline(VkDevice a_device, VkPipelineCache a_pipelineCache, VkPipelineLayout a_layout, const char* a_shaderFile)
+{
+    auto           shaderCode   = vk_utils::readFile(a_shaderFile);
+    VkShaderModule shaderModule = vk_utils::createShaderModule(a_device, shaderCode);
+
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName  = "main";
+    pipelineInfo.layout       = a_layout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateComputePipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("[waterReflections::init]: failed to create compute pipeline!");
+
+    vkDestroyShaderModule(a_device, shaderModule, NULL);
+    return pipeline;
+}
+
+static VkPipelineLayout createPipelineLayout(VkDevice a_device, VkDescriptorSetLayout a_setLayout, uint32_t a_pushSize)
+{
+    VkPushConstantRange pushConstant = {};
+    pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstant.offset     = 0;
+    pushConstant.size       = a_pushSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 1;
+    pipelineLayoutInfo.pSetLayouts            = &a_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = (a_pushSize > 0) ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VK_CHECK_RESULT(vkCreatePipelineLayout(a_device, &pipelineLayoutInfo, NULL, &layout));
+    return layout;
+}
+
+static VkSampler createSampler(VkDevice a_device, VkFilter a_filter)
+{
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter    = a_filter;
+    samplerInfo.minFilter    = a_filter;
+    samplerInfo.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod       = float(waterReflections::HIZ_LEVELS);
+
+    VkSampler sampler = VK_NULL_HANDLE;
+    VK_CHECK_RESULT(vkCreateSampler(a_device, &samplerInfo, NULL, &sampler));
+    return sampler;
+}
+
+// the writes of the previous level become visible to the next one
+//
+static void cmdLevelBarrier(VkCommandBuffer a_cmdBuff)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+static VkWriteDescriptorSet imageWrite(VkDescriptorSet a_set, uint32_t a_binding, VkDescriptorType a_type, const VkDescriptorImageInfo* a_pInfo)
+{
+    VkWriteDescriptorSet write = {};
+    write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet          = a_set;
+    write.dstBinding      = a_binding;
+    write.descriptorCount = 1;
+    write.descriptorType  = a_type;
+    write.pImageInfo      = a_pInfo;
+    return write;
+}
+
+void waterReflections::init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+                            VkSampleCountFlagBits a_depthSamples)
+{
+    m_linearSampler  = createSampler(a_device, VK_FILTER_LINEAR);
+    m_nearestSampler = createSampler(a_device, VK_FILTER_NEAREST);
+
+    // the sky: a cube for the fragment shader, written face by face as a 2D array
+    //
+    {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.flags         = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+        imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageInfo.format        = VK_FORMAT_R8G8B8A8_UNORM;
+        imageInfo.extent        = { SKY_SIZE, SKY_SIZE, 1 };
+        imageInfo.mipLevels     = 1;
+        imageInfo.arrayLayers   = 6;
+        imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage         = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        a_pAllocator->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_sky, &m_skyMem);
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType                       = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image                       = m_sky;
+        viewInfo.viewType                    = VK_IMAGE_VIEW_TYPE_CUBE;
+        viewInfo.format                      = imageInfo.format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 6;
+        VK_CHECK_RESULT(vkCreateImageView(a_device, &viewInfo, NULL, &m_skyView));
+
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        VK_CHECK_RESULT(vkCreateImageView(a_device, &viewInfo, NULL, &m_skyFacesView));
+    }
+
+    // copy: 0 - the depth, 1 - level 0; reduce: 0 - level L-1, 1 - level L
+    //
+    {
+        VkDescriptorSetLayoutBinding bindings[2] = {};
+        bindings[0].binding         = 0;
+        bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding         = 1;
+        bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+        m_copySetLayout = a_pLayouts->get(std::vector<VkDescriptorSetLayoutBinding>(bindings, bindings + 2));
+    }
+    m_reduceSetLayout = a_pLayouts->get(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, VK_SHADER_STAGE_COMPUTE_BIT);
+    m_skySetLayout    = a_pLayouts->get(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    // set 1 of the water: 0 - scene copy, 1 - Hi-Z, 2 - sky
+    //
+    m_setLayout = a_pLayouts->get(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+    {
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        poolSize.descriptorCount = 1;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets       = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes    = &poolSize;
+        VK_CHECK_RESULT(vkCreateDescriptorPool(a_device, &poolInfo, NULL, &m_descriptorPool));
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool     = m_descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts        = &m_skySetLayout;
+        VK_CHECK_RESULT(vkAllocateDescriptorSets(a_device, &allocInfo, &m_skySet));
+
+        VkDescriptorImageInfo faces = {};
+        faces.imageView   = m_skyFacesView;
+        faces.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet write = imageWrite(m_skySet, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &faces);
+        vkUpdateDescriptorSets(a_device, 1, &write, 0, NULL);
+    }
+
+    m_copyLayout   = createPipelineLayout(a_device, m_copySetLayout, sizeof(hizParams));
+    m_reduceLayout = createPipelineLayout(a_device, m_reduceSetLayout, sizeof(hizParams));
+    m_skyLayout    = createPipelineLayout(a_device, m_skySetLayout, 0);
+
+    m_copyPipeline   = createComputePipeline(a_device, a_pipelineCache, m_copyLayout, (a_depthSamples != VK_SAMPLE_COUNT_1_BIT) ?
+                                             "../WaterApp/shaders/hizCopyMs.spv" : "../WaterApp/shaders/hizCopy.spv");
+    m_reducePipeline = createComputePipeline(a_device, a_pipelineCache, m_reduceLayout, "../WaterApp/shaders/hizReduce.spv");
+    m_skyPipeline    = createComputePipeline(a_device, a_pipelineCache, m_skyLayout, "../WaterApp/shaders/sky.spv");
+
+    setQuality(m_quality);
+}
+
+void waterReflections::destroy(VkDevice a_device, deviceAllocator* a_pAllocator)
+{
+    vkDestroyPipeline           (a_device, m_copyPipeline, NULL);
+    vkDestroyPipeline           (a_device, m_reducePipeline, NULL);
+    vkDestroyPipeline           (a_device, m_skyPipeline, NULL);
+    vkDestroyPipelineLayout     (a_device, m_copyLayout, NULL);
+    vkDestroyPipelineLayout     (a_device, m_reduceLayout, NULL);
+    vkDestroyPipelineLayout     (a_device, m_skyLayout, NULL);
+    vkDestroyDescriptorPool     (a_device, m_descriptorPool, NULL);
+    vkDestroyImageView          (a_device, m_skyView, NULL);
+    vkDestroyImageView          (a_device, m_skyFacesView, NULL);
+    vkDestroySampler            (a_device, m_linearSampler, NULL);
+    vkDestroySampler            (a_device, m_nearestSampler, NULL);
+
+    a_pAllocator->destroyImage(m_sky, m_skyMem);
+}
+
+void waterReflections::setQuality(reflectionQuality a_quality)
+{
+    m_quality    = a_quality;
+    m_steps      = g_presets[a_quality].maxSteps;
+    m_overCount  = 0;
+    m_underCount = 0;
+}
+
+uint32_t waterReflections::hizLevels() const
+{
+    return g_presets[m_quality].hizLevels;
+}
+
+bool waterReflections::update(double a_frameMs)
+{
+    const bool over  = a_frameMs > double(targetMs * downThreshold);
+    const bool under = a_frameMs < double(targetMs * upThreshold);
+
+    // a frame inside the band, or on the other side of it, restarts the count
+    //
+    if (!over)  m_overCount  = 0;
+    if (!under) m_underCount = 0;
+    if (!over && !under)
+        return false;
+
+    const uint32_t count = over ? ++m_overCount : ++m_underCount;
+    if (count < settleFrames)
+        return false;
+
+    m_overCount  = 0;
+    m_underCount = 0;
+
+    const reflectionPreset& preset = g_presets[m_quality];
+    const uint32_t newSteps = over ? std::max(preset.minSteps, m_steps * 3 / 4) : std::min(preset.maxSteps, m_steps + STEP_QUANTUM);
+    if (newSteps == m_steps)
+        return false;
+
+    m_steps = newSteps;
+    return true;
+}
+
+void waterReflections::uniforms(float a_out[4]) const
+{
+    const reflectionPreset& preset = g_presets[m_quality];
+    a_out[0] = float(m_steps);
+    a_out[1] = float(preset.hizLevels);
+    a_out[2] = preset.thickness;
+    a_out[3] = preset.refraction;
+}
+
+VkImageCreateInfo waterReflections::colorImageInfo(VkFormat a_format, VkExtent2D a_extent) const
+{
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = a_format;
+    imageInfo.extent        = { a_extent.width, a_extent.height, 1 };
+    imageInfo.mipLevels     = 1;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    return imageInfo;
+}
+
+VkImageCreateInfo waterReflections::hizImageInfo(VkExtent2D a_extent) const
+{
+    const uint32_t align = 1u << (HIZ_LEVELS - 1);
+
+    VkImageCreateInfo imageInfo = colorImageInfo(VK_FORMAT_R32_SFLOAT, a_extent);
+    imageInfo.extent.width  = (a_extent.width  + align - 1) / align * align;
+    imageInfo.extent.height = (a_extent.height + align - 1) / align * align;
+    imageInfo.mipLevels     = HIZ_LEVELS;
+    imageInfo.usage         = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    return imageInfo;
+}
+
+void waterReflections::cmdBakeSky(VkCommandBuffer a_cmdBuff)
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask                   = 0;
+    barrier.dstAccessMask                   = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout                       = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                           = m_sky;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount     = 1;
+    barrier.subresourceRange.layerCount     = 6;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+    const uint32_t groups = (SKY_SIZE + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+
+    vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_skyPipeline);
+    vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_skyLayout, 0, 1, &m_skySet, 0, NULL);
+    vkCmdDispatch          (a_cmdBuff, groups, groups, 6);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+void waterReflections::cmdCopyColor(VkCommandBuffer a_cmdBuff, VkImage a_scene, VkImage a_copy, VkExtent2D a_renderExtent)
+{
+    VkImageCopy region = {};
+    region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.layerCount = 1;
+    region.dstSubresource            = region.srcSubresource;
+    region.extent                    = { a_renderExtent.width, a_renderExtent.height, 1 };
+
+    vkCmdCopyImage(a_cmdBuff, a_scene, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, a_copy, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+void waterReflections::cmdBuildHiZ(VkCommandBuffer a_cmdBuff, VkDevice a_device, frameDescriptorPools* a_pPools, VkImageView a_depthView,
+                                   const VkImageView a_levels[HIZ_LEVELS], VkExtent2D a_renderExtent, VkExtent2D a_hizExtent)
+{
+    // level 0: the depth of the rendered part, the far plane (0) around it
+    //
+    {
+        VkDescriptorSet set = a_pPools->allocate(m_copySetLayout);
+
+        VkDescriptorImageInfo images[2] = {};
+        images[0].sampler     = m_nearestSampler;
+        images[0].imageView   = a_depthView;
+        images[0].imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        images[1].imageView   = a_levels[0];
+        images[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet writes[2] = { imageWrite(set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &images[0]),
+                                           imageWrite(set, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &images[1]) };
+        vkUpdateDescriptorSets(a_device, 2, writes, 0, NULL);
+
+        hizParams params = {};
+        params.size[0]    = int32_t(a_hizExtent.width);
+        params.size[1]    = int32_t(a_hizExtent.height);
+        params.srcSize[0] = int32_t(a_renderExtent.width);
+        params.srcSize[1] = int32_t(a_renderExtent.height);
+
+        vkCmdBindPipeline      (a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_copyPipeline);
+        vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_copyLayout, 0, 1, &set, 0, NULL);
+        vkCmdPushConstants     (a_cmdBuff, m_copyLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+        vkCmdDispatch          (a_cmdBuff, (a_hizExtent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, (a_hizExtent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+    }
+
+    // every further level the nearest of 2x2 texels of the previous one; the extent halves exactly
+    //
+    const uint32_t levels = hizLevels();
+    if (levels > 1)
+        vkCmdBindPipeline(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_reducePipeline);
+
+    for (uint32_t level = 1; level < levels; level++)
+    {
+        cmdLevelBarrier(a_cmdBuff);
+
+        VkDescriptorSet set = a_pPools->allocate(m_reduceSetLayout);
+
+        VkDescriptorImageInfo images[2] = {};
+        images[0].imageView   = a_levels[level - 1];
+        images[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        images[1].imageView   = a_levels[level];
+        images[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet writes[2] = { imageWrite(set, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &images[0]),
+                                           imageWrite(set, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &images[1]) };
+        vkUpdateDescriptorSets(a_device, 2, writes, 0, NULL);
+
+        hizParams params = {};
+        params.size[0]    = int32_t(a_hizExtent.width  >> level);
+        params.size[1]    = int32_t(a_hizExtent.height >> level);
+        params.srcSize[0] = int32_t(a_hizExtent.width  >> (level - 1));
+        params.srcSize[1] = int32_t(a_hizExtent.height >> (level - 1));
+
+        vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_reduceLayout, 0, 1, &set, 0, NULL);
+        vkCmdPushConstants     (a_cmdBuff, m_reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+        vkCmdDispatch          (a_cmdBuff, (uint32_t(params.size[0]) + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                                           (uint32_t(params.size[1]) + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1);
+    }
+}
+
+VkDescriptorSet waterReflections::writeSet(VkDevice a_device, frameDescriptorPools* a_pPools, VkImageView a_copyView, VkImageView a_hizView) const
+{
+    VkDescriptorSet set = a_pPools->allocate(m_setLayout);
+
+    // the shader fetches the Hi-Z texels directly, the copy and the sky are filtered
+    //
+    VkDescriptorImageInfo images[3] = {};
+    images[0].sampler     = m_linearSampler;
+    images[0].imageView   = a_copyView;
+    images[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    images[1].sampler     = m_nearestSampler;
+    images[1].imageView   = a_hizView;
+    images[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    images[2].sampler     = m_linearSampler;
+    images[2].imageView   = m_skyView;
+    images[2].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet writes[3];
+    for (uint32_t i = 0; i < 3; i++)
+        writes[i] = imageWrite(set, i, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &images[i]);
+    vkUpdateDescriptorSets(a_device, 3, writes, 0, NULL);
+    return set;
+}
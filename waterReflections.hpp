@@ -0,0 +1,136 @@
+#ifndef WATERAPP_WATERREFLECTIONS_HPP
+#define WATERAPP_WATERREFLECTIONS_HPP
+#include <vulkan/vulkan.hpp>
+
+#include "descriptorCache.hpp"
+#include "deviceAllocator.hpp"
+
+namespace app
+{
+
+enum reflectionQuality
+{
+    REFLECTIONS_OFF = 0,       // the water shades itself, no scene copies
+    REFLECTIONS_LOW,           // short rays over a shallow Hi-Z chain, no refraction
+    REFLECTIONS_MEDIUM,
+    REFLECTIONS_HIGH,
+    REFLECTION_QUALITY_COUNT,
+};
+
+const char* reflectionQualityName(reflectionQuality a_quality);
+bool        parseReflectionQuality(const char* a_name, reflectionQuality* a_pQuality);
+
+// Push constants of shaders/hiz.comp, keep in sync with the shader.
+//
+struct hizParams
+{
+    int32_t size[2];      // of the level being written
+    int32_t srcSize[2];   // copy: the rendered part of the depth; reduce: the previous level
+};
+
+// Screen-space reflections and refraction of the water. The scene is drawn in two render passes, the opaque
+// objects first and the water over them; between the two this module takes the inputs of the water shading:
+//
+//   scene copy - the color of the opaque pass, the water samples it for what it reflects and what lies beneath
+//   Hi-Z       - the opaque depth and a mip chain of it, every texel the nearest depth of the 2x2 texels below it
+//                (reverse-Z: the max). Level 0 is the depth itself, resolved to one sample by taking the nearest.
+//
+// fragment.frag (built with -DREFLECTIONS) marches the reflected ray through the chain: cells the ray passes
+// in front of the nearest surface are skipped whole and the walk climbs a level, anything else descends until
+// a single pixel decides. Rays that leave the screen or run out of steps fall back to a sky cube map, baked
+// once by shaders/sky.comp.
+//
+// The march length is the cost that matters; quality presets bound it, and update() moves it within the bounds
+// of the preset to keep the measured GPU frame within targetMs, like resolutionController: settleFrames
+// consecutive frames outside the [upThreshold, downThreshold] * targetMs band, then a quarter fewer steps at
+// once, or STEP_QUANTUM more.
+//
+class waterReflections
+{
+public:
+    static const uint32_t HIZ_LEVELS     = 8;     // of the Hi-Z image; a preset may build and march fewer
+    static const uint32_t WORKGROUP_SIZE = 8;     // local_size_x/y of hiz.comp and sky.comp
+    static const uint32_t SKY_SIZE       = 128;   // texels per cube face side
+    static const uint32_t STEP_QUANTUM   = 4;     // steps added per change, growing back is cautious
+
+    float    targetMs      = 16.0f;
+    float    upThreshold   = 0.80f;   // more steps while the frame takes less than targetMs * upThreshold
+    float    downThreshold = 1.00f;   // fewer steps while the frame takes more than targetMs * downThreshold
+    uint32_t settleFrames  = 8;
+
+    // a_depthSamples - of the depth attachment the Hi-Z chain is built from
+    //
+    void init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+              VkSampleCountFlagBits a_depthSamples);
+    void destroy(VkDevice a_device, deviceAllocator* a_pAllocator);
+
+    // the steps start at the most the preset allows
+    //
+    void              setQuality(reflectionQuality a_quality);
+    reflectionQuality quality() const { return m_quality; }
+    uint32_t          steps() const   { return m_steps; }
+    uint32_t          hizLevels() const;
+
+    // a_frameMs - whole GPU frame at the current step count. Returns true if the step count changed.
+    //
+    bool update(double a_frameMs);
+
+    // frameUniforms::reflections: x - steps, 0 - off; y - Hi-Z levels; z - thickness, w - refraction strength
+    //
+    void uniforms(float a_out[4]) const;
+
+    // the transient images of a frame, for a render target of a_extent: the scene copy and the Hi-Z chain, whose
+    // level 0 is a_extent rounded up so that every level halves the previous one exactly
+    //
+    VkImageCreateInfo colorImageInfo(VkFormat a_format, VkExtent2D a_extent) const;
+    VkImageCreateInfo hizImageInfo(VkExtent2D a_extent) const;
+
+    // Once, before the first frame: leaves the sky in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL for the fragment shader.
+    //
+    void cmdBakeSky(VkCommandBuffer a_cmdBuff);
+
+    // The inputs of a frame, in this order, between the two render passes. The scene must be in
+    // VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL and the copy in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL; the depth in
+    // VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL and all Hi-Z levels in VK_IMAGE_LAYOUT_GENERAL. The levels
+    // synchronise each other; ordering the outputs against their readers is the caller's business.
+    //
+    void cmdCopyColor(VkCommandBuffer a_cmdBuff, VkImage a_scene, VkImage a_copy, VkExtent2D a_renderExtent);
+    void cmdBuildHiZ (VkCommandBuffer a_cmdBuff, VkDevice a_device, frameDescriptorPools* a_pPools, VkImageView a_depthView,
+                      const VkImageView a_levels[HIZ_LEVELS], VkExtent2D a_renderExtent, VkExtent2D a_hizExtent);
+
+    // Set 1 of the reflecting water pipeline, from the current frame's pools: the scene copy and the Hi-Z chain in
+    // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, and the sky.
+    //
+    VkDescriptorSet       writeSet(VkDevice a_device, frameDescriptorPools* a_pPools, VkImageView a_copyView, VkImageView a_hizView) const;
+    VkDescriptorSetLayout setLayout() const { return m_setLayout; }
+
+private:
+    reflectionQuality     m_quality    = REFLECTIONS_MEDIUM;
+    uint32_t              m_steps      = 0;
+    uint32_t              m_overCount  = 0;
+    uint32_t              m_underCount = 0;
+
+    VkSampler             m_linearSampler  = VK_NULL_HANDLE;   // clamped to the edge
+    VkSampler             m_nearestSampler = VK_NULL_HANDLE;
+
+    VkImage               m_sky = VK_NULL_HANDLE;   // cube, RGBA8
+    deviceAllocation      m_skyMem;
+    VkImageView           m_skyView      = VK_NULL_HANDLE;   // cube, sampled
+    VkImageView           m_skyFacesView = VK_NULL_HANDLE;   // 2D array, the bake writes it
+    VkDescriptorPool      m_descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet       m_skySet         = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout m_copySetLayout   = VK_NULL_HANDLE;   // owned by the descriptorLayoutCache
+    VkDescriptorSetLayout m_reduceSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_skySetLayout    = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout       = VK_NULL_HANDLE;
+    VkPipelineLayout      m_copyLayout     = VK_NULL_HANDLE;
+    VkPipelineLayout      m_reduceLayout   = VK_NULL_HANDLE;
+    VkPipelineLayout      m_skyLayout      = VK_NULL_HANDLE;
+    VkPipeline            m_copyPipeline   = VK_NULL_HANDLE;   // hizCopy.spv, or hizCopyMs.spv for multisampled depth
+    VkPipeline            m_reducePipeline = VK_NULL_HANDLE;
+    VkPipeline            m_skyPipeline    = VK_NULL_HANDLE;
+};
+
+}
+#endif // WATERAPP_WATERREFLECTIONS_HPP
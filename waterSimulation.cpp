@@ -0,0 +1,301 @@
+#include "createApp.hpp"
+
+using namespace std;
+using namespace app;
+
+void waterSimulation::init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+                           uint32_t a_gridSize, uint32_t a_frameCount, uint32_t a_graphicsFamily, uint32_t a_computeFamily)
+{
+    if (a_gridSize < MIN_GRID_SIZE || a_gridSize > MAX_GRID_SIZE)
+        throw std::runtime_error("[waterSimulation::init]: grid size is out of range!");
+
+    m_gridSize       = a_gridSize;
+    m_stepCount      = 0;
+    m_async          = (a_graphicsFamily != a_computeFamily);
+    m_graphicsFamily = a_graphicsFamily;
+    m_computeFamily  = a_computeFamily;
+
+    std::vector<uint32_t> sharedFamilies;
+    if (m_async)
+        sharedFamilies = { a_graphicsFamily, a_computeFamily };
+
+    for (int i = 0; i < 2; i++)
+    {
+        a_pAllocator->createBuffer(heightBufferSize(),
+                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_heights[i], &m_heightsMem[i], sharedFamilies);
+    }
+
+    if (m_async)
+    {
+        m_renderCopies.resize(a_frameCount);
+        m_renderCopiesMem.resize(a_frameCount);
+        for (uint32_t i = 0; i < a_frameCount; i++)
+        {
+            a_pAllocator->createBuffer(heightBufferSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_renderCopies[i], &m_renderCopiesMem[i]);
+        }
+    }
+
+    // compute reads binding 0 and updates binding 1 in place; the vertex shaders read renderBuffer() through the frame set
+    //
+    m_simSetLayout = a_pLayouts->get(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    {
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = 4;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets       = 2;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes    = &poolSize;
+        VK_CHECK_RESULT(vkCreateDescriptorPool(a_device, &poolInfo, NULL, &m_descriptorPool));
+
+        VkDescriptorSetLayout layouts[2] = { m_simSetLayout, m_simSetLayout };
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool     = m_descriptorPool;
+        allocInfo.descriptorSetCount = 2;
+        allocInfo.pSetLayouts        = layouts;
+        VK_CHECK_RESULT(vkAllocateDescriptorSets(a_device, &allocInfo, m_simSets));
+
+        VkDescriptorBufferInfo bufferInfos[2] = {};
+        for (int i = 0; i < 2; i++)
+        {
+            bufferInfos[i].buffer = m_heights[i];
+            bufferInfos[i].offset = 0;
+            bufferInfos[i].range  = VK_WHOLE_SIZE;
+        }
+
+        VkWriteDescriptorSet writes[4];
+        for (size_t i = 0; i < 4; i++)
+        {
+            writes[i]                 = VkWriteDescriptorSet();
+            writes[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        writes[0].dstSet = m_simSets[0]; writes[0].dstBinding = 0; writes[0].pBufferInfo = &bufferInfos[0];
+        writes[1].dstSet = m_simSets[0]; writes[1].dstBinding = 1; writes[1].pBufferInfo = &bufferInfos[1];
+        writes[2].dstSet = m_simSets[1]; writes[2].dstBinding = 0; writes[2].pBufferInfo = &bufferInfos[1];
+        writes[3].dstSet = m_simSets[1]; writes[3].dstBinding = 1; writes[3].pBufferInfo = &bufferInfos[0];
+        vkUpdateDescriptorSets(a_device, 4, writes, 0, NULL);
+    }
+
+    {
+        VkPushConstantRange pushConstant = {};
+        pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstant.offset     = 0;
+        pushConstant.size       = sizeof(waterSimParams);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount         = 1;
+        pipelineLayoutInfo.pSetLayouts            = &m_simSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+        VK_CHECK_RESULT(vkCreatePipelineLayout(a_device, &pipelineLayoutInfo, NULL, &m_pipelineLayout));
+
+        auto           shaderCode   = vk_utils::readFile("../WaterApp/shaders/waterSim.spv");
+        VkShaderModule shaderModule = vk_utils::createShaderModule(a_device, shaderCode);
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shaderModule;
+        pipelineInfo.stage.pName  = "main";
+        pipelineInfo.layout       = m_pipelineLayout;
+
+        if (vkCreateComputePipelines(a_device, a_pipelineCache, 1, &pipelineInfo, NULL, &m_pipeline) != VK_SUCCESS)
+            throw std::runtime_error("[waterSimulation::init]: failed to create compute pipeline!");
+
+        vkDestroyShaderModule(a_device, shaderModule, NULL);
+    }
+}
+
+void waterSimulation::destroy(VkDevice a_device, deviceAllocator* a_pAllocator)
+{
+    vkDestroyPipeline           (a_device, m_pipeline, NULL);
+    vkDestroyPipelineLayout     (a_device, m_pipelineLayout, NULL);
+    vkDestroyDescriptorPool     (a_device, m_descriptorPool, NULL);
+
+    for (int i = 0; i < 2; i++)
+        a_pAllocator->destroyBuffer(m_heights[i], m_heightsMem[i]);
+    for (size_t i = 0; i < m_renderCopies.size(); i++)
+        a_pAllocator->destroyBuffer(m_renderCopies[i], m_renderCopiesMem[i]);
+
+    m_renderCopies.clear();
+    m_renderCopiesMem.clear();
+}
+
+void waterSimulation::cmdSimulate(VkCommandBuffer a_cmdBuff)
+{
+    // the caller's render graph orders heights[0] against the previous frame's readers and this frame's ones
+    //
+    cmdSteps(a_cmdBuff, 0, 0);
+}
+
+void waterSimulation::cmdSimulateAsync(VkCommandBuffer a_cmdBuff, uint32_t a_frame)
+{
+    // the previous frame's steps and its copy out of heights[0] ran on this queue in earlier submissions
+    //
+    VkMemoryBarrier previous = {};
+    previous.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    previous.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    previous.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &previous, 0, NULL, 0, NULL);
+
+    cmdSteps(a_cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+    // The render copy was last read by the graphics frame that used this slot, whose fence was waited before
+    // this submission. Its old contents are not needed, so it is overwritten without acquiring it back.
+    //
+    VkBufferCopy region = {};
+    region.size = heightBufferSize();
+    vkCmdCopyBuffer(a_cmdBuff, m_heights[0], m_renderCopies[a_frame], 1, &region);
+
+    VkBufferMemoryBarrier release = vk_utils::bufferBarrier(m_renderCopies[a_frame], VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+    release.srcQueueFamilyIndex = m_computeFamily;
+    release.dstQueueFamilyIndex = m_graphicsFamily;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 1, &release, 0, NULL);
+}
+
+void waterSimulation::cmdAcquire(VkCommandBuffer a_cmdBuff, uint32_t a_frame)
+{
+    VkBufferMemoryBarrier acquire = vk_utils::bufferBarrier(m_renderCopies[a_frame], 0, VK_ACCESS_SHADER_READ_BIT);
+    acquire.srcQueueFamilyIndex = m_computeFamily;
+    acquire.dstQueueFamilyIndex = m_graphicsFamily;
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, NULL, 1, &acquire, 0, NULL);
+}
+
+void waterSimulation::cmdLoadHeights(VkCommandBuffer a_cmdBuff, VkBuffer a_src)
+{
+    // earlier steps (and in sync mode the previous frame's vertex shader) are done with both buffers before the copies
+    //
+    const VkPipelineStageFlags previousStages = m_async ? (VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT)
+                                                        : (VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+    VkMemoryBarrier previous = {};
+    previous.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    previous.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    previous.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(a_cmdBuff, previousStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &previous, 0, NULL, 0, NULL);
+
+    VkBufferCopy region = {};
+    region.size = heightBufferSize();
+
+    VkBufferMemoryBarrier loaded[2];
+    for (int i = 0; i < 2; i++)
+    {
+        vkCmdCopyBuffer(a_cmdBuff, a_src, m_heights[i], 1, &region);
+        loaded[i] = vk_utils::bufferBarrier(m_heights[i], VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+    vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 2, loaded, 0, NULL);
+}
+
+void waterSimulation::cmdSteps(VkCommandBuffer a_cmdBuff, VkPipelineStageFlags a_lastDstStage, VkAccessFlags a_lastDstAccess)
+{
+    waterSimParams params = {};
+    params.gridSize   = m_gridSize;
+    params.waveSpeed2 = waveSpeed2;
+    params.damping    = damping;
+
+    const uint32_t groups = (m_gridSize + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+
+    vkCmdBindPipeline (a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdPushConstants(a_cmdBuff, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+
+    for (uint32_t step = 0; step < STEPS_PER_FRAME; step++)
+    {
+        const uint32_t src = step % 2;
+        const uint32_t dst = 1 - src;
+
+        vkCmdBindDescriptorSets(a_cmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_simSets[src], 0, NULL);
+        vkCmdDispatch(a_cmdBuff, groups, groups, 1);
+        m_stepCount++;
+
+        // the written buffer becomes the source of the next step, or the vertex shader (copy) input after the last one;
+        // no barrier after the last one for a_lastDstStage 0
+        //
+        const bool            last        = (step + 1 == STEPS_PER_FRAME);
+        if (last && a_lastDstStage == 0)
+            break;
+        VkBufferMemoryBarrier barrier     = vk_utils::bufferBarrier(m_heights[dst], VK_ACCESS_SHADER_WRITE_BIT,
+                                                                    last ? a_lastDstAccess : VK_ACCESS_SHADER_READ_BIT);
+        VkPipelineStageFlags  dstStages   = last ? a_lastDstStage : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        vkCmdPipelineBarrier(a_cmdBuff, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStages, 0, 0, NULL, 1, &barrier, 0, NULL);
+    }
+}
+
+void waterSimulation::initialHeights(std::vector<float>* a_pHeights) const
+{
+    // a few gaussian bumps of different size, so interference shows up right after start
+    //
+    struct bump { float x, y, radius, amplitude; };
+    const bump bumps[] = { { 0.30f, 0.35f, 0.04f,  1.0f },
+                           { 0.70f, 0.60f, 0.06f, -0.8f },
+                           { 0.50f, 0.80f, 0.02f,  0.6f } };
+
+    const uint32_t n = m_gridSize;
+    a_pHeights->assign(size_t(n) * n, 0.0f);
+
+    for (uint32_t y = 0; y < n; y++)
+    {
+        for (uint32_t x = 0; x < n; x++)
+        {
+            const float u = float(x) / float(n - 1);
+            const float v = float(y) / float(n - 1);
+
+            float h = 0.0f;
+            for (const bump& b : bumps)
+            {
+                const float d2 = (u - b.x) * (u - b.x) + (v - b.y) * (v - b.y);
+                h += b.amplitude * expf(-d2 / (b.radius * b.radius));
+            }
+            (*a_pHeights)[size_t(y) * n + x] = h;
+        }
+    }
+}
+
+void waterSimulation::buildGridMesh(uint32_t a_gridSize, uint32_t a_segments, meshSource* a_pMesh)
+{
+    const uint32_t quads = a_gridSize - 1;
+    const float    scale = 1.0f / float(quads);
+
+    a_pMesh->positionComponents = 2;
+    a_pMesh->positions.resize(size_t(a_gridSize) * a_gridSize * 2);
+    a_pMesh->normals.clear();
+    for (uint32_t y = 0; y < a_gridSize; y++)
+    {
+        for (uint32_t x = 0; x < a_gridSize; x++)
+        {
+            a_pMesh->positions[(size_t(y) * a_gridSize + x) * 2 + 0] = float(x) * scale;
+            a_pMesh->positions[(size_t(y) * a_gridSize + x) * 2 + 1] = float(y) * scale;
+        }
+    }
+
+    a_pMesh->indices.resize(size_t(quads) * quads * 6);
+    uint32_t* out = a_pMesh->indices.data();
+    for (uint32_t y = 0; y < quads; y++)
+    {
+        for (uint32_t x = 0; x < quads; x++)
+        {
+            const uint32_t i00 = y * a_gridSize + x, i10 = i00 + 1;
+            const uint32_t i01 = i00 + a_gridSize,   i11 = i01 + 1;
+
+            const uint32_t quad[6] = { i00, i10, i11,  i00, i11, i01 };
+            memcpy(out, quad, sizeof(quad));
+            out += 6;
+        }
+    }
+
+    a_segments = std::max(1u, std::min(a_segments, quads));
+    a_pMesh->segments.resize(a_segments);
+    for (uint32_t s = 0; s < a_segments; s++)
+        a_pMesh->segments[s] = uint32_t(uint64_t(s) * quads / a_segments) * quads * 2;
+}
@@ -0,0 +1,115 @@
+#ifndef WATERAPP_WATERSIMULATION_HPP
+#define WATERAPP_WATERSIMULATION_HPP
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+#include "descriptorCache.hpp"
+#include "deviceAllocator.hpp"
+#include "gpuMesh.hpp"
+
+namespace app
+{
+
+// Push constants of shaders/waterSim.comp, keep in sync with the shader.
+//
+struct waterSimParams
+{
+    uint32_t gridSize;
+    float    waveSpeed2;  // (c * dt / dx)^2, must stay below 0.5 for the explicit scheme to be stable
+    float    damping;
+    float    pad;
+};
+
+// Push constants of shaders/vertex.vert, keep in sync with the shader.
+//
+struct waterRenderParams
+{
+    uint32_t gridSize;
+    float    heightScale;
+};
+
+// Wave-equation heightfield on a gridSize x gridSize grid, integrated on the GPU by a compute shader.
+//
+//   h(t+1) = (2 h(t) - h(t-1) + waveSpeed2 * laplacian(h(t))) * damping
+//
+// Two storage buffers are ping-ponged: a step reads the current heights from one buffer and overwrites the
+// previous heights in the other one in place (every invocation touches only its own cell of that buffer).
+// A frame always runs an even number of steps, so heightBuffer(0) holds the newest heights after every frame
+// and command buffers can be recorded once with fixed descriptor sets.
+//
+// With a separate compute queue family the steps run on that queue and the result is copied into a render copy
+// per frame in flight, handed over to the graphics family with a release/acquire pair. The next frame's steps
+// then overlap this frame's rendering, which reads only its own copy. The ping-pong buffers are shared
+// concurrently, since the initial upload and readbacks go through the graphics queue.
+//
+class waterSimulation
+{
+public:
+    static const uint32_t MIN_GRID_SIZE   = 2;
+    static const uint32_t MAX_GRID_SIZE   = 2048;  // the non-indexed grid mesh is ~200 MB at this size, ~80 MB with 16 bit indices
+    static const uint32_t WORKGROUP_SIZE  = 16;   // local_size_x/y of waterSim.comp
+    static const uint32_t STEPS_PER_FRAME = 2;
+
+    float waveSpeed2 = 0.25f;
+    float damping    = 0.998f;
+
+    // a_computeFamily != a_graphicsFamily enables the async mode with a_frameCount render copies
+    //
+    void init(deviceAllocator* a_pAllocator, descriptorLayoutCache* a_pLayouts, VkDevice a_device, VkPipelineCache a_pipelineCache,
+              uint32_t a_gridSize, uint32_t a_frameCount, uint32_t a_graphicsFamily, uint32_t a_computeFamily);
+    void destroy(VkDevice a_device, deviceAllocator* a_pAllocator);
+
+    // Records STEPS_PER_FRAME steps. Synchronising heightBuffer(0) with its readers before and after is the
+    // caller's business (the render graph's simulation pass).
+    //
+    void cmdSimulate(VkCommandBuffer a_cmdBuff);
+
+    // Async mode. cmdSimulateAsync() goes to a compute queue command buffer: the steps, the copy into the frame's
+    // render copy and its release to the graphics family. cmdAcquire() goes to the graphics command buffer of the
+    // same frame, which must wait for the compute submission with a semaphore at the first stage reading the
+    // heights: the vertex shader, or the compute shader when particles are emitted from them.
+    //
+    void cmdSimulateAsync(VkCommandBuffer a_cmdBuff, uint32_t a_frame);
+    void cmdAcquire      (VkCommandBuffer a_cmdBuff, uint32_t a_frame);
+
+    // Overwrites both height buffers with a_src (heightBufferSize() bytes), so the water continues at rest from that
+    // state. Goes right before cmdSimulate() or cmdSimulateAsync(), into the same command buffer.
+    //
+    void cmdLoadHeights(VkCommandBuffer a_cmdBuff, VkBuffer a_src);
+
+    void initialHeights(std::vector<float>* a_pHeights) const;
+
+    // gridSize^2 vertices with grid coordinates in [0,1]^2, two triangles per quad, a_segments strips of quad rows
+    //
+    static void buildGridMesh(uint32_t a_gridSize, uint32_t a_segments, meshSource* a_pMesh);
+
+    uint32_t              gridSize() const          { return m_gridSize; }
+    VkDeviceSize          heightBufferSize() const  { return VkDeviceSize(m_gridSize) * m_gridSize * sizeof(float); }
+    VkBuffer              heightBuffer(int i) const { return m_heights[i]; }
+    VkBuffer              renderBuffer(uint32_t a_frame) const { return m_async ? m_renderCopies[a_frame] : m_heights[0]; }
+    bool                  async() const             { return m_async; }
+    uint64_t              stepCount() const         { return m_stepCount; }   // steps recorded since init()
+
+private:
+    void cmdSteps(VkCommandBuffer a_cmdBuff, VkPipelineStageFlags a_lastDstStage, VkAccessFlags a_lastDstAccess);
+
+    uint32_t              m_gridSize = 0;
+    uint64_t              m_stepCount = 0;
+    VkBuffer              m_heights[2]    = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+    deviceAllocation      m_heightsMem[2];
+
+    bool                  m_async          = false;
+    uint32_t              m_graphicsFamily = 0;
+    uint32_t              m_computeFamily  = 0;
+    std::vector<VkBuffer>         m_renderCopies;     // async mode, one per frame in flight
+    std::vector<deviceAllocation> m_renderCopiesMem;
+
+    VkDescriptorSetLayout m_simSetLayout    = VK_NULL_HANDLE;   // owned by the descriptorLayoutCache
+    VkDescriptorPool      m_descriptorPool  = VK_NULL_HANDLE;
+    VkDescriptorSet       m_simSets[2];     // [0]: heights[0] -> heights[1], [1]: heights[1] -> heights[0]
+    VkPipelineLayout      m_pipelineLayout  = VK_NULL_HANDLE;
+    VkPipeline            m_pipeline        = VK_NULL_HANDLE;
+};
+
+}
+#endif // WATERAPP_WATERSIMULATION_HPP